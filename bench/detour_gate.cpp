@@ -0,0 +1,125 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Measures the cycles per call of a trivial function when unhooked, and when
+// detoured by PatchDetour using the regular stub gate, the fast stub gate and
+// the fast stub gate with a statically bound detour. Each detour calls through
+// to the trampoline, so the difference from the unhooked case is the total
+// overhead of the hook.
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include <windows.h>
+#include <intrin.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/patcher.hpp>
+#include <hadesmem/process.hpp>
+
+namespace
+{
+int volatile g_addend = 1;
+int volatile g_sink = 0;
+
+extern "C" __declspec(noinline) int __stdcall Target(int a, int b)
+{
+  return a * g_addend + b * g_addend;
+}
+
+extern "C" int __stdcall TargetDetour(hadesmem::PatchDetourBase* patch,
+                                      int a,
+                                      int b)
+{
+  auto const orig = patch->GetTrampolineT<decltype(&Target)>();
+  return orig(a, b);
+}
+
+using TargetFn = decltype(&Target);
+
+double GetCyclesPerCall(TargetFn volatile const& target)
+{
+  std::uint32_t const kNumCalls = 10000000;
+
+  // Warm up (and check the detour actually forwards its arguments).
+  std::uint32_t result = 0;
+  for (std::uint32_t i = 0; i < 1000; ++i)
+  {
+    result += static_cast<std::uint32_t>(target(1, 2));
+  }
+  if (result != 3000)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(hadesmem::Error{}
+                                    << hadesmem::ErrorString{"Bad result."});
+  }
+
+  std::uint64_t const start = __rdtsc();
+  for (std::uint32_t i = 0; i < kNumCalls; ++i)
+  {
+    result += static_cast<std::uint32_t>(target(static_cast<int>(i), 1));
+  }
+  std::uint64_t const end = __rdtsc();
+
+  g_sink = static_cast<int>(result);
+
+  return static_cast<double>(end - start) / kNumCalls;
+}
+
+template <typename... Args>
+double GetCyclesPerCallDetoured(hadesmem::Process const& process,
+                                TargetFn volatile const& target,
+                                Args&&... args)
+{
+  hadesmem::PatchDetour<TargetFn> detour{
+    process, target, std::forward<Args>(args)...};
+  detour.Apply();
+  return GetCyclesPerCall(target);
+}
+}
+
+int main()
+{
+  try
+  {
+    hadesmem::Process const process{::GetCurrentProcessId()};
+
+    // Pin to one core so the TSC deltas are comparable.
+    ::SetThreadAffinityMask(::GetCurrentThread(), 1);
+    ::SetThreadPriority(::GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+    TargetFn volatile const target = &Target;
+
+    double const unhooked = GetCyclesPerCall(target);
+    double const regular =
+      GetCyclesPerCallDetoured(process, target, &TargetDetour);
+    double const fast =
+      GetCyclesPerCallDetoured(process,
+                               target,
+                               &TargetDetour,
+                               nullptr,
+                               hadesmem::PatchDetourFlags::kFastGate);
+    double const fast_static = GetCyclesPerCallDetoured(
+      process,
+      target,
+      hadesmem::StaticDetour<decltype(&TargetDetour), &TargetDetour>{});
+
+    std::cout << "Unhooked: " << unhooked << " cycles/call\n";
+    std::cout << "Regular gate: " << regular << " cycles/call ("
+              << regular - unhooked << " overhead)\n";
+    std::cout << "Fast gate: " << fast << " cycles/call ("
+              << fast - unhooked << " overhead)\n";
+    std::cout << "Fast gate, static detour: " << fast_static
+              << " cycles/call (" << fast_static - unhooked << " overhead)\n";
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,107 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Compares the cost of taking and dropping a detour reference (as every call
+// through a detour does) on a single shared atomic counter against a
+// ShardedRefCount, from 1 to 32 threads all hammering the same detour.
+
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/detour_ref_counter.hpp>
+#include <hadesmem/detail/sharded_ref_count.hpp>
+#include <hadesmem/error.hpp>
+
+namespace
+{
+double GetSeconds(LARGE_INTEGER const& start, LARGE_INTEGER const& end)
+{
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(end.QuadPart - start.QuadPart) /
+         static_cast<double>(frequency.QuadPart);
+}
+
+std::uint32_t const kNumIterations = 1000000;
+
+// Returns nanoseconds per reference taken, averaged over all threads.
+template <typename RefCountT>
+double Run(RefCountT& ref_count, std::uint32_t num_threads)
+{
+  std::atomic<std::uint32_t> num_ready{};
+  std::atomic<bool> go{false};
+  std::vector<std::thread> threads;
+  for (std::uint32_t i = 0; i < num_threads; ++i)
+  {
+    threads.emplace_back([&]()
+                         {
+                           ++num_ready;
+                           while (!go)
+                           {
+                             std::this_thread::yield();
+                           }
+
+                           for (std::uint32_t j = 0; j < kNumIterations; ++j)
+                           {
+                             auto const ref_counter =
+                               hadesmem::detail::MakeDetourRefCounter(
+                                 ref_count);
+                           }
+                         });
+  }
+
+  while (num_ready != num_threads)
+  {
+    std::this_thread::yield();
+  }
+
+  LARGE_INTEGER start;
+  ::QueryPerformanceCounter(&start);
+  go = true;
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  LARGE_INTEGER end;
+  ::QueryPerformanceCounter(&end);
+
+  return GetSeconds(start, end) * 1e9 /
+         (static_cast<double>(kNumIterations) * num_threads);
+}
+}
+
+int main()
+{
+  try
+  {
+    std::cout << "Threads  Atomic (ns/ref)  Sharded (ns/ref)  Speedup\n"
+              << std::fixed << std::setprecision(2);
+    for (std::uint32_t num_threads = 1; num_threads <= 32; num_threads *= 2)
+    {
+      std::atomic<std::uint32_t> atomic_ref_count{};
+      double const atomic_ns = Run(atomic_ref_count, num_threads);
+
+      hadesmem::detail::ShardedRefCount sharded_ref_count;
+      double const sharded_ns = Run(sharded_ref_count, num_threads);
+
+      std::cout << std::setw(7) << num_threads << std::setw(17) << atomic_ns
+                << std::setw(18) << sharded_ns << std::setw(8)
+                << atomic_ns / sharded_ns << "x\n";
+    }
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,191 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Measures latency from a message being queued to its callback having run
+// (and how long the producer is blocked for) for the cerberus input queue,
+// comparing the lock-free ring buffer against the original std::queue guarded
+// by a mutex which is held while callbacks run. The consumer periodically
+// simulates a slow callback to show the effect on the producer.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/spsc_ring_buffer.hpp>
+#include <hadesmem/error.hpp>
+
+namespace
+{
+struct Msg
+{
+  std::uint32_t id;
+  std::int64_t queued_time;
+};
+
+std::size_t const kNumMsgs = 200000;
+std::size_t const kSlowCallbackInterval = 10000;
+
+std::int64_t GetPerformanceCounter()
+{
+  LARGE_INTEGER counter{};
+  ::QueryPerformanceCounter(&counter);
+  return counter.QuadPart;
+}
+
+double ToMicroseconds(std::int64_t ticks)
+{
+  LARGE_INTEGER frequency{};
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(ticks) * 1000000.0 /
+         static_cast<double>(frequency.QuadPart);
+}
+
+void Spin(double us)
+{
+  std::int64_t const start = GetPerformanceCounter();
+  while (ToMicroseconds(GetPerformanceCounter() - start) < us)
+  {
+  }
+}
+
+struct Results
+{
+  std::vector<std::int64_t> latencies;
+  std::int64_t max_push_time;
+  std::size_t dropped;
+};
+
+void Callback(Msg const& msg, Results& results)
+{
+  if (msg.id % kSlowCallbackInterval == 0)
+  {
+    Spin(2000.0);
+  }
+  results.latencies.push_back(GetPerformanceCounter() - msg.queued_time);
+}
+
+template <typename PushFunc, typename DrainFunc>
+void Run(PushFunc push, DrainFunc drain, Results& results)
+{
+  results.latencies.reserve(kNumMsgs);
+  results.max_push_time = 0;
+  results.dropped = 0;
+
+  std::atomic<bool> done{false};
+  std::thread producer([&]()
+                       {
+    for (std::uint32_t i = 0; i < kNumMsgs; ++i)
+    {
+      std::int64_t const start = GetPerformanceCounter();
+      if (!push(Msg{i, start}))
+      {
+        ++results.dropped;
+      }
+      results.max_push_time =
+        (std::max)(results.max_push_time, GetPerformanceCounter() - start);
+      Spin(2.0);
+    }
+    done = true;
+  });
+
+  while (!done)
+  {
+    drain(results);
+  }
+  producer.join();
+  drain(results);
+}
+
+void Report(char const* name, Results& results)
+{
+  auto& latencies = results.latencies;
+  std::sort(std::begin(latencies), std::end(latencies));
+  auto const percentile = [&](double p)
+  {
+    return latencies.empty()
+             ? 0.0
+             : ToMicroseconds(latencies[static_cast<std::size_t>(
+                 p * static_cast<double>(latencies.size() - 1))]);
+  };
+  std::cout << name << ":\n"
+            << "  Processed: " << latencies.size() << "\n"
+            << "  Dropped: " << results.dropped << "\n"
+            << "  Latency p50 (us): " << percentile(0.5) << "\n"
+            << "  Latency p99 (us): " << percentile(0.99) << "\n"
+            << "  Latency max (us): " << percentile(1.0) << "\n"
+            << "  Producer max push time (us): "
+            << ToMicroseconds(results.max_push_time) << "\n";
+}
+}
+
+int main()
+{
+  try
+  {
+    {
+      std::queue<Msg> queue;
+      std::recursive_mutex mutex;
+      Results results;
+      Run([&](Msg const& msg)
+          {
+            std::lock_guard<std::recursive_mutex> lock{mutex};
+            queue.push(msg);
+            return true;
+          },
+          [&](Results& r)
+          {
+            std::lock_guard<std::recursive_mutex> lock{mutex};
+            while (!queue.empty())
+            {
+              Callback(queue.front(), r);
+              queue.pop();
+            }
+          },
+          results);
+      Report("std::queue + std::recursive_mutex", results);
+    }
+
+    {
+      auto queue =
+        std::make_unique<hadesmem::detail::SpscRingBuffer<Msg, 1024>>();
+      Results results;
+      Run([&](Msg const& msg)
+          {
+            return queue->TryPush(msg);
+          },
+          [&](Results& r)
+          {
+            std::size_t const kBatchSize = 64;
+            Msg batch[kBatchSize];
+            std::size_t count = 0;
+            while ((count = queue->TryPopBatch(batch, kBatchSize)) != 0)
+            {
+              for (std::size_t i = 0; i < count; ++i)
+              {
+                Callback(batch[i], r);
+              }
+            }
+          },
+          results);
+      Report("SpscRingBuffer (batched drain)", results);
+    }
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
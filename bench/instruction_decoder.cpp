@@ -0,0 +1,207 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Compares the instruction length decoder used by PatchDetour against udis86
+// (both with and without text formatting, the latter being what PatchDetour
+// used previously) by linearly sweeping the code sections of a loaded module.
+// Defaults to ntdll, or loads the module given on the command line.
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <udis86.h>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/instruction_decoder.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/section.hpp>
+#include <hadesmem/pelib/section_list.hpp>
+#include <hadesmem/process.hpp>
+
+namespace
+{
+struct CodeRegion
+{
+  std::uint8_t const* base;
+  std::size_t size;
+};
+
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+bool const kIs64 = true;
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+bool const kIs64 = false;
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+
+std::size_t volatile g_sink = 0;
+
+std::size_t DecodeFast(CodeRegion const& region)
+{
+  std::size_t count = 0;
+  for (std::size_t offset = 0; offset < region.size; ++count)
+  {
+    hadesmem::detail::InstructionInfo info;
+    bool const valid = hadesmem::detail::DecodeInstruction(
+      region.base + offset, region.size - offset, kIs64, info);
+    offset += valid ? info.len : 1;
+  }
+  return count;
+}
+
+std::size_t DecodeUdis86(CodeRegion const& region, bool format)
+{
+  ud_t ud_obj;
+  ud_init(&ud_obj);
+  ud_set_input_buffer(&ud_obj, region.base, region.size);
+  ud_set_syntax(&ud_obj, format ? UD_SYN_INTEL : nullptr);
+  ud_set_pc(&ud_obj, reinterpret_cast<std::uint64_t>(region.base));
+  ud_set_mode(&ud_obj, kIs64 ? 64 : 32);
+
+  std::size_t count = 0;
+  std::size_t chars = 0;
+  while (ud_disassemble(&ud_obj))
+  {
+    if (format)
+    {
+      char const* const asm_str = ud_insn_asm(&ud_obj);
+      char const* const asm_bytes_str = ud_insn_hex(&ud_obj);
+      chars += (asm_str ? std::char_traits<char>::length(asm_str) : 0) +
+               (asm_bytes_str ? std::char_traits<char>::length(asm_bytes_str)
+                              : 0);
+    }
+    ++count;
+  }
+
+  // Stop the formatting from being optimized away.
+  g_sink = g_sink + chars;
+
+  return count;
+}
+
+std::size_t DecodeUdis86NoFormat(CodeRegion const& region)
+{
+  return DecodeUdis86(region, false);
+}
+
+std::size_t DecodeUdis86Format(CodeRegion const& region)
+{
+  return DecodeUdis86(region, true);
+}
+
+double GetSeconds(LARGE_INTEGER const& start, LARGE_INTEGER const& end)
+{
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(end.QuadPart - start.QuadPart) /
+         static_cast<double>(frequency.QuadPart);
+}
+
+template <typename Func>
+void RunBenchmark(wchar_t const* name,
+                  std::vector<CodeRegion> const& regions,
+                  std::size_t iterations,
+                  Func func)
+{
+  std::size_t count = 0;
+  std::size_t bytes = 0;
+  LARGE_INTEGER start;
+  ::QueryPerformanceCounter(&start);
+  for (std::size_t i = 0; i < iterations; ++i)
+  {
+    count = 0;
+    for (auto const& region : regions)
+    {
+      count += func(region);
+      bytes += region.size;
+    }
+  }
+  LARGE_INTEGER end;
+  ::QueryPerformanceCounter(&end);
+
+  double const seconds = GetSeconds(start, end);
+  std::wcout << name << L": " << count << L" instructions, " << seconds
+             << L" s, "
+             << (static_cast<double>(bytes) / seconds / (1024.0 * 1024.0))
+             << L" MB/s, "
+             << (static_cast<double>(count) * iterations / seconds / 1000000.0)
+             << L" M instructions/s\n";
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    HMODULE module = nullptr;
+    if (argc > 1)
+    {
+      module = ::LoadLibraryExW(
+        hadesmem::detail::MultiByteToWideChar(argv[1]).c_str(),
+        nullptr,
+        DONT_RESOLVE_DLL_REFERENCES);
+    }
+    else
+    {
+      module = ::GetModuleHandleW(L"ntdll");
+    }
+
+    if (!module)
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(hadesmem::Error()
+                                      << hadesmem::ErrorString(
+                                           "Failed to load module.")
+                                      << hadesmem::ErrorCodeWinLast(last_error));
+    }
+
+    hadesmem::Process const process{::GetCurrentProcessId()};
+    hadesmem::PeFile const pe_file{
+      process, module, hadesmem::PeFileType::Image, 0};
+
+    std::vector<CodeRegion> regions;
+    std::size_t total_size = 0;
+    hadesmem::SectionList const sections{process, pe_file};
+    for (auto const& section : sections)
+    {
+      if (!(section.GetCharacteristics() & IMAGE_SCN_CNT_CODE))
+      {
+        continue;
+      }
+
+      CodeRegion const region = {
+        reinterpret_cast<std::uint8_t const*>(module) +
+          section.GetVirtualAddress(),
+        section.GetVirtualSize()};
+      regions.push_back(region);
+      total_size += region.size;
+    }
+
+    std::wcout << L"Code size: " << total_size << L" bytes in "
+               << regions.size() << L" section(s)\n";
+
+    std::size_t const kIterations = 10;
+    RunBenchmark(L"DecodeInstruction", regions, kIterations, &DecodeFast);
+    RunBenchmark(
+      L"udis86 (no syntax)", regions, kIterations, &DecodeUdis86NoFormat);
+    RunBenchmark(
+      L"udis86 (Intel syntax)", regions, kIterations, &DecodeUdis86Format);
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,151 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Compares reading many small scattered values from another process one call
+// at a time (process_vm_readv per value, and pread on /proc/<pid>/mem per
+// value) against batching them into iovecs with ReadScatter. The target is a
+// forked child, so no permissions are needed. The number of reads can be
+// given on the command line.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/read.hpp>
+
+namespace
+{
+template <typename Func> double Time(Func func)
+{
+  auto const start = std::chrono::steady_clock::now();
+  func();
+  auto const end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    std::size_t const num_reads =
+      argc > 1 ? static_cast<std::size_t>(std::strtoul(argv[1], nullptr, 10))
+               : 100000;
+    std::size_t const size = 64 << 20;
+    void* const mem = ::mmap(nullptr,
+                             size,
+                             PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS,
+                             -1,
+                             0);
+    if (mem == MAP_FAILED)
+    {
+      int const last_error = errno;
+      HADESMEM_DETAIL_THROW_EXCEPTION(hadesmem::Error{}
+                                      << hadesmem::ErrorString{"mmap failed."}
+                                      << hadesmem::ErrorCodeErrno{last_error});
+    }
+    auto const buffer = static_cast<std::uint64_t*>(mem);
+    std::size_t const count = size / sizeof(std::uint64_t);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      buffer[i] = i;
+    }
+
+    pid_t const child = ::fork();
+    if (child == 0)
+    {
+      for (;;)
+      {
+        ::pause();
+      }
+    }
+
+    std::mt19937 rng(0);
+    std::vector<std::uint64_t const*> addresses;
+    for (std::size_t i = 0; i < num_reads; ++i)
+    {
+      addresses.push_back(buffer + rng() % count);
+    }
+
+    hadesmem::procfs::Process const process{child};
+    std::vector<std::uint64_t> out(num_reads);
+
+    double const read_seconds = Time([&]()
+                                     {
+      for (std::size_t i = 0; i < num_reads; ++i)
+      {
+        out[i] = hadesmem::procfs::Read<std::uint64_t>(process, addresses[i]);
+      }
+    });
+    std::uint64_t read_sum = 0;
+    for (auto const v : out)
+    {
+      read_sum += v;
+    }
+
+    double const pread_seconds = Time([&]()
+                                      {
+      for (std::size_t i = 0; i < num_reads; ++i)
+      {
+        hadesmem::procfs::detail::ReadMem(
+          process, addresses[i], &out[i], sizeof(out[i]));
+      }
+    });
+
+    std::vector<hadesmem::procfs::ReadRequest> requests;
+    for (std::size_t i = 0; i < num_reads; ++i)
+    {
+      requests.push_back({addresses[i], &out[i], sizeof(out[i])});
+    }
+    std::fill(std::begin(out), std::end(out), 0);
+    double const scatter_seconds = Time([&]()
+                                        {
+      hadesmem::procfs::ReadScatter(process, requests);
+    });
+    std::uint64_t scatter_sum = 0;
+    for (auto const v : out)
+    {
+      scatter_sum += v;
+    }
+
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+
+    auto const per_read = [&](double seconds)
+    {
+      return seconds * 1e9 / static_cast<double>(num_reads);
+    };
+    std::cout << "Reads: " << num_reads << "\n";
+    std::cout << "Read (process_vm_readv): " << per_read(read_seconds)
+              << " ns/read\n";
+    std::cout << "pread (/proc/<pid>/mem): " << per_read(pread_seconds)
+              << " ns/read\n";
+    std::cout << "ReadScatter: " << per_read(scatter_seconds)
+              << " ns/read\n";
+    std::cout << "Speedup over Read: " << read_seconds / scatter_seconds
+              << "x\n";
+
+    return read_sum == scatter_sum ? 0 : 1;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,158 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Compares the cost of building a ModuleIndex against the per-query latency of
+// the index and of Find (std::search over the module sections), to show how
+// many queries it takes for the index to pay for itself. Patterns are taken
+// from random offsets in the code sections with some bytes wildcarded.
+// Defaults to ntdll, or uses the module given on the command line (which must
+// already be loaded, or be loadable by name).
+
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/module_index.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+namespace
+{
+double GetSeconds(LARGE_INTEGER const& start, LARGE_INTEGER const& end)
+{
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(end.QuadPart - start.QuadPart) /
+         static_cast<double>(frequency.QuadPart);
+}
+
+std::vector<std::wstring>
+  GeneratePatterns(hadesmem::Process const& process,
+                   hadesmem::detail::ModuleRegionInfo const& mod_info,
+                   std::size_t count)
+{
+  std::mt19937 rng(0);
+  std::vector<std::wstring> patterns;
+  auto const& regions = mod_info.code_regions;
+  while (patterns.size() < count)
+  {
+    auto const& region = regions[rng() % regions.size()];
+    std::size_t const size = static_cast<std::size_t>(region.second -
+                                                      region.first);
+    std::size_t const len = 8 + rng() % 24;
+    if (size <= len)
+    {
+      continue;
+    }
+
+    auto const bytes = hadesmem::ReadVector<std::uint8_t>(
+      process, region.first + rng() % (size - len), len);
+    std::wostringstream pattern;
+    pattern.imbue(std::locale::classic());
+    for (std::size_t i = 0; i < len; ++i)
+    {
+      if (i)
+      {
+        pattern << L' ';
+      }
+      if (rng() % 4 == 0)
+      {
+        pattern << L"??";
+      }
+      else
+      {
+        pattern << std::hex << std::uppercase << std::setw(2)
+                << std::setfill(L'0') << static_cast<unsigned>(bytes[i]);
+      }
+    }
+    patterns.push_back(pattern.str());
+  }
+  return patterns;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    std::wstring const module =
+      argc > 1 ? hadesmem::detail::MultiByteToWideChar(argv[1])
+               : std::wstring{L"ntdll.dll"};
+    if (argc > 1 && !::GetModuleHandleW(module.c_str()) &&
+        !::LoadLibraryExW(
+          module.c_str(), nullptr, DONT_RESOLVE_DLL_REFERENCES))
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(hadesmem::Error()
+                                      << hadesmem::ErrorString(
+                                           "Failed to load module.")
+                                      << hadesmem::ErrorCodeWinLast(last_error));
+    }
+
+    hadesmem::Process const process{::GetCurrentProcessId()};
+    auto const mod_info = hadesmem::detail::GetModuleInfo(process, module);
+    std::size_t const kNumPatterns = 100;
+    auto const patterns = GeneratePatterns(process, mod_info, kNumPatterns);
+
+    LARGE_INTEGER start;
+    ::QueryPerformanceCounter(&start);
+    hadesmem::ModuleIndex const index{process, module};
+    LARGE_INTEGER end;
+    ::QueryPerformanceCounter(&end);
+    double const build_seconds = GetSeconds(start, end);
+
+    ::QueryPerformanceCounter(&start);
+    std::size_t index_found = 0;
+    for (auto const& pattern : patterns)
+    {
+      index_found += !!index.Find(pattern, hadesmem::PatternFlags::kNone, 0U);
+    }
+    ::QueryPerformanceCounter(&end);
+    double const index_seconds = GetSeconds(start, end);
+
+    ::QueryPerformanceCounter(&start);
+    std::size_t search_found = 0;
+    for (auto const& pattern : patterns)
+    {
+      search_found += !!hadesmem::Find(
+        process, module, pattern, hadesmem::PatternFlags::kNone, 0U);
+    }
+    ::QueryPerformanceCounter(&end);
+    double const search_seconds = GetSeconds(start, end);
+
+    double const index_query = index_seconds / kNumPatterns;
+    double const search_query = search_seconds / kNumPatterns;
+    std::wcout << L"Module: " << module << L"\n";
+    std::wcout << L"Build: " << build_seconds * 1000.0 << L" ms\n";
+    std::wcout << L"ModuleIndex::Find: " << index_query * 1000.0
+               << L" ms/query (" << index_found << L" found)\n";
+    std::wcout << L"Find: " << search_query * 1000.0 << L" ms/query ("
+               << search_found << L" found)\n";
+    if (search_query > index_query)
+    {
+      std::wcout << L"Break even after "
+                 << build_seconds / (search_query - index_query)
+                 << L" queries\n";
+    }
+
+    return index_found == search_found ? 0 : 1;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
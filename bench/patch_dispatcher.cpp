@@ -0,0 +1,150 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Compares five hooks on one function installed as chained PatchDetours
+// against the same hooks registered as handlers on a single PatchDispatcher.
+// Measures the cycles per call through all five hooks, and the time taken to
+// install and then remove all five.
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <windows.h>
+#include <intrin.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/patcher.hpp>
+#include <hadesmem/process.hpp>
+
+namespace
+{
+int volatile g_addend = 1;
+int volatile g_sink = 0;
+
+extern "C" __declspec(noinline) int __stdcall Target(int a, int b)
+{
+  return a * g_addend + b * g_addend;
+}
+
+using TargetFn = decltype(&Target);
+using DetourT = hadesmem::PatchDetour<TargetFn>;
+using DispatcherT = hadesmem::PatchDispatcher<TargetFn>;
+
+std::size_t const kNumHooks = 5;
+
+double GetSeconds(LARGE_INTEGER const& start, LARGE_INTEGER const& end)
+{
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(end.QuadPart - start.QuadPart) /
+         static_cast<double>(frequency.QuadPart);
+}
+
+double GetCyclesPerCall(TargetFn volatile const& target)
+{
+  std::uint32_t const kNumCalls = 1000000;
+
+  std::uint32_t result = 0;
+  std::uint64_t const start = __rdtsc();
+  for (std::uint32_t i = 0; i < kNumCalls; ++i)
+  {
+    result += static_cast<std::uint32_t>(target(static_cast<int>(i), 1));
+  }
+  std::uint64_t const end = __rdtsc();
+
+  g_sink = static_cast<int>(result);
+
+  return static_cast<double>(end - start) / kNumCalls;
+}
+}
+
+int main()
+{
+  try
+  {
+    hadesmem::Process const process{::GetCurrentProcessId()};
+
+    TargetFn volatile const target = &Target;
+
+    double const unhooked = GetCyclesPerCall(target);
+
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+
+    ::QueryPerformanceCounter(&start);
+    std::vector<std::unique_ptr<DetourT>> detours;
+    for (std::size_t i = 0; i < kNumHooks; ++i)
+    {
+      detours.emplace_back(std::make_unique<DetourT>(
+        process,
+        target,
+        [](hadesmem::PatchDetourBase* patch, int a, int b)
+        {
+          return patch->GetTrampolineT<TargetFn>()(a, b);
+        }));
+      detours.back()->Apply();
+    }
+    ::QueryPerformanceCounter(&end);
+    double const chained_install = GetSeconds(start, end);
+
+    double const chained = GetCyclesPerCall(target);
+
+    ::QueryPerformanceCounter(&start);
+    while (!detours.empty())
+    {
+      detours.back()->Remove();
+      detours.pop_back();
+    }
+    ::QueryPerformanceCounter(&end);
+    double const chained_remove = GetSeconds(start, end);
+
+    DispatcherT dispatcher{process, target};
+    dispatcher.Apply();
+
+    ::QueryPerformanceCounter(&start);
+    std::vector<std::size_t> ids;
+    for (std::size_t i = 0; i < kNumHooks; ++i)
+    {
+      ids.push_back(
+        dispatcher.Register([](DispatcherT::Next const& next, int a, int b)
+                            {
+                              return next(a, b);
+                            }));
+    }
+    ::QueryPerformanceCounter(&end);
+    double const dispatcher_install = GetSeconds(start, end);
+
+    double const dispatched = GetCyclesPerCall(target);
+
+    ::QueryPerformanceCounter(&start);
+    for (auto const id : ids)
+    {
+      dispatcher.Unregister(id);
+    }
+    ::QueryPerformanceCounter(&end);
+    double const dispatcher_remove = GetSeconds(start, end);
+
+    dispatcher.Remove();
+
+    std::cout << "Hooks: " << kNumHooks << "\n";
+    std::cout << "Unhooked: " << unhooked << " cycles/call\n";
+    std::cout << "Chained PatchDetour: " << chained << " cycles/call, "
+              << chained_install * 1e6 << " us install, "
+              << chained_remove * 1e6 << " us remove\n";
+    std::cout << "PatchDispatcher: " << dispatched << " cycles/call, "
+              << dispatcher_install * 1e6 << " us install, "
+              << dispatcher_remove * 1e6 << " us remove\n";
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,103 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Compares 10k small remote allocations (and their frees) made with one
+// VirtualAllocEx each through Allocator against the same allocations from a
+// RemoteArena, and shows how much of the target's address space each
+// reserves. Targets the current process, or the process with the ID given on
+// the command line.
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/remote_arena.hpp>
+
+namespace
+{
+double GetSeconds(LARGE_INTEGER const& start, LARGE_INTEGER const& end)
+{
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(end.QuadPart - start.QuadPart) /
+         static_cast<double>(frequency.QuadPart);
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    DWORD const pid = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                               : ::GetCurrentProcessId();
+    hadesmem::Process const process{pid};
+
+    std::size_t const kNumAllocs = 10000;
+    std::mt19937 rng(0);
+    std::vector<SIZE_T> sizes;
+    for (std::size_t i = 0; i < kNumAllocs; ++i)
+    {
+      sizes.push_back(8 + rng() % 248);
+    }
+
+    LARGE_INTEGER start;
+    ::QueryPerformanceCounter(&start);
+    {
+      std::vector<std::unique_ptr<hadesmem::Allocator>> allocators;
+      allocators.reserve(kNumAllocs);
+      for (auto const size : sizes)
+      {
+        allocators.emplace_back(
+          std::make_unique<hadesmem::Allocator>(process, size));
+      }
+    }
+    LARGE_INTEGER end;
+    ::QueryPerformanceCounter(&end);
+    double const allocator_seconds = GetSeconds(start, end);
+
+    hadesmem::RemoteArenaStats stats{};
+    ::QueryPerformanceCounter(&start);
+    {
+      hadesmem::RemoteArena arena{process};
+      std::vector<hadesmem::Allocator> allocators;
+      allocators.reserve(kNumAllocs);
+      for (auto const size : sizes)
+      {
+        allocators.emplace_back(arena.Allocate(size));
+      }
+      stats = arena.GetStats();
+      allocators.clear();
+    }
+    ::QueryPerformanceCounter(&end);
+    double const arena_seconds = GetSeconds(start, end);
+
+    SYSTEM_INFO system_info{};
+    ::GetSystemInfo(&system_info);
+    std::cout << "Allocations: " << kNumAllocs << "\n";
+    std::cout << "Allocator: " << allocator_seconds * 1000.0 << " ms, "
+              << kNumAllocs * system_info.dwAllocationGranularity / 1024
+              << " KB reserved\n";
+    std::cout << "RemoteArena: " << arena_seconds * 1000.0 << " ms, "
+              << stats.reserved / 1024 << " KB reserved, "
+              << stats.committed / 1024 << " KB committed, "
+              << stats.num_remote_allocs << " VirtualAllocEx calls\n";
+    std::cout << "Speedup: " << allocator_seconds / arena_seconds << "x\n";
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
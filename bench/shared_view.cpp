@@ -0,0 +1,102 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Bulk reads of 64KB to 8MB through ReadVector (ReadProcessMemory) compared
+// against copying the same data out of a SharedView, both directly and under
+// a SeqLock. The target is the current process, so ReadVector doesn't pay for
+// crossing into another address space and the gap is a lower bound. The
+// shared view copies go into a preallocated buffer, whereas ReadVector also
+// allocates its result, as a caller of it would.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+#include <hadesmem/shared_view.hpp>
+
+#include "suite.hpp"
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    hadesmem::bench::Suite suite{"shared_view", argc, argv};
+    hadesmem::Process const process{::GetCurrentProcessId()};
+
+    std::size_t const kMaxSize = 8 << 20;
+    hadesmem::SharedView view{process, sizeof(hadesmem::SeqLock) + kMaxSize};
+    auto const lock = static_cast<hadesmem::SeqLock*>(view.GetBase());
+    auto const local = static_cast<std::uint8_t*>(view.GetBase()) +
+                       sizeof(hadesmem::SeqLock);
+    auto const remote = static_cast<std::uint8_t*>(view.GetRemoteBase()) +
+                        sizeof(hadesmem::SeqLock);
+    for (std::size_t i = 0; i < kMaxSize; ++i)
+    {
+      local[i] = static_cast<std::uint8_t>(i * 7);
+    }
+
+    std::vector<std::uint8_t> buffer(kMaxSize);
+    for (std::size_t size = 64 << 10; size <= kMaxSize; size *= 4)
+    {
+      std::size_t const ops = size >= (1 << 20) ? 4 : 32;
+      std::string const suffix = "/" + std::to_string(size);
+
+      suite.Run("ReadVector" + suffix,
+                ops,
+                [&]()
+                {
+                  for (std::size_t i = 0; i < ops; ++i)
+                  {
+                    auto const data =
+                      hadesmem::ReadVector<std::uint8_t>(process, remote, size);
+                    hadesmem::bench::DoNotOptimize(data[size - 1]);
+                  }
+                });
+
+      suite.Run("SharedView" + suffix,
+                ops,
+                [&]()
+                {
+                  for (std::size_t i = 0; i < ops; ++i)
+                  {
+                    std::memcpy(buffer.data(), local, size);
+                    hadesmem::bench::DoNotOptimize(buffer[size - 1]);
+                  }
+                });
+
+      suite.Run("SharedView/SeqLock" + suffix,
+                ops,
+                [&]()
+                {
+                  for (std::size_t i = 0; i < ops; ++i)
+                  {
+                    if (!hadesmem::TryReadSeqLocked(
+                          *lock, local, buffer.data(), size))
+                    {
+                      HADESMEM_DETAIL_THROW_EXCEPTION(
+                        hadesmem::Error{}
+                        << hadesmem::ErrorString{"TryReadSeqLocked failed."});
+                    }
+                    hadesmem::bench::DoNotOptimize(buffer[size - 1]);
+                  }
+                });
+    }
+
+    return suite.Report();
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
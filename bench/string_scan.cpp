@@ -0,0 +1,177 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Compares the single pass string scanner used by the dump tool against the
+// original implementation (three scalar passes using std::isprint). Scans
+// either a synthetic buffer or the file given on the command line.
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <locale>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/string_scan.hpp>
+#include <hadesmem/error.hpp>
+
+namespace
+{
+std::size_t const kMinStringLen = 3;
+
+std::size_t LegacyScanPass(std::uint8_t const* beg,
+                           std::uint8_t const* end,
+                           bool wide)
+{
+  std::size_t count = 0;
+  std::string buf;
+  std::locale const& loc = std::locale::classic();
+  auto const step = wide ? 2 : 1;
+  for (std::uint8_t const* current = beg; (current + step - 1) < end;
+       current += step)
+  {
+    bool const is_print = (wide ? *(current + 1) == 0 : true) &&
+                          std::isprint(static_cast<char>(*current), loc);
+    if (is_print)
+    {
+      buf += static_cast<char>(*current);
+    }
+
+    if (!is_print || current + step == end)
+    {
+      if (buf.size() >= kMinStringLen)
+      {
+        ++count;
+      }
+
+      buf.clear();
+    }
+  }
+  return count;
+}
+
+std::size_t LegacyScan(std::vector<std::uint8_t> const& data)
+{
+  auto const beg = data.data();
+  auto const end = beg + data.size();
+  return LegacyScanPass(beg, end, false) + LegacyScanPass(beg, end, true) +
+         LegacyScanPass(beg + 1, end, true);
+}
+
+std::size_t FastScan(std::vector<std::uint8_t> const& data)
+{
+  std::size_t count = 0;
+  hadesmem::detail::ScanStrings(
+    data.data(),
+    data.size(),
+    kMinStringLen,
+    [&](std::size_t, std::size_t, hadesmem::detail::StringEncoding)
+    {
+      ++count;
+    });
+  return count;
+}
+
+double GetSeconds(LARGE_INTEGER const& start, LARGE_INTEGER const& end)
+{
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(end.QuadPart - start.QuadPart) /
+         static_cast<double>(frequency.QuadPart);
+}
+
+template <typename Func>
+void RunBenchmark(wchar_t const* name,
+                  std::vector<std::uint8_t> const& data,
+                  std::size_t iterations,
+                  Func func)
+{
+  std::size_t count = 0;
+  LARGE_INTEGER start;
+  ::QueryPerformanceCounter(&start);
+  for (std::size_t i = 0; i < iterations; ++i)
+  {
+    count = func(data);
+  }
+  LARGE_INTEGER end;
+  ::QueryPerformanceCounter(&end);
+
+  double const seconds = GetSeconds(start, end);
+  double const bytes = static_cast<double>(data.size()) * iterations;
+  std::wcout << name << L": " << count << L" strings, " << seconds
+             << L" s, " << (bytes / seconds / (1024.0 * 1024.0 * 1024.0))
+             << L" GB/s\n";
+}
+
+std::vector<std::uint8_t> MakeSyntheticData(std::size_t len)
+{
+  // Mix of binary noise, narrow strings, and wide strings at both alignments
+  // (roughly what a typical PE file looks like).
+  std::vector<std::uint8_t> data(len);
+  std::uint32_t state = 0x12345678;
+  for (std::size_t i = 0; i < len;)
+  {
+    state = state * 1103515245U + 12345U;
+    std::size_t const run = 1 + ((state >> 16) % 32);
+    std::size_t const kind = (state >> 8) % 4;
+    for (std::size_t j = 0; j < run && i < len; ++j, ++i)
+    {
+      state = state * 1103515245U + 12345U;
+      std::uint8_t const c = static_cast<std::uint8_t>(state >> 24);
+      if (kind == 0)
+      {
+        data[i] = c;
+      }
+      else if (kind == 1)
+      {
+        data[i] = static_cast<std::uint8_t>(0x20 + c % 0x5F);
+      }
+      else
+      {
+        data[i] =
+          (i % 2 == kind % 2) ? static_cast<std::uint8_t>(0x20 + c % 0x5F) : 0;
+      }
+    }
+  }
+  return data;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    std::vector<std::uint8_t> data;
+    if (argc > 1)
+    {
+      std::ifstream file(argv[1], std::ios::binary);
+      data.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    }
+    else
+    {
+      data = MakeSyntheticData(64 * 1024 * 1024);
+    }
+
+    std::wcout << L"Buffer size: " << data.size() << L" bytes\n";
+    std::wcout << L"SSSE3: " << hadesmem::detail::IsSsse3Supported() << L"\n";
+
+    std::size_t const kIterations = 5;
+    RunBenchmark(L"Legacy (3 passes)", data, kIterations, &LegacyScan);
+    RunBenchmark(L"ScanStrings", data, kIterations, &FastScan);
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
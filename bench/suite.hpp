@@ -0,0 +1,258 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else // #if defined(_WIN32)
+#include <sched.h>
+#include <time.h>
+#endif // #if defined(_WIN32)
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/error.hpp>
+
+// Shared harness for the suite_* benchmarks. Each benchmark is run for a number
+// of samples (after discarding warm up samples), each sample performing a
+// fixed number of operations, and is reported as the median, 99th percentile,
+// minimum and mean time per operation. Inputs are generated from fixed seeds
+// and the thread is pinned to one CPU so that runs are comparable.
+//
+// Options:
+//   --samples <n>  Number of samples per benchmark (default 51).
+//   --filter <s>   Only run benchmarks whose name contains s.
+//   --json <path>  Also write the results as JSON to path ("-" for stdout).
+// The human readable table is always written to stderr.
+
+namespace hadesmem
+{
+namespace bench
+{
+struct Result
+{
+  std::string name;
+  std::size_t ops;
+  std::size_t samples;
+  double median_ns;
+  double p99_ns;
+  double min_ns;
+  double mean_ns;
+};
+
+inline std::uint64_t GetTimeNs()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  LARGE_INTEGER counter;
+  ::QueryPerformanceCounter(&counter);
+  std::uint64_t const ticks = static_cast<std::uint64_t>(counter.QuadPart);
+  std::uint64_t const freq = static_cast<std::uint64_t>(frequency.QuadPart);
+  return ticks / freq * 1000000000ULL + ticks % freq * 1000000000ULL / freq;
+#else  // #if defined(_WIN32)
+  timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL +
+         static_cast<std::uint64_t>(ts.tv_nsec);
+#endif // #if defined(_WIN32)
+}
+
+inline unsigned char volatile& GetSink()
+{
+  static unsigned char volatile sink = 0;
+  return sink;
+}
+
+// Keeps the compiler from discarding the computation of value, by reading it
+// through a volatile pointer.
+template <typename T> void DoNotOptimize(T const& value)
+{
+  GetSink() = *reinterpret_cast<unsigned char const volatile*>(&value);
+}
+
+// Nearest rank percentile of sorted, for p in (0, 1].
+inline double GetPercentile(std::vector<double> const& sorted, double p)
+{
+  HADESMEM_DETAIL_ASSERT(!sorted.empty());
+  auto rank = static_cast<std::size_t>(p * sorted.size() + 0.999999);
+  rank = (std::max)(rank, static_cast<std::size_t>(1));
+  return sorted[(std::min)(rank, sorted.size()) - 1];
+}
+
+inline std::string EscapeJson(std::string const& s)
+{
+  std::string escaped;
+  for (auto const c : s)
+  {
+    if (c == '"' || c == '\\')
+    {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+class Suite
+{
+public:
+  explicit Suite(std::string const& name, int argc, char* argv[])
+    : name_(name)
+  {
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+      std::string const option = argv[i];
+      if (option == "--samples")
+      {
+        num_samples_ = static_cast<std::size_t>(
+          (std::max)(std::strtoul(argv[i + 1], nullptr, 10), 1UL));
+      }
+      else if (option == "--filter")
+      {
+        filter_ = argv[i + 1];
+      }
+      else if (option == "--json")
+      {
+        json_path_ = argv[i + 1];
+      }
+      else
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Unknown option: " + option});
+      }
+    }
+
+    PinCurrentThread();
+
+    std::cerr << std::left << std::setw(40) << "Benchmark" << std::right
+              << std::setw(8) << "Ops" << std::setw(14) << "Median (ns)"
+              << std::setw(14) << "P99 (ns)" << std::setw(14) << "Min (ns)"
+              << '\n';
+  }
+
+  // Runs func once per sample. Each call must perform ops operations.
+  template <typename Func>
+  void Run(std::string const& name, std::size_t ops, Func func)
+  {
+    if (!filter_.empty() && name.find(filter_) == std::string::npos)
+    {
+      return;
+    }
+
+    for (std::size_t i = 0; i < kNumWarmUpSamples; ++i)
+    {
+      func();
+    }
+
+    std::vector<double> samples;
+    samples.reserve(num_samples_);
+    for (std::size_t i = 0; i < num_samples_; ++i)
+    {
+      std::uint64_t const start = GetTimeNs();
+      func();
+      std::uint64_t const end = GetTimeNs();
+      samples.push_back(static_cast<double>(end - start) /
+                        static_cast<double>(ops));
+    }
+
+    double const mean =
+      std::accumulate(std::begin(samples), std::end(samples), 0.0) /
+      static_cast<double>(samples.size());
+    std::sort(std::begin(samples), std::end(samples));
+    Result const result{name,
+                        ops,
+                        samples.size(),
+                        GetPercentile(samples, 0.5),
+                        GetPercentile(samples, 0.99),
+                        samples.front(),
+                        mean};
+    results_.push_back(result);
+
+    std::cerr << std::left << std::setw(40) << name << std::right
+              << std::setw(8) << ops << std::fixed << std::setprecision(1)
+              << std::setw(14) << result.median_ns << std::setw(14)
+              << result.p99_ns << std::setw(14) << result.min_ns << '\n';
+  }
+
+  std::vector<Result> const& GetResults() const
+  {
+    return results_;
+  }
+
+  // Writes the JSON report (if requested). Returns the process exit code.
+  int Report() const
+  {
+    if (json_path_.empty())
+    {
+      return 0;
+    }
+
+    if (json_path_ == "-")
+    {
+      WriteJson(std::cout);
+      return 0;
+    }
+
+    std::ofstream file(json_path_.c_str());
+    if (!file)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Failed to open JSON output file."});
+    }
+    WriteJson(file);
+    return file ? 0 : 1;
+  }
+
+private:
+  static std::size_t const kNumWarmUpSamples = 3;
+
+  static void PinCurrentThread()
+  {
+#if defined(_WIN32)
+    ::SetThreadAffinityMask(::GetCurrentThread(), 1);
+    ::SetThreadPriority(::GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+#else  // #if defined(_WIN32)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    ::sched_setaffinity(0, sizeof(cpus), &cpus);
+#endif // #if defined(_WIN32)
+  }
+
+  void WriteJson(std::ostream& out) const
+  {
+    out << "{\"suite\":\"" << EscapeJson(name_) << "\",\"results\":[";
+    for (std::size_t i = 0; i < results_.size(); ++i)
+    {
+      auto const& result = results_[i];
+      out << (i ? "," : "") << "\n  {\"name\":\"" << EscapeJson(result.name)
+          << "\",\"ops\":" << result.ops << ",\"samples\":" << result.samples
+          << std::fixed << std::setprecision(3)
+          << ",\"median_ns\":" << result.median_ns
+          << ",\"p99_ns\":" << result.p99_ns << ",\"min_ns\":" << result.min_ns
+          << ",\"mean_ns\":" << result.mean_ns << "}";
+    }
+    out << "\n]}\n";
+  }
+
+  std::string name_;
+  std::size_t num_samples_{51};
+  std::string filter_;
+  std::string json_path_;
+  std::vector<Result> results_;
+};
+}
+}
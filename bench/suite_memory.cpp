@@ -0,0 +1,193 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// Read and Write of single values and of vectors from 16 bytes to 1MB, and
+// (on Windows) Call and MultiCall round trips. The target is the current
+// process, so this measures the cost of the API calls and the copies rather
+// than of crossing into another address space. On Linux the procfs backend is
+// used.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else // #if defined(_WIN32)
+#include <unistd.h>
+#endif // #if defined(_WIN32)
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#if defined(_WIN32)
+#include <hadesmem/call.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+#include <hadesmem/write.hpp>
+#else // #if defined(_WIN32)
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/read.hpp>
+#include <hadesmem/linux/write.hpp>
+#endif // #if defined(_WIN32)
+
+#include "suite.hpp"
+
+namespace
+{
+#if defined(_WIN32)
+namespace mem = hadesmem;
+
+hadesmem::Process OpenSelf()
+{
+  return hadesmem::Process{::GetCurrentProcessId()};
+}
+
+extern "C" __declspec(noinline) DWORD_PTR __stdcall CallMe(DWORD_PTR a,
+                                                           DWORD_PTR b)
+{
+  return a + b;
+}
+#else  // #if defined(_WIN32)
+namespace mem = hadesmem::procfs;
+
+hadesmem::procfs::Process OpenSelf()
+{
+  return hadesmem::procfs::Process{::getpid()};
+}
+#endif // #if defined(_WIN32)
+
+std::size_t const kNumValueOps = 10000;
+
+std::vector<std::size_t> GetVectorSizes()
+{
+  return {16, 256, 4096, 65536, 1 << 20};
+}
+
+std::size_t GetVectorOps(std::size_t size)
+{
+  return size >= 65536 ? 10 : 1000;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    hadesmem::bench::Suite suite{"memory", argc, argv};
+    auto const process = OpenSelf();
+
+    std::vector<std::uint8_t> buffer(1 << 20);
+    for (std::size_t i = 0; i < buffer.size(); ++i)
+    {
+      buffer[i] = static_cast<std::uint8_t>(i * 7);
+    }
+    void* const address = buffer.data();
+
+    suite.Run("Read<uint32_t>",
+              kNumValueOps,
+              [&]()
+              {
+                std::uint32_t sum = 0;
+                for (std::size_t i = 0; i < kNumValueOps; ++i)
+                {
+                  sum += mem::Read<std::uint32_t>(process, address);
+                }
+                hadesmem::bench::DoNotOptimize(sum);
+              });
+
+    suite.Run("Read<array<uint8_t, 64>>",
+              kNumValueOps,
+              [&]()
+              {
+                for (std::size_t i = 0; i < kNumValueOps; ++i)
+                {
+                  auto const value =
+                    mem::Read<std::array<std::uint8_t, 64>>(process, address);
+                  hadesmem::bench::DoNotOptimize(value);
+                }
+              });
+
+    suite.Run("Write<uint32_t>",
+              kNumValueOps,
+              [&]()
+              {
+                for (std::size_t i = 0; i < kNumValueOps; ++i)
+                {
+                  mem::Write(process, address, static_cast<std::uint32_t>(i));
+                }
+              });
+
+    for (auto const size : GetVectorSizes())
+    {
+      std::size_t const ops = GetVectorOps(size);
+      suite.Run("ReadVector<uint8_t>/" + std::to_string(size),
+                ops,
+                [&]()
+                {
+                  for (std::size_t i = 0; i < ops; ++i)
+                  {
+                    auto const data =
+                      mem::ReadVector<std::uint8_t>(process, address, size);
+                    hadesmem::bench::DoNotOptimize(data);
+                  }
+                });
+
+      std::vector<std::uint8_t> const data(size, 0xCC);
+      suite.Run("WriteVector<uint8_t>/" + std::to_string(size),
+                ops,
+                [&]()
+                {
+                  for (std::size_t i = 0; i < ops; ++i)
+                  {
+                    mem::WriteVector(process, address, data);
+                  }
+                });
+    }
+
+#if defined(_WIN32)
+    std::size_t const kNumCallOps = 100;
+    suite.Run("Call",
+              kNumCallOps,
+              [&]()
+              {
+                for (std::size_t i = 0; i < kNumCallOps; ++i)
+                {
+                  auto const result = hadesmem::Call(
+                    process, &CallMe, hadesmem::CallConv::kStdCall, i, 1);
+                  hadesmem::bench::DoNotOptimize(result);
+                }
+              });
+
+    // Eight calls per round trip, to compare against eight separate Calls.
+    std::size_t const kNumMultiCallCalls = 8;
+    hadesmem::MultiCall multi_call{process};
+    for (std::size_t i = 0; i < kNumMultiCallCalls; ++i)
+    {
+      multi_call.Add(&CallMe, hadesmem::CallConv::kStdCall, i, 1);
+    }
+    suite.Run("MultiCall/8",
+              kNumCallOps,
+              [&]()
+              {
+                for (std::size_t i = 0; i < kNumCallOps; ++i)
+                {
+                  std::vector<hadesmem::CallResultRaw> results;
+                  multi_call.Call(std::back_inserter(results));
+                  hadesmem::bench::DoNotOptimize(results);
+                }
+              });
+#endif // #if defined(_WIN32)
+
+    return suite.Report();
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
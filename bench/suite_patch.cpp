@@ -0,0 +1,129 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// PatchDetour: the time to apply and remove a detour, and the time per call
+// of a trivial function when unhooked and when detoured through each kind of
+// stub gate. Each detour calls through to the trampoline, so the difference
+// from the unhooked case is the total overhead of the hook.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/patcher.hpp>
+#include <hadesmem/process.hpp>
+
+#include "suite.hpp"
+
+namespace
+{
+int volatile g_addend = 1;
+
+extern "C" __declspec(noinline) int __stdcall Target(int a, int b)
+{
+  return a * g_addend + b * g_addend;
+}
+
+extern "C" int __stdcall TargetDetour(hadesmem::PatchDetourBase* patch,
+                                      int a,
+                                      int b)
+{
+  auto const orig = patch->GetTrampolineT<decltype(&Target)>();
+  return orig(a, b);
+}
+
+using TargetFn = decltype(&Target);
+
+std::size_t const kNumCalls = 100000;
+
+void CallTarget(TargetFn volatile const& target)
+{
+  int result = 0;
+  for (std::size_t i = 0; i < kNumCalls; ++i)
+  {
+    result += target(static_cast<int>(i), 1);
+  }
+  hadesmem::bench::DoNotOptimize(result);
+}
+
+template <typename... Args>
+void RunDetoured(hadesmem::bench::Suite& suite,
+                 std::string const& name,
+                 hadesmem::Process const& process,
+                 TargetFn volatile const& target,
+                 Args&&... args)
+{
+  hadesmem::PatchDetour<TargetFn> detour{
+    process, target, std::forward<Args>(args)...};
+  detour.Apply();
+  suite.Run(name,
+            kNumCalls,
+            [&]()
+            {
+              CallTarget(target);
+            });
+  detour.Remove();
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    hadesmem::bench::Suite suite{"patch", argc, argv};
+    hadesmem::Process const process{::GetCurrentProcessId()};
+
+    TargetFn volatile const target = &Target;
+
+    // Each apply suspends the process and allocates a trampoline and stub
+    // gate near the target, so this is dominated by system calls.
+    std::size_t const kNumApplies = 20;
+    suite.Run("PatchDetour Apply+Remove",
+              kNumApplies,
+              [&]()
+              {
+                for (std::size_t i = 0; i < kNumApplies; ++i)
+                {
+                  hadesmem::PatchDetour<TargetFn> detour{
+                    process, target, &TargetDetour};
+                  detour.Apply();
+                  detour.Remove();
+                }
+              });
+
+    suite.Run("Call/unhooked",
+              kNumCalls,
+              [&]()
+              {
+                CallTarget(target);
+              });
+    RunDetoured(suite, "Call/regular gate", process, target, &TargetDetour);
+    RunDetoured(suite,
+                "Call/fast gate",
+                process,
+                target,
+                &TargetDetour,
+                nullptr,
+                hadesmem::PatchDetourFlags::kFastGate);
+    RunDetoured(
+      suite,
+      "Call/fast gate, static detour",
+      process,
+      target,
+      hadesmem::StaticDetour<decltype(&TargetDetour), &TargetDetour>{});
+
+    return suite.Report();
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,173 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// The platform independent kernels behind pattern scanning and detouring:
+// pattern parsing, FindMasked over synthetic buffers with rare and common
+// anchors, and instruction length decoding. On Linux, procfs Find over the
+// mappings of libc is also measured. Builds and runs on Windows and Linux.
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif // #if !defined(_WIN32)
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/instruction_decoder.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+#include <hadesmem/error.hpp>
+#if !defined(_WIN32)
+#include <hadesmem/linux/find_pattern.hpp>
+#include <hadesmem/linux/process.hpp>
+#endif // #if !defined(_WIN32)
+
+#include "suite.hpp"
+
+namespace
+{
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+bool const kIs64 = true;
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+bool const kIs64 = false;
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+
+std::size_t const kBufferSize = 16 << 20;
+
+// Patterns which never match, so every scan covers the whole buffer.
+wchar_t const* const kMissing = L"DE AD ?? BE EF ?? CA FE BA BE";
+wchar_t const* const kMissingCommon = L"00 00 ?? 00 00 ?? 00 00 DE AD";
+
+std::uint8_t const* FindMasked(std::vector<std::uint8_t> const& buffer,
+                               hadesmem::detail::MaskedPattern const& pattern)
+{
+  return hadesmem::detail::FindMasked(buffer.data(),
+                                      buffer.data() + buffer.size(),
+                                      pattern.value.data(),
+                                      pattern.mask.data(),
+                                      pattern.value.size(),
+                                      pattern.anchor_offset,
+                                      pattern.anchor_len);
+}
+
+hadesmem::detail::MaskedPattern GetPattern(wchar_t const* data)
+{
+  return hadesmem::detail::ConvertToMaskedPattern(
+    hadesmem::detail::ConvertData(data));
+}
+
+// Common prologue, call, branch and RIP-relative encodings repeated to fill a
+// buffer, so the decoder sees a realistic mix without needing a real image.
+std::vector<std::uint8_t> GetSyntheticCode()
+{
+  std::vector<std::uint8_t> const kCode = {
+    0x55,                                     // push rbp
+    0x48, 0x89, 0xE5,                         // mov rbp, rsp
+    0x48, 0x83, 0xEC, 0x20,                   // sub rsp, 0x20
+    0x48, 0x8B, 0x05, 0x10, 0x00, 0x00, 0x00, // mov rax, [rip+0x10]
+    0x85, 0xC0,                               // test eax, eax
+    0x74, 0x05,                               // jz +5
+    0xE8, 0x00, 0x10, 0x00, 0x00,             // call +0x1000
+    0x0F, 0x84, 0x00, 0x01, 0x00, 0x00,       // jz +0x100
+    0xC7, 0x44, 0x24, 0x08, 0x01, 0x00, 0x00, 0x00, // mov [rsp+8], 1
+    0xC5, 0xF8, 0x57, 0xC0,                   // vxorps xmm0, xmm0, xmm0
+    0x48, 0x83, 0xC4, 0x20,                   // add rsp, 0x20
+    0x5D,                                     // pop rbp
+    0xC3,                                     // ret
+    0xCC,                                     // int3
+  };
+
+  std::vector<std::uint8_t> code;
+  while (code.size() < (1 << 20))
+  {
+    code.insert(std::end(code), std::begin(kCode), std::end(kCode));
+  }
+  return code;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    hadesmem::bench::Suite suite{"pattern", argc, argv};
+
+    std::size_t const kNumParses = 10000;
+    suite.Run("ConvertData",
+              kNumParses,
+              [&]()
+              {
+                for (std::size_t i = 0; i < kNumParses; ++i)
+                {
+                  hadesmem::bench::DoNotOptimize(GetPattern(kMissing));
+                }
+              });
+
+    std::vector<std::uint8_t> random(kBufferSize);
+    std::mt19937 rng{0};
+    for (auto& b : random)
+    {
+      b = static_cast<std::uint8_t>(rng());
+    }
+    std::vector<std::uint8_t> const zeros(kBufferSize);
+
+    auto const missing = GetPattern(kMissing);
+    auto const missing_common = GetPattern(kMissingCommon);
+
+    suite.Run("FindMasked/random 16MB",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(FindMasked(random, missing));
+              });
+
+    suite.Run("FindMasked/zeros 16MB",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(
+                  FindMasked(zeros, missing_common));
+              });
+
+    auto const code = GetSyntheticCode();
+    suite.Run("DecodeInstruction/1MB",
+              1,
+              [&]()
+              {
+                std::size_t count = 0;
+                for (std::size_t offset = 0; offset < code.size(); ++count)
+                {
+                  hadesmem::detail::InstructionInfo info;
+                  bool const valid = hadesmem::detail::DecodeInstruction(
+                    code.data() + offset, code.size() - offset, kIs64, info);
+                  offset += valid ? info.len : 1;
+                }
+                hadesmem::bench::DoNotOptimize(count);
+              });
+
+#if !defined(_WIN32)
+    hadesmem::procfs::Process const process{::getpid()};
+    suite.Run("procfs Find/libc code",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(hadesmem::procfs::Find(
+                  process, "libc.so.6", kMissing, 0, 0));
+              });
+#endif // #if !defined(_WIN32)
+
+    return suite.Report();
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,343 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// pelib and pattern scanning on real images: export and import enumeration
+// of system modules (both mapped and as a data file read from disk), RvaToVa,
+// and Find over the code and data sections of ntdll. Find is also run over a
+// large synthetic buffer to measure the scan kernel without the module
+// lookup. RebaseImage is run over a local copy of ntdll, compared against
+// just walking the same relocations with RelocationList.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/pelib/export.hpp>
+#include <hadesmem/pelib/export_list.hpp>
+#include <hadesmem/pelib/import_dir.hpp>
+#include <hadesmem/pelib/import_dir_list.hpp>
+#include <hadesmem/pelib/import_thunk.hpp>
+#include <hadesmem/pelib/import_thunk_list.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/rebase.hpp>
+#include <hadesmem/pelib/relocation.hpp>
+#include <hadesmem/pelib/relocation_block.hpp>
+#include <hadesmem/pelib/relocation_block_list.hpp>
+#include <hadesmem/pelib/relocation_list.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+#include "suite.hpp"
+
+namespace
+{
+std::size_t EnumExports(hadesmem::Process const& process,
+                        hadesmem::PeFile const& pe_file)
+{
+  std::size_t count = 0;
+  for (auto const& e : hadesmem::ExportList{process, pe_file})
+  {
+    count += e.ByName() ? e.GetName().size() : 1;
+  }
+  return count;
+}
+
+std::size_t EnumImports(hadesmem::Process const& process,
+                        hadesmem::PeFile const& pe_file)
+{
+  std::size_t count = 0;
+  for (auto const& dir : hadesmem::ImportDirList{process, pe_file})
+  {
+    DWORD const ilt = dir.GetOriginalFirstThunk();
+    hadesmem::ImportThunkList const thunks{
+      process, pe_file, ilt ? ilt : dir.GetFirstThunk()};
+    for (auto const& thunk : thunks)
+    {
+      count += thunk.ByOrdinal() ? 1 : thunk.GetName().size();
+    }
+  }
+  return count;
+}
+
+std::size_t WalkRelocations(hadesmem::Process const& process,
+                            hadesmem::PeFile const& pe_file)
+{
+  std::size_t count = 0;
+  for (auto const& block : hadesmem::RelocationBlockList{process, pe_file})
+  {
+    hadesmem::RelocationList const relocs{process,
+                                          pe_file,
+                                          block.GetRelocationDataStart(),
+                                          block.GetNumberOfRelocations()};
+    for (auto const& reloc : relocs)
+    {
+      count += reloc.GetType() != IMAGE_REL_BASED_ABSOLUTE;
+    }
+  }
+  return count;
+}
+
+HMODULE GetModule(wchar_t const* name)
+{
+  HMODULE const module = ::GetModuleHandleW(name);
+  if (!module)
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error{} << hadesmem::ErrorString{"GetModuleHandleW failed."}
+                        << hadesmem::ErrorCodeWinLast{last_error});
+  }
+  return module;
+}
+
+std::vector<char> ReadModuleFile(hadesmem::Process const& process,
+                                 HMODULE module)
+{
+  auto const path = hadesmem::Module{process, module}.GetPath();
+  auto const file = hadesmem::detail::OpenFile<char>(
+    path, std::ios::in | std::ios::binary);
+  std::vector<char> data((std::istreambuf_iterator<char>(*file)),
+                         std::istreambuf_iterator<char>());
+  if (data.empty())
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error{} << hadesmem::ErrorString{"Failed to read module."});
+  }
+  return data;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    hadesmem::bench::Suite suite{"pelib", argc, argv};
+    hadesmem::Process const process{::GetCurrentProcessId()};
+
+    HMODULE const ntdll = GetModule(L"ntdll.dll");
+    HMODULE const kernel32 = GetModule(L"kernel32.dll");
+
+    suite.Run("PeFile/kernel32",
+              1000,
+              [&]()
+              {
+                for (std::size_t i = 0; i < 1000; ++i)
+                {
+                  hadesmem::PeFile const pe_file{
+                    process, kernel32, hadesmem::PeFileType::Image, 0};
+                  hadesmem::bench::DoNotOptimize(pe_file);
+                }
+              });
+
+    hadesmem::PeFile const ntdll_pe{
+      process, ntdll, hadesmem::PeFileType::Image, 0};
+    hadesmem::PeFile const kernel32_pe{
+      process, kernel32, hadesmem::PeFileType::Image, 0};
+
+    suite.Run("ExportList/ntdll",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(EnumExports(process, ntdll_pe));
+              });
+
+    suite.Run("ImportDirList/kernel32",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(
+                  EnumImports(process, kernel32_pe));
+              });
+
+    // Data files have to map each RVA through the section table, where
+    // images can just add it to the base.
+    auto kernel32_file = ReadModuleFile(process, kernel32);
+    hadesmem::PeFile const kernel32_data_pe{
+      process,
+      kernel32_file.data(),
+      hadesmem::PeFileType::Data,
+      static_cast<DWORD>(kernel32_file.size())};
+
+    suite.Run("ExportList/kernel32 (data)",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(
+                  EnumExports(process, kernel32_data_pe));
+              });
+
+    suite.Run("ImportDirList/kernel32 (data)",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(
+                  EnumImports(process, kernel32_data_pe));
+              });
+
+    std::vector<DWORD> rvas;
+    for (auto const& e : hadesmem::ExportList{process, kernel32_pe})
+    {
+      if (!e.IsForwarded())
+      {
+        rvas.push_back(e.GetRva());
+      }
+    }
+    std::shuffle(std::begin(rvas), std::end(rvas), std::mt19937{0});
+
+    suite.Run("RvaToVa (image)",
+              rvas.size(),
+              [&]()
+              {
+                for (auto const rva : rvas)
+                {
+                  hadesmem::bench::DoNotOptimize(
+                    hadesmem::RvaToVa(process, kernel32_pe, rva));
+                }
+              });
+
+    suite.Run("RvaToVa (data)",
+              rvas.size(),
+              [&]()
+              {
+                for (auto const rva : rvas)
+                {
+                  hadesmem::bench::DoNotOptimize(
+                    hadesmem::RvaToVa(process, kernel32_data_pe, rva));
+                }
+              });
+
+    // Each op moves the image away and back again, so every sample starts
+    // from the same state.
+    auto const ntdll_base = reinterpret_cast<std::uintptr_t>(ntdll);
+    auto const ntdll_moved = ntdll_base + 0x10000000;
+    auto ntdll_image = hadesmem::ReadVectorEx<std::uint8_t>(
+      process,
+      ntdll,
+      hadesmem::Module{process, ntdll}.GetSize(),
+      hadesmem::ReadFlags::kZeroFillReserved);
+
+    suite.Run("RelocationList/ntdll",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(
+                  WalkRelocations(process, ntdll_pe));
+              });
+
+    suite.Run("RebaseImage/ntdll",
+              2,
+              [&]()
+              {
+                hadesmem::RebaseImage(ntdll_image.data(),
+                                      ntdll_image.size(),
+                                      ntdll_base,
+                                      ntdll_moved);
+                hadesmem::bench::DoNotOptimize(
+                  hadesmem::RebaseImage(ntdll_image.data(),
+                                        ntdll_image.size(),
+                                        ntdll_moved,
+                                        ntdll_base));
+              });
+
+    suite.Run("RebaseImage/ntdll (parallel)",
+              2,
+              [&]()
+              {
+                hadesmem::RebaseImage(ntdll_image.data(),
+                                      ntdll_image.size(),
+                                      ntdll_base,
+                                      ntdll_moved,
+                                      0);
+                hadesmem::bench::DoNotOptimize(
+                  hadesmem::RebaseImage(ntdll_image.data(),
+                                        ntdll_image.size(),
+                                        ntdll_moved,
+                                        ntdll_base,
+                                        0));
+              });
+
+    // Patterns which never match, so every scan covers the whole range.
+    std::wstring const kMissing = L"DE AD ?? BE EF ?? CA FE BA BE";
+    std::wstring const kMissingCommon = L"00 00 ?? 00 00 ?? 00 00 DE AD";
+
+    suite.Run("Find/ntdll code",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(
+                  hadesmem::Find(process,
+                                 L"ntdll.dll",
+                                 kMissing,
+                                 hadesmem::PatternFlags::kNone,
+                                 0));
+              });
+
+    suite.Run("Find/ntdll data",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(
+                  hadesmem::Find(process,
+                                 L"ntdll.dll",
+                                 kMissing,
+                                 hadesmem::PatternFlags::kScanData,
+                                 0));
+              });
+
+    std::vector<std::uint8_t> synthetic(16 << 20);
+    std::mt19937 rng{0};
+    for (auto& b : synthetic)
+    {
+      b = static_cast<std::uint8_t>(rng());
+    }
+
+    suite.Run("Find/synthetic 16MB",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(
+                  hadesmem::Find(process,
+                                 synthetic.data(),
+                                 synthetic.size(),
+                                 kMissing,
+                                 hadesmem::PatternFlags::kNone,
+                                 0));
+              });
+
+    // Mostly zeros, so the anchor's first byte matches almost everywhere.
+    std::vector<std::uint8_t> zeros(16 << 20);
+    suite.Run("Find/synthetic 16MB zeros",
+              1,
+              [&]()
+              {
+                hadesmem::bench::DoNotOptimize(
+                  hadesmem::Find(process,
+                                 zeros.data(),
+                                 zeros.size(),
+                                 kMissingCommon,
+                                 hadesmem::PatternFlags::kNone,
+                                 0));
+              });
+
+    return suite.Report();
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,168 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+// pelib over local buffers, which needs no process and so builds and runs on
+// Windows and Linux: RebaseImage and UnrelocateImage (serial and parallel)
+// over synthetic 32-bit and 64-bit images with a relocation on every 16 bytes
+// of a 16MB image, and GetImageBase. See suite_pelib for the same over a copy
+// of ntdll.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/pelib/rebase.hpp>
+
+#include "suite.hpp"
+
+namespace
+{
+std::size_t const kPageSize = 0x1000;
+std::size_t const kNtOffset = 0x80;
+std::size_t const kNumPages = 4096;
+std::size_t const kFixupStride = 16;
+std::size_t const kFixupsPerPage = kPageSize / kFixupStride;
+
+template <typename T>
+void Put(std::vector<std::uint8_t>& image, std::size_t offset, T value)
+{
+  std::memcpy(&image[offset], &value, sizeof(value));
+}
+
+// Headers in the first page, then kNumPages pages of pointers (to their own
+// RVA) with one relocation block each, then the relocation directory.
+std::vector<std::uint8_t> MakeImage(bool is_64, std::uint64_t base)
+{
+  std::size_t const reloc_rva = (1 + kNumPages) * kPageSize;
+  std::size_t const block_size = 8 + kFixupsPerPage * 2;
+  std::size_t const reloc_size = kNumPages * block_size;
+  std::vector<std::uint8_t> image(reloc_rva + reloc_size);
+
+  Put<std::uint16_t>(image, 0, 0x5A4D);
+  Put<std::uint32_t>(image, 0x3C, static_cast<std::uint32_t>(kNtOffset));
+  Put<std::uint32_t>(image, kNtOffset, 0x00004550);
+  std::size_t const optional = kNtOffset + 4 + 20;
+  Put<std::uint16_t>(image, optional, is_64 ? 0x20B : 0x10B);
+  std::size_t const dirs = optional + (is_64 ? 112 : 96);
+  if (is_64)
+  {
+    Put<std::uint64_t>(image, optional + 24, base);
+    Put<std::uint32_t>(image, optional + 108, 16);
+  }
+  else
+  {
+    Put<std::uint32_t>(image, optional + 28, static_cast<std::uint32_t>(base));
+    Put<std::uint32_t>(image, optional + 92, 16);
+  }
+  Put<std::uint32_t>(
+    image, dirs + 5 * 8, static_cast<std::uint32_t>(reloc_rva));
+  Put<std::uint32_t>(
+    image, dirs + 5 * 8 + 4, static_cast<std::uint32_t>(reloc_size));
+
+  std::uint16_t const type = is_64 ? 10 : 3;
+  for (std::size_t page = 0; page < kNumPages; ++page)
+  {
+    std::size_t const page_rva = (1 + page) * kPageSize;
+    std::size_t const block = reloc_rva + page * block_size;
+    Put<std::uint32_t>(image, block, static_cast<std::uint32_t>(page_rva));
+    Put<std::uint32_t>(
+      image, block + 4, static_cast<std::uint32_t>(block_size));
+    for (std::size_t i = 0; i < kFixupsPerPage; ++i)
+    {
+      std::size_t const offset = i * kFixupStride;
+      std::uint64_t const pointer = base + page_rva + offset;
+      if (is_64)
+      {
+        Put<std::uint64_t>(image, page_rva + offset, pointer);
+      }
+      else
+      {
+        Put<std::uint32_t>(
+          image, page_rva + offset, static_cast<std::uint32_t>(pointer));
+      }
+      Put<std::uint16_t>(image,
+                         block + 8 + i * 2,
+                         static_cast<std::uint16_t>((type << 12) | offset));
+    }
+  }
+
+  return image;
+}
+
+// Each op moves the image away and back again, so every sample starts from
+// the same state.
+void RunRebase(hadesmem::bench::Suite& suite,
+               char const* name,
+               std::vector<std::uint8_t>& image,
+               std::uint64_t base,
+               std::uint64_t moved,
+               std::size_t num_threads)
+{
+  suite.Run(name,
+            2,
+            [&]()
+            {
+              hadesmem::RebaseImage(
+                image.data(), image.size(), base, moved, num_threads);
+              hadesmem::bench::DoNotOptimize(hadesmem::RebaseImage(
+                image.data(), image.size(), moved, base, num_threads));
+            });
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    hadesmem::bench::Suite suite{"pelib_buffer", argc, argv};
+
+    std::uint64_t const base_32 = 0x00400000;
+    std::uint64_t const moved_32 = 0x10000000;
+    std::uint64_t const base_64 = 0x0000000140000000ULL;
+    std::uint64_t const moved_64 = 0x00007FF700000000ULL;
+    auto image_32 = MakeImage(false, base_32);
+    auto image_64 = MakeImage(true, base_64);
+
+    suite.Run("GetImageBase",
+              1000,
+              [&]()
+              {
+                for (std::size_t i = 0; i < 1000; ++i)
+                {
+                  hadesmem::bench::DoNotOptimize(hadesmem::GetImageBase(
+                    image_64.data(), image_64.size()));
+                }
+              });
+
+    RunRebase(suite, "RebaseImage/32-bit 16MB", image_32, base_32, moved_32, 1);
+    RunRebase(suite, "RebaseImage/64-bit 16MB", image_64, base_64, moved_64, 1);
+    RunRebase(suite,
+              "RebaseImage/64-bit 16MB (parallel)",
+              image_64,
+              base_64,
+              moved_64,
+              0);
+
+    suite.Run("UnrelocateImage/64-bit 16MB",
+              2,
+              [&]()
+              {
+                hadesmem::UnrelocateImage(
+                  image_64.data(), image_64.size(), base_64);
+                hadesmem::bench::DoNotOptimize(hadesmem::RebaseImage(
+                  image_64.data(), image_64.size(), 0, base_64));
+              });
+
+    return suite.Report();
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n"
+              << boost::current_exception_diagnostic_information() << '\n';
+    return 1;
+  }
+}
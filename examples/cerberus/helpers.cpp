@@ -3,6 +3,10 @@
 
 #include "helpers.hpp"
 
+#include <sstream>
+
+#include <hadesmem/hook_profile.hpp>
+
 #include "module.hpp"
 
 namespace
@@ -114,5 +118,35 @@ HelperInterface& GetHelperInterface() HADESMEM_DETAIL_NOEXCEPT
   static HelperImpl helper_impl;
   return helper_impl;
 }
+
+void DumpHookProfile(Process const& process)
+{
+  auto const entries = ReadHookProfile(process);
+  HADESMEM_DETAIL_TRACE_FORMAT_A("Hook profile: %Iu hooks.", entries.size());
+
+  for (auto const& entry : entries)
+  {
+    std::uint64_t const avg_cycles =
+      entry.num_calls ? entry.total_cycles / entry.num_calls : 0;
+    (void)avg_cycles;
+    HADESMEM_DETAIL_TRACE_FORMAT_A(
+      "Target = %p, Calls = %llu, Cycles = %llu, Avg = %llu.",
+      entry.target,
+      entry.num_calls,
+      entry.total_cycles,
+      avg_cycles);
+
+    // One "2^i:count" pair per non-empty bucket.
+    std::ostringstream histogram;
+    for (std::size_t i = 0; i < HookProfileEntry::kNumBuckets; ++i)
+    {
+      if (entry.histogram[i])
+      {
+        histogram << " 2^" << i << ":" << entry.histogram[i];
+      }
+    }
+    HADESMEM_DETAIL_TRACE_FORMAT_A("Histogram:%s", histogram.str().c_str());
+  }
+}
 }
 }
@@ -98,10 +98,9 @@ void UndetourFunc(std::wstring const& name,
     remove ? detour->Remove() : detour->Detach();
     HADESMEM_DETAIL_TRACE_FORMAT_W(L"%s undetoured.", name.c_str());
 
-    auto& ref_count = detour->GetRefCount();
-    while (ref_count.load())
+    while (!detour->WaitForQuiescence(1000))
     {
-      HADESMEM_DETAIL_TRACE_FORMAT_W(L"Spinning on %s ref count.",
+      HADESMEM_DETAIL_TRACE_FORMAT_W(L"Waiting on %s ref count.",
                                      name.c_str());
     }
     HADESMEM_DETAIL_TRACE_FORMAT_W(L"%s free of references.", name.c_str());
@@ -137,5 +136,9 @@ public:
 };
 
 HelperInterface& GetHelperInterface() HADESMEM_DETAIL_NOEXCEPT;
+
+// Traces the call count, average cycles and latency histogram of every hook
+// in the process. Only has data to dump when built with HADESMEM_HOOK_PROFILE.
+void DumpHookProfile(Process const& process);
 }
 }
@@ -4,16 +4,17 @@
 #include "input.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
-#include <mutex>
-#include <queue>
 
 #include <windows.h>
 #include <winnt.h>
 #include <winternl.h>
 
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/scope_warden.hpp>
 #include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/detail/spsc_ring_buffer.hpp>
 #include <hadesmem/detail/str_conv.hpp>
 
 #include "callbacks.hpp"
@@ -49,6 +50,8 @@ public:
     auto& callbacks = GetOnInputQueueEntryCallbacks();
     return callbacks.Unregister(id);
   }
+
+  virtual hadesmem::cerberus::InputQueueStats GetInputQueueStats() final;
 };
 
 int& GetShowCursorCount() HADESMEM_DETAIL_NOEXCEPT
@@ -81,18 +84,84 @@ struct WndProcInputMsg
   UINT msg_;
   WPARAM wparam_;
   LPARAM lparam_;
+  std::int64_t queued_time_;
 };
 
-std::queue<WndProcInputMsg>& GetWndProcInputMsgQueue()
+// Messages are queued by the window thread and consumed by the render thread
+// (which may be the same thread). The queue must never block the window
+// thread, so if the render thread stalls (or isn't running) messages are
+// dropped once it fills up rather than being buffered indefinitely.
+using WndProcInputMsgQueue =
+  hadesmem::detail::SpscRingBuffer<WndProcInputMsg, 1024>;
+
+WndProcInputMsgQueue& GetWndProcInputMsgQueue() HADESMEM_DETAIL_NOEXCEPT
 {
-  static std::queue<WndProcInputMsg> queue;
+  static WndProcInputMsgQueue queue;
   return queue;
 }
 
-std::recursive_mutex& GetWndProcInputMsgQueueMutex()
+// The present hooks for each graphics API can run on different threads, but
+// the queue only supports a single consumer. Whichever thread holds this flag
+// drains the queue, and any others skip it for that frame.
+std::atomic_flag& GetWndProcInputMsgQueueConsumerFlag() HADESMEM_DETAIL_NOEXCEPT
+{
+  static std::atomic_flag flag = ATOMIC_FLAG_INIT;
+  return flag;
+}
+
+struct WndProcInputMsgQueueStats
+{
+  // Written by the window thread.
+  std::atomic<std::uint64_t> queued_{};
+  std::atomic<std::uint64_t> dropped_{};
+  // Written by the render thread.
+  std::atomic<std::uint64_t> processed_{};
+  std::atomic<std::uint64_t> max_depth_{};
+  std::atomic<std::uint64_t> total_latency_{};
+  std::atomic<std::uint64_t> max_latency_{};
+};
+
+WndProcInputMsgQueueStats& GetWndProcInputMsgQueueStats()
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  static WndProcInputMsgQueueStats stats;
+  return stats;
+}
+
+std::int64_t GetPerformanceCounter() HADESMEM_DETAIL_NOEXCEPT
+{
+  LARGE_INTEGER counter{};
+  ::QueryPerformanceCounter(&counter);
+  return counter.QuadPart;
+}
+
+double PerformanceCounterToMicroseconds(std::uint64_t ticks)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  LARGE_INTEGER frequency{};
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(ticks) * 1000000.0 /
+         static_cast<double>(frequency.QuadPart);
+}
+
+hadesmem::cerberus::InputQueueStats InputImpl::GetInputQueueStats()
 {
-  static std::recursive_mutex mutex;
-  return mutex;
+  auto& stats = GetWndProcInputMsgQueueStats();
+  hadesmem::cerberus::InputQueueStats result{};
+  result.capacity_ = WndProcInputMsgQueue::GetCapacity();
+  result.queued_ = stats.queued_.load(std::memory_order_relaxed);
+  result.dropped_ = stats.dropped_.load(std::memory_order_relaxed);
+  result.processed_ = stats.processed_.load(std::memory_order_relaxed);
+  result.max_depth_ = stats.max_depth_.load(std::memory_order_relaxed);
+  result.avg_latency_us_ =
+    result.processed_
+      ? PerformanceCounterToMicroseconds(
+          stats.total_latency_.load(std::memory_order_relaxed)) /
+          static_cast<double>(result.processed_)
+      : 0.0;
+  result.max_latency_us_ = PerformanceCounterToMicroseconds(
+    stats.max_latency_.load(std::memory_order_relaxed));
+  return result;
 }
 
 void SetOrRestoreCursor(bool visible)
@@ -304,9 +373,22 @@ void WindowProcCallback(
 {
   {
     auto& queue = GetWndProcInputMsgQueue();
-    auto& mutex = GetWndProcInputMsgQueueMutex();
-    std::lock_guard<std::recursive_mutex> lock{mutex};
-    queue.push(WndProcInputMsg{hwnd, msg, wparam, lparam});
+    auto& stats = GetWndProcInputMsgQueueStats();
+    if (queue.TryPush(
+          WndProcInputMsg{hwnd, msg, wparam, lparam, GetPerformanceCounter()}))
+    {
+      stats.queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+      auto const dropped =
+        stats.dropped_.fetch_add(1, std::memory_order_relaxed) + 1;
+      if ((dropped & (dropped - 1)) == 0)
+      {
+        HADESMEM_DETAIL_TRACE_FORMAT_A(
+          "WARNING! Input queue overflow. Dropped: [%llu].", dropped);
+      }
+    }
   }
 
   if (msg == WM_KEYDOWN && !((lparam >> 30) & 1) && wparam == VK_F9 &&
@@ -466,15 +548,61 @@ void SetGuiVisibleForInput(bool visible, bool old_visible)
 
 void HandleInputQueue()
 {
+  auto& consumer_flag = GetWndProcInputMsgQueueConsumerFlag();
+  if (consumer_flag.test_and_set(std::memory_order_acquire))
+  {
+    return;
+  }
+  auto const clear_consumer_flag = [&]()
+  {
+    consumer_flag.clear(std::memory_order_release);
+  };
+  auto scope_clear_consumer_flag =
+    hadesmem::detail::MakeScopeWarden(clear_consumer_flag);
+
   auto& queue = GetWndProcInputMsgQueue();
-  auto& mutex = GetWndProcInputMsgQueueMutex();
-  std::lock_guard<std::recursive_mutex> lock{mutex};
-  while (!queue.empty())
+  auto& stats = GetWndProcInputMsgQueueStats();
+  auto& callbacks = GetOnInputQueueEntryCallbacks();
+
+  std::uint64_t const depth = queue.GetSize();
+  if (depth > stats.max_depth_.load(std::memory_order_relaxed))
   {
-    WndProcInputMsg msg = queue.front();
-    auto& callbacks = GetOnInputQueueEntryCallbacks();
-    callbacks.Run(msg.hwnd_, msg.msg_, msg.wparam_, msg.lparam_);
-    queue.pop();
+    stats.max_depth_.store(depth, std::memory_order_relaxed);
+  }
+
+  // Callbacks are run on a local copy of each batch, so the window thread can
+  // keep queueing (and callbacks can cause messages to be queued) while they
+  // run. Messages queued after this point wait for the next frame, so a
+  // callback which always causes another message can't stall the render
+  // thread.
+  std::size_t const kBatchSize = 64;
+  WndProcInputMsg batch[kBatchSize];
+  std::size_t remaining = static_cast<std::size_t>(depth);
+  while (remaining)
+  {
+    std::size_t const count =
+      queue.TryPopBatch(batch, (std::min)(remaining, kBatchSize));
+    if (!count)
+    {
+      break;
+    }
+    remaining -= count;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      WndProcInputMsg const& msg = batch[i];
+      callbacks.Run(msg.hwnd_, msg.msg_, msg.wparam_, msg.lparam_);
+
+      auto const latency =
+        static_cast<std::uint64_t>(GetPerformanceCounter() - msg.queued_time_);
+      stats.total_latency_.fetch_add(latency, std::memory_order_relaxed);
+      if (latency > stats.max_latency_.load(std::memory_order_relaxed))
+      {
+        stats.max_latency_.store(latency, std::memory_order_relaxed);
+      }
+    }
+
+    stats.processed_.fetch_add(count, std::memory_order_relaxed);
   }
 }
 
@@ -486,6 +614,11 @@ InputInterface& GetInputInterface() HADESMEM_DETAIL_NOEXCEPT
 
 void InitializeInput()
 {
+  // Force initialization of the queue before the window thread can use it.
+  GetWndProcInputMsgQueue();
+  GetWndProcInputMsgQueueStats();
+  GetWndProcInputMsgQueueConsumerFlag();
+
   auto& window = GetWindowInterface();
   window.RegisterOnWndProcMsg(WindowProcCallback);
 
@@ -15,6 +15,19 @@ namespace cerberus
 typedef void
   OnInputQueueEntry(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam);
 
+// Latency is measured from the message arriving at the window procedure to
+// the OnInputQueueEntry callbacks for it having returned.
+struct InputQueueStats
+{
+  std::uint64_t capacity_;
+  std::uint64_t queued_;
+  std::uint64_t dropped_;
+  std::uint64_t processed_;
+  std::uint64_t max_depth_;
+  double avg_latency_us_;
+  double max_latency_us_;
+};
+
 class InputInterface
 {
 public:
@@ -26,6 +39,8 @@ public:
     std::function<OnInputQueueEntry> const& callback) = 0;
 
   virtual void UnregisterOnInputQueueEntry(std::size_t id) = 0;
+
+  virtual InputQueueStats GetInputQueueStats() = 0;
 };
 
 void SetGuiVisibleForInput(bool visible, bool old_visible);
@@ -309,14 +309,12 @@ bool IsSafeToUnload()
   for (std::size_t retries = 5; retries && !safe; --retries)
   {
     hadesmem::SuspendedProcess suspend{process.GetId()};
-    hadesmem::ThreadList threads{process.GetId()};
+    auto const& threads = suspend.GetThreads();
 
-    auto const is_unsafe = [&](hadesmem::ThreadEntry const& thread_entry)
+    auto const is_unsafe = [&](hadesmem::SuspendedThread const& thread)
     {
-      auto const id = thread_entry.GetId();
-      return id != ::GetCurrentThreadId() &&
-             hadesmem::detail::IsExecutingInRange(
-               thread_entry, this_module, this_module + this_module_size);
+      return hadesmem::detail::IsExecutingInRange(
+        thread.GetThread(), this_module, this_module + this_module_size);
     };
 
     safe = std::find_if(std::begin(threads), std::end(threads), is_unsafe) ==
@@ -431,6 +429,19 @@ extern "C" HADESMEM_DETAIL_DLLEXPORT DWORD_PTR Free() HADESMEM_DETAIL_NOEXCEPT
 
     is_initialized = false;
 
+#if defined(HADESMEM_HOOK_PROFILE)
+    try
+    {
+      hadesmem::cerberus::DumpHookProfile(
+        hadesmem::cerberus::GetThisProcess());
+    }
+    catch (...)
+    {
+      HADESMEM_DETAIL_TRACE_A(
+        boost::current_exception_diagnostic_information().c_str());
+    }
+#endif
+
     hadesmem::cerberus::UndetourNtdllForModule(true);
     hadesmem::cerberus::UndetourNtdllForException(true);
     hadesmem::cerberus::UndetourKernelBaseForException(true);
@@ -0,0 +1,520 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include "cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/fast_hash.hpp>
+#include <hadesmem/detail/self_path.hpp>
+#include <hadesmem/error.hpp>
+
+namespace
+{
+DumpCache* g_dump_cache = nullptr;
+
+std::uint32_t const kCacheMagic = 0x43444D48; // 'HMDC'
+std::uint32_t const kCacheVersion = 1;
+
+struct DumpCacheHeader
+{
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t build_key;
+  std::uint32_t generation;
+  std::uint32_t reserved;
+  std::uint64_t num_files;
+  std::uint64_t num_contents;
+  std::uint64_t blob_len;
+};
+
+std::uint64_t GetPathHash(std::wstring const& path)
+{
+  return hadesmem::detail::GetFastHash(path.c_str(),
+                                       path.size() * sizeof(wchar_t));
+}
+
+// Output for the same file can change between builds of the dump tool, so
+// key the cache on the identity of the executable itself.
+std::uint64_t GetBuildKey()
+{
+  DumpCacheStamp stamp{};
+  GetDumpCacheStamp(hadesmem::detail::GetSelfPath(), stamp);
+  std::uint64_t const key[] = {stamp.file_size,
+                               stamp.last_write_time,
+                               sizeof(void*),
+                               sizeof(wchar_t)};
+  return hadesmem::detail::GetFastHash(key, sizeof(key), kCacheVersion);
+}
+
+template <typename T>
+void AppendPod(std::vector<std::uint8_t>& buf, T const& value)
+{
+  auto const p = reinterpret_cast<std::uint8_t const*>(&value);
+  buf.insert(std::end(buf), p, p + sizeof(value));
+}
+}
+
+bool GetDumpCacheStamp(std::wstring const& path, DumpCacheStamp& stamp)
+{
+  WIN32_FILE_ATTRIBUTE_DATA data{};
+  if (!::GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+  {
+    return false;
+  }
+
+  stamp.file_size = (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) |
+                    data.nFileSizeLow;
+  stamp.last_write_time =
+    (static_cast<std::uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+    data.ftLastWriteTime.dwLowDateTime;
+  return true;
+}
+
+DumpCache::DumpCache(std::wstring const& path) : path_{path}
+{
+  Load();
+}
+
+bool DumpCache::FindByStamp(std::wstring const& path,
+                            DumpCacheStamp const& stamp,
+                            DumpCacheEntry& entry)
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  std::uint64_t content_hash = 0;
+  auto const touched = touched_files_.find(path);
+  if (touched != std::end(touched_files_))
+  {
+    if (touched->second.file_size != stamp.file_size ||
+        touched->second.last_write_time != stamp.last_write_time)
+    {
+      return false;
+    }
+    content_hash = touched->second.content_hash;
+  }
+  else
+  {
+    FileEntry const* const file = FindFile(path, GetPathHash(path));
+    if (!file || file->file_size != stamp.file_size ||
+        file->last_write_time != stamp.last_write_time)
+    {
+      return false;
+    }
+    content_hash = file->content_hash;
+  }
+
+  if (!FindContent(ContentKey{content_hash, stamp.file_size}, entry))
+  {
+    return false;
+  }
+
+  TouchFile(path, stamp, content_hash);
+  ++stats_.stamp_hits;
+  return true;
+}
+
+bool DumpCache::FindByContent(std::wstring const& path,
+                              DumpCacheStamp const& stamp,
+                              std::uint64_t content_hash,
+                              DumpCacheEntry& entry)
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  if (!FindContent(ContentKey{content_hash, stamp.file_size}, entry))
+  {
+    ++stats_.misses;
+    return false;
+  }
+
+  TouchFile(path, stamp, content_hash);
+  ++stats_.content_hits;
+  return true;
+}
+
+void DumpCache::Insert(std::wstring const& path,
+                       DumpCacheStamp const& stamp,
+                       std::uint64_t content_hash,
+                       std::vector<std::uint8_t>&& record,
+                       std::uint32_t warning_types)
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  PendingContent& content =
+    pending_contents_[ContentKey{content_hash, stamp.file_size}];
+  content.data =
+    std::make_shared<std::vector<std::uint8_t> const>(std::move(record));
+  content.warning_types = warning_types;
+  TouchFile(path, stamp, content_hash);
+  ++stats_.inserts;
+}
+
+void DumpCache::Save()
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  std::uint32_t const generation = generation_ + 1;
+
+  // Gather surviving path entries (and their paths) first, as the existing
+  // mapping must be released before the file can be replaced.
+  std::vector<std::pair<FileEntry, std::wstring>> files;
+  for (std::size_t i = 0; i < num_files_; ++i)
+  {
+    FileEntry const& file = files_[i];
+    if (file.path_offset > blob_len_ ||
+        file.path_len > (blob_len_ - file.path_offset) / sizeof(wchar_t))
+    {
+      ++stats_.evicted;
+      continue;
+    }
+
+    auto const path_beg =
+      reinterpret_cast<wchar_t const*>(blob_ + file.path_offset);
+    std::wstring path(path_beg, path_beg + file.path_len);
+    if (touched_files_.find(path) != std::end(touched_files_))
+    {
+      continue;
+    }
+
+    if (generation - file.last_used > kMaxIdleGenerations)
+    {
+      ++stats_.evicted;
+      continue;
+    }
+
+    files.emplace_back(file, std::move(path));
+  }
+  for (auto const& touched : touched_files_)
+  {
+    files.emplace_back(touched.second, touched.first);
+  }
+
+  std::vector<ContentKey> keys;
+  keys.reserve(files.size());
+  for (auto const& file : files)
+  {
+    keys.emplace_back(file.first.content_hash, file.first.file_size);
+  }
+  std::sort(std::begin(keys), std::end(keys));
+  keys.erase(std::unique(std::begin(keys), std::end(keys)), std::end(keys));
+
+  std::vector<std::pair<ContentEntry, DumpCacheEntry>> contents;
+  contents.reserve(keys.size());
+  for (auto const& key : keys)
+  {
+    DumpCacheEntry entry{};
+    if (!FindContent(key, entry))
+    {
+      continue;
+    }
+
+    ContentEntry content{};
+    content.content_hash = key.first;
+    content.file_size = key.second;
+    content.data_len = static_cast<std::uint32_t>(entry.len);
+    content.warning_types = entry.warning_types;
+    contents.emplace_back(content, entry);
+  }
+
+  std::sort(std::begin(files),
+            std::end(files),
+            [](std::pair<FileEntry, std::wstring> const& lhs,
+               std::pair<FileEntry, std::wstring> const& rhs)
+            {
+    return lhs.first.path_hash < rhs.first.path_hash;
+  });
+
+  std::vector<std::uint8_t> blob;
+  for (auto& file : files)
+  {
+    file.first.path_offset = blob.size();
+    file.first.path_len = static_cast<std::uint32_t>(file.second.size());
+    auto const p = reinterpret_cast<std::uint8_t const*>(file.second.c_str());
+    blob.insert(std::end(blob), p, p + file.second.size() * sizeof(wchar_t));
+    blob.resize((blob.size() + 7) & ~static_cast<std::size_t>(7));
+  }
+  for (auto& content : contents)
+  {
+    content.first.data_offset = blob.size();
+    blob.insert(std::end(blob),
+                content.second.data,
+                content.second.data + content.second.len);
+    blob.resize((blob.size() + 7) & ~static_cast<std::size_t>(7));
+  }
+
+  DumpCacheHeader header{};
+  header.magic = kCacheMagic;
+  header.version = kCacheVersion;
+  header.build_key = GetBuildKey();
+  header.generation = generation;
+  header.num_files = files.size();
+  header.num_contents = contents.size();
+  header.blob_len = blob.size();
+
+  std::vector<std::uint8_t> buf;
+  buf.reserve(sizeof(header) + files.size() * sizeof(FileEntry) +
+              contents.size() * sizeof(ContentEntry) + blob.size());
+  AppendPod(buf, header);
+  for (auto const& file : files)
+  {
+    AppendPod(buf, file.first);
+  }
+  for (auto const& content : contents)
+  {
+    AppendPod(buf, content.first);
+  }
+  buf.insert(std::end(buf), std::begin(blob), std::end(blob));
+
+  stats_.files = files.size();
+  stats_.contents = contents.size();
+  stats_.bytes = buf.size();
+
+  files_ = nullptr;
+  num_files_ = 0;
+  contents_ = nullptr;
+  num_contents_ = 0;
+  blob_ = nullptr;
+  blob_len_ = 0;
+  touched_files_.clear();
+  pending_contents_.clear();
+  view_.Cleanup();
+  mapping_.Cleanup();
+  file_.Cleanup();
+
+  // Write to a temporary file first so an interrupted save can't leave a
+  // truncated cache behind.
+  std::wstring const temp_path = path_ + L".tmp";
+  {
+    hadesmem::detail::SmartFileHandle const temp_file{
+      ::CreateFileW(temp_path.c_str(),
+                    GENERIC_WRITE,
+                    0,
+                    nullptr,
+                    CREATE_ALWAYS,
+                    FILE_ATTRIBUTE_NORMAL,
+                    nullptr)};
+    if (!temp_file.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        hadesmem::Error() << hadesmem::ErrorString("CreateFileW failed.")
+                          << hadesmem::ErrorCodeWinLast(last_error));
+    }
+
+    std::size_t written_total = 0;
+    while (written_total < buf.size())
+    {
+      DWORD const kMaxWrite = 1UL << 30;
+      DWORD const to_write = static_cast<DWORD>((std::min)(
+        buf.size() - written_total, static_cast<std::size_t>(kMaxWrite)));
+      DWORD written = 0;
+      if (!::WriteFile(temp_file.GetHandle(),
+                       buf.data() + written_total,
+                       to_write,
+                       &written,
+                       nullptr))
+      {
+        DWORD const last_error = ::GetLastError();
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          hadesmem::Error() << hadesmem::ErrorString("WriteFile failed.")
+                            << hadesmem::ErrorCodeWinLast(last_error));
+      }
+      written_total += written;
+    }
+  }
+
+  if (!::MoveFileExW(
+        temp_path.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING))
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error() << hadesmem::ErrorString("MoveFileExW failed.")
+                        << hadesmem::ErrorCodeWinLast(last_error));
+  }
+}
+
+DumpCacheStats DumpCache::GetStats()
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  return stats_;
+}
+
+void DumpCache::Load()
+{
+  file_ = ::CreateFileW(path_.c_str(),
+                        GENERIC_READ,
+                        FILE_SHARE_READ,
+                        nullptr,
+                        OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL,
+                        nullptr);
+  if (!file_.IsValid())
+  {
+    DWORD const last_error = ::GetLastError();
+    if (last_error == ERROR_FILE_NOT_FOUND)
+    {
+      return;
+    }
+
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error() << hadesmem::ErrorString("CreateFileW failed.")
+                        << hadesmem::ErrorCodeWinLast(last_error));
+  }
+
+  LARGE_INTEGER file_size{};
+  if (!::GetFileSizeEx(file_.GetHandle(), &file_size))
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error() << hadesmem::ErrorString("GetFileSizeEx failed.")
+                        << hadesmem::ErrorCodeWinLast(last_error));
+  }
+
+  auto const size = static_cast<std::uint64_t>(file_size.QuadPart);
+  if (size < sizeof(DumpCacheHeader) ||
+      size > static_cast<std::size_t>(-1))
+  {
+    file_.Cleanup();
+    return;
+  }
+
+  mapping_ = ::CreateFileMappingW(
+    file_.GetHandle(), nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping_.IsValid())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error() << hadesmem::ErrorString("CreateFileMappingW failed.")
+                        << hadesmem::ErrorCodeWinLast(last_error));
+  }
+
+  view_ = ::MapViewOfFile(mapping_.GetHandle(), FILE_MAP_READ, 0, 0, 0);
+  if (!view_.IsValid())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error() << hadesmem::ErrorString("MapViewOfFile failed.")
+                        << hadesmem::ErrorCodeWinLast(last_error));
+  }
+
+  auto const base = static_cast<std::uint8_t const*>(view_.GetHandle());
+  auto const header = reinterpret_cast<DumpCacheHeader const*>(base);
+  std::uint64_t const tables_len =
+    sizeof(DumpCacheHeader) + header->num_files * sizeof(FileEntry) +
+    header->num_contents * sizeof(ContentEntry);
+  bool const valid =
+    header->magic == kCacheMagic && header->version == kCacheVersion &&
+    header->build_key == GetBuildKey() &&
+    header->num_files < size / sizeof(FileEntry) &&
+    header->num_contents < size / sizeof(ContentEntry) &&
+    tables_len <= size && header->blob_len <= size - tables_len;
+  if (!valid)
+  {
+    // Written by a different build (or corrupt). Start from scratch.
+    view_.Cleanup();
+    mapping_.Cleanup();
+    file_.Cleanup();
+    return;
+  }
+
+  generation_ = header->generation;
+  files_ = reinterpret_cast<FileEntry const*>(base + sizeof(DumpCacheHeader));
+  num_files_ = static_cast<std::size_t>(header->num_files);
+  contents_ = reinterpret_cast<ContentEntry const*>(files_ + num_files_);
+  num_contents_ = static_cast<std::size_t>(header->num_contents);
+  blob_ = reinterpret_cast<std::uint8_t const*>(contents_ + num_contents_);
+  blob_len_ = header->blob_len;
+}
+
+DumpCache::FileEntry const*
+  DumpCache::FindFile(std::wstring const& path, std::uint64_t path_hash) const
+{
+  auto const end = files_ + num_files_;
+  auto iter = std::lower_bound(files_,
+                               end,
+                               path_hash,
+                               [](FileEntry const& lhs, std::uint64_t rhs)
+                               {
+    return lhs.path_hash < rhs;
+  });
+  for (; iter != end && iter->path_hash == path_hash; ++iter)
+  {
+    if (iter->path_offset > blob_len_ ||
+        iter->path_len != path.size() ||
+        iter->path_len > (blob_len_ - iter->path_offset) / sizeof(wchar_t))
+    {
+      continue;
+    }
+
+    if (!std::memcmp(blob_ + iter->path_offset,
+                     path.c_str(),
+                     path.size() * sizeof(wchar_t)))
+    {
+      return iter;
+    }
+  }
+
+  return nullptr;
+}
+
+bool DumpCache::FindContent(ContentKey const& key, DumpCacheEntry& entry) const
+{
+  auto const pending = pending_contents_.find(key);
+  if (pending != std::end(pending_contents_))
+  {
+    entry.owner = pending->second.data;
+    entry.data = pending->second.data->data();
+    entry.len = pending->second.data->size();
+    entry.warning_types = pending->second.warning_types;
+    return true;
+  }
+
+  auto const end = contents_ + num_contents_;
+  auto const iter = std::lower_bound(
+    contents_,
+    end,
+    key,
+    [](ContentEntry const& lhs, ContentKey const& rhs)
+    {
+      return ContentKey{lhs.content_hash, lhs.file_size} < rhs;
+    });
+  if (iter == end || iter->content_hash != key.first ||
+      iter->file_size != key.second || iter->data_offset > blob_len_ ||
+      iter->data_len > blob_len_ - iter->data_offset)
+  {
+    return false;
+  }
+
+  entry.owner = nullptr;
+  entry.data = blob_ + iter->data_offset;
+  entry.len = iter->data_len;
+  entry.warning_types = iter->warning_types;
+  return true;
+}
+
+void DumpCache::TouchFile(std::wstring const& path,
+                          DumpCacheStamp const& stamp,
+                          std::uint64_t content_hash)
+{
+  FileEntry& file = touched_files_[path];
+  file.path_hash = GetPathHash(path);
+  file.file_size = stamp.file_size;
+  file.last_write_time = stamp.last_write_time;
+  file.content_hash = content_hash;
+  file.path_offset = 0;
+  file.path_len = static_cast<std::uint32_t>(path.size());
+  file.last_used = generation_ + 1;
+}
+
+DumpCache* GetDumpCache()
+{
+  return g_dump_cache;
+}
+
+void SetDumpCache(DumpCache* cache)
+{
+  g_dump_cache = cache;
+}
@@ -0,0 +1,156 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/smart_handle.hpp>
+
+// Size and last write time of a file, used to answer lookups for unchanged
+// files without reading them.
+struct DumpCacheStamp
+{
+  std::uint64_t file_size;
+  std::uint64_t last_write_time;
+};
+
+bool GetDumpCacheStamp(std::wstring const& path, DumpCacheStamp& stamp);
+
+// Recorded dump output (see Output::SetRecord) for a single PE file.
+struct DumpCacheEntry
+{
+  std::shared_ptr<std::vector<std::uint8_t> const> owner;
+  std::uint8_t const* data;
+  std::size_t len;
+  std::uint32_t warning_types;
+};
+
+struct DumpCacheStats
+{
+  std::uint64_t stamp_hits;
+  std::uint64_t content_hits;
+  std::uint64_t misses;
+  std::uint64_t inserts;
+  std::uint64_t evicted;
+  std::uint64_t files;
+  std::uint64_t contents;
+  std::uint64_t bytes;
+};
+
+// Persistent content addressed cache of dump output. Entries are keyed by a
+// fast hash of the file contents, with a second table keyed by path which
+// allows unchanged files (same size and last write time) to be answered
+// without being opened. The cache file is memory mapped and searched in place.
+//
+// Invalidation:
+// - The whole cache is discarded if it was written by a different build of
+//   the dump tool (output for the same file could differ).
+// - A path whose size or last write time has changed falls back to a content
+//   lookup, and its path entry is replaced.
+// - Path entries which have not been used for kMaxIdleGenerations saves are
+//   evicted, along with any content no longer referenced by a path.
+//
+// Lookups and inserts are thread safe.
+class DumpCache
+{
+public:
+  static std::uint32_t const kMaxIdleGenerations = 16;
+
+  explicit DumpCache(std::wstring const& path);
+
+  DumpCache(DumpCache const&) = delete;
+
+  DumpCache& operator=(DumpCache const&) = delete;
+
+  bool FindByStamp(std::wstring const& path,
+                   DumpCacheStamp const& stamp,
+                   DumpCacheEntry& entry);
+
+  bool FindByContent(std::wstring const& path,
+                     DumpCacheStamp const& stamp,
+                     std::uint64_t content_hash,
+                     DumpCacheEntry& entry);
+
+  void Insert(std::wstring const& path,
+              DumpCacheStamp const& stamp,
+              std::uint64_t content_hash,
+              std::vector<std::uint8_t>&& record,
+              std::uint32_t warning_types);
+
+  // Writes the cache back to disk (replacing the existing file) and unmaps
+  // it. The cache must not be used afterwards.
+  void Save();
+
+  DumpCacheStats GetStats();
+
+private:
+  struct FileEntry
+  {
+    std::uint64_t path_hash;
+    std::uint64_t file_size;
+    std::uint64_t last_write_time;
+    std::uint64_t content_hash;
+    std::uint64_t path_offset;
+    std::uint32_t path_len;
+    std::uint32_t last_used;
+  };
+
+  struct ContentEntry
+  {
+    std::uint64_t content_hash;
+    std::uint64_t file_size;
+    std::uint64_t data_offset;
+    std::uint32_t data_len;
+    std::uint32_t warning_types;
+  };
+
+  struct PendingContent
+  {
+    std::shared_ptr<std::vector<std::uint8_t> const> data;
+    std::uint32_t warning_types;
+  };
+
+  using ContentKey = std::pair<std::uint64_t, std::uint64_t>;
+
+  void Load();
+
+  FileEntry const* FindFile(std::wstring const& path,
+                            std::uint64_t path_hash) const;
+
+  bool FindContent(ContentKey const& key, DumpCacheEntry& entry) const;
+
+  void TouchFile(std::wstring const& path,
+                 DumpCacheStamp const& stamp,
+                 std::uint64_t content_hash);
+
+  std::wstring path_;
+  std::mutex mutex_;
+  hadesmem::detail::SmartFileHandle file_;
+  hadesmem::detail::SmartHandle mapping_;
+  hadesmem::detail::SmartMappedFileHandle view_;
+  std::uint32_t generation_{};
+  FileEntry const* files_{};
+  std::size_t num_files_{};
+  ContentEntry const* contents_{};
+  std::size_t num_contents_{};
+  std::uint8_t const* blob_{};
+  std::uint64_t blob_len_{};
+  // Path entries used or added by this run, keyed by path.
+  std::map<std::wstring, FileEntry> touched_files_;
+  std::map<ContentKey, PendingContent> pending_contents_;
+  DumpCacheStats stats_{};
+};
+
+DumpCache* GetDumpCache();
+
+void SetDumpCache(DumpCache* cache);
@@ -32,7 +32,7 @@ void DumpExports(hadesmem::Process const& process,
     return;
   }
 
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
   WriteNormal(out, L"Export Dir:", 1);
@@ -135,7 +135,7 @@ void DumpExports(hadesmem::Process const& process,
         out, L"ForwarderModule", e.GetForwarderModule().c_str(), 3);
       WriteNamedNormal(
         out, L"ForwarderFunction", e.GetForwarderFunction().c_str(), 3);
-      WriteNamedNormal(
+      WriteNamedBool(
         out, L"IsForwardedByOrdinal", e.IsForwardedByOrdinal(), 3);
       if (e.IsForwardedByOrdinal())
       {
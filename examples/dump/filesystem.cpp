@@ -3,26 +3,83 @@
 
 #include "filesystem.hpp"
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include <hadesmem/detail/fast_hash.hpp>
 #include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/scope_warden.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/pelib/nt_headers.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
 #include <hadesmem/process.hpp>
 
+#include "cache.hpp"
 #include "main.hpp"
+#include "output.hpp"
 #include "print.hpp"
+#include "warning.hpp"
 
-void DumpFile(std::wstring const& path)
+namespace
+{
+bool HandleFileError(hadesmem::Error const& e)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
-  SetCurrentFilePath(path);
+  auto const last_error_ptr =
+    boost::get_error_info<hadesmem::ErrorCodeWinLast>(e);
+  if (last_error_ptr && *last_error_ptr == ERROR_SHARING_VIOLATION)
+  {
+    WriteNewline(out);
+    WriteNormal(out, L"Sharing violation.", 0);
+    return true;
+  }
+
+  if (last_error_ptr && *last_error_ptr == ERROR_ACCESS_DENIED)
+  {
+    WriteNewline(out);
+    WriteNormal(out, L"Access denied.", 0);
+    return true;
+  }
+
+  if (last_error_ptr && *last_error_ptr == ERROR_FILE_NOT_FOUND)
+  {
+    WriteNewline(out);
+    WriteNormal(out, L"File not found.", 0);
+    return true;
+  }
+
+  return false;
+}
+
+void DumpFileImpl(std::wstring const& path)
+{
+  Output& out = GetOutput();
+
+  DumpCache* const cache = GetDumpCache();
+  DumpCacheStamp stamp{};
+  bool const use_cache = cache && GetDumpCacheStamp(path, stamp);
+  DumpCacheEntry cached{};
+  if (use_cache && cache->FindByStamp(path, stamp, cached))
+  {
+    if (ClaimFileLimitSlot())
+    {
+      ReplayPeFile(cached.data, cached.len, cached.warning_types, path);
+    }
+    return;
+  }
 
   std::unique_ptr<std::fstream> file_ptr(hadesmem::detail::OpenFile<char>(
     path, std::ios::in | std::ios::binary | std::ios::ate));
@@ -82,6 +139,20 @@ void DumpFile(std::wstring const& path)
     return;
   }
 
+  std::uint64_t content_hash = 0;
+  if (use_cache)
+  {
+    content_hash = hadesmem::detail::GetFastHash(buf.data(), buf.size());
+    if (cache->FindByContent(path, stamp, content_hash, cached))
+    {
+      if (ClaimFileLimitSlot())
+      {
+        ReplayPeFile(cached.data, cached.len, cached.warning_types, path);
+      }
+      return;
+    }
+  }
+
   hadesmem::Process const process(GetCurrentProcessId());
 
   hadesmem::PeFile const pe_file(process,
@@ -96,16 +167,46 @@ void DumpFile(std::wstring const& path)
   catch (std::exception const& /*e*/)
   {
     WriteNewline(out);
-    WriteNormal(out, L"Not a PE file or wrong architecture (Pass 2).", 0);
+    WriteNormal(out, L"Not a PE file (Pass 2).", 0);
+    return;
+  }
+
+  // Other workers may have used up the remaining slots since the directory
+  // walk last checked.
+  if (!ClaimFileLimitSlot())
+  {
+    return;
+  }
+
+  if (!use_cache)
+  {
+    DumpPeFile(process, pe_file, path);
     return;
   }
 
+  std::vector<std::uint8_t> record;
+  out.SetRecord(&record);
+  auto const stop_recording = [&]()
+  {
+    out.SetRecord(nullptr);
+  };
+  auto scope_stop_recording =
+    hadesmem::detail::MakeScopeWarden(stop_recording);
+
   DumpPeFile(process, pe_file, path);
+
+  stop_recording();
+  cache->Insert(path,
+                stamp,
+                content_hash,
+                std::move(record),
+                GetWarningTypesForCurrentFile());
 }
 
-void DumpDir(std::wstring const& path)
+void WalkDir(std::wstring const& path,
+             std::function<void(std::wstring const&)> const& dump_file)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
   WriteNormal(out, L"Entering dir: \"" + path + L"\".", 0);
@@ -141,6 +242,11 @@ void DumpDir(std::wstring const& path)
 
   do
   {
+    if (IsFileLimitReached())
+    {
+      return;
+    }
+
     std::wstring const cur_file = find_data.cFileName;
     if (cur_file == L"." || cur_file == L"..")
     {
@@ -164,36 +270,18 @@ void DumpDir(std::wstring const& path)
         }
         else
         {
-          DumpDir(cur_path);
+          WalkDir(cur_path, dump_file);
         }
       }
       else
       {
-        DumpFile(cur_path);
+        dump_file(cur_path);
       }
     }
     catch (hadesmem::Error const& e)
     {
-      auto const last_error_ptr =
-        boost::get_error_info<hadesmem::ErrorCodeWinLast>(e);
-      if (last_error_ptr && *last_error_ptr == ERROR_SHARING_VIOLATION)
-      {
-        WriteNewline(out);
-        WriteNormal(out, L"Sharing violation.", 0);
-        continue;
-      }
-
-      if (last_error_ptr && *last_error_ptr == ERROR_ACCESS_DENIED)
-      {
-        WriteNewline(out);
-        WriteNormal(out, L"Access denied.", 0);
-        continue;
-      }
-
-      if (last_error_ptr && *last_error_ptr == ERROR_FILE_NOT_FOUND)
+      if (HandleFileError(e))
       {
-        WriteNewline(out);
-        WriteNormal(out, L"File not found.", 0);
         continue;
       }
 
@@ -210,3 +298,269 @@ void DumpDir(std::wstring const& path)
     hadesmem::Error() << hadesmem::ErrorString("FindNextFile failed.")
                       << hadesmem::ErrorCodeWinLast(last_error));
 }
+
+// Dumps files on a pool of worker threads. A single producer thread walks the
+// directory tree and queues files, workers dump each file into its own
+// buffer, and the calling thread emits the buffers (along with any output
+// from the directory walk) strictly in enumeration order. Warned files are
+// deferred per file and committed in the same order, and an unhandled error
+// is rethrown only once all output preceding it has been emitted, so the
+// result is indistinguishable from a sequential dump.
+class ParallelDumper
+{
+public:
+  explicit ParallelDumper(std::uint32_t jobs)
+    : jobs_{jobs},
+      max_pending_{static_cast<std::size_t>(jobs) * 64},
+      format_{GetOutput().GetFormat()}
+  {
+  }
+
+  ParallelDumper(ParallelDumper const&) = delete;
+
+  ParallelDumper& operator=(ParallelDumper const&) = delete;
+
+  void Run(std::wstring const& path)
+  {
+    std::vector<std::thread> threads;
+    auto const join_threads = [&]()
+    {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        aborted_ = true;
+      }
+      work_cv_.notify_all();
+      space_cv_.notify_all();
+
+      for (auto& thread : threads)
+      {
+        thread.join();
+      }
+    };
+    auto scope_join_threads = hadesmem::detail::MakeScopeWarden(join_threads);
+
+    threads.emplace_back(&ParallelDumper::Produce, this, path);
+    for (std::uint32_t i = 0; i < jobs_; ++i)
+    {
+      threads.emplace_back(&ParallelDumper::Work, this);
+    }
+
+    Emit();
+  }
+
+private:
+  static std::size_t const kJobBufferLen = 0x4000;
+
+  struct Job
+  {
+    std::wstring path;
+    std::wstring prefix;
+    std::wostringstream output;
+    std::vector<std::wstring> warned;
+    std::exception_ptr error;
+    bool done{};
+  };
+
+  void Produce(std::wstring const& path)
+  {
+    // Output from the directory walk itself is attached to the next queued
+    // file so that it is emitted in the correct position.
+    std::wostringstream prefix_stream;
+    Output prefix_out{prefix_stream, kJobBufferLen};
+    prefix_out.SetFormat(format_);
+    SetThreadOutput(&prefix_out);
+
+    auto const take_prefix = [&]()
+    {
+      prefix_out.Flush();
+      std::wstring prefix = prefix_stream.str();
+      prefix_stream.str(std::wstring());
+      return prefix;
+    };
+
+    auto job = std::make_shared<Job>();
+    try
+    {
+      WalkDir(path,
+              [&](std::wstring const& file_path)
+              {
+        job->path = file_path;
+        job->prefix = take_prefix();
+        if (!Push(job))
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            hadesmem::Error() << hadesmem::ErrorString("Dump aborted."));
+        }
+
+        job = std::make_shared<Job>();
+      });
+    }
+    catch (...)
+    {
+      job->error = std::current_exception();
+    }
+
+    SetThreadOutput(nullptr);
+    job->prefix = take_prefix();
+    job->done = true;
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    ordered_.push_back(job);
+    producer_done_ = true;
+    work_cv_.notify_all();
+    done_cv_.notify_one();
+  }
+
+  bool Push(std::shared_ptr<Job> const& job)
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+    space_cv_.wait(lock,
+                   [&]()
+                   {
+      return aborted_ || ordered_.size() < max_pending_;
+    });
+    if (aborted_)
+    {
+      return false;
+    }
+
+    ordered_.push_back(job);
+    queue_.push_back(job);
+    work_cv_.notify_one();
+    return true;
+  }
+
+  void Work()
+  {
+    for (;;)
+    {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        work_cv_.wait(lock,
+                      [&]()
+                      {
+          return aborted_ || producer_done_ || !queue_.empty();
+        });
+        if (aborted_ || queue_.empty())
+        {
+          return;
+        }
+
+        job = queue_.front();
+        queue_.pop_front();
+      }
+
+      DumpJob(*job);
+
+      std::lock_guard<std::mutex> lock{mutex_};
+      job->done = true;
+      done_cv_.notify_one();
+    }
+  }
+
+  void DumpJob(Job& job)
+  {
+    Output out{job.output, kJobBufferLen};
+    out.SetFormat(format_);
+    SetThreadOutput(&out);
+    SetThreadDeferredWarnings(&job.warned);
+
+    try
+    {
+      out.SetFilePath(job.path);
+
+      try
+      {
+        DumpFileImpl(job.path);
+      }
+      catch (hadesmem::Error const& e)
+      {
+        if (!HandleFileError(e))
+        {
+          throw;
+        }
+      }
+    }
+    catch (...)
+    {
+      job.error = std::current_exception();
+    }
+
+    SetThreadDeferredWarnings(nullptr);
+    SetThreadOutput(nullptr);
+    out.Flush();
+  }
+
+  void Emit()
+  {
+    Output& out = GetOutput();
+
+    for (;;)
+    {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        done_cv_.wait(lock,
+                      [&]()
+                      {
+          return !ordered_.empty() && ordered_.front()->done;
+        });
+        job = ordered_.front();
+        ordered_.pop_front();
+      }
+      space_cv_.notify_one();
+
+      out.Raw(job->prefix.c_str(), job->prefix.size());
+      if (!job->path.empty())
+      {
+        SetCurrentFilePath(job->path);
+        std::wstring const output = job->output.str();
+        out.Raw(output.c_str(), output.size());
+        CommitWarnings(job->warned);
+      }
+
+      if (job->error)
+      {
+        std::rethrow_exception(job->error);
+      }
+
+      if (job->path.empty())
+      {
+        return;
+      }
+    }
+  }
+
+  std::uint32_t jobs_;
+  std::size_t max_pending_;
+  OutputFormat format_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::condition_variable space_cv_;
+  std::deque<std::shared_ptr<Job>> ordered_;
+  std::deque<std::shared_ptr<Job>> queue_;
+  bool producer_done_{};
+  bool aborted_{};
+};
+}
+
+void DumpFile(std::wstring const& path)
+{
+  SetCurrentFilePath(path);
+
+  DumpFileImpl(path);
+}
+
+void DumpDir(std::wstring const& path, std::uint32_t jobs)
+{
+  if (jobs > 1)
+  {
+    ParallelDumper dumper{jobs};
+    dumper.Run(path);
+    return;
+  }
+
+  WalkDir(path, &DumpFile);
+}
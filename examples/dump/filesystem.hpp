@@ -3,8 +3,12 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 void DumpFile(std::wstring const& path);
 
-void DumpDir(std::wstring const& path);
+// Files are dumped on 'jobs' worker threads when 'jobs' is greater than one.
+// Output is buffered per file and emitted in enumeration order, so the result
+// is identical to a sequential dump.
+void DumpDir(std::wstring const& path, std::uint32_t jobs = 1);
@@ -4,6 +4,8 @@
 #include "main.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <ctime>
 #include <fstream>
 #include <iostream>
@@ -41,11 +43,13 @@
 #include <hadesmem/thread_entry.hpp>
 
 #include "bound_imports.hpp"
+#include "cache.hpp"
 #include "exports.hpp"
 #include "filesystem.hpp"
 #include "headers.hpp"
 #include "imports.hpp"
 #include "memory.hpp"
+#include "output.hpp"
 #include "print.hpp"
 #include "relocations.hpp"
 #include "sections.hpp"
@@ -56,10 +60,28 @@
 namespace
 {
 std::wstring g_current_file_path;
+std::atomic<std::uint64_t> g_pe_files_dumped{0};
+std::atomic<std::uint64_t> g_pe_files_claimed{0};
+std::uint64_t g_max_pe_files = 0;
+
+std::uint64_t GetPerformanceCounter()
+{
+  LARGE_INTEGER counter{};
+  ::QueryPerformanceCounter(&counter);
+  return static_cast<std::uint64_t>(counter.QuadPart);
+}
+
+double GetPerformanceCounterSeconds(std::uint64_t ticks)
+{
+  LARGE_INTEGER frequency{};
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(ticks) /
+         static_cast<double>(frequency.QuadPart);
+}
 
 void DumpRegions(hadesmem::Process const& process)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
   WriteNormal(out, L"Regions:", 0);
@@ -84,7 +106,7 @@ void DumpRegions(hadesmem::Process const& process)
 
 void DumpModules(hadesmem::Process const& process)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
   WriteNormal(out, L"Modules:", 0);
@@ -120,7 +142,7 @@ void DumpModules(hadesmem::Process const& process)
 
 void DumpThreadEntry(hadesmem::ThreadEntry const& thread_entry)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
   WriteNamedHex(out, L"Usage", thread_entry.GetUsage(), 1);
@@ -133,7 +155,7 @@ void DumpThreadEntry(hadesmem::ThreadEntry const& thread_entry)
 
 void DumpThreads(DWORD pid)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
   WriteNormal(out, L"Threads:", 0);
@@ -147,7 +169,7 @@ void DumpThreads(DWORD pid)
 
 void DumpProcessEntry(hadesmem::ProcessEntry const& process_entry)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
   WriteNamedHex(out, L"ID", process_entry.GetId(), 0);
@@ -198,7 +220,7 @@ void DumpProcessEntry(hadesmem::ProcessEntry const& process_entry)
 
 void DumpProcesses()
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
   WriteNormal(out, L"Processes:", 0);
@@ -215,10 +237,12 @@ void DumpPeFile(hadesmem::Process const& process,
                 hadesmem::PeFile const& pe_file,
                 std::wstring const& path)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   ClearWarnForCurrentFile();
 
+  ++g_pe_files_dumped;
+
   std::uint32_t const k1MB = (1U << 20);
   std::uint32_t const k100MB = k1MB * 100;
   if (pe_file.GetSize() > k100MB)
@@ -249,9 +273,50 @@ void DumpPeFile(hadesmem::Process const& process,
   HandleWarnings(path);
 }
 
+void ReplayPeFile(std::uint8_t const* data,
+                  std::size_t len,
+                  std::uint32_t warning_types,
+                  std::wstring const& path)
+{
+  ClearWarnForCurrentFile();
+
+  ++g_pe_files_dumped;
+
+  GetOutput().Replay(data, len);
+
+  WarnForCurrentFile(warning_types);
+
+  HandleWarnings(path);
+}
+
 void SetCurrentFilePath(std::wstring const& path)
 {
   g_current_file_path = path;
+  GetOutput().SetFilePath(path);
+}
+
+bool IsFileLimitReached()
+{
+  return g_max_pe_files && g_pe_files_claimed >= g_max_pe_files;
+}
+
+bool ClaimFileLimitSlot()
+{
+  if (!g_max_pe_files)
+  {
+    return true;
+  }
+
+  std::uint64_t claimed = g_pe_files_claimed.load();
+  do
+  {
+    if (claimed >= g_max_pe_files)
+    {
+      return false;
+    }
+  } while (!g_pe_files_claimed.compare_exchange_weak(claimed, claimed + 1));
+
+  return true;
 }
 
 void HandleLongOrUnprintableString(std::wstring const& name,
@@ -260,7 +325,7 @@ void HandleLongOrUnprintableString(std::wstring const& name,
                                    WarningType warning_type,
                                    std::string value)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   auto const unprintable = FindFirstUnprintableClassicLocale(value);
   std::size_t const kMaxNameLength = 1024;
@@ -282,7 +347,7 @@ void HandleLongOrUnprintableString(std::wstring const& name,
     WarnForCurrentFile(warning_type);
     value.erase(kMaxNameLength);
   }
-  WriteNamedNormal(out, name, value.c_str(), tabs);
+  WriteNamedNormal(out, name.c_str(), value.c_str(), tabs);
 }
 
 bool ConvertTimeStamp(std::time_t time, std::wstring& str)
@@ -349,8 +414,65 @@ int main(int argc, char* argv[])
                                          -1,
                                          "int",
                                          cmd);
+    TCLAP::ValueArg<std::string> format_arg(
+      "",
+      "format",
+      "Output format ('text' or 'jsonl' for one JSON record per line)",
+      false,
+      "text",
+      "string",
+      cmd);
+    TCLAP::ValueArg<std::uint64_t> max_files_arg(
+      "",
+      "max-files",
+      "Stop after dumping the given number of PE files",
+      false,
+      0,
+      "uint64",
+      cmd);
+    TCLAP::ValueArg<std::uint32_t> jobs_arg(
+      "",
+      "jobs",
+      "Number of worker threads to use when dumping a directory",
+      false,
+      1,
+      "uint32",
+      cmd);
+    TCLAP::ValueArg<std::string> cache_arg(
+      "",
+      "cache",
+      "Cache dump output for PE files in the given file, so unchanged files "
+      "are not parsed again on subsequent runs",
+      false,
+      "",
+      "string",
+      cmd);
+    TCLAP::SwitchArg bench_arg(
+      "", "bench", "Print timing statistics to stderr when finished", cmd);
     cmd.parse(argc, argv);
 
+    std::uint64_t const bench_start = GetPerformanceCounter();
+
+    if (format_arg.getValue() == "jsonl")
+    {
+      GetOutput().SetFormat(OutputFormat::kJsonLines);
+    }
+    else if (format_arg.getValue() != "text")
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        hadesmem::Error() << hadesmem::ErrorString("Unknown output format."));
+    }
+
+    g_max_pe_files = max_files_arg.getValue();
+
+    std::unique_ptr<DumpCache> cache;
+    if (cache_arg.isSet())
+    {
+      cache = std::make_unique<DumpCache>(
+        hadesmem::detail::MultiByteToWideChar(cache_arg.getValue()));
+      SetDumpCache(cache.get());
+    }
+
     SetWarningsEnabled(warned_arg.getValue());
     SetDynamicWarningsEnabled(warned_file_dynamic_arg.getValue());
     if (warned_file_arg.isSet())
@@ -388,11 +510,13 @@ int main(int argc, char* argv[])
     {
       hadesmem::GetSeDebugPrivilege();
 
-      std::wcout << "\nAcquired SeDebugPrivilege.\n";
+      WriteNewline(GetOutput());
+      WriteNormal(GetOutput(), L"Acquired SeDebugPrivilege.", 0);
     }
     catch (std::exception const& /*e*/)
     {
-      std::wcout << "\nFailed to acquire SeDebugPrivilege.\n";
+      WriteNewline(GetOutput());
+      WriteNormal(GetOutput(), L"Failed to acquire SeDebugPrivilege.", 0);
     }
 
     if (pid_arg.isSet())
@@ -431,7 +555,7 @@ int main(int argc, char* argv[])
         hadesmem::detail::MultiByteToWideChar(path_arg.getValue());
       if (hadesmem::detail::IsDirectory(path))
       {
-        DumpDir(path);
+        DumpDir(path, jobs_arg.getValue());
       }
       else
       {
@@ -444,11 +568,12 @@ int main(int argc, char* argv[])
 
       DumpProcesses();
 
-      std::wcout << "\nFiles:\n";
+      WriteNewline(GetOutput());
+      WriteNormal(GetOutput(), L"Files:", 0);
 
       std::wstring const self_path = hadesmem::detail::GetSelfPath();
       std::wstring const root_path = hadesmem::detail::GetRootPath(self_path);
-      DumpDir(root_path);
+      DumpDir(root_path, jobs_arg.getValue());
     }
 
     if (GetWarningsEnabled())
@@ -466,18 +591,65 @@ int main(int argc, char* argv[])
             << hadesmem::ErrorString("Failed to open warned file for output."));
         }
 
-        DumpWarned(warned_file);
+        Output warned_out{warned_file};
+        DumpWarned(warned_out);
+        warned_out.Flush();
       }
       else
       {
-        DumpWarned(std::wcout);
+        DumpWarned(GetOutput());
       }
     }
 
+    GetOutput().Flush();
+
+    if (cache)
+    {
+      SetDumpCache(nullptr);
+      cache->Save();
+
+      DumpCacheStats const stats = cache->GetStats();
+      std::uint64_t const lookups =
+        stats.stamp_hits + stats.content_hits + stats.misses;
+      double const hit_rate =
+        lookups ? 100.0 * static_cast<double>(lookups - stats.misses) /
+                    static_cast<double>(lookups)
+                : 0.0;
+      std::wcerr << "\nCache hits (unchanged): " << stats.stamp_hits
+                 << "\nCache hits (content): " << stats.content_hits
+                 << "\nCache misses: " << stats.misses
+                 << "\nCache hit rate (%): " << hit_rate
+                 << "\nCache evicted: " << stats.evicted
+                 << "\nCache files: " << stats.files
+                 << "\nCache contents: " << stats.contents
+                 << "\nCache size (bytes): " << stats.bytes << '\n';
+    }
+
+    if (bench_arg.getValue())
+    {
+      double const elapsed =
+        GetPerformanceCounterSeconds(GetPerformanceCounter() - bench_start);
+      double const files_per_sec =
+        elapsed > 0 ? static_cast<double>(g_pe_files_dumped.load()) / elapsed
+                    : 0.0;
+      std::wcerr << "\nPE files: " << g_pe_files_dumped.load()
+                 << "\nOutput chars: " << GetOutput().GetCharsWritten()
+                 << "\nElapsed (s): " << elapsed
+                 << "\nFiles/s: " << files_per_sec << '\n';
+    }
+
     return 0;
   }
   catch (...)
   {
+    try
+    {
+      GetOutput().Flush();
+    }
+    catch (...)
+    {
+    }
+
     std::cerr << "\nError!\n"
               << boost::current_exception_diagnostic_information() << '\n';
 
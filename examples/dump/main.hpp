@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <ctime>
 #include <iomanip>
 #include <locale>
@@ -24,8 +25,22 @@ void DumpPeFile(hadesmem::Process const& process,
                 hadesmem::PeFile const& pe_file,
                 std::wstring const& path);
 
+// Reproduces the output and warnings of DumpPeFile from a cached recording.
+void ReplayPeFile(std::uint8_t const* data,
+                  std::size_t len,
+                  std::uint32_t warning_types,
+                  std::wstring const& path);
+
 void SetCurrentFilePath(std::wstring const& path);
 
+bool IsFileLimitReached();
+
+// Reserves one of the --max-files slots for a PE file about to be dumped.
+// Returns false (without reserving anything) if the limit has been reached.
+// Safe to call from multiple threads, so no more files than the limit are
+// ever dumped, even when several are in flight at once.
+bool ClaimFileLimitSlot();
+
 void HandleLongOrUnprintableString(std::wstring const& name,
                                    std::wstring const& description,
                                    std::size_t tabs,
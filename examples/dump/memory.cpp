@@ -9,6 +9,7 @@
 #include <limits>
 
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
 #include <hadesmem/detail/str_conv.hpp>
 #include <hadesmem/pelib/dos_header.hpp>
 #include <hadesmem/pelib/import_dir.hpp>
@@ -17,6 +18,7 @@
 #include <hadesmem/pelib/import_thunk_list.hpp>
 #include <hadesmem/pelib/nt_headers.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/rebase.hpp>
 #include <hadesmem/pelib/section.hpp>
 #include <hadesmem/pelib/section_list.hpp>
 #include <hadesmem/module.hpp>
@@ -50,7 +52,7 @@ std::uint64_t RoundUp(std::uint64_t n, std::uint64_t m)
 
 void DumpMemory(hadesmem::Process const& process)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
   WriteNormal(out, "Dumping image memory to disk.", 0);
@@ -79,6 +81,27 @@ void DumpMemory(hadesmem::Process const& process)
       module.GetHandle(),
       module.GetSize(),
       hadesmem::ReadFlags::kZeroFillReserved);
+
+    // Revert the image to the base it has on disk, so that dumps are
+    // comparable regardless of where ASLR put the module. RebaseImage doesn't
+    // write anything unless it succeeds, so if that fails the image is left
+    // as loaded, relocated for (and based at) its current address.
+    WriteNormal(out, L"Reverting relocations.", 1);
+    auto const loaded_base =
+      reinterpret_cast<std::uintptr_t>(module.GetHandle());
+    try
+    {
+      auto const file = hadesmem::detail::FileToBuffer(module.GetPath());
+      auto const preferred_base =
+        hadesmem::GetImageBase(file.data(), file.size());
+      hadesmem::RebaseImage(
+        raw.data(), raw.size(), loaded_base, preferred_base);
+    }
+    catch (std::exception const& /*e*/)
+    {
+      WriteNormal(out, "WARNING! Unable to revert relocations.", 1);
+    }
+
     hadesmem::Process const local_process(::GetCurrentProcessId());
     hadesmem::PeFile const pe_file(local_process,
                                    raw.data(),
@@ -124,12 +147,6 @@ void DumpMemory(hadesmem::Process const& process)
                                        hadesmem::PeFileType::Data,
                                        static_cast<DWORD>(raw_new.size()));
 
-    WriteNormal(out, L"Fixing NT headers.", 1);
-    hadesmem::NtHeaders nt_headers_new(local_process, pe_file_new);
-    nt_headers_new.SetImageBase(
-      reinterpret_cast<ULONG_PTR>(module.GetHandle()));
-    nt_headers_new.UpdateWrite();
-
     WriteNormal(out, L"Fixing section headers.", 1);
     hadesmem::SectionList sections_new(local_process, pe_file_new);
     std::size_t n = 0;
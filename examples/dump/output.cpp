@@ -0,0 +1,825 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include "output.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/error.hpp>
+
+namespace
+{
+wchar_t const kHexDigits[] = L"0123456789ABCDEF";
+
+__declspec(thread) Output* g_thread_output = nullptr;
+
+// Opcodes used by Output::SetRecord and Output::Replay.
+enum RecordOpcode : std::uint8_t
+{
+  kRecordRaw,
+  kRecordNewline,
+  kRecordLineWide,
+  kRecordLineNarrow,
+  kRecordNamedHexSuffix,
+  kRecordNamedHexList,
+  kRecordNamedStringWide,
+  kRecordNamedStringNarrow,
+  kRecordNamedBool
+};
+
+// Bounds checked reader for recorded output (which may have come from an on
+// disk cache).
+class RecordReader
+{
+public:
+  RecordReader(std::uint8_t const* data, std::size_t len)
+    : cur_{data}, end_{data + len}
+  {
+  }
+
+  bool Done() const
+  {
+    return cur_ == end_;
+  }
+
+  std::uint8_t ReadU8()
+  {
+    std::uint8_t value = 0;
+    Read(&value, sizeof(value));
+    return value;
+  }
+
+  std::size_t ReadU32()
+  {
+    std::uint32_t value = 0;
+    Read(&value, sizeof(value));
+    return value;
+  }
+
+  std::uint64_t ReadU64()
+  {
+    std::uint64_t value = 0;
+    Read(&value, sizeof(value));
+    return value;
+  }
+
+  template <typename CharT> void ReadString(std::basic_string<CharT>& value)
+  {
+    std::size_t const len = ReadU32();
+    if (static_cast<std::size_t>(end_ - cur_) / sizeof(CharT) < len)
+    {
+      ThrowInvalid();
+    }
+    value.resize(len);
+    Read(&value[0], len * sizeof(CharT));
+  }
+
+private:
+  void Read(void* value, std::size_t len)
+  {
+    if (static_cast<std::size_t>(end_ - cur_) < len)
+    {
+      ThrowInvalid();
+    }
+    std::memcpy(value, cur_, len);
+    cur_ += len;
+  }
+
+  static void ThrowInvalid()
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error() << hadesmem::ErrorString("Invalid recorded output."));
+  }
+
+  std::uint8_t const* cur_;
+  std::uint8_t const* end_;
+};
+
+// Everything outside of printable ASCII is escaped so that JSON output is
+// independent of the encoding used by the underlying stream.
+template <typename CharT, typename OutputIterator>
+OutputIterator EscapeJsonString(CharT const* s,
+                                std::size_t len,
+                                OutputIterator out)
+{
+  using UCharT = typename std::make_unsigned<CharT>::type;
+
+  *out++ = L'"';
+  for (std::size_t i = 0; i < len; ++i)
+  {
+    auto const c = static_cast<UCharT>(s[i]);
+    if (c == '"' || c == '\\')
+    {
+      *out++ = L'\\';
+      *out++ = static_cast<wchar_t>(c);
+    }
+    else if (c >= 0x20 && c < 0x7F)
+    {
+      *out++ = static_cast<wchar_t>(c);
+    }
+    else
+    {
+      *out++ = L'\\';
+      *out++ = L'u';
+      *out++ = kHexDigits[(c >> 12) & 0xF];
+      *out++ = kHexDigits[(c >> 8) & 0xF];
+      *out++ = kHexDigits[(c >> 4) & 0xF];
+      *out++ = kHexDigits[c & 0xF];
+    }
+  }
+  *out++ = L'"';
+  return out;
+}
+}
+
+Output::Output(std::wostream& stream, std::size_t buffer_len)
+  : stream_{&stream}, buf_(buffer_len)
+{
+  HADESMEM_DETAIL_ASSERT(buffer_len != 0);
+}
+
+Output::~Output()
+{
+  try
+  {
+    Flush();
+  }
+  catch (...)
+  {
+    HADESMEM_DETAIL_TRACE_A(
+      boost::current_exception_diagnostic_information().c_str());
+    HADESMEM_DETAIL_ASSERT(false);
+  }
+}
+
+OutputFormat Output::GetFormat() const
+{
+  return format_;
+}
+
+void Output::SetFormat(OutputFormat format)
+{
+  format_ = format;
+}
+
+void Output::SetFilePath(std::wstring const& path)
+{
+  if (format_ != OutputFormat::kJsonLines)
+  {
+    return;
+  }
+
+  // Escape the path once up front rather than once per record.
+  json_file_.clear();
+  EscapeJsonString(path.c_str(), path.size(), std::back_inserter(json_file_));
+
+  sections_.clear();
+  json_section_.clear();
+  record_ = 0;
+}
+
+std::uint64_t Output::GetCharsWritten() const
+{
+  return chars_written_ + pos_;
+}
+
+void Output::Flush()
+{
+  if (!pos_)
+  {
+    return;
+  }
+
+  std::size_t const len = pos_;
+  pos_ = 0;
+  chars_written_ += len;
+  if (!stream_->write(buf_.data(), static_cast<std::streamsize>(len)))
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      hadesmem::Error() << hadesmem::ErrorString("Failed to write output."));
+  }
+}
+
+void Output::Raw(wchar_t const* value, std::size_t len)
+{
+  if (recorded_)
+  {
+    RecordOp(kRecordRaw);
+    RecordString(value, len);
+  }
+
+  if (len > buf_.size())
+  {
+    Flush();
+    chars_written_ += len;
+    if (!stream_->write(value, static_cast<std::streamsize>(len)))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        hadesmem::Error() << hadesmem::ErrorString("Failed to write output."));
+    }
+    return;
+  }
+
+  Put(value, len);
+}
+
+void Output::Newline()
+{
+  if (recorded_)
+  {
+    RecordOp(kRecordNewline);
+  }
+
+  if (format_ == OutputFormat::kJsonLines)
+  {
+    ++record_;
+    return;
+  }
+
+  Put(L'\n');
+}
+
+void Output::Line(wchar_t const* value, std::size_t len, std::size_t tabs)
+{
+  if (recorded_)
+  {
+    RecordOp(kRecordLineWide);
+    RecordString(value, len);
+    RecordU32(tabs);
+  }
+
+  if (format_ == OutputFormat::kJsonLines)
+  {
+    if (len && value[len - 1] == L':')
+    {
+      UpdateSection(value, len - 1, tabs);
+      return;
+    }
+
+    BeginJsonRecord(tabs);
+    Put(L"\"text\":", 7);
+    PutJsonString(value, len);
+    Put(L"}\n", 2);
+    return;
+  }
+
+  PutTabs(tabs);
+  Put(value, len);
+  Put(L'\n');
+}
+
+void Output::Line(char const* value, std::size_t tabs)
+{
+  std::size_t const len = std::strlen(value);
+  if (recorded_)
+  {
+    RecordOp(kRecordLineNarrow);
+    RecordString(value, len);
+    RecordU32(tabs);
+  }
+
+  if (format_ == OutputFormat::kJsonLines)
+  {
+    if (len && value[len - 1] == ':')
+    {
+      // Widened byte by byte, as for the text output below.
+      std::wstring section;
+      section.reserve(len - 1);
+      for (std::size_t i = 0; i + 1 < len; ++i)
+      {
+        section.push_back(static_cast<unsigned char>(value[i]));
+      }
+      UpdateSection(section.c_str(), section.size(), tabs);
+      return;
+    }
+
+    BeginJsonRecord(tabs);
+    Put(L"\"text\":", 7);
+    PutJsonString(value, len);
+    Put(L"}\n", 2);
+    return;
+  }
+
+  PutTabs(tabs);
+  Reserve(len);
+  for (std::size_t i = 0; i < len; ++i)
+  {
+    buf_[pos_++] = static_cast<unsigned char>(value[i]);
+  }
+  Put(L'\n');
+}
+
+void Output::NamedHex(wchar_t const* name,
+                      std::uint64_t value,
+                      std::size_t width,
+                      std::size_t tabs)
+{
+  NamedHexSuffix(name, value, width, nullptr, 0, tabs);
+}
+
+void Output::NamedHexSuffix(wchar_t const* name,
+                            std::uint64_t value,
+                            std::size_t width,
+                            wchar_t const* suffix,
+                            std::size_t suffix_len,
+                            std::size_t tabs)
+{
+  if (recorded_)
+  {
+    RecordOp(kRecordNamedHexSuffix);
+    RecordString(name, std::wcslen(name));
+    RecordU64(value);
+    RecordU32(width);
+    RecordU32(suffix ? 1 : 0);
+    RecordString(suffix, suffix_len);
+    RecordU32(tabs);
+  }
+
+  if (format_ == OutputFormat::kJsonLines)
+  {
+    BeginJsonRecord(tabs);
+    Put(L"\"name\":", 7);
+    PutJsonString(name, std::wcslen(name));
+    Put(L",\"value\":\"0x", 12);
+    PutHex(value, width);
+    Put(L'"');
+    if (suffix)
+    {
+      Put(L",\"suffix\":", 10);
+      PutJsonString(suffix, suffix_len);
+    }
+    Put(L"}\n", 2);
+    return;
+  }
+
+  PutTabs(tabs);
+  Put(name, std::wcslen(name));
+  Put(L": 0x", 4);
+  PutHex(value, width);
+  if (suffix)
+  {
+    Put(L" (", 2);
+    Put(suffix, suffix_len);
+    Put(L')');
+  }
+  Put(L'\n');
+}
+
+void Output::NamedHexList(wchar_t const* name,
+                          std::uint64_t const* values,
+                          std::size_t count,
+                          std::size_t width,
+                          std::size_t tabs)
+{
+  if (recorded_)
+  {
+    RecordOp(kRecordNamedHexList);
+    RecordString(name, std::wcslen(name));
+    RecordU32(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      RecordU64(values[i]);
+    }
+    RecordU32(width);
+    RecordU32(tabs);
+  }
+
+  if (format_ == OutputFormat::kJsonLines)
+  {
+    BeginJsonRecord(tabs);
+    Put(L"\"name\":", 7);
+    PutJsonString(name, std::wcslen(name));
+    Put(L",\"value\":[", 10);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (i)
+      {
+        Put(L',');
+      }
+      Put(L"\"0x", 3);
+      PutHex(values[i], width);
+      Put(L'"');
+    }
+    Put(L"]}\n", 3);
+    return;
+  }
+
+  PutTabs(tabs);
+  Put(name, std::wcslen(name));
+  Put(L':');
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    Put(L" 0x", 3);
+    PutHex(values[i], width);
+  }
+  Put(L'\n');
+}
+
+void Output::NamedString(wchar_t const* name,
+                         wchar_t const* value,
+                         std::size_t len,
+                         std::size_t tabs)
+{
+  if (recorded_)
+  {
+    RecordOp(kRecordNamedStringWide);
+    RecordString(name, std::wcslen(name));
+    RecordString(value, len);
+    RecordU32(tabs);
+  }
+
+  if (format_ == OutputFormat::kJsonLines)
+  {
+    BeginJsonRecord(tabs);
+    Put(L"\"name\":", 7);
+    PutJsonString(name, std::wcslen(name));
+    Put(L",\"value\":", 9);
+    PutJsonString(value, len);
+    Put(L"}\n", 2);
+    return;
+  }
+
+  PutTabs(tabs);
+  Put(name, std::wcslen(name));
+  Put(L": ", 2);
+  Put(value, len);
+  Put(L'\n');
+}
+
+void Output::NamedString(wchar_t const* name,
+                         char const* value,
+                         std::size_t tabs)
+{
+  NamedString(name, value, std::strlen(value), tabs);
+}
+
+void Output::NamedString(wchar_t const* name,
+                         char const* value,
+                         std::size_t len,
+                         std::size_t tabs)
+{
+  if (recorded_)
+  {
+    RecordOp(kRecordNamedStringNarrow);
+    RecordString(name, std::wcslen(name));
+    RecordString(value, len);
+    RecordU32(tabs);
+  }
+
+  if (format_ == OutputFormat::kJsonLines)
+  {
+    BeginJsonRecord(tabs);
+    Put(L"\"name\":", 7);
+    PutJsonString(name, std::wcslen(name));
+    Put(L",\"value\":", 9);
+    PutJsonString(value, len);
+    Put(L"}\n", 2);
+    return;
+  }
+
+  PutTabs(tabs);
+  Put(name, std::wcslen(name));
+  Put(L": ", 2);
+  Reserve(len);
+  for (std::size_t i = 0; i < len; ++i)
+  {
+    buf_[pos_++] = static_cast<unsigned char>(value[i]);
+  }
+  Put(L'\n');
+}
+
+void Output::NamedBool(wchar_t const* name, bool value, std::size_t tabs)
+{
+  if (recorded_)
+  {
+    RecordOp(kRecordNamedBool);
+    RecordString(name, std::wcslen(name));
+    RecordU32(value ? 1 : 0);
+    RecordU32(tabs);
+  }
+
+  if (format_ == OutputFormat::kJsonLines)
+  {
+    BeginJsonRecord(tabs);
+    Put(L"\"name\":", 7);
+    PutJsonString(name, std::wcslen(name));
+    Put(L",\"value\":", 9);
+    if (value)
+    {
+      Put(L"true", 4);
+    }
+    else
+    {
+      Put(L"false", 5);
+    }
+    Put(L"}\n", 2);
+    return;
+  }
+
+  PutTabs(tabs);
+  Put(name, std::wcslen(name));
+  Put(L": ", 2);
+  Put(value ? L'1' : L'0');
+  Put(L'\n');
+}
+
+void Output::SetRecord(std::vector<std::uint8_t>* record)
+{
+  recorded_ = record;
+}
+
+void Output::Replay(std::uint8_t const* data, std::size_t len)
+{
+  RecordReader reader{data, len};
+  std::wstring name;
+  std::wstring wide;
+  std::string narrow;
+  std::vector<std::uint64_t> values;
+  while (!reader.Done())
+  {
+    switch (reader.ReadU8())
+    {
+    case kRecordRaw:
+      reader.ReadString(wide);
+      Raw(wide.c_str(), wide.size());
+      break;
+
+    case kRecordNewline:
+      Newline();
+      break;
+
+    case kRecordLineWide:
+    {
+      reader.ReadString(wide);
+      std::size_t const tabs = reader.ReadU32();
+      Line(wide.c_str(), wide.size(), tabs);
+      break;
+    }
+
+    case kRecordLineNarrow:
+    {
+      reader.ReadString(narrow);
+      std::size_t const tabs = reader.ReadU32();
+      Line(narrow.c_str(), tabs);
+      break;
+    }
+
+    case kRecordNamedHexSuffix:
+    {
+      reader.ReadString(name);
+      std::uint64_t const value = reader.ReadU64();
+      std::size_t const width = reader.ReadU32();
+      bool const has_suffix = reader.ReadU32() != 0;
+      reader.ReadString(wide);
+      std::size_t const tabs = reader.ReadU32();
+      NamedHexSuffix(name.c_str(),
+                     value,
+                     width,
+                     has_suffix ? wide.c_str() : nullptr,
+                     wide.size(),
+                     tabs);
+      break;
+    }
+
+    case kRecordNamedHexList:
+    {
+      reader.ReadString(name);
+      values.resize(reader.ReadU32());
+      for (auto& value : values)
+      {
+        value = reader.ReadU64();
+      }
+      std::size_t const width = reader.ReadU32();
+      std::size_t const tabs = reader.ReadU32();
+      NamedHexList(name.c_str(), values.data(), values.size(), width, tabs);
+      break;
+    }
+
+    case kRecordNamedStringWide:
+    {
+      reader.ReadString(name);
+      reader.ReadString(wide);
+      std::size_t const tabs = reader.ReadU32();
+      NamedString(name.c_str(), wide.c_str(), wide.size(), tabs);
+      break;
+    }
+
+    case kRecordNamedStringNarrow:
+    {
+      reader.ReadString(name);
+      reader.ReadString(narrow);
+      std::size_t const tabs = reader.ReadU32();
+      NamedString(name.c_str(), narrow.c_str(), narrow.size(), tabs);
+      break;
+    }
+
+    case kRecordNamedBool:
+    {
+      reader.ReadString(name);
+      bool const value = reader.ReadU32() != 0;
+      std::size_t const tabs = reader.ReadU32();
+      NamedBool(name.c_str(), value, tabs);
+      break;
+    }
+
+    default:
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        hadesmem::Error() << hadesmem::ErrorString("Invalid recorded output."));
+    }
+  }
+}
+
+void Output::Reserve(std::size_t len)
+{
+  if (buf_.size() - pos_ >= len)
+  {
+    return;
+  }
+
+  Flush();
+
+  if (buf_.size() < len)
+  {
+    buf_.resize(len);
+  }
+}
+
+void Output::Put(wchar_t c)
+{
+  if (pos_ == buf_.size())
+  {
+    Flush();
+  }
+
+  buf_[pos_++] = c;
+}
+
+void Output::Put(wchar_t const* s, std::size_t len)
+{
+  Reserve(len);
+  std::copy(s, s + len, buf_.data() + pos_);
+  pos_ += len;
+}
+
+void Output::PutTabs(std::size_t tabs)
+{
+  Reserve(tabs);
+  std::fill(buf_.data() + pos_, buf_.data() + pos_ + tabs, L'\t');
+  pos_ += tabs;
+}
+
+void Output::PutHex(std::uint64_t value, std::size_t width)
+{
+  wchar_t digits[16];
+  std::size_t len = 0;
+  do
+  {
+    digits[len++] = kHexDigits[value & 0xF];
+    value >>= 4;
+  } while (value);
+
+  std::size_t const pad = width > len ? width - len : 0;
+  Reserve(pad + len);
+  std::fill(buf_.data() + pos_, buf_.data() + pos_ + pad, L'0');
+  pos_ += pad;
+  while (len)
+  {
+    buf_[pos_++] = digits[--len];
+  }
+}
+
+void Output::PutDec(std::uint64_t value)
+{
+  wchar_t digits[20];
+  std::size_t len = 0;
+  do
+  {
+    digits[len++] = static_cast<wchar_t>(L'0' + value % 10);
+    value /= 10;
+  } while (value);
+
+  Reserve(len);
+  while (len)
+  {
+    buf_[pos_++] = digits[--len];
+  }
+}
+
+template <typename CharT>
+void Output::PutJsonString(CharT const* s, std::size_t len)
+{
+  std::size_t const kMaxEscapedCharLen = 6;
+  Reserve(len * kMaxEscapedCharLen + 2);
+  pos_ = EscapeJsonString(s, len, buf_.data() + pos_) - buf_.data();
+}
+
+void Output::BeginJsonRecord(std::size_t tabs)
+{
+  Put(L"{\"file\":", 8);
+  if (json_file_.empty())
+  {
+    Put(L"null", 4);
+  }
+  else
+  {
+    Put(json_file_.data(), json_file_.size());
+  }
+  Put(L",\"section\":", 11);
+  if (json_section_.empty())
+  {
+    Put(L"null", 4);
+  }
+  else
+  {
+    Put(json_section_.data(), json_section_.size());
+  }
+  Put(L",\"record\":", 10);
+  PutDec(record_);
+  Put(L",\"depth\":", 9);
+  PutDec(tabs);
+  Put(L',');
+}
+
+// Text mode headings (e.g. "NT Headers:") become the section path attached to
+// each subsequent record at a greater depth.
+void Output::UpdateSection(wchar_t const* value,
+                           std::size_t len,
+                           std::size_t tabs)
+{
+  sections_.resize(tabs);
+  sections_.emplace_back(value, len);
+
+  std::wstring path;
+  for (auto const& section : sections_)
+  {
+    if (section.empty())
+    {
+      continue;
+    }
+
+    if (!path.empty())
+    {
+      path += L'/';
+    }
+    path += section;
+  }
+
+  json_section_.clear();
+  EscapeJsonString(
+    path.c_str(), path.size(), std::back_inserter(json_section_));
+}
+
+void Output::RecordOp(std::uint8_t op)
+{
+  recorded_->push_back(op);
+}
+
+void Output::RecordU32(std::size_t value)
+{
+  HADESMEM_DETAIL_ASSERT(value <= 0xFFFFFFFFUL);
+  auto const value_32 = static_cast<std::uint32_t>(value);
+  auto const p = reinterpret_cast<std::uint8_t const*>(&value_32);
+  recorded_->insert(std::end(*recorded_), p, p + sizeof(value_32));
+}
+
+void Output::RecordU64(std::uint64_t value)
+{
+  auto const p = reinterpret_cast<std::uint8_t const*>(&value);
+  recorded_->insert(std::end(*recorded_), p, p + sizeof(value));
+}
+
+template <typename CharT>
+void Output::RecordString(CharT const* s, std::size_t len)
+{
+  RecordU32(len);
+  if (len)
+  {
+    auto const p = reinterpret_cast<std::uint8_t const*>(s);
+    recorded_->insert(std::end(*recorded_), p, p + len * sizeof(CharT));
+  }
+}
+
+Output& GetOutput()
+{
+  if (g_thread_output)
+  {
+    return *g_thread_output;
+  }
+
+  static Output out{std::wcout};
+  return out;
+}
+
+void SetThreadOutput(Output* out)
+{
+  g_thread_output = out;
+}
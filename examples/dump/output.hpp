@@ -0,0 +1,140 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+enum class OutputFormat
+{
+  kText,
+  kJsonLines
+};
+
+// Buffered writer used for all dump output. Formatting is done by hand into a
+// large reusable buffer (no iostream manipulators, no locale lookups, no
+// temporary strings) which is handed to the underlying stream in large chunks.
+// In JSON lines mode every field is emitted as a self-contained record tagged
+// with the current file and section so the output can be indexed directly.
+class Output
+{
+public:
+  static std::size_t const kDefaultBufferLen = 1U << 18;
+
+  explicit Output(std::wostream& stream,
+                  std::size_t buffer_len = kDefaultBufferLen);
+
+  Output(Output const&) = delete;
+
+  Output& operator=(Output const&) = delete;
+
+  ~Output();
+
+  OutputFormat GetFormat() const;
+
+  void SetFormat(OutputFormat format);
+
+  void SetFilePath(std::wstring const& path);
+
+  std::uint64_t GetCharsWritten() const;
+
+  void Flush();
+
+  // Append pre-formatted output (e.g. output buffered by another thread).
+  void Raw(wchar_t const* value, std::size_t len);
+
+  void Newline();
+
+  void Line(wchar_t const* value, std::size_t len, std::size_t tabs);
+
+  void Line(char const* value, std::size_t tabs);
+
+  void NamedHex(wchar_t const* name,
+                std::uint64_t value,
+                std::size_t width,
+                std::size_t tabs);
+
+  void NamedHexSuffix(wchar_t const* name,
+                      std::uint64_t value,
+                      std::size_t width,
+                      wchar_t const* suffix,
+                      std::size_t suffix_len,
+                      std::size_t tabs);
+
+  void NamedHexList(wchar_t const* name,
+                    std::uint64_t const* values,
+                    std::size_t count,
+                    std::size_t width,
+                    std::size_t tabs);
+
+  void NamedString(wchar_t const* name,
+                   wchar_t const* value,
+                   std::size_t len,
+                   std::size_t tabs);
+
+  void NamedString(wchar_t const* name, char const* value, std::size_t tabs);
+
+  void NamedString(wchar_t const* name,
+                   char const* value,
+                   std::size_t len,
+                   std::size_t tabs);
+
+  void NamedBool(wchar_t const* name, bool value, std::size_t tabs);
+
+  // While a record is set every call is also appended to it in a compact
+  // binary form, independent of the output format and current file, which can
+  // later be passed to Replay to reproduce the same calls.
+  void SetRecord(std::vector<std::uint8_t>* record);
+
+  void Replay(std::uint8_t const* data, std::size_t len);
+
+private:
+  void Reserve(std::size_t len);
+
+  void Put(wchar_t c);
+
+  void Put(wchar_t const* s, std::size_t len);
+
+  void PutTabs(std::size_t tabs);
+
+  void PutHex(std::uint64_t value, std::size_t width);
+
+  void PutDec(std::uint64_t value);
+
+  template <typename CharT>
+  void PutJsonString(CharT const* s, std::size_t len);
+
+  void BeginJsonRecord(std::size_t tabs);
+
+  void UpdateSection(wchar_t const* value, std::size_t len, std::size_t tabs);
+
+  void RecordOp(std::uint8_t op);
+
+  void RecordU32(std::size_t value);
+
+  void RecordU64(std::uint64_t value);
+
+  template <typename CharT> void RecordString(CharT const* s, std::size_t len);
+
+  std::wostream* stream_;
+  std::vector<wchar_t> buf_;
+  std::size_t pos_{};
+  std::uint64_t chars_written_{};
+  OutputFormat format_{OutputFormat::kText};
+  std::vector<wchar_t> json_file_;
+  std::vector<std::wstring> sections_;
+  std::vector<wchar_t> json_section_;
+  std::uint64_t record_{};
+  std::vector<std::uint8_t>* recorded_{};
+};
+
+// Output for the main dump stream (stdout), or the current thread's output
+// if one has been set.
+Output& GetOutput();
+
+// Redirect GetOutput on the calling thread (nullptr to restore the default).
+void SetThreadOutput(Output* out);
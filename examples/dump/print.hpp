@@ -4,95 +4,129 @@
 #pragma once
 
 #include <cstddef>
-#include <iomanip>
-#include <locale>
-#include <ostream>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 #include <vector>
 
-template <typename CharT> class StreamFlagSaver
-{
-public:
-  explicit StreamFlagSaver(std::basic_ios<CharT>& str)
-    : str_(&str), flags_(str.flags()), width_(str.width()), fill_(str.fill())
-  {
-  }
+#include "output.hpp"
 
-  ~StreamFlagSaver()
-  {
-    str_->flags(flags_);
-    str_->width(width_);
-    str_->fill(fill_);
-  }
-
-  StreamFlagSaver(StreamFlagSaver const&) = delete;
-  StreamFlagSaver& operator=(StreamFlagSaver const&) = delete;
+// Sign extension is avoided so that negative values are printed at their
+// natural width (as they were when formatted by iostreams).
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value, std::uint64_t>::type
+  ToHexValue(T const& num)
+{
+  return static_cast<typename std::make_unsigned<T>::type>(num);
+}
 
-private:
-  std::basic_ios<CharT>* str_;
-  std::ios_base::fmtflags flags_;
-  std::streamsize width_;
-  CharT fill_;
-};
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value, std::uint64_t>::type
+  ToHexValue(T const& num)
+{
+  return ToHexValue(static_cast<typename std::underlying_type<T>::type>(num));
+}
 
 template <typename T>
-inline void WriteNamedHex(std::wostream& out,
-                          std::wstring const& name,
+inline void WriteNamedHex(Output& out,
+                          wchar_t const* name,
                           T const& num,
                           std::size_t tabs)
 {
-  StreamFlagSaver<wchar_t> flags(out);
-  out << std::wstring(tabs, '\t') << name << ": 0x" << std::hex
-      << std::setw(sizeof(num) * 2) << std::setfill(L'0') << num << '\n';
+  out.NamedHex(name, ToHexValue(num), sizeof(num) * 2, tabs);
 }
 
 template <typename T>
-inline void WriteNamedHexSuffix(std::wostream& out,
-                                std::wstring const& name,
+inline void WriteNamedHexSuffix(Output& out,
+                                wchar_t const* name,
                                 T const& num,
                                 std::wstring const& suffix,
                                 std::size_t tabs)
 {
-  StreamFlagSaver<wchar_t> flags(out);
-  out << std::wstring(tabs, '\t') << name << ": 0x" << std::hex
-      << std::setw(sizeof(num) * 2) << std::setfill(L'0') << num << L" ("
-      << suffix << L")" << '\n';
+  out.NamedHexSuffix(name,
+                     ToHexValue(num),
+                     sizeof(num) * 2,
+                     suffix.c_str(),
+                     suffix.size(),
+                     tabs);
 }
 
 template <typename C>
-inline void WriteNamedHexContainer(std::wostream& out,
-                                   std::wstring const& name,
+inline void WriteNamedHexContainer(Output& out,
+                                   wchar_t const* name,
                                    C const& c,
                                    std::size_t tabs)
 {
-  StreamFlagSaver<wchar_t> flags(out);
-  out << std::wstring(tabs, '\t') << name << ": " << std::hex
-      << std::setw(sizeof(typename C::value_type) * 2) << std::setfill(L'0');
+  std::vector<std::uint64_t> values;
+  values.reserve(c.size());
   for (auto const& e : c)
   {
-    out << " 0x" << e;
+    values.push_back(ToHexValue(e));
   }
-  out << '\n';
+  out.NamedHexList(name,
+                   values.data(),
+                   values.size(),
+                   sizeof(typename C::value_type) * 2,
+                   tabs);
 }
 
-template <typename T>
-inline void WriteNamedNormal(std::wostream& out,
-                             std::wstring const& name,
-                             T const& t,
+inline void WriteNamedNormal(Output& out,
+                             wchar_t const* name,
+                             std::wstring const& t,
                              std::size_t tabs)
 {
-  StreamFlagSaver<wchar_t> flags(out);
-  out << std::wstring(tabs, '\t') << name << ": " << t << '\n';
+  out.NamedString(name, t.c_str(), t.size(), tabs);
 }
 
-template <typename T>
-inline void WriteNormal(std::wostream& out, T const& t, std::size_t tabs)
+inline void WriteNamedNormal(Output& out,
+                             wchar_t const* name,
+                             wchar_t const* t,
+                             std::size_t tabs)
+{
+  out.NamedString(name, t, std::char_traits<wchar_t>::length(t), tabs);
+}
+
+inline void WriteNamedNormal(Output& out,
+                             wchar_t const* name,
+                             char const* t,
+                             std::size_t tabs)
+{
+  out.NamedString(name, t, tabs);
+}
+
+inline void WriteNamedNormal(Output& out,
+                             wchar_t const* name,
+                             char const* t,
+                             std::size_t len,
+                             std::size_t tabs)
+{
+  out.NamedString(name, t, len, tabs);
+}
+
+// Not an overload of WriteNamedNormal, as pointers and integers would
+// silently convert to bool.
+inline void
+  WriteNamedBool(Output& out, wchar_t const* name, bool t, std::size_t tabs)
+{
+  out.NamedBool(name, t, tabs);
+}
+
+inline void WriteNormal(Output& out, std::wstring const& t, std::size_t tabs)
+{
+  out.Line(t.c_str(), t.size(), tabs);
+}
+
+inline void WriteNormal(Output& out, wchar_t const* t, std::size_t tabs)
+{
+  out.Line(t, std::char_traits<wchar_t>::length(t), tabs);
+}
+
+inline void WriteNormal(Output& out, char const* t, std::size_t tabs)
 {
-  StreamFlagSaver<wchar_t> flags(out);
-  out << std::wstring(tabs, '\t') << t << '\n';
+  out.Line(t, tabs);
 }
 
-inline void WriteNewline(std::wostream& out)
+inline void WriteNewline(Output& out)
 {
-  out << L'\n';
+  out.Newline();
 }
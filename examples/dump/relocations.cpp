@@ -41,7 +41,7 @@ void DumpRelocations(hadesmem::Process const& process,
     return;
   }
 
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   WriteNewline(out);
 
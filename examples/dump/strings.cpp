@@ -3,17 +3,14 @@
 
 #include "strings.hpp"
 
-#include <cctype>
 #include <cstddef>
 #include <cstdint>
-#include <iostream>
-#include <iterator>
-#include <memory>
-#include <sstream>
+#include <exception>
 #include <string>
+#include <utility>
 #include <vector>
 
-#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/detail/string_scan.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
@@ -24,49 +21,40 @@
 
 namespace
 {
-void DumpStringsImpl(hadesmem::Process const& /*process*/,
-                     hadesmem::PeFile const& pe_file,
-                     void* beg,
-                     void* end,
-                     bool wide)
+// Offset (in bytes) and length (in characters) of a string in the file.
+using StringRun = std::pair<std::size_t, std::size_t>;
+
+void DumpNarrowStrings(std::uint8_t const* beg,
+                       std::vector<StringRun> const& strings)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
-  if (pe_file.GetType() != hadesmem::PeFileType::Data)
+  for (auto const& s : strings)
   {
-    WriteNormal(out,
-                L"WARNING! Skipping string dump (Image file type is currently "
-                L"unsupported).",
-                2);
-    WarnForCurrentFile(WarningType::kUnsupported);
-    return;
+    WriteNamedNormal(out,
+                     L"String",
+                     reinterpret_cast<char const*>(beg + s.first),
+                     s.second,
+                     2);
   }
+}
 
-  std::size_t const kMinStringLen = 3;
+void DumpWideStrings(std::uint8_t const* beg,
+                     std::vector<StringRun> const& strings)
+{
+  Output& out = GetOutput();
 
+  // Only the ASCII range is matched, so the high byte of each character is
+  // known to be zero and can simply be dropped.
   std::string buf;
-  std::locale const& loc = std::locale::classic();
-  auto const step = wide ? 2 : 1;
-  for (std::uint8_t* current = static_cast<std::uint8_t*>(beg);
-       (current + step - 1) < end;
-       current += (wide ? 2 : 1))
+  for (auto const& s : strings)
   {
-    bool const is_print = (wide ? *(current + 1) == 0 : true) &&
-                          std::isprint(static_cast<char>(*current), loc);
-    if (is_print)
+    buf.resize(s.second);
+    for (std::size_t i = 0; i < s.second; ++i)
     {
-      buf += static_cast<char>(*current);
-    }
-
-    if (!is_print || current + (wide ? 2 : 1) == end)
-    {
-      if (buf.size() >= kMinStringLen)
-      {
-        WriteNamedNormal(out, L"String", buf.c_str(), 2);
-      }
-
-      buf.clear();
+      buf[i] = static_cast<char>(beg[s.first + i * 2]);
     }
+    WriteNamedNormal(out, L"String", buf.c_str(), buf.size(), 2);
   }
 }
 }
@@ -74,23 +62,70 @@ void DumpStringsImpl(hadesmem::Process const& /*process*/,
 void DumpStrings(hadesmem::Process const& process,
                  hadesmem::PeFile const& pe_file)
 {
-  std::wostream& out = std::wcout;
+  Output& out = GetOutput();
 
   std::uint8_t* const file_beg = static_cast<std::uint8_t*>(pe_file.GetBase());
-  void* const file_end = file_beg + pe_file.GetSize();
+  std::size_t const file_size = pe_file.GetSize();
+
+  // Image mappings may belong to another process (and may have reserved or
+  // inaccessible pages), so take a local copy to scan.
+  std::vector<std::uint8_t> image_buf;
+  std::uint8_t const* beg = file_beg;
+  if (pe_file.GetType() == hadesmem::PeFileType::Image)
+  {
+    try
+    {
+      image_buf = hadesmem::ReadVectorEx<std::uint8_t>(
+        process, file_beg, file_size, hadesmem::ReadFlags::kZeroFillReserved);
+    }
+    catch (std::exception const& /*e*/)
+    {
+      WriteNewline(out);
+      WriteNormal(out,
+                  L"WARNING! Skipping string dump (failed to read image "
+                  L"memory).",
+                  1);
+      WarnForCurrentFile(WarningType::kUnsupported);
+      return;
+    }
+
+    beg = image_buf.data();
+  }
+
+  std::size_t const kMinStringLen = 3;
+
+  std::vector<StringRun> narrow_strings;
+  std::vector<StringRun> wide_strings[2];
+  hadesmem::detail::ScanStrings(
+    beg,
+    file_size,
+    kMinStringLen,
+    [&](std::size_t offset,
+        std::size_t len,
+        hadesmem::detail::StringEncoding encoding)
+    {
+      if (encoding == hadesmem::detail::StringEncoding::kAscii)
+      {
+        narrow_strings.emplace_back(offset, len);
+      }
+      else
+      {
+        wide_strings[offset % 2].emplace_back(offset, len);
+      }
+    });
 
   WriteNewline(out);
   WriteNormal(out, L"Narrow Strings:", 1);
   WriteNewline(out);
-  DumpStringsImpl(process, pe_file, file_beg, file_end, false);
+  DumpNarrowStrings(beg, narrow_strings);
 
   WriteNewline(out);
   WriteNormal(out, L"Wide Strings (Pass 1):", 1);
   WriteNewline(out);
-  DumpStringsImpl(process, pe_file, file_beg, file_end, true);
+  DumpWideStrings(beg, wide_strings[0]);
 
   WriteNewline(out);
   WriteNormal(out, L"Wide Strings (Pass 2):", 1);
   WriteNewline(out);
-  DumpStringsImpl(process, pe_file, file_beg + 1, file_end, true);
+  DumpWideStrings(beg, wide_strings[1]);
 }
@@ -3,6 +3,7 @@
 
 #include "warning.hpp"
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -17,7 +18,12 @@ namespace
 {
 // Record all modules (on disk) which cause a warning when dumped, to make it
 // easier to isolate files which require further investigation.
-bool g_warned = false;
+__declspec(thread) bool g_warned = false;
+__declspec(thread) std::uint32_t g_warning_types = 0;
+// When set, files which cause a warning are recorded here instead of being
+// committed immediately. Used by worker threads so that the warned list is
+// built in the same order as a sequential dump.
+__declspec(thread) std::vector<std::wstring>* g_deferred_warned = nullptr;
 bool g_warned_enabled = false;
 bool g_warned_dynamic = false;
 std::vector<std::wstring> g_all_warned;
@@ -27,6 +33,8 @@ WarningType g_warned_type = WarningType::kAll;
 
 void WarnForCurrentFile(WarningType warned_type)
 {
+  g_warning_types |= 1UL << static_cast<int>(warned_type);
+
   if (warned_type == g_warned_type || g_warned_type == WarningType::kAll)
   {
     g_warned = true;
@@ -36,11 +44,48 @@ void WarnForCurrentFile(WarningType warned_type)
 void ClearWarnForCurrentFile()
 {
   g_warned = false;
+  g_warning_types = 0;
+}
+
+std::uint32_t GetWarningTypesForCurrentFile()
+{
+  return g_warning_types;
+}
+
+void WarnForCurrentFile(std::uint32_t warning_types)
+{
+  for (int i = 0; i < 32; ++i)
+  {
+    if (warning_types & (1UL << i))
+    {
+      WarnForCurrentFile(static_cast<WarningType>(i));
+    }
+  }
 }
 
 void HandleWarnings(std::wstring const& path)
 {
   if (g_warned_enabled && g_warned)
+  {
+    if (g_deferred_warned)
+    {
+      g_deferred_warned->push_back(path);
+    }
+    else
+    {
+      CommitWarnings(std::vector<std::wstring>{path});
+    }
+  }
+}
+
+void SetThreadDeferredWarnings(std::vector<std::wstring>* warned)
+{
+  g_deferred_warned = warned;
+}
+
+void CommitWarnings(std::vector<std::wstring> const& paths)
+{
+  for (auto const& path : paths)
   {
     if (g_warned_dynamic)
     {
@@ -63,7 +108,7 @@ void HandleWarnings(std::wstring const& path)
   }
 }
 
-void DumpWarned(std::wostream& out)
+void DumpWarned(Output& out)
 {
   if (!g_all_warned.empty())
   {
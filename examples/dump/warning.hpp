@@ -3,8 +3,11 @@
 
 #pragma once
 
-#include <iosfwd>
+#include <cstdint>
 #include <string>
+#include <vector>
+
+class Output;
 
 enum class WarningType : int
 {
@@ -17,9 +20,19 @@ void WarnForCurrentFile(WarningType warned_type);
 
 void ClearWarnForCurrentFile();
 
+// Bit mask (1 << type) of all warning types raised for the current file,
+// regardless of the warned type filter.
+std::uint32_t GetWarningTypesForCurrentFile();
+
+void WarnForCurrentFile(std::uint32_t warning_types);
+
 void HandleWarnings(std::wstring const& path);
 
-void DumpWarned(std::wostream& out);
+void SetThreadDeferredWarnings(std::vector<std::wstring>* warned);
+
+void CommitWarnings(std::vector<std::wstring> const& paths);
+
+void DumpWarned(Output& out);
 
 bool GetWarningsEnabled();
 
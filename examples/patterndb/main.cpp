@@ -0,0 +1,63 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <tclap/CmdLine.h>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/pattern_database.hpp>
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    std::cout << "HadesMem Pattern Compiler [" << HADESMEM_VERSION_STRING
+              << "]\n";
+
+    TCLAP::CmdLine cmd{
+      "FindPattern pattern file compiler", ' ', HADESMEM_VERSION_STRING};
+    TCLAP::ValueArg<std::string> input_arg{
+      "", "input", "Pattern file (XML)", true, "", "string", cmd};
+    TCLAP::ValueArg<std::string> output_arg{
+      "", "output", "Compiled pattern database", true, "", "string", cmd};
+    cmd.parse(argc, argv);
+
+    auto const input_path =
+      hadesmem::detail::MultiByteToWideChar(input_arg.getValue());
+    auto const output_path =
+      hadesmem::detail::MultiByteToWideChar(output_arg.getValue());
+
+    std::vector<std::uint8_t> const database =
+      hadesmem::FindPattern::CompilePatternFile(input_path, false);
+    auto const database_size = static_cast<std::streamsize>(database.size());
+    hadesmem::detail::BufferToFile(
+      output_path, database.data(), database_size);
+
+    // Make sure what was written can be loaded.
+    hadesmem::PatternDatabase const loaded{output_path};
+
+    std::wcout << "\nCompiled " << loaded.GetNumModules() << " module(s) to "
+               << database.size() << " bytes.\n";
+
+    return 0;
+  }
+  catch (...)
+  {
+    std::cerr << "\nError!\n";
+    std::cerr << boost::current_exception_diagnostic_information() << '\n';
+
+    return 1;
+  }
+}
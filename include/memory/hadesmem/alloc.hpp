@@ -60,6 +60,8 @@ inline void Free(Process const& process, LPVOID address)
 class Allocator
 {
 public:
+  using FreeFn = void (*)(void* context, PVOID base);
+
   explicit Allocator(Process const& process,
                      SIZE_T size,
                      PVOID base = nullptr,
@@ -73,6 +75,25 @@ public:
     HADESMEM_DETAIL_ASSERT(size_ != 0);
   }
 
+  // Memory owned by a sub-allocator (e.g. RemoteArena), which is handed back
+  // to it with free_fn rather than released with VirtualFreeEx.
+  explicit Allocator(Process const& process,
+                     PVOID base,
+                     SIZE_T size,
+                     FreeFn free_fn,
+                     void* free_context)
+    : process_{&process},
+      base_{base},
+      size_{size},
+      free_fn_{free_fn},
+      free_context_{free_context}
+  {
+    HADESMEM_DETAIL_ASSERT(process_ != 0);
+    HADESMEM_DETAIL_ASSERT(base_ != 0);
+    HADESMEM_DETAIL_ASSERT(size_ != 0);
+    HADESMEM_DETAIL_ASSERT(free_fn_ != 0);
+  }
+
   explicit Allocator(Process&& process,
                      SIZE_T size,
                      PVOID base = nullptr) = delete;
@@ -84,11 +105,15 @@ public:
   Allocator(Allocator&& other) HADESMEM_DETAIL_NOEXCEPT
     : process_{other.process_},
       base_{other.base_},
-      size_{other.size_}
+      size_{other.size_},
+      free_fn_{other.free_fn_},
+      free_context_{other.free_context_}
   {
     other.process_ = nullptr;
     other.base_ = nullptr;
     other.size_ = 0;
+    other.free_fn_ = nullptr;
+    other.free_context_ = nullptr;
   }
 
   Allocator& operator=(Allocator&& other) HADESMEM_DETAIL_NOEXCEPT
@@ -104,6 +129,12 @@ public:
     size_ = other.size_;
     other.size_ = 0;
 
+    free_fn_ = other.free_fn_;
+    other.free_fn_ = nullptr;
+
+    free_context_ = other.free_context_;
+    other.free_context_ = nullptr;
+
     return *this;
   }
 
@@ -122,11 +153,20 @@ public:
     HADESMEM_DETAIL_ASSERT(base_ != nullptr);
     HADESMEM_DETAIL_ASSERT(size_ != 0);
 
-    ::hadesmem::Free(*process_, base_);
+    if (free_fn_)
+    {
+      free_fn_(free_context_, base_);
+    }
+    else
+    {
+      ::hadesmem::Free(*process_, base_);
+    }
 
     process_ = nullptr;
     base_ = nullptr;
     size_ = 0;
+    free_fn_ = nullptr;
+    free_context_ = nullptr;
   }
 
   PVOID GetBase() const HADESMEM_DETAIL_NOEXCEPT
@@ -157,12 +197,16 @@ private:
       process_ = nullptr;
       base_ = nullptr;
       size_ = 0;
+      free_fn_ = nullptr;
+      free_context_ = nullptr;
     }
   }
 
   Process const* process_;
   PVOID base_;
   SIZE_T size_;
+  FreeFn free_fn_{};
+  void* free_context_{};
 };
 
 inline bool operator==(Allocator const& lhs,
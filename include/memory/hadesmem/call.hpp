@@ -34,6 +34,7 @@
 #include <hadesmem/module.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/remote_arena.hpp>
 #include <hadesmem/write.hpp>
 
 namespace hadesmem
@@ -796,7 +797,8 @@ inline Allocator GenerateCallCode(Process const& process,
                                   AddressesForwardIterator addresses_end,
                                   ConvForwardIterator call_convs_beg,
                                   ArgsForwardIterator args_full_beg,
-                                  PVOID return_values_remote)
+                                  PVOID return_values_remote,
+                                  RemoteArena* arena)
 {
   HADESMEM_DETAIL_TRACE_A("GenerateCallCode called.");
 
@@ -834,7 +836,8 @@ inline Allocator GenerateCallCode(Process const& process,
 
   HADESMEM_DETAIL_TRACE_A("Allocating memory for remote stub.");
 
-  Allocator stub_mem_remote{process, stub_size};
+  Allocator stub_mem_remote{detail::AllocateFrom(
+    process, arena, stub_size, RemoteArenaPool::kExecute)};
 
   HADESMEM_DETAIL_TRACE_A("Performing code relocation.");
 
@@ -861,7 +864,8 @@ inline void CallMulti(Process const& process,
                       AddressesForwardIterator addresses_end,
                       ConvForwardIterator call_convs_beg,
                       ArgsForwardIterator args_full_beg,
-                      ResultsOutputIterator results)
+                      ResultsOutputIterator results,
+                      RemoteArena* arena = nullptr)
 {
   using AddressesForwardIteratorCategory =
     typename std::iterator_traits<AddressesForwardIterator>::iterator_category;
@@ -896,7 +900,10 @@ inline void CallMulti(Process const& process,
   HADESMEM_DETAIL_TRACE_A("Allocating memory for return values.");
 
   Allocator const return_values_remote{
-    process, sizeof(detail::CallResultRemote) * num_addresses};
+    detail::AllocateFrom(process,
+                         arena,
+                         sizeof(detail::CallResultRemote) * num_addresses,
+                         RemoteArenaPool::kReadWrite)};
 
   HADESMEM_DETAIL_TRACE_A("Allocating memory for code stub.");
 
@@ -906,7 +913,8 @@ inline void CallMulti(Process const& process,
                              addresses_end,
                              call_convs_beg,
                              args_full_beg,
-                             return_values_remote.GetBase())};
+                             return_values_remote.GetBase(),
+                             arena)};
   LPTHREAD_START_ROUTINE code_remote_pfn =
     reinterpret_cast<LPTHREAD_START_ROUTINE>(
       reinterpret_cast<DWORD_PTR>(code_remote.GetBase()));
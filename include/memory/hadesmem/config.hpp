@@ -5,7 +5,9 @@
 
 #include <memory>
 
+#if defined(_WIN32)
 #include <windows.h>
+#endif // #if defined(_WIN32)
 
 #include <hadesmem/detail/static_assert.hpp>
 
@@ -28,22 +30,30 @@
 
 #define HADESMEM_DETAIL_NO_CONSTEXPR
 
-#if defined(_M_IX86)
+#if defined(_M_IX86) || defined(__i386__)
 #define HADESMEM_DETAIL_ARCH_X86
-#elif defined(_M_AMD64)
+#elif defined(_M_AMD64) || defined(__x86_64__)
 #define HADESMEM_DETAIL_ARCH_X64
-#else // #if defined(_M_IX86)
-// #elif defined(_M_AMD64)
+#else // #if defined(_M_IX86) || defined(__i386__)
+// #elif defined(_M_AMD64) || defined(__x86_64__)
 #error "[HadesMem] Unsupported architecture."
-#endif // #if defined(_M_IX86)
-// #elif defined(_M_AMD64)
+#endif // #if defined(_M_IX86) || defined(__i386__)
+// #elif defined(_M_AMD64) || defined(__x86_64__)
+
+// _M_IX86_FP is MSVC specific, other compilers define __SSE2__ instead.
+#if defined(_M_IX86_FP)
+#if _M_IX86_FP >= 2
+#define HADESMEM_DETAIL_SSE2
+#endif // #if _M_IX86_FP >= 2
+#elif defined(__SSE2__) // #if defined(_M_IX86_FP)
+#define HADESMEM_DETAIL_SSE2
+#endif // #if defined(_M_IX86_FP) #elif defined(__SSE2__)
 
 #if !(defined(HADESMEM_DETAIL_ARCH_X64) ||                                     \
-      (defined(HADESMEM_DETAIL_ARCH_X86) && _M_IX86_FP >= 2))
+      (defined(HADESMEM_DETAIL_ARCH_X86) && defined(HADESMEM_DETAIL_SSE2)))
 #define HADESMEM_DETAIL_NO_VECTORCALL
-#endif // #if (defined(HADESMEM_GCC) || defined(HADESMEM_CLANG) ||
-       // defined(HADESMEM_INTEL)) || !(defined(HADESMEM_DETAIL_ARCH_X64) ||
-       // (defined(HADESMEM_DETAIL_ARCH_X86) && _M_IX86_FP >= 2))
+#endif // #if !(defined(HADESMEM_DETAIL_ARCH_X64) ||
+       // (defined(HADESMEM_DETAIL_ARCH_X86) && defined(HADESMEM_DETAIL_SSE2)))
 
 #if defined(HADESMEM_DETAIL_NO_NOEXCEPT)
 #define HADESMEM_DETAIL_NOEXCEPT throw()
@@ -67,6 +77,8 @@
 // See: http://bit.ly/17CCZFX
 #define HADESMEM_DETAIL_MAX_PATH_UNICODE (1 << 15)
 
+#if defined(_WIN32)
+
 // Every effort is made to NOT assume the below is true across the entire
 // codebase, but for the Call module it is unavoidable. If adding support for
 // another architecture, this may need adjusting. However, if anywhere other
@@ -84,3 +96,5 @@ HADESMEM_DETAIL_STATIC_ASSERT(sizeof(double) == sizeof(DWORD64));
 // when manually implementing functions such as GetProcAddress, which is
 // required by the Injector.
 HADESMEM_DETAIL_STATIC_ASSERT(sizeof(FARPROC) == sizeof(void*));
+
+#endif // #if defined(_WIN32)
@@ -8,6 +8,7 @@
 #include <type_traits>
 
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/sharded_ref_count.hpp>
 #include <hadesmem/detail/static_assert.hpp>
 
 namespace hadesmem
@@ -55,10 +56,59 @@ private:
   std::atomic<T>* ref_count_;
 };
 
+template <> class DetourRefCounter<ShardedRefCount>
+{
+public:
+  DetourRefCounter(ShardedRefCount& ref_count) HADESMEM_DETAIL_NOEXCEPT
+    : shard_{&ref_count.Acquire()}
+  {
+  }
+
+  DetourRefCounter(DetourRefCounter const&) = delete;
+
+  DetourRefCounter& operator=(DetourRefCounter const&) = delete;
+
+  DetourRefCounter(DetourRefCounter&& other) HADESMEM_DETAIL_NOEXCEPT
+    : shard_(other.shard_)
+  {
+    other.shard_ = nullptr;
+  }
+
+  DetourRefCounter& operator=(DetourRefCounter&& other) HADESMEM_DETAIL_NOEXCEPT
+  {
+    if (shard_)
+    {
+      ShardedRefCount::Release(*shard_);
+    }
+
+    shard_ = other.shard_;
+    other.shard_ = nullptr;
+
+    return *this;
+  }
+
+  ~DetourRefCounter()
+  {
+    if (shard_)
+    {
+      ShardedRefCount::Release(*shard_);
+    }
+  }
+
+private:
+  std::atomic<std::uint32_t>* shard_;
+};
+
 template <typename T>
 DetourRefCounter<T> MakeDetourRefCounter(std::atomic<T>& ref_count)
 {
   return DetourRefCounter<T>{ref_count};
 }
+
+inline DetourRefCounter<ShardedRefCount>
+  MakeDetourRefCounter(ShardedRefCount& ref_count)
+{
+  return DetourRefCounter<ShardedRefCount>{ref_count};
+}
 }
 }
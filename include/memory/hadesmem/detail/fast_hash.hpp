@@ -0,0 +1,134 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <hadesmem/config.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+// Non-cryptographic 64-bit hash (XXH64). Intended for cache keys and content
+// addressing where GetSha1Hash would be needlessly slow. Not suitable for
+// anything where collisions could be crafted by an attacker.
+namespace fast_hash
+{
+std::uint64_t const kPrime1 = 0x9E3779B185EBCA87ULL;
+std::uint64_t const kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+std::uint64_t const kPrime3 = 0x165667B19E3779F9ULL;
+std::uint64_t const kPrime4 = 0x85EBCA77C2B2AE63ULL;
+std::uint64_t const kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t Rotl(std::uint64_t value, int shift)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  return (value << shift) | (value >> (64 - shift));
+}
+
+inline std::uint64_t Read64(std::uint8_t const* p) HADESMEM_DETAIL_NOEXCEPT
+{
+  std::uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline std::uint32_t Read32(std::uint8_t const* p) HADESMEM_DETAIL_NOEXCEPT
+{
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline std::uint64_t Round(std::uint64_t acc, std::uint64_t input)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  acc += input * kPrime2;
+  acc = Rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+inline std::uint64_t MergeRound(std::uint64_t acc, std::uint64_t value)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  acc ^= Round(0, value);
+  return acc * kPrime1 + kPrime4;
+}
+}
+
+inline std::uint64_t GetFastHash(void const* data,
+                                 std::size_t len,
+                                 std::uint64_t seed = 0)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  auto p = static_cast<std::uint8_t const*>(data);
+  auto const end = p + len;
+
+  std::uint64_t hash = 0;
+  if (len >= 32)
+  {
+    std::uint64_t v1 = seed + fast_hash::kPrime1 + fast_hash::kPrime2;
+    std::uint64_t v2 = seed + fast_hash::kPrime2;
+    std::uint64_t v3 = seed;
+    std::uint64_t v4 = seed - fast_hash::kPrime1;
+
+    auto const limit = end - 32;
+    do
+    {
+      v1 = fast_hash::Round(v1, fast_hash::Read64(p));
+      v2 = fast_hash::Round(v2, fast_hash::Read64(p + 8));
+      v3 = fast_hash::Round(v3, fast_hash::Read64(p + 16));
+      v4 = fast_hash::Round(v4, fast_hash::Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    hash = fast_hash::Rotl(v1, 1) + fast_hash::Rotl(v2, 7) +
+           fast_hash::Rotl(v3, 12) + fast_hash::Rotl(v4, 18);
+    hash = fast_hash::MergeRound(hash, v1);
+    hash = fast_hash::MergeRound(hash, v2);
+    hash = fast_hash::MergeRound(hash, v3);
+    hash = fast_hash::MergeRound(hash, v4);
+  }
+  else
+  {
+    hash = seed + fast_hash::kPrime5;
+  }
+
+  hash += static_cast<std::uint64_t>(len);
+
+  while (p + 8 <= end)
+  {
+    hash ^= fast_hash::Round(0, fast_hash::Read64(p));
+    hash = fast_hash::Rotl(hash, 27) * fast_hash::kPrime1 + fast_hash::kPrime4;
+    p += 8;
+  }
+
+  if (p + 4 <= end)
+  {
+    hash ^=
+      static_cast<std::uint64_t>(fast_hash::Read32(p)) * fast_hash::kPrime1;
+    hash = fast_hash::Rotl(hash, 23) * fast_hash::kPrime2 + fast_hash::kPrime3;
+    p += 4;
+  }
+
+  while (p < end)
+  {
+    hash ^= (*p) * fast_hash::kPrime5;
+    hash = fast_hash::Rotl(hash, 11) * fast_hash::kPrime1;
+    ++p;
+  }
+
+  hash ^= hash >> 33;
+  hash *= fast_hash::kPrime2;
+  hash ^= hash >> 29;
+  hash *= fast_hash::kPrime3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+}
+}
@@ -0,0 +1,218 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <windows.h>
+#include <intrin.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/srw_lock.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/hook_profile.hpp>
+
+#if defined(HADESMEM_HOOK_PROFILE)
+#define HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch)                              \
+  ::hadesmem::detail::HookProfileScope const hook_profile_scope                \
+  {                                                                            \
+    (patch)->GetProfileSlot()                                                  \
+  }
+#else
+#define HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch) (void)0
+#endif
+
+namespace hadesmem
+{
+namespace detail
+{
+std::uint32_t const kInvalidHookProfileSlot = 0xFFFFFFFF;
+
+inline HookProfileSegment*& GetHookProfileSegmentStorage()
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  static HookProfileSegment* segment = nullptr;
+  return segment;
+}
+
+// Created on first use and never unmapped, as hooks may still be running
+// when the module unloads. Must be called with the slot lock held. Returns
+// null on failure, in which case profiling is disabled.
+inline HookProfileSegment* GetHookProfileSegment() HADESMEM_DETAIL_NOEXCEPT
+{
+  HookProfileSegment*& segment = GetHookProfileSegmentStorage();
+  static bool failed = false;
+  if (segment || failed)
+  {
+    return segment;
+  }
+
+  failed = true;
+
+  std::wstring name;
+  try
+  {
+    name = GetHookProfileSegmentName(::GetCurrentProcessId());
+  }
+  catch (...)
+  {
+    return nullptr;
+  }
+
+  // Another module in the process may have created the segment already, in
+  // which case we share it.
+  HANDLE const mapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE,
+                                              nullptr,
+                                              PAGE_READWRITE,
+                                              0,
+                                              sizeof(HookProfileSegment),
+                                              name.c_str());
+  if (!mapping)
+  {
+    HADESMEM_DETAIL_TRACE_FORMAT_A(
+      "CreateFileMappingW failed. LastError: %lu.", ::GetLastError());
+    return nullptr;
+  }
+
+  void* const view = ::MapViewOfFile(mapping,
+                                     FILE_MAP_READ | FILE_MAP_WRITE,
+                                     0,
+                                     0,
+                                     sizeof(HookProfileSegment));
+  if (!view)
+  {
+    HADESMEM_DETAIL_TRACE_FORMAT_A("MapViewOfFile failed. LastError: %lu.",
+                                   ::GetLastError());
+    ::CloseHandle(mapping);
+    return nullptr;
+  }
+
+  // The mapping handle is intentionally leaked, so that the segment outlives
+  // any module which dumps or polls it.
+  segment = static_cast<HookProfileSegment*>(view);
+  segment->magic = HookProfileSegment::kMagic;
+  failed = false;
+  return segment;
+}
+
+// Returns the slot for the target, allocating one if this is the first hook
+// on it, or kInvalidHookProfileSlot if the segment is unavailable or full.
+inline std::uint32_t GetHookProfileSlot(void const* target)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  static SRWLOCK srw_lock = SRWLOCK_INIT;
+  AcquireSRWLock const lock{&srw_lock, SRWLockType::Exclusive};
+
+  HookProfileSegment* const segment = GetHookProfileSegment();
+  if (!segment)
+  {
+    return kInvalidHookProfileSlot;
+  }
+
+  // The segment may be shared with other modules, which don't take our lock,
+  // so a slot is claimed by swapping its target in from zero. If another
+  // module claims the same slot first for the same target we share it, so a
+  // target never ends up with two slots.
+  auto const target_value =
+    static_cast<LONGLONG>(reinterpret_cast<std::uintptr_t>(target));
+  std::uint32_t slot = kInvalidHookProfileSlot;
+  for (std::uint32_t i = 0; i < HookProfileSegment::kMaxHooks; ++i)
+  {
+    auto const slot_target =
+      reinterpret_cast<LONGLONG volatile*>(&segment->targets[i]);
+    LONGLONG const prev =
+      ::InterlockedCompareExchange64(slot_target, target_value, 0);
+    if (!prev || prev == target_value)
+    {
+      slot = i;
+      break;
+    }
+  }
+
+  if (slot == kInvalidHookProfileSlot)
+  {
+    HADESMEM_DETAIL_TRACE_A("Hook profile segment is full.");
+    return kInvalidHookProfileSlot;
+  }
+
+  // Only raise the count once the target is published, so readers never see
+  // a slot without its target.
+  auto const num_hooks = reinterpret_cast<LONG volatile*>(&segment->num_hooks);
+  auto const new_num_hooks = static_cast<LONG>(slot + 1);
+  for (LONG cur = *num_hooks; cur < new_num_hooks;)
+  {
+    LONG const prev =
+      ::InterlockedCompareExchange(num_hooks, new_num_hooks, cur);
+    if (prev == cur)
+    {
+      break;
+    }
+
+    cur = prev;
+  }
+
+  return slot;
+}
+
+// Times a single call through a detour stub, including the detour and
+// anything it calls (e.g. the trampoline).
+class HookProfileScope
+{
+public:
+  explicit HookProfileScope(std::uint32_t slot) HADESMEM_DETAIL_NOEXCEPT
+    : slot_{slot},
+      start_{__rdtsc()}
+  {
+  }
+
+  HookProfileScope(HookProfileScope const& other) = delete;
+
+  HookProfileScope& operator=(HookProfileScope const& other) = delete;
+
+  ~HookProfileScope()
+  {
+    std::uint64_t const cycles = __rdtsc() - start_;
+
+    if (slot_ == kInvalidHookProfileSlot)
+    {
+      return;
+    }
+
+    // Bucket i holds [2^i, 2^(i+1)) cycles, so it's the index of the highest
+    // set bit. Anything which doesn't fit in 32 bits goes in the last bucket.
+    std::size_t bucket = 0;
+    if (cycles >> 32)
+    {
+      bucket = HookProfileEntry::kNumBuckets - 1;
+    }
+    else if (cycles)
+    {
+      unsigned long index = 0;
+      ::_BitScanReverse(&index, static_cast<unsigned long>(cycles));
+      bucket = index;
+    }
+
+    // Valid slots are only handed out once the segment exists, and it's never
+    // unmapped, so no lock is needed here.
+    std::size_t const shard =
+      (::GetCurrentThreadId() >> 2) % HookProfileSegment::kNumShards;
+    HookProfileCounters& counters =
+      GetHookProfileSegmentStorage()->counters[shard][slot_];
+    ::InterlockedIncrement64(
+      reinterpret_cast<LONGLONG volatile*>(&counters.num_calls));
+    ::InterlockedExchangeAdd64(
+      reinterpret_cast<LONGLONG volatile*>(&counters.total_cycles),
+      static_cast<LONGLONG>(cycles));
+    ::InterlockedIncrement64(
+      reinterpret_cast<LONGLONG volatile*>(&counters.histogram[bucket]));
+  }
+
+private:
+  std::uint32_t slot_;
+  std::uint64_t start_;
+};
+}
+}
@@ -0,0 +1,829 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <hadesmem/config.hpp>
+
+// Table driven x86/x64 instruction length decoder. Only decodes as much as is
+// needed to relocate code (length, relative branches, and RIP-relative memory
+// operands), and never formats any text. Use a full disassembler (udis86) for
+// anything else.
+
+namespace hadesmem
+{
+namespace detail
+{
+enum class InstructionType
+{
+  kOther,
+  // JMP rel8/rel16/rel32.
+  kJmpRel,
+  // CALL rel16/rel32.
+  kCallRel,
+  // Jcc rel8/rel16/rel32.
+  kJccRel,
+  // LOOP/LOOPE/LOOPNE/JCXZ/JECXZ/JRCXZ rel8.
+  kLoopRel,
+  // JMP r/m (FF /4).
+  kJmpIndirect,
+  // CALL r/m (FF /2).
+  kCallIndirect,
+  // RET/RET imm16 (near).
+  kReturn
+};
+
+struct InstructionInfo
+{
+  std::uint32_t len;
+  InstructionType type;
+  // Last opcode byte (for Jcc the condition is the low nibble).
+  std::uint8_t opcode;
+  bool addr_size_prefix;
+  // Relative branch operand. Only valid for the *Rel types. The target is
+  // relative to the end of the instruction.
+  std::uint32_t rel_offset;
+  std::uint32_t rel_size;
+  std::int64_t rel;
+  // RIP-relative memory operand (x64 only). The effective address is
+  // relative to the end of the instruction.
+  bool rip_relative;
+  std::uint32_t disp_offset;
+  std::int32_t disp;
+};
+
+namespace instruction_decoder
+{
+enum : std::uint8_t
+{
+  kModRm = 1 << 0,
+  kImm8 = 1 << 1,
+  kImm16 = 1 << 2,
+  // 16 or 32 bits depending on operand size.
+  kImmZ = 1 << 3,
+  // 16, 32 or 64 bits depending on operand size (MOV r, imm only).
+  kImmV = 1 << 4,
+  kRel8 = 1 << 5,
+  // 16 or 32 bits depending on operand size (always 32 bits on x64).
+  kRelZ = 1 << 6,
+  // Needs special handling (prefixes, escapes, invalid, etc.).
+  kSpecial = 1 << 7
+};
+
+// One byte opcode map.
+inline std::uint8_t const* GetOneByteTable() HADESMEM_DETAIL_NOEXCEPT
+{
+  std::uint8_t const m = kModRm;
+  std::uint8_t const mi = kModRm | kImm8;
+  std::uint8_t const mz = kModRm | kImmZ;
+  std::uint8_t const i8 = kImm8;
+  std::uint8_t const iz = kImmZ;
+  std::uint8_t const r8 = kRel8;
+  std::uint8_t const s = kSpecial;
+
+  static std::uint8_t const table[256] = {
+    // 00-0F
+    m, m, m, m, i8, iz, s, s, m, m, m, m, i8, iz, s, s,
+    // 10-1F
+    m, m, m, m, i8, iz, s, s, m, m, m, m, i8, iz, s, s,
+    // 20-2F
+    m, m, m, m, i8, iz, s, s, m, m, m, m, i8, iz, s, s,
+    // 30-3F
+    m, m, m, m, i8, iz, s, s, m, m, m, m, i8, iz, s, s,
+    // 40-4F (INC/DEC on x86, REX on x64)
+    s, s, s, s, s, s, s, s, s, s, s, s, s, s, s, s,
+    // 50-5F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    // 60-6F
+    s, s, s, m, s, s, s, s, iz, mz, i8, mi, 0, 0, 0, 0,
+    // 70-7F
+    r8, r8, r8, r8, r8, r8, r8, r8, r8, r8, r8, r8, r8, r8, r8, r8,
+    // 80-8F
+    mi, mz, s, mi, m, m, m, m, m, m, m, m, m, m, m, s,
+    // 90-9F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, s, 0, 0, 0, 0, 0,
+    // A0-AF
+    s, s, s, s, 0, 0, 0, 0, i8, iz, 0, 0, 0, 0, 0, 0,
+    // B0-BF
+    i8, i8, i8, i8, i8, i8, i8, i8, s, s, s, s, s, s, s, s,
+    // C0-CF
+    mi, mi, s, 0, s, s, mi, mz, s, 0, s, 0, 0, i8, s, 0,
+    // D0-DF
+    m, m, m, m, s, s, s, 0, m, m, m, m, m, m, m, m,
+    // E0-EF
+    r8, r8, r8, r8, i8, i8, i8, i8, s, s, s, r8, 0, 0, 0, 0,
+    // F0-FF
+    s, 0, s, s, 0, 0, s, s, 0, 0, 0, 0, 0, 0, m, s};
+
+  return table;
+}
+
+// Two byte opcode map (0F xx).
+inline std::uint8_t const* GetTwoByteTable() HADESMEM_DETAIL_NOEXCEPT
+{
+  std::uint8_t const m = kModRm;
+  std::uint8_t const mi = kModRm | kImm8;
+  std::uint8_t const rz = kRelZ;
+  std::uint8_t const s = kSpecial;
+
+  static std::uint8_t const table[256] = {
+    // 00-0F
+    m, m, m, m, s, 0, 0, 0, 0, 0, s, 0, s, m, 0, mi,
+    // 10-1F
+    m, m, m, m, m, m, m, m, m, m, m, m, m, m, m, m,
+    // 20-2F
+    m, m, m, m, s, s, s, s, m, m, m, m, m, m, m, m,
+    // 30-3F
+    0, 0, 0, 0, 0, 0, s, 0, s, s, s, s, s, s, s, s,
+    // 40-4F
+    m, m, m, m, m, m, m, m, m, m, m, m, m, m, m, m,
+    // 50-5F
+    m, m, m, m, m, m, m, m, m, m, m, m, m, m, m, m,
+    // 60-6F
+    m, m, m, m, m, m, m, m, m, m, m, m, m, m, m, m,
+    // 70-7F
+    mi, mi, mi, mi, m, m, m, 0, m, m, s, s, m, m, m, m,
+    // 80-8F
+    rz, rz, rz, rz, rz, rz, rz, rz, rz, rz, rz, rz, rz, rz, rz, rz,
+    // 90-9F
+    m, m, m, m, m, m, m, m, m, m, m, m, m, m, m, m,
+    // A0-AF
+    0, 0, 0, m, mi, m, s, s, 0, 0, 0, m, mi, m, m, m,
+    // B0-BF
+    m, m, m, m, m, m, m, m, m, m, mi, m, m, m, m, m,
+    // C0-CF
+    m, m, mi, m, mi, mi, mi, m, 0, 0, 0, 0, 0, 0, 0, 0,
+    // D0-DF
+    m, m, m, m, m, m, m, m, m, m, m, m, m, m, m, m,
+    // E0-EF
+    m, m, m, m, m, m, m, m, m, m, m, m, m, m, m, m,
+    // F0-FF
+    m, m, m, m, m, m, m, m, m, m, m, m, m, m, m, m};
+
+  return table;
+}
+
+class Reader
+{
+public:
+  Reader(std::uint8_t const* p, std::size_t avail) HADESMEM_DETAIL_NOEXCEPT
+    : p_{p},
+      avail_{avail < 15 ? avail : 15}
+  {
+  }
+
+  bool CanRead(std::size_t len) const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return pos_ + len <= avail_;
+  }
+
+  std::uint8_t Peek() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return p_[pos_];
+  }
+
+  std::uint8_t Next() HADESMEM_DETAIL_NOEXCEPT
+  {
+    return p_[pos_++];
+  }
+
+  std::int64_t ReadSigned(std::uint32_t len) const HADESMEM_DETAIL_NOEXCEPT
+  {
+    switch (len)
+    {
+    case 1:
+      return static_cast<std::int8_t>(p_[pos_]);
+    case 2:
+    {
+      std::int16_t value;
+      std::memcpy(&value, p_ + pos_, sizeof(value));
+      return value;
+    }
+    case 4:
+    {
+      std::int32_t value;
+      std::memcpy(&value, p_ + pos_, sizeof(value));
+      return value;
+    }
+    default:
+    {
+      std::int64_t value;
+      std::memcpy(&value, p_ + pos_, sizeof(value));
+      return value;
+    }
+    }
+  }
+
+  bool Skip(std::size_t len) HADESMEM_DETAIL_NOEXCEPT
+  {
+    if (!CanRead(len))
+    {
+      return false;
+    }
+
+    pos_ += len;
+    return true;
+  }
+
+  std::uint32_t GetPos() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return static_cast<std::uint32_t>(pos_);
+  }
+
+private:
+  std::uint8_t const* p_;
+  std::size_t avail_;
+  std::size_t pos_{};
+};
+
+struct Prefixes
+{
+  bool op_size;
+  bool addr_size;
+  std::uint8_t rex;
+};
+
+inline bool IsLegacyPrefix(std::uint8_t b) HADESMEM_DETAIL_NOEXCEPT
+{
+  switch (b)
+  {
+  case 0x26:
+  case 0x2E:
+  case 0x36:
+  case 0x3E:
+  case 0x64:
+  case 0x65:
+  case 0x66:
+  case 0x67:
+  case 0xF0:
+  case 0xF2:
+  case 0xF3:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Decodes the ModRM byte (plus SIB and displacement).
+inline bool DecodeModRm(Reader& reader,
+                        bool is_64,
+                        Prefixes const& prefixes,
+                        InstructionInfo& info,
+                        std::uint8_t& reg) HADESMEM_DETAIL_NOEXCEPT
+{
+  if (!reader.CanRead(1))
+  {
+    return false;
+  }
+
+  std::uint8_t const modrm = reader.Next();
+  std::uint8_t const mod = modrm >> 6;
+  std::uint8_t const rm = modrm & 7;
+  reg = (modrm >> 3) & 7;
+
+  if (mod == 3)
+  {
+    return true;
+  }
+
+  std::uint32_t disp_len = 0;
+  bool const addr_16 = !is_64 && prefixes.addr_size;
+  if (addr_16)
+  {
+    if (mod == 0 && rm == 6)
+    {
+      disp_len = 2;
+    }
+    else
+    {
+      disp_len = mod == 1 ? 1 : (mod == 2 ? 2 : 0);
+    }
+  }
+  else
+  {
+    if (rm == 4)
+    {
+      if (!reader.CanRead(1))
+      {
+        return false;
+      }
+
+      std::uint8_t const sib = reader.Next();
+      if (mod == 0 && (sib & 7) == 5)
+      {
+        disp_len = 4;
+      }
+    }
+
+    if (mod == 0 && rm == 5)
+    {
+      disp_len = 4;
+      if (is_64)
+      {
+        if (!reader.CanRead(disp_len))
+        {
+          return false;
+        }
+
+        info.rip_relative = true;
+        info.disp_offset = reader.GetPos();
+        info.disp = static_cast<std::int32_t>(reader.ReadSigned(disp_len));
+      }
+    }
+    else if (mod == 1)
+    {
+      disp_len = 1;
+    }
+    else if (mod == 2)
+    {
+      disp_len = 4;
+    }
+  }
+
+  return reader.Skip(disp_len);
+}
+
+inline std::uint32_t GetImmZSize(Prefixes const& prefixes)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  return prefixes.op_size && !(prefixes.rex & 0x08) ? 2 : 4;
+}
+
+inline bool ReadRel(Reader& reader,
+                    std::uint32_t len,
+                    InstructionInfo& info) HADESMEM_DETAIL_NOEXCEPT
+{
+  if (!reader.CanRead(len))
+  {
+    return false;
+  }
+
+  info.rel_offset = reader.GetPos();
+  info.rel_size = len;
+  info.rel = reader.ReadSigned(len);
+  return reader.Skip(len);
+}
+
+// Handles the VEX (C4/C5), XOP (8F) and EVEX (62) prefixes. The opcode map to
+// use is taken from the prefix, and every instruction other than
+// VZEROUPPER/VZEROALL has a ModRM byte.
+inline bool DecodeVex(Reader& reader,
+                      bool is_64,
+                      Prefixes const& prefixes,
+                      std::uint8_t escape,
+                      InstructionInfo& info) HADESMEM_DETAIL_NOEXCEPT
+{
+  std::uint32_t const prefix_len =
+    escape == 0xC5 ? 1U : (escape == 0x62 ? 3U : 2U);
+  if (!reader.CanRead(prefix_len + 1))
+  {
+    return false;
+  }
+
+  std::uint8_t const p0 = reader.Next();
+  std::uint8_t map = 1;
+  if (escape != 0xC5)
+  {
+    map = escape == 0x62 ? (p0 & 0x07) : (p0 & 0x1F);
+  }
+
+  if (!reader.Skip(prefix_len - 1))
+  {
+    return false;
+  }
+
+  std::uint8_t const opcode = reader.Next();
+  info.opcode = opcode;
+
+  // VZEROUPPER/VZEROALL.
+  if (map == 1 && opcode == 0x77)
+  {
+    return true;
+  }
+
+  std::uint8_t reg = 0;
+  if (!DecodeModRm(reader, is_64, prefixes, info, reg))
+  {
+    return false;
+  }
+
+  std::uint32_t imm_len = 0;
+  if (escape == 0x8F)
+  {
+    if (map < 8 || map > 0xA)
+    {
+      return false;
+    }
+    imm_len = map == 8 ? 1 : (map == 0xA ? 4 : 0);
+  }
+  else if (map == 3)
+  {
+    imm_len = 1;
+  }
+  else if (map == 1)
+  {
+    bool const has_imm8 = (opcode >= 0x70 && opcode <= 0x73) ||
+                          opcode == 0xC2 || (opcode >= 0xC4 && opcode <= 0xC6);
+    imm_len = has_imm8 ? 1 : 0;
+  }
+  else if (map != 2)
+  {
+    return false;
+  }
+
+  return reader.Skip(imm_len);
+}
+}
+
+// Decodes a single instruction from 'buffer' (at most 'avail' bytes). Returns
+// false if the instruction is invalid, unsupported, or truncated.
+inline bool DecodeInstruction(void const* buffer,
+                              std::size_t avail,
+                              bool is_64,
+                              InstructionInfo& info) HADESMEM_DETAIL_NOEXCEPT
+{
+  using namespace instruction_decoder;
+
+  info = InstructionInfo{};
+  Reader reader{static_cast<std::uint8_t const*>(buffer), avail};
+  Prefixes prefixes{};
+
+  std::uint8_t b = 0;
+  for (;;)
+  {
+    if (!reader.CanRead(1))
+    {
+      return false;
+    }
+
+    b = reader.Next();
+    if (IsLegacyPrefix(b))
+    {
+      prefixes.op_size |= b == 0x66;
+      prefixes.addr_size |= b == 0x67;
+      // REX is ignored unless it immediately precedes the opcode.
+      prefixes.rex = 0;
+      continue;
+    }
+
+    if (is_64 && (b & 0xF0) == 0x40)
+    {
+      prefixes.rex = b;
+      continue;
+    }
+
+    break;
+  }
+
+  info.addr_size_prefix = prefixes.addr_size;
+  info.opcode = b;
+
+  std::uint8_t flags = GetOneByteTable()[b];
+  bool two_byte = false;
+
+  if (flags & kSpecial)
+  {
+    switch (b)
+    {
+    case 0x0F:
+    {
+      if (!reader.CanRead(1))
+      {
+        return false;
+      }
+
+      b = reader.Next();
+      info.opcode = b;
+      two_byte = true;
+      if (b == 0x38 || b == 0x3A)
+      {
+        // Three byte opcode maps. Every instruction has a ModRM byte, and
+        // those in the 0F 3A map also have an imm8.
+        if (!reader.Skip(1))
+        {
+          return false;
+        }
+
+        flags = b == 0x3A ? (kModRm | kImm8) : kModRm;
+      }
+      else
+      {
+        flags = GetTwoByteTable()[b];
+        if (flags & kSpecial)
+        {
+          // Invalid or unsupported.
+          return false;
+        }
+      }
+      break;
+    }
+
+    case 0x40:
+    case 0x41:
+    case 0x42:
+    case 0x43:
+    case 0x44:
+    case 0x45:
+    case 0x46:
+    case 0x47:
+    case 0x48:
+    case 0x49:
+    case 0x4A:
+    case 0x4B:
+    case 0x4C:
+    case 0x4D:
+    case 0x4E:
+    case 0x4F:
+      // INC/DEC (REX is consumed as a prefix on x64).
+      flags = 0;
+      break;
+
+    case 0x06:
+    case 0x07:
+    case 0x0E:
+    case 0x16:
+    case 0x17:
+    case 0x1E:
+    case 0x1F:
+    case 0x27:
+    case 0x2F:
+    case 0x37:
+    case 0x3F:
+    case 0x60:
+    case 0x61:
+    case 0xCE:
+    case 0xD6:
+      // PUSH/POP seg, DAA, DAS, AAA, AAS, PUSHA, POPA, INTO, SALC.
+      if (is_64)
+      {
+        return false;
+      }
+      flags = 0;
+      break;
+
+    case 0x62:
+    case 0xC4:
+    case 0xC5:
+    {
+      // BOUND, LES and LDS on x86 unless the following byte has a ModRM.mod
+      // of 3, otherwise EVEX or VEX.
+      if (!reader.CanRead(1))
+      {
+        return false;
+      }
+
+      if (is_64 || (reader.Peek() & 0xC0) == 0xC0)
+      {
+        if (!DecodeVex(reader, is_64, prefixes, b, info))
+        {
+          return false;
+        }
+        info.len = reader.GetPos();
+        return true;
+      }
+
+      flags = kModRm;
+      break;
+    }
+
+    case 0x8F:
+      // POP r/m, unless ModRM.reg is non-zero in which case it is XOP.
+      if (!reader.CanRead(1))
+      {
+        return false;
+      }
+
+      if (reader.Peek() & 0x18)
+      {
+        if (!DecodeVex(reader, is_64, prefixes, b, info))
+        {
+          return false;
+        }
+        info.len = reader.GetPos();
+        return true;
+      }
+
+      flags = kModRm;
+      break;
+
+    case 0x82:
+    case 0xD4:
+    case 0xD5:
+      // Group 1 alias, AAM, AAD.
+      if (is_64)
+      {
+        return false;
+      }
+      flags = b == 0x82 ? (kModRm | kImm8) : kImm8;
+      break;
+
+    case 0x9A:
+    case 0xEA:
+      // CALL/JMP far ptr16:16/32.
+      if (is_64)
+      {
+        return false;
+      }
+      if (!reader.Skip((prefixes.op_size ? 2 : 4) + 2))
+      {
+        return false;
+      }
+      info.len = reader.GetPos();
+      return true;
+
+    case 0xA0:
+    case 0xA1:
+    case 0xA2:
+    case 0xA3:
+    {
+      // MOV moffs.
+      std::uint32_t const moffs_len =
+        is_64 ? (prefixes.addr_size ? 4 : 8) : (prefixes.addr_size ? 2 : 4);
+      if (!reader.Skip(moffs_len))
+      {
+        return false;
+      }
+      info.len = reader.GetPos();
+      return true;
+    }
+
+    case 0xB8:
+    case 0xB9:
+    case 0xBA:
+    case 0xBB:
+    case 0xBC:
+    case 0xBD:
+    case 0xBE:
+    case 0xBF:
+      flags = kImmV;
+      break;
+
+    case 0xC2:
+    case 0xCA:
+      // RET imm16.
+      flags = kImm16;
+      break;
+
+    case 0xC8:
+      // ENTER imm16, imm8.
+      flags = kImm16 | kImm8;
+      break;
+
+    case 0xE8:
+      info.type = InstructionType::kCallRel;
+      flags = kRelZ;
+      break;
+
+    case 0xE9:
+      info.type = InstructionType::kJmpRel;
+      flags = kRelZ;
+      break;
+
+    case 0xF6:
+    case 0xF7:
+    {
+      // Group 3. Only TEST has an immediate.
+      std::uint8_t reg = 0;
+      if (!DecodeModRm(reader, is_64, prefixes, info, reg))
+      {
+        return false;
+      }
+      if (reg == 0 || reg == 1)
+      {
+        std::uint32_t const imm_len = b == 0xF6 ? 1 : GetImmZSize(prefixes);
+        if (!reader.Skip(imm_len))
+        {
+          return false;
+        }
+      }
+      info.len = reader.GetPos();
+      return true;
+    }
+
+    case 0xFF:
+    {
+      // Group 5.
+      std::uint8_t reg = 0;
+      if (!DecodeModRm(reader, is_64, prefixes, info, reg))
+      {
+        return false;
+      }
+      if (reg == 2)
+      {
+        info.type = InstructionType::kCallIndirect;
+      }
+      else if (reg == 4)
+      {
+        info.type = InstructionType::kJmpIndirect;
+      }
+      info.len = reader.GetPos();
+      return true;
+    }
+
+    default:
+      // Prefixes are consumed above, so this is unreachable in practice.
+      return false;
+    }
+  }
+
+  if (flags & kModRm)
+  {
+    std::uint8_t reg = 0;
+    if (!DecodeModRm(reader, is_64, prefixes, info, reg))
+    {
+      return false;
+    }
+  }
+
+  if (flags & kImm16)
+  {
+    if (!reader.Skip(2))
+    {
+      return false;
+    }
+  }
+
+  if (flags & kImm8)
+  {
+    if (!reader.Skip(1))
+    {
+      return false;
+    }
+  }
+
+  if (flags & kImmZ)
+  {
+    if (!reader.Skip(GetImmZSize(prefixes)))
+    {
+      return false;
+    }
+  }
+
+  if (flags & kImmV)
+  {
+    std::uint32_t const imm_len =
+      (prefixes.rex & 0x08) ? 8 : (prefixes.op_size ? 2 : 4);
+    if (!reader.Skip(imm_len))
+    {
+      return false;
+    }
+  }
+
+  if (flags & kRel8)
+  {
+    if (!two_byte && b >= 0x70 && b <= 0x7F)
+    {
+      info.type = InstructionType::kJccRel;
+    }
+    else if (!two_byte && b >= 0xE0 && b <= 0xE3)
+    {
+      info.type = InstructionType::kLoopRel;
+    }
+    else
+    {
+      info.type = InstructionType::kJmpRel;
+    }
+
+    if (!ReadRel(reader, 1, info))
+    {
+      return false;
+    }
+  }
+
+  if (flags & kRelZ)
+  {
+    if (two_byte)
+    {
+      info.type = InstructionType::kJccRel;
+    }
+
+    std::uint32_t const rel_len = is_64 ? 4 : GetImmZSize(prefixes);
+    if (!ReadRel(reader, rel_len, info))
+    {
+      return false;
+    }
+  }
+
+  if (!two_byte && (b == 0xC2 || b == 0xC3))
+  {
+    info.type = InstructionType::kReturn;
+  }
+
+  info.len = reader.GetPos();
+  return true;
+}
+
+inline bool IsRelativeBranch(InstructionInfo const& info)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  return info.type == InstructionType::kJmpRel ||
+         info.type == InstructionType::kCallRel ||
+         info.type == InstructionType::kJccRel ||
+         info.type == InstructionType::kLoopRel;
+}
+}
+}
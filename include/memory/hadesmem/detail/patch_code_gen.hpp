@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -520,5 +521,76 @@ inline void WriteStubGate(Process const& process,
             nullptr);
   FlushInstructionCache(process, address, stub_gate.size());
 }
+
+// The fast stub gate only clobbers EAX/RAX, which is volatile and never used
+// to pass arguments, so unlike the gates above it needs to preserve nothing.
+// The stub is handed over in a TLS slot instead of ArbitraryUserPointer, so
+// there's nothing to restore (and no call to make) either.
+inline std::vector<std::uint8_t> GenFastStubGate32(void* stub,
+                                                   std::uint32_t slot_ofs)
+{
+  HADESMEM_DETAIL_ASSERT(stub);
+  std::vector<std::uint8_t> buf = {// MOV EAX, 0xDEADBEEF
+                                   0xB8, 0xEF, 0xBE, 0xAD, 0xDE,
+                                   // MOV FS:[0xCAFEBABE], EAX
+                                   0x64, 0xA3, 0xBE, 0xBA, 0xFE, 0xCA};
+  std::size_t const kStubPtrOfs = 1;
+  std::size_t const kSlotOfs = 7;
+  *reinterpret_cast<std::uint32_t*>(&buf[kStubPtrOfs]) =
+    static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(stub));
+  *reinterpret_cast<std::uint32_t*>(&buf[kSlotOfs]) = slot_ofs;
+  return buf;
+}
+
+inline std::vector<std::uint8_t> GenFastStubGate64(void* stub,
+                                                   std::uint32_t slot_ofs)
+{
+  HADESMEM_DETAIL_ASSERT(stub);
+  std::vector<std::uint8_t> buf = {
+    // MOV RAX, 0xDEADBEEFDEADBEEF
+    0x48, 0xB8, 0xEF, 0xBE, 0xAD, 0xDE, 0xEF, 0xBE, 0xAD, 0xDE,
+    // MOV GS:[0xCAFEBABE], RAX
+    0x65, 0x48, 0x89, 0x04, 0x25, 0xBE, 0xBA, 0xFE, 0xCA};
+  std::size_t const kStubPtrOfs = 2;
+  std::size_t const kSlotOfs = 15;
+  *reinterpret_cast<std::uint64_t*>(&buf[kStubPtrOfs]) =
+    reinterpret_cast<std::uint64_t>(stub);
+  *reinterpret_cast<std::uint32_t*>(&buf[kSlotOfs]) = slot_ofs;
+  return buf;
+}
+
+// Returns false without writing anything if the TLS slot isn't in the TEB's
+// inline TlsSlots array, in which case the caller should use WriteStubGate.
+inline bool WriteFastStubGate(Process const& process,
+                              void* address,
+                              void* stub,
+                              void* stub_fn)
+{
+  DWORD const tls_index = GetFastStubGateTlsIndex();
+  if (tls_index >= TLS_MINIMUM_AVAILABLE)
+  {
+    HADESMEM_DETAIL_TRACE_FORMAT_A(
+      "TLS index %lu is not inline, fast stub gate unavailable.", tls_index);
+    return false;
+  }
+
+  auto const slot_ofs = static_cast<std::uint32_t>(
+    offsetof(winternl::TEB, TlsSlots) + tls_index * sizeof(void*));
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+  auto const stub_gate = GenFastStubGate64(stub, slot_ofs);
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+  auto const stub_gate = GenFastStubGate32(stub, slot_ofs);
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+  WriteVector(process, address, stub_gate);
+  WriteJump(process,
+            static_cast<std::uint8_t*>(address) + stub_gate.size(),
+            stub_fn,
+            true,
+            nullptr);
+  FlushInstructionCache(process, address, stub_gate.size());
+  return true;
+}
 }
 }
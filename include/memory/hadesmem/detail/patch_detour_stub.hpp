@@ -11,7 +11,9 @@
 
 #include <windows.h>
 
+#include <hadesmem/detail/assert.hpp>
 #include <hadesmem/detail/detour_ref_counter.hpp>
+#include <hadesmem/detail/hook_profile.hpp>
 #include <hadesmem/detail/trace.hpp>
 #include <hadesmem/detail/type_traits.hpp>
 #include <hadesmem/detail/winternl.hpp>
@@ -22,6 +24,55 @@ namespace hadesmem
 {
 namespace detail
 {
+// Index (plus one, so that zero means unallocated) of the TLS slot a fast stub
+// gate uses to hand its stub to the detour.
+inline volatile LONG& GetFastStubGateTlsIndexStorage() HADESMEM_DETAIL_NOEXCEPT
+{
+  static volatile LONG index = 0;
+  return index;
+}
+
+// Allocated on first use and never freed, as detours may still be running
+// when the module unloads. Only indices in the TEB's inline TlsSlots array
+// can be written by the gate without a call, so callers must check the
+// result against TLS_MINIMUM_AVAILABLE.
+inline DWORD GetFastStubGateTlsIndex()
+{
+  volatile LONG& storage = GetFastStubGateTlsIndexStorage();
+  LONG const cur = storage;
+  if (cur)
+  {
+    return static_cast<DWORD>(cur - 1);
+  }
+
+  DWORD const index = ::TlsAlloc();
+  if (index == TLS_OUT_OF_INDEXES)
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"TlsAlloc failed."}
+                                            << ErrorCodeWinLast{last_error});
+  }
+
+  LONG const prev = ::InterlockedCompareExchange(
+    &storage, static_cast<LONG>(index + 1), 0);
+  if (prev)
+  {
+    ::TlsFree(index);
+    return static_cast<DWORD>(prev - 1);
+  }
+
+  return index;
+}
+
+// Read straight from the TEB rather than with TlsGetValue, which would
+// clobber the last error value seen by the detour.
+inline void* GetFastStubGateSlot() HADESMEM_DETAIL_NOEXCEPT
+{
+  LONG const index = GetFastStubGateTlsIndexStorage() - 1;
+  HADESMEM_DETAIL_ASSERT(index >= 0 && index < TLS_MINIMUM_AVAILABLE);
+  return winternl::GetCurrentTeb()->TlsSlots[index];
+}
+
 template <typename TargetFuncT> class PatchDetourStub;
 
 template <typename C, typename R, typename... Args>
@@ -47,16 +98,56 @@ struct PatchDetourStub<R (C::*)(Args...)>
     return stub->StubImpl(this_, std::forward<Args>(args)...);
   }
 
+  // Entered from a fast stub gate, which passes the stub in a TLS slot and
+  // leaves ArbitraryUserPointer untouched.
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+  static R FastStub(C* this_, Args... args)
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+  static R __fastcall FastStub(C* this_, void* /*edx_*/, Args... args)
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+  {
+    auto const stub = static_cast<PatchDetourStub*>(GetFastStubGateSlot());
+    return stub->FastStubImpl(this_, std::forward<Args>(args)...);
+  }
+
+  // As FastStub, but calls a detour bound at compile time.
+  template <DetourFuncRawT Detour>
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+  static R StaticStub(C* this_, Args... args)
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+  static R __fastcall StaticStub(C* this_, void* /*edx_*/, Args... args)
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+  {
+    auto const stub = static_cast<PatchDetourStub*>(GetFastStubGateSlot());
+    auto const ref_counter =
+      MakeDetourRefCounter(stub->patch_->GetRefCount());
+    HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(stub->patch_);
+    return Detour(stub->patch_, this_, std::forward<Args>(args)...);
+  }
+
 private:
   R StubImpl(C* this_, Args... args)
   {
     auto const ref_counter = MakeDetourRefCounter(patch_->GetRefCount());
+    HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch_);
     winternl::GetCurrentTeb()->NtTib.ArbitraryUserPointer =
       patch_->GetOriginalArbitraryUserPtr();
     auto const detour = static_cast<DetourFuncT const*>(patch_->GetDetour());
     return (*detour)(patch_, this_, std::forward<Args>(args)...);
   }
 
+  R FastStubImpl(C* this_, Args... args)
+  {
+    auto const ref_counter = MakeDetourRefCounter(patch_->GetRefCount());
+    HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch_);
+    auto const detour = static_cast<DetourFuncT const*>(patch_->GetDetour());
+    return (*detour)(patch_, this_, std::forward<Args>(args)...);
+  }
+
   PatchDetourBase* patch_;
 };
 
@@ -85,16 +176,56 @@ struct PatchDetourStub<R (C::*)(Args...) const>
     return stub->StubImpl(this_, std::forward<Args>(args)...);
   }
 
+  // Entered from a fast stub gate, which passes the stub in a TLS slot and
+  // leaves ArbitraryUserPointer untouched.
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+  static R FastStub(C const* this_, Args... args)
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+  static R __fastcall FastStub(C const* this_, void* /*edx_*/, Args... args)
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+  {
+    auto const stub = static_cast<PatchDetourStub*>(GetFastStubGateSlot());
+    return stub->FastStubImpl(this_, std::forward<Args>(args)...);
+  }
+
+  // As FastStub, but calls a detour bound at compile time.
+  template <DetourFuncRawT Detour>
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+  static R StaticStub(C const* this_, Args... args)
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+  static R __fastcall StaticStub(C const* this_, void* /*edx_*/, Args... args)
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+  {
+    auto const stub = static_cast<PatchDetourStub*>(GetFastStubGateSlot());
+    auto const ref_counter =
+      MakeDetourRefCounter(stub->patch_->GetRefCount());
+    HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(stub->patch_);
+    return Detour(stub->patch_, this_, std::forward<Args>(args)...);
+  }
+
 private:
   R StubImpl(C const* this_, Args... args)
   {
     auto const ref_counter = MakeDetourRefCounter(patch_->GetRefCount());
+    HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch_);
     winternl::GetCurrentTeb()->NtTib.ArbitraryUserPointer =
       patch_->GetOriginalArbitraryUserPtr();
     auto const detour = static_cast<DetourFuncT const*>(patch_->GetDetour());
     return (*detour)(patch_, this_, std::forward<Args>(args)...);
   }
 
+  R FastStubImpl(C const* this_, Args... args)
+  {
+    auto const ref_counter = MakeDetourRefCounter(patch_->GetRefCount());
+    HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch_);
+    auto const detour = static_cast<DetourFuncT const*>(patch_->GetDetour());
+    return (*detour)(patch_, this_, std::forward<Args>(args)...);
+  }
+
   PatchDetourBase* patch_;
 };
 
@@ -118,6 +249,24 @@ public:                                                                        \
       auto const stub = static_cast<PatchDetourStub*>(                         \
         winternl::GetCurrentTeb()->NtTib.ArbitraryUserPointer);                \
       return stub->StubImpl(std::forward<Args>(args)...);                      \
+    }                                                                          \
+                                                                               \
+    static R call_conv FastStub(Args... args)                                  \
+    {                                                                          \
+      auto const stub =                                                        \
+        static_cast<PatchDetourStub*>(GetFastStubGateSlot());                  \
+      return stub->FastStubImpl(std::forward<Args>(args)...);                  \
+    }                                                                          \
+                                                                               \
+    template <DetourFuncRawT Detour>                                           \
+    static R call_conv StaticStub(Args... args)                                \
+    {                                                                          \
+      auto const stub =                                                        \
+        static_cast<PatchDetourStub*>(GetFastStubGateSlot());                  \
+      auto const ref_counter =                                                 \
+        MakeDetourRefCounter(stub->patch_->GetRefCount());                     \
+      HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(stub->patch_);                        \
+      return Detour(stub->patch_, std::forward<Args>(args)...);                \
     }                                                                          \
   \
 private:                                                                       \
@@ -125,6 +274,7 @@ private:                                                                       \
     {                                                                          \
       HADESMEM_DETAIL_STATIC_ASSERT(IsFunction<DetourFuncRawT>::value);        \
       auto const ref_counter = MakeDetourRefCounter(patch_->GetRefCount());    \
+      HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch_);                              \
       winternl::GetCurrentTeb()->NtTib.ArbitraryUserPointer =                  \
         patch_->GetOriginalArbitraryUserPtr();                                 \
       auto const detour =                                                      \
@@ -132,6 +282,15 @@ private:                                                                       \
       return (*detour)(patch_, std::forward<Args>(args)...);                   \
     }                                                                          \
                                                                                \
+    R FastStubImpl(Args... args)                                               \
+    {                                                                          \
+      auto const ref_counter = MakeDetourRefCounter(patch_->GetRefCount());    \
+      HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch_);                              \
+      auto const detour =                                                      \
+        static_cast<DetourFuncT const*>(patch_->GetDetour());                  \
+      return (*detour)(patch_, std::forward<Args>(args)...);                   \
+    }                                                                          \
+                                                                               \
     PatchDetourBase* patch_;                                                   \
   \
 };                                                                             \
@@ -154,6 +313,24 @@ public:                                                                        \
       auto const stub = static_cast<PatchDetourStub*>(                         \
         winternl::GetCurrentTeb()->NtTib.ArbitraryUserPointer);                \
       return stub->StubImpl(std::forward<Args>(args)...);                      \
+    }                                                                          \
+                                                                               \
+    static R call_conv FastStub(Args... args)                                  \
+    {                                                                          \
+      auto const stub =                                                        \
+        static_cast<PatchDetourStub*>(GetFastStubGateSlot());                  \
+      return stub->FastStubImpl(std::forward<Args>(args)...);                  \
+    }                                                                          \
+                                                                               \
+    template <DetourFuncRawT* Detour>                                          \
+    static R call_conv StaticStub(Args... args)                                \
+    {                                                                          \
+      auto const stub =                                                        \
+        static_cast<PatchDetourStub*>(GetFastStubGateSlot());                  \
+      auto const ref_counter =                                                 \
+        MakeDetourRefCounter(stub->patch_->GetRefCount());                     \
+      HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(stub->patch_);                        \
+      return Detour(stub->patch_, std::forward<Args>(args)...);                \
     }                                                                          \
   \
 private:                                                                       \
@@ -161,11 +338,21 @@ private:                                                                       \
     {                                                                          \
       HADESMEM_DETAIL_STATIC_ASSERT(IsFunction<DetourFuncRawT>::value);        \
       auto const ref_counter = MakeDetourRefCounter(patch_->GetRefCount());    \
+      HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch_);                              \
       winternl::GetCurrentTeb()->NtTib.ArbitraryUserPointer =                  \
         patch_->GetOriginalArbitraryUserPtr();                                 \
       auto const detour =                                                      \
         static_cast<DetourFuncT const*>(patch_->GetDetour());                  \
       return (*detour)(patch_, std::forward<Args>(args)...);                   \
+    }                                                                          \
+                                                                               \
+    R FastStubImpl(Args... args)                                               \
+    {                                                                          \
+      auto const ref_counter = MakeDetourRefCounter(patch_->GetRefCount());    \
+      HADESMEM_DETAIL_HOOK_PROFILE_SCOPE(patch_);                              \
+      auto const detour =                                                      \
+        static_cast<DetourFuncT const*>(patch_->GetDetour());                  \
+      return (*detour)(patch_, std::forward<Args>(args)...);                   \
     }                                                                          \
     \
 PatchDetourBase* patch_;                                                       \
@@ -34,5 +34,23 @@ inline void VerifyPatchThreads(DWORD pid, void* target, std::size_t len)
     }
   }
 }
+
+// Reuses the handles already held by the suspension rather than taking a new
+// snapshot and reopening every thread.
+inline void VerifyPatchThreads(SuspendedProcess const& suspended_process,
+                               void* target,
+                               std::size_t len)
+{
+  for (auto const& thread : suspended_process.GetThreads())
+  {
+    if (IsExecutingInRange(thread.GetThread(),
+                           target,
+                           static_cast<std::uint8_t*>(target) + len))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Thread is currently executing patch target."});
+    }
+  }
+}
 }
 }
@@ -0,0 +1,187 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/error.hpp>
+
+namespace hadesmem
+{
+struct PatternFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    kThrowOnUnmatch = 1 << 0,
+    kRelativeAddress = 1 << 1,
+    kScanData = 1 << 2,
+    kInvalidFlagMaxValue = 1 << 3
+  };
+};
+
+namespace detail
+{
+struct PatternDataByte
+{
+  std::uint8_t data;
+  bool wildcard;
+};
+
+inline std::vector<PatternDataByte> ConvertData(std::wstring const& data)
+{
+  HADESMEM_DETAIL_ASSERT(!data.empty());
+
+  std::wstring const data_trimmed{
+    data.substr(0, data.find_last_not_of(L" \n\r\t") + 1)};
+
+  HADESMEM_DETAIL_ASSERT(!data_trimmed.empty());
+
+  std::wistringstream data_str{data_trimmed};
+  data_str.imbue(std::locale::classic());
+  std::vector<PatternDataByte> data_real;
+  do
+  {
+    std::wstring data_cur_str;
+    if (!(data_str >> data_cur_str))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Data parsing failed."});
+    }
+
+    bool const is_wildcard = (data_cur_str == L"??");
+    std::uint32_t current = 0U;
+    if (!is_wildcard)
+    {
+      std::wistringstream conv{data_cur_str};
+      conv.imbue(std::locale::classic());
+      if (!(conv >> std::hex >> current))
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Data conversion failed."});
+      }
+
+      if (current > static_cast<std::uint8_t>(-1))
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(Error()
+                                        << ErrorString("Invalid data."));
+      }
+    }
+
+    data_real.emplace_back(
+      PatternDataByte{static_cast<std::uint8_t>(current), is_wildcard});
+  } while (!data_str.eof());
+
+  return data_real;
+}
+
+// Pattern data as value/mask arrays plus the anchor to search for, for use
+// with FindMasked.
+struct MaskedPattern
+{
+  std::vector<std::uint8_t> value;
+  // 0xFF for bytes which must match, 0x00 for wildcards.
+  std::vector<std::uint8_t> mask;
+  // Longest run of non-wildcard bytes in the pattern. Zero length if the
+  // pattern is all wildcards.
+  std::size_t anchor_offset;
+  std::size_t anchor_len;
+};
+
+inline MaskedPattern
+  ConvertToMaskedPattern(std::vector<PatternDataByte> const& needle)
+{
+  MaskedPattern pattern{};
+  for (auto const& b : needle)
+  {
+    pattern.value.push_back(static_cast<std::uint8_t>(b.wildcard ? 0 : b.data));
+    pattern.mask.push_back(static_cast<std::uint8_t>(b.wildcard ? 0 : 0xFF));
+  }
+
+  for (std::size_t i = 0; i < needle.size();)
+  {
+    if (needle[i].wildcard)
+    {
+      ++i;
+      continue;
+    }
+
+    std::size_t run_end = i;
+    while (run_end < needle.size() && !needle[run_end].wildcard)
+    {
+      ++run_end;
+    }
+    if (run_end - i > pattern.anchor_len)
+    {
+      pattern.anchor_offset = i;
+      pattern.anchor_len = run_end - i;
+    }
+    i = run_end;
+  }
+
+  return pattern;
+}
+
+// Search with a compiled pattern. Candidates are found by searching for the
+// anchor (the longest run of bytes without wildcards) with memchr and memcmp,
+// and only then is the whole pattern compared. Returns the first match.
+inline std::uint8_t const* FindMasked(std::uint8_t const* h_beg,
+                                      std::uint8_t const* h_end,
+                                      std::uint8_t const* value,
+                                      std::uint8_t const* mask,
+                                      std::size_t len,
+                                      std::size_t anchor_offset,
+                                      std::size_t anchor_len)
+{
+  if (static_cast<std::size_t>(h_end - h_beg) < len)
+  {
+    return nullptr;
+  }
+
+  if (!anchor_len)
+  {
+    return h_beg;
+  }
+
+  auto const matches = [&](std::uint8_t const* candidate)
+  {
+    for (std::size_t i = 0; i < len; ++i)
+    {
+      if ((candidate[i] ^ value[i]) & mask[i])
+      {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  std::uint8_t const* const anchor = value + anchor_offset;
+  std::uint8_t const* const anchor_last = h_end - len + anchor_offset;
+  for (auto p = h_beg + anchor_offset; p <= anchor_last; ++p)
+  {
+    p = static_cast<std::uint8_t const*>(std::memchr(
+      p, anchor[0], static_cast<std::size_t>(anchor_last - p) + 1));
+    if (!p)
+    {
+      break;
+    }
+
+    if (!std::memcmp(p, anchor, anchor_len) && matches(p - anchor_offset))
+    {
+      return p - anchor_offset;
+    }
+  }
+
+  return nullptr;
+}
+}
+}
@@ -0,0 +1,105 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+// In-flight call count for a detour, split across cache line sized shards
+// indexed by thread ID so that threads concurrently calling the same hooked
+// function don't all contend on one cache line. A call increments and
+// decrements the same shard, so no shard ever goes negative and a call which
+// is in flight for the whole of GetCount is always seen by it.
+class ShardedRefCount
+{
+public:
+  static std::size_t const kNumShards = 64;
+
+  ShardedRefCount() HADESMEM_DETAIL_NOEXCEPT : shards_()
+  {
+  }
+
+  ShardedRefCount(ShardedRefCount const&) = delete;
+
+  ShardedRefCount& operator=(ShardedRefCount const&) = delete;
+
+  // Returns the shard to pass to Release.
+  std::atomic<std::uint32_t>& Acquire() HADESMEM_DETAIL_NOEXCEPT
+  {
+    // Thread IDs are multiples of four.
+    std::size_t const index = (::GetCurrentThreadId() >> 2) % kNumShards;
+    auto& count = shards_[index].count;
+    ++count;
+    return count;
+  }
+
+  static void Release(std::atomic<std::uint32_t>& shard)
+    HADESMEM_DETAIL_NOEXCEPT
+  {
+    HADESMEM_DETAIL_ASSERT(shard.load() != 0);
+    --shard;
+  }
+
+  std::uint32_t GetCount() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    std::uint32_t count = 0;
+    for (auto const& shard : shards_)
+    {
+      count += shard.count.load();
+    }
+    return count;
+  }
+
+  // Waits for all calls currently in flight to complete. Spins briefly before
+  // falling back to yielding the thread. Returns false on timeout.
+  bool WaitForQuiescence(DWORD timeout = INFINITE) const
+    HADESMEM_DETAIL_NOEXCEPT
+  {
+    ULONGLONG const start = ::GetTickCount64();
+    for (std::uint32_t i = 0; GetCount(); ++i)
+    {
+      if (timeout != INFINITE && ::GetTickCount64() - start >= timeout)
+      {
+        return false;
+      }
+
+      if (i < kSpinCount)
+      {
+        ::YieldProcessor();
+      }
+      else
+      {
+        ::Sleep(i < kSpinCount * 2 ? 0 : 1);
+      }
+    }
+
+    return true;
+  }
+
+private:
+  static std::size_t const kCacheLineSize = 64;
+  static std::uint32_t const kSpinCount = 1000;
+
+  // Every counter is at the same offset within its shard, so no two counters
+  // share a cache line even if the shards aren't line aligned.
+  struct Shard
+  {
+    std::atomic<std::uint32_t> count;
+    char pad[kCacheLineSize - sizeof(std::atomic<std::uint32_t>)];
+  };
+
+  Shard shards_[kNumShards];
+};
+}
+}
@@ -0,0 +1,254 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+
+namespace hadesmem
+{
+// Address range in the target.
+struct SnapshotRange
+{
+  void* base;
+  std::size_t size;
+};
+
+struct SnapshotStats
+{
+  // Pages in the snapshot after the capture.
+  std::size_t num_pages;
+  // Pages read from the target by the capture.
+  std::size_t num_pages_read;
+  // Pages whose contents differed from the previous capture, including every
+  // page of a new region.
+  std::size_t num_pages_changed;
+  // Pages covered by OS dirty tracking, of which only those reported as
+  // written were read.
+  std::size_t num_pages_tracked;
+};
+
+namespace detail
+{
+// Backend independent part of a snapshot. Holds a copy of each captured
+// region along with the generation in which each of its pages last changed.
+// Backends enumerate the regions, decide which pages to read, and pass what
+// they read to Update, which compares it against the previous contents.
+class SnapshotStore
+{
+public:
+  struct Region
+  {
+    std::uintptr_t base;
+    std::size_t size;
+    std::vector<std::uint8_t> data;
+    std::vector<std::uint64_t> page_generations;
+    // Added by the current capture, so every page counts as changed.
+    bool is_new;
+  };
+
+  explicit SnapshotStore(std::size_t page_size) : page_size_{page_size}
+  {
+    HADESMEM_DETAIL_ASSERT(page_size_ &&
+                           !(page_size_ & (page_size_ - 1)));
+  }
+
+  std::size_t GetPageSize() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return page_size_;
+  }
+
+  std::uint64_t GetGeneration() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return generation_;
+  }
+
+  SnapshotStats GetStats() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return stats_;
+  }
+
+  // Starts a new generation with the given (page aligned) regions. Regions
+  // with the same base and size as in the previous capture keep their
+  // contents, and any others are added as new. Regions which no longer exist
+  // are discarded.
+  void BeginCapture(
+    std::vector<std::pair<std::uintptr_t, std::size_t>> const& extents)
+  {
+    ++generation_;
+    stats_ = SnapshotStats{};
+
+    std::map<std::uintptr_t, std::size_t> old_indices;
+    for (std::size_t i = 0; i < regions_.size(); ++i)
+    {
+      old_indices[regions_[i].base] = i;
+    }
+
+    std::vector<Region> regions;
+    regions.reserve(extents.size());
+    for (auto const& extent : extents)
+    {
+      HADESMEM_DETAIL_ASSERT(!(extent.first & (page_size_ - 1)) &&
+                             !(extent.second & (page_size_ - 1)));
+
+      auto const iter = old_indices.find(extent.first);
+      if (iter != std::end(old_indices) &&
+          regions_[iter->second].size == extent.second)
+      {
+        regions.emplace_back(std::move(regions_[iter->second]));
+        regions.back().is_new = false;
+      }
+      else
+      {
+        Region region;
+        region.base = extent.first;
+        region.size = extent.second;
+        region.data.resize(extent.second);
+        region.page_generations.assign(extent.second / page_size_,
+                                       generation_);
+        region.is_new = true;
+        regions.emplace_back(std::move(region));
+      }
+
+      stats_.num_pages += extent.second / page_size_;
+    }
+
+    regions_ = std::move(regions);
+  }
+
+  std::size_t GetNumRegions() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return regions_.size();
+  }
+
+  Region const& GetRegion(std::size_t index) const HADESMEM_DETAIL_NOEXCEPT
+  {
+    HADESMEM_DETAIL_ASSERT(index < regions_.size());
+    return regions_[index];
+  }
+
+  // Records num_pages pages starting at first_page of the region, as read
+  // from the target during the current capture.
+  void Update(std::size_t index,
+              std::size_t first_page,
+              std::uint8_t const* data,
+              std::size_t num_pages)
+  {
+    Region& region = regions_[index];
+    HADESMEM_DETAIL_ASSERT(first_page + num_pages <=
+                           region.page_generations.size());
+
+    for (std::size_t i = 0; i < num_pages; ++i)
+    {
+      auto const src = data + i * page_size_;
+      auto const dst = &region.data[(first_page + i) * page_size_];
+      if (region.is_new || std::memcmp(dst, src, page_size_))
+      {
+        std::memcpy(dst, src, page_size_);
+        region.page_generations[first_page + i] = generation_;
+        ++stats_.num_pages_changed;
+      }
+    }
+
+    stats_.num_pages_read += num_pages;
+  }
+
+  // Records that the OS reported which pages of the region were written, so
+  // only those were passed to Update.
+  void MarkTracked(std::size_t index) HADESMEM_DETAIL_NOEXCEPT
+  {
+    HADESMEM_DETAIL_ASSERT(index < regions_.size());
+    stats_.num_pages_tracked += regions_[index].size / page_size_;
+  }
+
+  // Drops a region which could not be read, e.g. because it was unmapped
+  // after being enumerated.
+  void Remove(std::size_t index)
+  {
+    HADESMEM_DETAIL_ASSERT(index < regions_.size());
+    stats_.num_pages -= regions_[index].size / page_size_;
+    regions_.erase(std::begin(regions_) +
+                   static_cast<std::ptrdiff_t>(index));
+  }
+
+  // Pages (merged into ranges, in address order) whose contents changed after
+  // the given generation, including those of regions added since. Pass zero
+  // to get every page.
+  std::vector<SnapshotRange> GetChangedSince(std::uint64_t generation) const
+  {
+    std::vector<SnapshotRange> ranges;
+    for (auto const& region : regions_)
+    {
+      for (std::size_t i = 0; i < region.page_generations.size(); ++i)
+      {
+        if (region.page_generations[i] <= generation)
+        {
+          continue;
+        }
+
+        auto const address = region.base + i * page_size_;
+        if (!ranges.empty() &&
+            reinterpret_cast<std::uintptr_t>(ranges.back().base) +
+                ranges.back().size ==
+              address)
+        {
+          ranges.back().size += page_size_;
+        }
+        else
+        {
+          SnapshotRange const range = {reinterpret_cast<void*>(address),
+                                       page_size_};
+          ranges.push_back(range);
+        }
+      }
+    }
+
+    return ranges;
+  }
+
+  // Captured copy of [address, address + len), or null if the range is not
+  // (entirely) in a single captured region.
+  void const* GetData(void const* address, std::size_t len) const
+  {
+    auto const target = reinterpret_cast<std::uintptr_t>(address);
+    auto const iter =
+      std::upper_bound(std::begin(regions_),
+                       std::end(regions_),
+                       target,
+                       [](std::uintptr_t value, Region const& region)
+                       {
+                         return value < region.base;
+                       });
+    if (iter == std::begin(regions_))
+    {
+      return nullptr;
+    }
+
+    Region const& region = *std::prev(iter);
+    auto const offset = target - region.base;
+    if (offset >= region.size || len > region.size - offset)
+    {
+      return nullptr;
+    }
+
+    return region.data.data() + offset;
+  }
+
+private:
+  std::size_t page_size_;
+  std::uint64_t generation_{};
+  SnapshotStats stats_{};
+  std::vector<Region> regions_;
+};
+}
+}
@@ -0,0 +1,104 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/detail/type_traits.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread (which may be the same thread). Storage is inline, so pushing and
+// popping never allocate, and a full queue fails the push rather than
+// blocking the producer.
+template <typename T, std::size_t Capacity> class SpscRingBuffer
+{
+public:
+  HADESMEM_DETAIL_STATIC_ASSERT(Capacity != 0 &&
+                                (Capacity & (Capacity - 1)) == 0);
+  HADESMEM_DETAIL_STATIC_ASSERT(IsTriviallyCopyable<T>::value);
+
+  SpscRingBuffer() HADESMEM_DETAIL_NOEXCEPT
+  {
+  }
+
+  SpscRingBuffer(SpscRingBuffer const&) = delete;
+
+  SpscRingBuffer& operator=(SpscRingBuffer const&) = delete;
+
+  static std::size_t GetCapacity() HADESMEM_DETAIL_NOEXCEPT
+  {
+    return Capacity;
+  }
+
+  // Producer only.
+  bool TryPush(T const& value) HADESMEM_DETAIL_NOEXCEPT
+  {
+    std::size_t const tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == Capacity)
+    {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == Capacity)
+      {
+        return false;
+      }
+    }
+
+    buf_[tail & (Capacity - 1)] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Pops up to 'max' elements into 'out' and returns the number
+  // of elements popped.
+  std::size_t TryPopBatch(T* out, std::size_t max) HADESMEM_DETAIL_NOEXCEPT
+  {
+    std::size_t const head = head_.load(std::memory_order_relaxed);
+    if (tail_cache_ - head < max)
+    {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+    }
+
+    std::size_t const avail = tail_cache_ - head;
+    std::size_t const count = avail < max ? avail : max;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      out[i] = buf_[(head + i) & (Capacity - 1)];
+    }
+
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  // Approximate when called concurrently with the producer or consumer.
+  std::size_t GetSize() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+private:
+  static std::size_t const kCacheLineSize = 64;
+
+  // Indices increase monotonically and wrap naturally. Producer and consumer
+  // state is kept on separate cache lines, and each side caches the other's
+  // index to avoid touching the shared line on every operation.
+  std::atomic<std::size_t> head_{};
+  std::size_t tail_cache_{};
+  char pad_1_[kCacheLineSize - sizeof(std::atomic<std::size_t>) -
+              sizeof(std::size_t)];
+  std::atomic<std::size_t> tail_{};
+  std::size_t head_cache_{};
+  char pad_2_[kCacheLineSize - sizeof(std::atomic<std::size_t>) -
+              sizeof(std::size_t)];
+  T buf_[Capacity];
+};
+}
+}
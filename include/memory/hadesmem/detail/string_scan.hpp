@@ -0,0 +1,257 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <intrin.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+enum class StringEncoding
+{
+  kAscii,
+  kUtf16Le
+};
+
+inline bool IsStringScanPrintable(std::uint8_t c) HADESMEM_DETAIL_NOEXCEPT
+{
+  return c >= 0x20 && c < 0x7F;
+}
+
+inline bool IsSsse3Supported() HADESMEM_DETAIL_NOEXCEPT
+{
+  int cpu_info[4] = {};
+  __cpuid(cpu_info, 1);
+  return !!(cpu_info[2] & (1 << 9));
+}
+
+inline std::uint32_t
+  CountTrailingZeros64(std::uint64_t value) HADESMEM_DETAIL_NOEXCEPT
+{
+  HADESMEM_DETAIL_ASSERT(value != 0);
+
+  unsigned long index = 0;
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+  _BitScanForward64(&index, value);
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+  if (!_BitScanForward(&index, static_cast<std::uint32_t>(value)))
+  {
+    _BitScanForward(&index, static_cast<std::uint32_t>(value >> 32));
+    index += 32;
+  }
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+  return index;
+}
+
+// Classifies 64 bytes at once. Printable bytes are found with a nibble lookup
+// table (one shuffle per nibble) rather than a per-byte locale query.
+inline void ClassifyStringBlockSsse3(std::uint8_t const* p,
+                                     std::uint64_t& printable,
+                                     std::uint64_t& zero)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  // High nibble 0x2-0x6 is printable for any low nibble (bit 0), high nibble
+  // 0x7 is printable for any low nibble except 0xF (bit 1).
+  __m128i const lut_hi =
+    _mm_setr_epi8(0, 0, 1, 1, 1, 1, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+  __m128i const lut_lo =
+    _mm_setr_epi8(3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 1);
+  __m128i const nibble_mask = _mm_set1_epi8(0x0F);
+  __m128i const zero_vec = _mm_setzero_si128();
+
+  printable = 0;
+  zero = 0;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    __m128i const v =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + i * 16));
+    __m128i const lo = _mm_and_si128(v, nibble_mask);
+    __m128i const hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble_mask);
+    __m128i const cls = _mm_and_si128(_mm_shuffle_epi8(lut_hi, hi),
+                                      _mm_shuffle_epi8(lut_lo, lo));
+    auto const not_printable = static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(cls, zero_vec)));
+    auto const is_zero = static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero_vec)));
+    printable |= static_cast<std::uint64_t>(~not_printable & 0xFFFFU)
+                 << (i * 16);
+    zero |= static_cast<std::uint64_t>(is_zero) << (i * 16);
+  }
+}
+
+inline void ClassifyStringBlockScalar(std::uint8_t const* p,
+                                      std::uint64_t& printable,
+                                      std::uint64_t& zero)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  printable = 0;
+  zero = 0;
+  for (std::size_t i = 0; i < 64; ++i)
+  {
+    printable |= static_cast<std::uint64_t>(IsStringScanPrintable(p[i])) << i;
+    zero |= static_cast<std::uint64_t>(p[i] == 0) << i;
+  }
+}
+
+// Tracks runs of set bits in one 'lane' of the per-block character masks.
+// ASCII uses a stride of one byte, UTF-16LE uses a stride of two bytes with
+// a separate lane for each alignment.
+class StringRunTracker
+{
+public:
+  explicit StringRunTracker(StringEncoding encoding,
+                            std::uint64_t lane_mask,
+                            std::size_t min_len) HADESMEM_DETAIL_NOEXCEPT
+    : encoding_{encoding},
+      stride_{encoding == StringEncoding::kAscii ? 1U : 2U},
+      lane_mask_{lane_mask},
+      min_len_{min_len}
+  {
+  }
+
+  template <typename Func>
+  void Process(std::uint64_t mask, std::size_t base, Func& func)
+  {
+    mask &= lane_mask_;
+
+    // Every set bit is a position where the lane changes state, so they
+    // alternate between the start of a run and one past the end of a run.
+    std::uint64_t const carry = prev_ >> (64 - stride_);
+    std::uint64_t transitions =
+      (mask ^ ((mask << stride_) | carry)) & lane_mask_;
+    while (transitions)
+    {
+      std::uint32_t const i = CountTrailingZeros64(transitions);
+      transitions &= transitions - 1;
+
+      std::size_t const pos = base + i;
+      if ((mask >> i) & 1)
+      {
+        start_ = pos;
+      }
+      else
+      {
+        std::size_t const len = (pos - start_) / stride_;
+        if (len >= min_len_)
+        {
+          func(start_, len, encoding_);
+        }
+      }
+    }
+
+    prev_ = mask;
+  }
+
+  template <typename Func> void Finish(std::size_t base, Func& func)
+  {
+    Process(0, base, func);
+  }
+
+private:
+  StringEncoding encoding_;
+  std::size_t stride_;
+  std::uint64_t lane_mask_;
+  std::size_t min_len_;
+  std::uint64_t prev_{};
+  std::size_t start_{};
+};
+
+// Finds all runs of at least 'min_len' printable ASCII characters, and all
+// runs of at least 'min_len' printable UTF-16LE characters (ASCII range only)
+// at both even and odd offsets, in a single pass over the buffer. Each run is
+// reported to 'func' as (offset in bytes, length in characters, encoding),
+// ordered by end offset within each encoding/alignment. No data is copied.
+template <typename Func>
+void ScanStrings(void const* buffer,
+                 std::size_t len,
+                 std::size_t min_len,
+                 Func func)
+{
+  HADESMEM_DETAIL_ASSERT(len ? buffer != nullptr : true);
+  HADESMEM_DETAIL_ASSERT(min_len != 0);
+
+  if (!len)
+  {
+    return;
+  }
+
+  auto const classify =
+    IsSsse3Supported() ? &ClassifyStringBlockSsse3 : &ClassifyStringBlockScalar;
+  auto const p = static_cast<std::uint8_t const*>(buffer);
+  std::size_t const kBlockLen = 64;
+
+  // Trailing partial blocks are classified from a zero padded copy so the
+  // vector loads never read past the end of the buffer.
+  auto const classify_at = [&](std::size_t base,
+                               std::uint64_t& printable,
+                               std::uint64_t& zero)
+  {
+    if (len - base >= kBlockLen)
+    {
+      classify(p + base, printable, zero);
+    }
+    else
+    {
+      std::uint8_t tail[kBlockLen] = {};
+      std::memcpy(tail, p + base, len - base);
+      classify(tail, printable, zero);
+    }
+  };
+
+  StringRunTracker ascii{StringEncoding::kAscii, ~0ULL, min_len};
+  StringRunTracker wide_even{
+    StringEncoding::kUtf16Le, 0x5555555555555555ULL, min_len};
+  StringRunTracker wide_odd{
+    StringEncoding::kUtf16Le, 0xAAAAAAAAAAAAAAAAULL, min_len};
+
+  std::uint64_t printable = 0;
+  std::uint64_t zero = 0;
+  classify_at(0, printable, zero);
+
+  std::size_t base = 0;
+  for (; base < len; base += kBlockLen)
+  {
+    // A UTF-16LE character at the last byte of a block depends on the first
+    // byte of the next block, so classification runs one block ahead.
+    std::uint64_t printable_next = 0;
+    std::uint64_t zero_next = 0;
+    if (len - base > kBlockLen)
+    {
+      classify_at(base + kBlockLen, printable_next, zero_next);
+    }
+
+    std::size_t const avail = len - base;
+    std::uint64_t const ascii_valid =
+      avail >= kBlockLen ? ~0ULL : ((1ULL << avail) - 1);
+    std::uint64_t const wide_valid =
+      avail > kBlockLen ? ~0ULL : ((1ULL << (avail - 1)) - 1);
+
+    std::uint64_t const ascii_mask = printable & ascii_valid;
+    std::uint64_t const wide_mask =
+      printable & ((zero >> 1) | (zero_next << 63)) & wide_valid;
+
+    ascii.Process(ascii_mask, base, func);
+    wide_even.Process(wide_mask, base, func);
+    wide_odd.Process(wide_mask, base, func);
+
+    printable = printable_next;
+    zero = zero_next;
+  }
+
+  ascii.Finish(base, func);
+  wide_even.Finish(base, func);
+  wide_odd.Finish(base, func);
+}
+}
+}
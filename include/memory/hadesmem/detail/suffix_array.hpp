@@ -0,0 +1,290 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+
+// Suffix array used by ModuleIndex. Suffixes are only ordered on their first
+// 'depth' bytes (ties are broken by position), which bounds the cost of each
+// comparison on the long runs of identical bytes found in modules (padding,
+// zero filled data, etc.). Lookups of keys longer than the depth return a
+// superset which must be verified by the caller.
+
+namespace hadesmem
+{
+namespace detail
+{
+std::size_t const kSuffixArrayDefaultDepth = 32;
+
+inline int CompareSuffixes(std::uint8_t const* data,
+                           std::size_t size,
+                           std::size_t depth,
+                           std::uint32_t lhs,
+                           std::uint32_t rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  std::size_t const lhs_len = (std::min)(depth, size - lhs);
+  std::size_t const rhs_len = (std::min)(depth, size - rhs);
+  if (int const r =
+        std::memcmp(data + lhs, data + rhs, (std::min)(lhs_len, rhs_len)))
+  {
+    return r;
+  }
+  if (lhs_len != rhs_len)
+  {
+    return lhs_len < rhs_len ? -1 : 1;
+  }
+  return lhs < rhs ? -1 : (lhs == rhs ? 0 : 1);
+}
+
+// Counting sort on the first two bytes, then each bucket is sorted on the
+// remaining bytes in parallel. A num_threads of zero uses one thread per
+// hardware thread.
+inline std::vector<std::uint32_t> BuildSuffixArray(std::uint8_t const* data,
+                                                   std::size_t size,
+                                                   std::size_t depth,
+                                                   std::size_t num_threads = 0)
+{
+  HADESMEM_DETAIL_ASSERT(depth >= 2);
+  HADESMEM_DETAIL_ASSERT(size <= static_cast<std::uint32_t>(-1));
+
+  std::size_t const kNumBuckets = 1U << 16;
+  auto const get_bucket = [&](std::size_t i)
+  {
+    return (static_cast<std::size_t>(data[i]) << 8) |
+           (i + 1 < size ? data[i + 1] : 0);
+  };
+
+  std::vector<std::uint32_t> bucket_beg(kNumBuckets + 1);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    ++bucket_beg[get_bucket(i) + 1];
+  }
+  for (std::size_t i = 0; i < kNumBuckets; ++i)
+  {
+    bucket_beg[i + 1] += bucket_beg[i];
+  }
+
+  std::vector<std::uint32_t> sa(size);
+  {
+    std::vector<std::uint32_t> next(std::begin(bucket_beg),
+                                    std::end(bucket_beg) - 1);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      sa[next[get_bucket(i)]++] = static_cast<std::uint32_t>(i);
+    }
+  }
+
+  std::vector<std::size_t> buckets;
+  for (std::size_t i = 0; i < kNumBuckets; ++i)
+  {
+    if (bucket_beg[i + 1] - bucket_beg[i] > 1)
+    {
+      buckets.push_back(i);
+    }
+  }
+
+  // Largest buckets first so one large bucket late in the order doesn't end
+  // up serialized behind everything else.
+  std::sort(std::begin(buckets),
+            std::end(buckets),
+            [&](std::size_t lhs, std::size_t rhs)
+            {
+              return bucket_beg[lhs + 1] - bucket_beg[lhs] >
+                     bucket_beg[rhs + 1] - bucket_beg[rhs];
+            });
+
+  std::atomic<std::size_t> next_bucket(0);
+  auto const worker = [&]()
+  {
+    for (std::size_t i = next_bucket++; i < buckets.size(); i = next_bucket++)
+    {
+      std::size_t const bucket = buckets[i];
+      std::sort(sa.data() + bucket_beg[bucket],
+                sa.data() + bucket_beg[bucket + 1],
+                [&](std::uint32_t lhs, std::uint32_t rhs)
+                {
+                  return CompareSuffixes(data, size, depth, lhs, rhs) < 0;
+                });
+    }
+  };
+
+  if (!num_threads)
+  {
+    num_threads = (std::max)(std::thread::hardware_concurrency(), 1U);
+  }
+  num_threads = (std::min)(num_threads, buckets.size());
+
+  if (num_threads > 1)
+  {
+    std::vector<std::exception_ptr> errors(num_threads);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < num_threads; ++i)
+    {
+      threads.emplace_back([&, i]()
+                           {
+                             try
+                             {
+                               worker();
+                             }
+                             catch (...)
+                             {
+                               errors[i] = std::current_exception();
+                               next_bucket = buckets.size();
+                             }
+                           });
+    }
+
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+
+    for (auto const& error : errors)
+    {
+      if (error)
+      {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+  else
+  {
+    worker();
+  }
+
+  return sa;
+}
+
+// Range of suffixes starting with the key. The key length must not exceed the
+// depth the array was sorted to.
+inline std::pair<std::uint32_t const*, std::uint32_t const*>
+  FindSuffixRange(std::uint8_t const* data,
+                  std::size_t size,
+                  std::uint32_t const* sa_beg,
+                  std::uint32_t const* sa_end,
+                  std::uint8_t const* key,
+                  std::size_t key_len)
+{
+  auto const compare = [&](std::uint32_t pos) -> int
+  {
+    std::size_t const len = (std::min)(key_len, size - pos);
+    if (int const r = std::memcmp(data + pos, key, len))
+    {
+      return r;
+    }
+    return len < key_len ? -1 : 0;
+  };
+
+  auto const first = std::partition_point(sa_beg,
+                                          sa_end,
+                                          [&](std::uint32_t pos)
+                                          {
+                                            return compare(pos) < 0;
+                                          });
+  auto const last = std::partition_point(first,
+                                         sa_end,
+                                         [&](std::uint32_t pos)
+                                         {
+                                           return compare(pos) == 0;
+                                         });
+  return {first, last};
+}
+
+// Every offset where the needle (a sequence of objects with data and wildcard
+// members) matches, in ascending order. The longest literal run in the needle
+// is looked up in the suffix array and each candidate is then verified. Matches
+// of needles without any literal bytes are not returned, as every offset is a
+// match.
+template <typename NeedleIterator>
+std::vector<std::uint32_t> FindInSuffixArray(std::uint8_t const* data,
+                                             std::size_t size,
+                                             std::uint32_t const* sa_beg,
+                                             std::uint32_t const* sa_end,
+                                             std::size_t depth,
+                                             NeedleIterator n_beg,
+                                             NeedleIterator n_end)
+{
+  std::size_t const n_len =
+    static_cast<std::size_t>(std::distance(n_beg, n_end));
+  std::vector<std::uint32_t> results;
+  if (!n_len || n_len > size)
+  {
+    return results;
+  }
+
+  std::size_t anchor_beg = 0;
+  std::size_t anchor_len = 0;
+  std::size_t run_beg = 0;
+  std::size_t i = 0;
+  for (auto n = n_beg; n != n_end; ++n, ++i)
+  {
+    if (n->wildcard)
+    {
+      run_beg = i + 1;
+    }
+    else if (i + 1 - run_beg > anchor_len)
+    {
+      anchor_beg = run_beg;
+      anchor_len = i + 1 - run_beg;
+    }
+  }
+
+  if (!anchor_len)
+  {
+    return results;
+  }
+
+  std::vector<std::uint8_t> key;
+  auto anchor = n_beg;
+  std::advance(anchor, anchor_beg);
+  for (std::size_t j = 0; j < (std::min)(anchor_len, depth); ++j, ++anchor)
+  {
+    key.push_back(anchor->data);
+  }
+
+  auto const range =
+    FindSuffixRange(data, size, sa_beg, sa_end, key.data(), key.size());
+  for (auto candidate = range.first; candidate != range.second; ++candidate)
+  {
+    if (*candidate < anchor_beg || *candidate - anchor_beg + n_len > size)
+    {
+      continue;
+    }
+
+    std::uint32_t const pos =
+      *candidate - static_cast<std::uint32_t>(anchor_beg);
+    std::uint8_t const* h = data + pos;
+    bool match = true;
+    for (auto n = n_beg; n != n_end; ++n, ++h)
+    {
+      if (!n->wildcard && n->data != *h)
+      {
+        match = false;
+        break;
+      }
+    }
+
+    if (match)
+    {
+      results.push_back(pos);
+    }
+  }
+
+  std::sort(std::begin(results), std::end(results));
+  return results;
+}
+}
+}
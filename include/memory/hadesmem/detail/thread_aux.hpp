@@ -27,16 +27,22 @@ inline std::uintptr_t GetThreadContextIp(CONTEXT const& context)
 #endif
 }
 
-inline bool IsExecutingInRange(ThreadEntry const& thread_entry,
-                               void const* beg,
-                               void const* end)
+inline bool
+  IsExecutingInRange(Thread const& thread, void const* beg, void const* end)
 {
-  hadesmem::Thread const thread{thread_entry.GetId()};
   auto const context = GetThreadContext(thread, CONTEXT_CONTROL);
   auto const ip = reinterpret_cast<void const*>(
     hadesmem::detail::GetThreadContextIp(context));
   HADESMEM_DETAIL_ASSERT(ip);
   return ip >= beg && ip < end;
 }
+
+inline bool IsExecutingInRange(ThreadEntry const& thread_entry,
+                               void const* beg,
+                               void const* end)
+{
+  hadesmem::Thread const thread{thread_entry.GetId()};
+  return IsExecutingInRange(thread, beg, end);
+}
 }
 }
@@ -0,0 +1,136 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+// Fixed size pool of worker threads running tasks in submission order. Tasks
+// still queued when the pool is destroyed are run before the workers exit, so
+// every future returned by Submit is eventually satisfied.
+class ThreadPool
+{
+public:
+  // Zero threads means one per CPU.
+  explicit ThreadPool(std::size_t num_threads = 0)
+  {
+    if (!num_threads)
+    {
+      num_threads = (std::max)(std::thread::hardware_concurrency(), 1U);
+    }
+
+    try
+    {
+      for (std::size_t i = 0; i < num_threads; ++i)
+      {
+        threads_.emplace_back(&ThreadPool::Work, this);
+      }
+    }
+    catch (...)
+    {
+      Stop();
+      throw;
+    }
+  }
+
+  ThreadPool(ThreadPool const&) = delete;
+
+  ThreadPool& operator=(ThreadPool const&) = delete;
+
+  ~ThreadPool()
+  {
+    Stop();
+  }
+
+  std::size_t GetNumThreads() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return threads_.size();
+  }
+
+  // Exceptions thrown by func are stored in the future.
+  template <typename Func>
+  auto Submit(Func func) -> std::future<decltype(func())>
+  {
+    using ResultT = decltype(func());
+    auto const task =
+      std::make_shared<std::packaged_task<ResultT()>>(std::move(func));
+    auto future = task->get_future();
+
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      HADESMEM_DETAIL_ASSERT(!stopping_);
+      queue_.emplace_back([task]()
+                          {
+                            (*task)();
+                          });
+    }
+    work_cv_.notify_one();
+
+    return future;
+  }
+
+private:
+  void Work()
+  {
+    for (;;)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        work_cv_.wait(lock,
+                      [&]()
+                      {
+                        return stopping_ || !queue_.empty();
+                      });
+        if (queue_.empty())
+        {
+          return;
+        }
+
+        task = std::move(queue_.front());
+        queue_.pop_front();
+      }
+
+      task();
+    }
+  }
+
+  void Stop() HADESMEM_DETAIL_NOEXCEPT
+  {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stopping_ = true;
+    }
+    work_cv_.notify_all();
+
+    for (auto& thread : threads_)
+    {
+      thread.join();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::deque<std::function<void()>> queue_;
+  bool stopping_{};
+  std::vector<std::thread> threads_;
+};
+}
+}
@@ -109,5 +109,28 @@ inline std::wstring QueryFullProcessImageName(HANDLE handle)
 
   return path.data();
 }
+
+template <typename FuncT> FuncT GetNtdllProc(char const* name)
+{
+  HMODULE const ntdll = ::GetModuleHandleW(L"ntdll.dll");
+  if (!ntdll)
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"GetModuleHandleW failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  auto const proc = reinterpret_cast<FuncT>(::GetProcAddress(ntdll, name));
+  if (!proc)
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"GetProcAddress failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  return proc;
+}
 }
 }
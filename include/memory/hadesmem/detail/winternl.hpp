@@ -14,6 +14,8 @@
 #define HADESMEM_DETAIL_STATUS_NO_SUCH_FILE (static_cast<NTSTATUS>(0xC000000FL))
 #define HADESMEM_DETAIL_STATUS_NO_MORE_FILES                                   \
   (static_cast<NTSTATUS>(0x80000006L))
+#define HADESMEM_DETAIL_STATUS_NO_MORE_ENTRIES                                 \
+  (static_cast<NTSTATUS>(0x8000001AL))
 #define HADESMEM_DETAIL_STATUS_INFO_LENGTH_MISMATCH                            \
   (static_cast<NTSTATUS>(0xC0000004L)
 #define HADESMEM_DETAIL_RTL_USER_PROC_PARAMS_NORMALIZED 0x00000001
@@ -0,0 +1,486 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/instruction_decoder.hpp>
+#include <hadesmem/error.hpp>
+
+// Builds the cross reference list used by XrefIndex from code that has already
+// been copied into local buffers, so it has no dependency on the process or PE
+// APIs.
+
+namespace hadesmem
+{
+enum class XrefType : std::uint8_t
+{
+  // CALL rel.
+  kCall,
+  // JMP/Jcc/LOOP rel.
+  kJump,
+  // RIP-relative memory operand (x64 only).
+  kRipRelative,
+  // Absolute address taken from the base relocation table. The source is the
+  // RVA of the relocated pointer rather than the instruction containing it.
+  kAbsolute
+};
+
+struct Xref
+{
+  std::uint32_t from;
+  std::uint32_t to;
+  XrefType type;
+};
+
+inline bool operator==(Xref const& lhs, Xref const& rhs)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.from == rhs.from && lhs.to == rhs.to && lhs.type == rhs.type;
+}
+
+inline bool operator!=(Xref const& lhs, Xref const& rhs)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  return !(lhs == rhs);
+}
+
+// Ordered by target first so all references to an address are adjacent.
+inline bool operator<(Xref const& lhs, Xref const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  if (lhs.to != rhs.to)
+  {
+    return lhs.to < rhs.to;
+  }
+  if (lhs.from != rhs.from)
+  {
+    return lhs.from < rhs.from;
+  }
+  return lhs.type < rhs.type;
+}
+
+namespace detail
+{
+struct XrefCodeRegion
+{
+  std::uint32_t rva;
+  std::uint8_t const* data;
+  std::size_t size;
+};
+
+struct XrefImageInfo
+{
+  bool is_64;
+  std::uint32_t image_size;
+  std::vector<XrefCodeRegion> code;
+  // Known code addresses (entry point, exports, etc.). Any which the linear
+  // sweep did not land on are disassembled by recursive descent.
+  std::vector<std::uint32_t> hints;
+  // References which don't come from disassembly (i.e. relocations).
+  std::vector<Xref> extra;
+};
+
+std::size_t const kXrefDefaultChunkSize = 1U << 16;
+
+inline void AddInstructionXrefs(InstructionInfo const& info,
+                                std::uint32_t rva,
+                                std::uint32_t image_size,
+                                std::vector<Xref>& xrefs)
+{
+  std::int64_t const next = static_cast<std::int64_t>(rva) + info.len;
+  auto const add = [&](std::int64_t to, XrefType type)
+  {
+    if (to >= 0 && to < static_cast<std::int64_t>(image_size))
+    {
+      Xref const xref = {rva, static_cast<std::uint32_t>(to), type};
+      xrefs.push_back(xref);
+    }
+  };
+
+  if (IsRelativeBranch(info))
+  {
+    add(next + info.rel,
+        info.type == InstructionType::kCallRel ? XrefType::kCall
+                                               : XrefType::kJump);
+  }
+
+  if (info.rip_relative)
+  {
+    add(next + info.disp, XrefType::kRipRelative);
+  }
+}
+
+struct XrefChunk
+{
+  std::size_t region;
+  std::size_t begin;
+  std::size_t end;
+  // End of the last instruction decoded, which may be past the end of the
+  // chunk if an instruction straddles the boundary.
+  std::size_t reach;
+  std::vector<Xref> xrefs;
+};
+
+// Linear sweep of a single chunk, marking every instruction start. Bytes which
+// fail to decode are skipped one at a time.
+inline void SweepXrefChunk(XrefImageInfo const& image,
+                           std::uint8_t* starts,
+                           XrefChunk& chunk)
+{
+  XrefCodeRegion const& region = image.code[chunk.region];
+  std::size_t offset = chunk.begin;
+  while (offset < chunk.end)
+  {
+    InstructionInfo info;
+    if (!DecodeInstruction(region.data + offset,
+                           region.size - offset,
+                           image.is_64,
+                           info))
+    {
+      ++offset;
+      continue;
+    }
+
+    starts[offset] = 1;
+    AddInstructionXrefs(info,
+                        region.rva + static_cast<std::uint32_t>(offset),
+                        image.image_size,
+                        chunk.xrefs);
+    offset += info.len;
+  }
+  chunk.reach = offset;
+}
+
+// Fix up a chunk which was started part way through an instruction from the
+// previous chunk (i.e. reach is past its beginning). Decoding continues
+// sequentially from reach until it lands on an instruction start already found
+// by the chunk's own sweep, after which the two streams are identical. The
+// result is the same as sweeping the whole region in one go.
+inline void StitchXrefChunk(XrefImageInfo const& image,
+                            std::uint8_t* starts,
+                            std::size_t reach,
+                            XrefChunk& chunk)
+{
+  XrefCodeRegion const& region = image.code[chunk.region];
+
+  std::vector<std::size_t> offsets;
+  std::vector<Xref> xrefs;
+  std::size_t offset = reach;
+  while (offset < chunk.end && !starts[offset])
+  {
+    InstructionInfo info;
+    if (!DecodeInstruction(region.data + offset,
+                           region.size - offset,
+                           image.is_64,
+                           info))
+    {
+      ++offset;
+      continue;
+    }
+
+    offsets.push_back(offset);
+    AddInstructionXrefs(info,
+                        region.rva + static_cast<std::uint32_t>(offset),
+                        image.image_size,
+                        xrefs);
+    offset += info.len;
+  }
+
+  std::fill(starts + chunk.begin, starts + (std::min)(offset, chunk.end), 0);
+  for (auto const o : offsets)
+  {
+    starts[o] = 1;
+  }
+
+  // Chunk xrefs are in instruction order, so the desynchronized ones are a
+  // prefix.
+  std::uint32_t const sync_rva =
+    region.rva + static_cast<std::uint32_t>(offset);
+  auto const sync_iter =
+    std::find_if(std::begin(chunk.xrefs),
+                 std::end(chunk.xrefs),
+                 [&](Xref const& xref)
+                 {
+                   return xref.from >= sync_rva;
+                 });
+  chunk.xrefs.erase(std::begin(chunk.xrefs), sync_iter);
+  chunk.xrefs.insert(
+    std::begin(chunk.xrefs), std::begin(xrefs), std::end(xrefs));
+
+  if (offset >= chunk.end)
+  {
+    chunk.reach = offset;
+  }
+}
+
+inline void DescendXrefHints(XrefImageInfo const& image,
+                             std::vector<std::vector<std::uint8_t>>& starts,
+                             std::vector<Xref>& xrefs)
+{
+  std::vector<std::uint32_t> pending(image.hints);
+  while (!pending.empty())
+  {
+    std::uint32_t const rva = pending.back();
+    pending.pop_back();
+
+    auto const region_iter = std::find_if(
+      std::begin(image.code),
+      std::end(image.code),
+      [&](XrefCodeRegion const& r)
+      {
+        return rva >= r.rva && rva - r.rva < r.size;
+      });
+    if (region_iter == std::end(image.code))
+    {
+      continue;
+    }
+
+    XrefCodeRegion const& region = *region_iter;
+    std::uint8_t* const region_starts =
+      starts[static_cast<std::size_t>(region_iter - std::begin(image.code))]
+        .data();
+    std::size_t offset = rva - region.rva;
+    while (offset < region.size && !region_starts[offset])
+    {
+      InstructionInfo info;
+      if (!DecodeInstruction(region.data + offset,
+                             region.size - offset,
+                             image.is_64,
+                             info))
+      {
+        break;
+      }
+
+      region_starts[offset] = 1;
+      std::size_t const old_size = xrefs.size();
+      std::uint32_t const insn_rva =
+        region.rva + static_cast<std::uint32_t>(offset);
+      AddInstructionXrefs(info, insn_rva, image.image_size, xrefs);
+      if (IsRelativeBranch(info) && xrefs.size() != old_size)
+      {
+        pending.push_back(xrefs[old_size].to);
+      }
+
+      if (info.type == InstructionType::kJmpRel ||
+          info.type == InstructionType::kJmpIndirect ||
+          info.type == InstructionType::kReturn ||
+          (info.len == 1 && region.data[offset] == 0xCC))
+      {
+        break;
+      }
+
+      offset += info.len;
+    }
+  }
+}
+
+// Linear sweep of every code region, split into chunks which are disassembled
+// in parallel and then stitched back together, followed by recursive descent
+// from the hints. Returns the xrefs sorted by target. A num_threads of zero
+// uses one thread per hardware thread.
+inline std::vector<Xref>
+  BuildXrefs(XrefImageInfo const& image,
+             std::size_t num_threads = 0,
+             std::size_t chunk_size = kXrefDefaultChunkSize)
+{
+  HADESMEM_DETAIL_ASSERT(chunk_size != 0);
+
+  std::vector<std::vector<std::uint8_t>> starts;
+  std::vector<XrefChunk> chunks;
+  for (std::size_t i = 0; i < image.code.size(); ++i)
+  {
+    std::size_t const size = image.code[i].size;
+    starts.emplace_back(size);
+    for (std::size_t begin = 0; begin < size; begin += chunk_size)
+    {
+      XrefChunk chunk;
+      chunk.region = i;
+      chunk.begin = begin;
+      chunk.end = begin + (std::min)(chunk_size, size - begin);
+      chunk.reach = chunk.end;
+      chunks.emplace_back(std::move(chunk));
+    }
+  }
+
+  if (!num_threads)
+  {
+    num_threads = (std::max)(std::thread::hardware_concurrency(), 1U);
+  }
+  num_threads = (std::min)(num_threads, chunks.size());
+
+  std::atomic<std::size_t> next_chunk(0);
+  auto const worker = [&]()
+  {
+    for (std::size_t i = next_chunk++; i < chunks.size(); i = next_chunk++)
+    {
+      SweepXrefChunk(image, starts[chunks[i].region].data(), chunks[i]);
+    }
+  };
+
+  if (num_threads > 1)
+  {
+    std::vector<std::exception_ptr> errors(num_threads);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < num_threads; ++i)
+    {
+      threads.emplace_back([&, i]()
+                           {
+                             try
+                             {
+                               worker();
+                             }
+                             catch (...)
+                             {
+                               errors[i] = std::current_exception();
+                               next_chunk = chunks.size();
+                             }
+                           });
+    }
+
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+
+    for (auto const& error : errors)
+    {
+      if (error)
+      {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+  else
+  {
+    worker();
+  }
+
+  for (std::size_t i = 1; i < chunks.size(); ++i)
+  {
+    XrefChunk const& prev = chunks[i - 1];
+    XrefChunk& chunk = chunks[i];
+    if (prev.region == chunk.region && prev.reach > chunk.begin)
+    {
+      StitchXrefChunk(image, starts[chunk.region].data(), prev.reach, chunk);
+    }
+  }
+
+  std::size_t num_xrefs = image.extra.size();
+  for (auto const& chunk : chunks)
+  {
+    num_xrefs += chunk.xrefs.size();
+  }
+
+  std::vector<Xref> xrefs;
+  xrefs.reserve(num_xrefs);
+  for (auto& chunk : chunks)
+  {
+    xrefs.insert(
+      std::end(xrefs), std::begin(chunk.xrefs), std::end(chunk.xrefs));
+    std::vector<Xref>().swap(chunk.xrefs);
+  }
+  std::copy_if(std::begin(image.extra),
+               std::end(image.extra),
+               std::back_inserter(xrefs),
+               [&](Xref const& xref)
+               {
+                 return xref.to < image.image_size;
+               });
+
+  DescendXrefHints(image, starts, xrefs);
+
+  std::sort(std::begin(xrefs), std::end(xrefs));
+  xrefs.erase(std::unique(std::begin(xrefs), std::end(xrefs)), std::end(xrefs));
+
+  return xrefs;
+}
+
+std::uint32_t const kXrefMagic = 0x52584D48; // "HMXR"
+std::uint32_t const kXrefVersion = 1;
+
+// Serialized form is a header (magic, version, count) followed by packed
+// little endian records (from, to, type). x86 only, so no byte swapping.
+inline std::vector<std::uint8_t> SerializeXrefs(std::vector<Xref> const& xrefs)
+{
+  std::size_t const kRecordSize = 9;
+  std::vector<std::uint8_t> buf(12 + xrefs.size() * kRecordSize);
+  std::uint8_t* p = buf.data();
+  auto const put = [&](std::uint32_t value)
+  {
+    std::memcpy(p, &value, sizeof(value));
+    p += sizeof(value);
+  };
+
+  put(kXrefMagic);
+  put(kXrefVersion);
+  put(static_cast<std::uint32_t>(xrefs.size()));
+  for (auto const& xref : xrefs)
+  {
+    put(xref.from);
+    put(xref.to);
+    *p++ = static_cast<std::uint8_t>(xref.type);
+  }
+
+  return buf;
+}
+
+inline std::vector<Xref> DeserializeXrefs(void const* data, std::size_t len)
+{
+  std::size_t const kRecordSize = 9;
+  auto p = static_cast<std::uint8_t const*>(data);
+  auto const get = [&]() -> std::uint32_t
+  {
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return value;
+  };
+
+  if (len < 12 || get() != kXrefMagic || get() != kXrefVersion)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Invalid xref index header."});
+  }
+
+  std::uint32_t const count = get();
+  if ((len - 12) / kRecordSize != count || (len - 12) % kRecordSize)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Invalid xref index size."});
+  }
+
+  std::vector<Xref> xrefs(count);
+  for (auto& xref : xrefs)
+  {
+    xref.from = get();
+    xref.to = get();
+    std::uint8_t const type = *p++;
+    if (type > static_cast<std::uint8_t>(XrefType::kAbsolute))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid xref type."});
+    }
+    xref.type = static_cast<XrefType>(type);
+  }
+
+  if (!std::is_sorted(std::begin(xrefs), std::end(xrefs)))
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Xref index is not sorted."});
+  }
+
+  return xrefs;
+}
+}
+}
@@ -3,11 +3,14 @@
 
 #pragma once
 
+#include <cstdint>
 #include <exception>
 
+#if defined(_WIN32)
 #include <windows.h>
 #include <winnt.h>
 #include <winternl.h>
+#endif // #if defined(_WIN32)
 
 #include <hadesmem/detail/warning_disable_prefix.hpp>
 #include <boost/exception/all.hpp>
@@ -22,6 +25,7 @@ class Error : public virtual std::exception, public virtual boost::exception
 };
 
 using ErrorString = boost::error_info<struct TagErrorString, std::string>;
+#if defined(_WIN32)
 using ErrorCodeWinRet = boost::error_info<struct TagErrorCodeWinRet, DWORD_PTR>;
 using ErrorCodeWinLast = boost::error_info<struct TagErrorCodeWinLast, DWORD>;
 using ErrorCodeWinOther =
@@ -30,6 +34,11 @@ using ErrorCodeOther = boost::error_info<struct TagErrorCodeOther, DWORD_PTR>;
 using ErrorCodeWinHr = boost::error_info<struct TagErrorCodWinHr, HRESULT>;
 using ErrorCodeWinStatus =
   boost::error_info<struct TagErrorCodeWinStatus, NTSTATUS>;
+#else // #if defined(_WIN32)
+using ErrorCodeOther =
+  boost::error_info<struct TagErrorCodeOther, std::uintptr_t>;
+#endif // #if defined(_WIN32)
+using ErrorCodeErrno = boost::error_info<struct TagErrorCodeErrno, int>;
 using ErrorStringOther =
   boost::error_info<struct TagErrorStringOther, std::string>;
 }
@@ -3,14 +3,29 @@
 
 #pragma once
 
+#if !defined(_WIN32)
+
+#include <hadesmem/linux/find_pattern.hpp>
+
+namespace hadesmem
+{
+using procfs::Find;
+}
+
+#else // #if !defined(_WIN32)
+
 #include <algorithm>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <limits>
 #include <locale>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -23,7 +38,11 @@
 
 #include <hadesmem/config.hpp>
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/fast_hash.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
 #include <hadesmem/detail/pugixml_helpers.hpp>
+#include <hadesmem/detail/scope_warden.hpp>
 #include <hadesmem/detail/smart_handle.hpp>
 #include <hadesmem/detail/static_assert.hpp>
 #include <hadesmem/detail/str_conv.hpp>
@@ -32,6 +51,7 @@
 #include <hadesmem/find_procedure.hpp>
 #include <hadesmem/module.hpp>
 #include <hadesmem/module_list.hpp>
+#include <hadesmem/pattern_database.hpp>
 #include <hadesmem/pelib/dos_header.hpp>
 #include <hadesmem/pelib/nt_headers.hpp>
 #include <hadesmem/pelib/pe_file.hpp>
@@ -42,18 +62,6 @@
 
 namespace hadesmem
 {
-struct PatternFlags
-{
-  enum : std::uint32_t
-  {
-    kNone = 0,
-    kThrowOnUnmatch = 1 << 0,
-    kRelativeAddress = 1 << 1,
-    kScanData = 1 << 2,
-    kInvalidFlagMaxValue = 1 << 3
-  };
-};
-
 namespace detail
 {
 inline void* Add(Process const& /*process*/,
@@ -134,59 +142,6 @@ inline void* Rel(Process const& process,
   }
 }
 
-struct PatternDataByte
-{
-  std::uint8_t data;
-  bool wildcard;
-};
-
-inline std::vector<PatternDataByte> ConvertData(std::wstring const& data)
-{
-  HADESMEM_DETAIL_ASSERT(!data.empty());
-
-  std::wstring const data_trimmed{
-    data.substr(0, data.find_last_not_of(L" \n\r\t") + 1)};
-
-  HADESMEM_DETAIL_ASSERT(!data_trimmed.empty());
-
-  std::wistringstream data_str{data_trimmed};
-  data_str.imbue(std::locale::classic());
-  std::vector<PatternDataByte> data_real;
-  do
-  {
-    std::wstring data_cur_str;
-    if (!(data_str >> data_cur_str))
-    {
-      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
-                                      << ErrorString{"Data parsing failed."});
-    }
-
-    bool const is_wildcard = (data_cur_str == L"??");
-    std::uint32_t current = 0U;
-    if (!is_wildcard)
-    {
-      std::wistringstream conv{data_cur_str};
-      conv.imbue(std::locale::classic());
-      if (!(conv >> std::hex >> current))
-      {
-        HADESMEM_DETAIL_THROW_EXCEPTION(
-          Error{} << ErrorString{"Data conversion failed."});
-      }
-
-      if (current > static_cast<std::uint8_t>(-1))
-      {
-        HADESMEM_DETAIL_THROW_EXCEPTION(Error()
-                                        << ErrorString("Invalid data."));
-      }
-    }
-
-    data_real.emplace_back(
-      PatternDataByte{static_cast<std::uint8_t>(current), is_wildcard});
-  } while (!data_str.eof());
-
-  return data_real;
-}
-
 template <typename NeedleIterator>
 void* FindRaw(Process const& process,
               std::uint8_t* s_beg,
@@ -707,28 +662,198 @@ private:
   std::map<std::wstring, PatternMap> map_;
 };
 
-class FindPattern
+struct PatternCacheStats
+{
+  // Patterns whose cached match was verified and used.
+  std::size_t hits;
+  // Patterns which were scanned for.
+  std::size_t misses;
+};
+
+// In-memory match cache which can be shared by FindPattern instances for
+// different processes (e.g. by Fleet), and is keyed in the same way as the
+// cache file. The first instance to load a given module image scans it and
+// publishes its matches, and any other instance loading the same image at the
+// same time waits for them rather than scanning too. Matches are verified in
+// each process before use, as for the cache file. Thread-safe.
+class PatternCache
 {
 public:
-  explicit FindPattern(Process const& process,
-                       std::wstring const& pattern_file,
-                       bool in_memory_file)
-    : process_{&process}, find_pattern_datas_{}
+  PatternCache()
   {
-    if (in_memory_file)
+  }
+
+  PatternCache(PatternCache const&) = delete;
+
+  PatternCache& operator=(PatternCache const&) = delete;
+
+  std::size_t GetNumModules() const
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return static_cast<std::size_t>(
+      std::count_if(std::begin(entries_),
+                    std::end(entries_),
+                    [](std::pair<Key const, Entry> const& entry)
+                    {
+                      return entry.second.ready;
+                    }));
+  }
+
+private:
+  friend class FindPattern;
+
+  struct Key
+  {
+    std::uint64_t file_hash;
+    std::wstring module;
+    std::uint32_t time_date_stamp;
+    std::uint32_t size_of_image;
+    std::uint32_t check_sum;
+
+    bool operator<(Key const& other) const
     {
-      LoadPatternFileMemory(pattern_file);
+      return std::tie(
+               file_hash, module, time_date_stamp, size_of_image, check_sum) <
+             std::tie(other.file_hash,
+                      other.module,
+                      other.time_date_stamp,
+                      other.size_of_image,
+                      other.check_sum);
     }
-    else
+  };
+
+  struct Entry
+  {
+    bool ready;
+    bool scanning;
+    std::vector<std::uint32_t> rvas;
+  };
+
+  // Returns true with the cached match RVAs, or false if the caller is to
+  // scan the module, in which case it must call Publish or Abandon.
+  bool Acquire(Key const& key, std::vector<std::uint32_t>& rvas)
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+    for (;;)
     {
-      LoadPatternFile(pattern_file);
+      Entry& entry = entries_[key];
+      if (entry.ready)
+      {
+        rvas = entry.rvas;
+        return true;
+      }
+
+      if (!entry.scanning)
+      {
+        entry.scanning = true;
+        return false;
+      }
+
+      ready_cv_.wait(lock);
+    }
+  }
+
+  void Publish(Key const& key, std::vector<std::uint32_t> const& rvas)
+  {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      Entry& entry = entries_[key];
+      entry.rvas = rvas;
+      entry.ready = true;
+      entry.scanning = false;
+    }
+    ready_cv_.notify_all();
+  }
+
+  // Lets the next waiter (if any) scan the module instead.
+  void Abandon(Key const& key) HADESMEM_DETAIL_NOEXCEPT
+  {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      auto const iter = entries_.find(key);
+      if (iter != std::end(entries_))
+      {
+        iter->second.scanning = false;
+      }
     }
+    ready_cv_.notify_all();
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable ready_cv_;
+  std::map<Key, Entry> entries_;
+};
+
+class FindPattern
+{
+public:
+  explicit FindPattern(Process const& process,
+                       std::wstring const& pattern_file,
+                       bool in_memory_file)
+    : FindPattern{process, pattern_file, in_memory_file, std::wstring{}}
+  {
+  }
+
+  // Cache the match for each pattern in cache_path, keyed by the module image
+  // (timestamp, size and checksum) and a hash of the pattern file. A cached
+  // match is used if the pattern still matches at the cached RVA, otherwise
+  // the module is scanned as normal and the cache is rewritten.
+  explicit FindPattern(Process const& process,
+                       std::wstring const& pattern_file,
+                       bool in_memory_file,
+                       std::wstring const& cache_path)
+    : process_{&process},
+      find_pattern_datas_{},
+      cache_path_{cache_path},
+      cache_stats_{}
+  {
+    LoadPatternFileAny(pattern_file, in_memory_file);
+  }
+
+  // Share matches with other instances through cache rather than a cache
+  // file. The cache must outlive the constructor call.
+  explicit FindPattern(Process const& process,
+                       std::wstring const& pattern_file,
+                       bool in_memory_file,
+                       PatternCache& cache)
+    : process_{&process},
+      find_pattern_datas_{},
+      cache_path_{},
+      cache_stats_{},
+      shared_cache_{&cache}
+  {
+    LoadPatternFileAny(pattern_file, in_memory_file);
   }
 
   explicit FindPattern(Process&& process,
                        std::wstring const& pattern,
                        bool in_memory_file) = delete;
 
+  explicit FindPattern(Process&& process,
+                       std::wstring const& pattern,
+                       bool in_memory_file,
+                       std::wstring const& cache_path) = delete;
+
+  explicit FindPattern(Process&& process,
+                       std::wstring const& pattern,
+                       bool in_memory_file,
+                       PatternCache& cache) = delete;
+
+  // Load a pattern file compiled with CompilePatternFile. Each section of a
+  // module is read once for all patterns, rather than once per pattern.
+  explicit FindPattern(Process const& process,
+                       PatternDatabase const& database)
+    : process_{&process},
+      find_pattern_datas_{},
+      cache_path_{},
+      cache_stats_{}
+  {
+    LoadPatternDatabase(database);
+  }
+
+  explicit FindPattern(Process&& process,
+                       PatternDatabase const& database) = delete;
+
 #if defined(HADESMEM_DETAIL_NO_RVALUE_REFERENCES_V3)
 
   FindPattern(FindPattern const&) = default;
@@ -737,9 +862,13 @@ public:
 
   FindPattern(FindPattern&& other)
     : process_{other.process_},
-      find_pattern_datas_{std::move(other.find_pattern_datas_)}
+      find_pattern_datas_{std::move(other.find_pattern_datas_)},
+      cache_path_{std::move(other.cache_path_)},
+      cache_stats_(other.cache_stats_),
+      shared_cache_{other.shared_cache_}
   {
     other.process_ = nullptr;
+    other.shared_cache_ = nullptr;
   }
 
   FindPattern& operator=(FindPattern&& other)
@@ -748,6 +877,11 @@ public:
     other.process_ = nullptr;
 
     find_pattern_datas_ = std::move(other.find_pattern_datas_);
+    cache_path_ = std::move(other.cache_path_);
+    cache_stats_ = other.cache_stats_;
+
+    shared_cache_ = other.shared_cache_;
+    other.shared_cache_ = nullptr;
 
     return *this;
   }
@@ -777,6 +911,168 @@ public:
     return LookupEx(module, name).GetAddress();
   }
 
+  // Without a cache every pattern is counted as a miss.
+  PatternCacheStats GetCacheStats() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return cache_stats_;
+  }
+
+  // Compile a pattern file to the format loaded by PatternDatabase. Patterns
+  // give the same results as when loaded from the pattern file.
+  static std::vector<std::uint8_t>
+    CompilePatternFile(std::wstring const& pattern_file, bool in_memory_file)
+  {
+    pugi::xml_document doc;
+    ParsePatternFile(doc, pattern_file, in_memory_file);
+    auto const pattern_infos_full_list = ReadPatternsFromXml(doc);
+
+    std::vector<detail::PatternDbModule> modules;
+    std::vector<detail::PatternDbPattern> patterns;
+    std::vector<detail::PatternDbManipulator> manipulators;
+    std::vector<std::uint8_t> bytes;
+    std::vector<std::uint8_t> strings;
+
+    auto const add_string = [&](std::wstring const& str)
+    {
+      auto const offset = static_cast<std::uint32_t>(strings.size());
+      for (auto const c : str)
+      {
+        strings.push_back(static_cast<std::uint8_t>(c));
+        strings.push_back(static_cast<std::uint8_t>(c >> 8));
+      }
+      return std::make_pair(offset, static_cast<std::uint32_t>(str.size()));
+    };
+
+    for (auto const& patterns_info_full_pair : pattern_infos_full_list)
+    {
+      auto const& patterns_info_full = patterns_info_full_pair.second;
+      auto const& pattern_infos = patterns_info_full.patterns;
+
+      detail::PatternDbModule db_module{};
+      auto const module_name = add_string(patterns_info_full_pair.first);
+      db_module.name_offset = module_name.first;
+      db_module.name_len = module_name.second;
+      db_module.first_pattern = static_cast<std::uint32_t>(patterns.size());
+      db_module.num_patterns = static_cast<std::uint32_t>(pattern_infos.size());
+      modules.push_back(db_module);
+
+      // Start patterns are looked up by name when the pattern is resolved, so
+      // always refer to the most recent pattern of that name.
+      std::map<std::wstring, std::uint32_t> indices;
+      for (std::size_t i = 0; i < pattern_infos.size(); ++i)
+      {
+        auto const& p = pattern_infos[i];
+
+        detail::PatternDbPattern db_pattern{};
+        auto const name = add_string(p.pattern.name);
+        db_pattern.name_offset = name.first;
+        db_pattern.name_len = name.second;
+        db_pattern.flags = patterns_info_full.flags | p.pattern.flags;
+
+        auto const masked = detail::ConvertToMaskedPattern(
+          detail::ConvertData(p.pattern.data));
+        db_pattern.data_offset = static_cast<std::uint32_t>(bytes.size());
+        db_pattern.len = static_cast<std::uint32_t>(masked.value.size());
+        db_pattern.anchor_offset =
+          static_cast<std::uint32_t>(masked.anchor_offset);
+        db_pattern.anchor_len = static_cast<std::uint32_t>(masked.anchor_len);
+        bytes.insert(
+          std::end(bytes), std::begin(masked.value), std::end(masked.value));
+        bytes.insert(
+          std::end(bytes), std::begin(masked.mask), std::end(masked.mask));
+
+        if (!p.pattern.start_rva.empty())
+        {
+          db_pattern.start_type = detail::PatternDbStart::kRva;
+          db_pattern.start_value = static_cast<std::uint32_t>(
+            detail::HexStrToPtr(p.pattern.start_rva));
+        }
+        else if (!p.pattern.start_export.empty())
+        {
+          auto const start_export = add_string(p.pattern.start_export);
+          db_pattern.start_type = detail::PatternDbStart::kExport;
+          db_pattern.start_value = start_export.first;
+          db_pattern.start_len = start_export.second;
+        }
+        else if (!p.pattern.start.empty())
+        {
+          auto const start_iter = indices.find(p.pattern.start);
+          if (start_iter == std::end(indices))
+          {
+            HADESMEM_DETAIL_THROW_EXCEPTION(
+              Error{} << ErrorString{"Invalid pattern name."}
+                      << ErrorStringOther{
+                           detail::WideCharToMultiByte(p.pattern.start)});
+          }
+          db_pattern.start_type = detail::PatternDbStart::kPattern;
+          db_pattern.start_value = start_iter->second;
+        }
+        else
+        {
+          db_pattern.start_type = detail::PatternDbStart::kNone;
+        }
+
+        db_pattern.first_manipulator =
+          static_cast<std::uint32_t>(manipulators.size());
+        db_pattern.num_manipulators =
+          static_cast<std::uint32_t>(p.manipulators.size());
+        for (auto const& m : p.manipulators)
+        {
+          detail::PatternDbManipulator db_manipulator{};
+          db_manipulator.type = static_cast<detail::PatternDbManipulatorType>(
+            static_cast<std::uint32_t>(m.type));
+          db_manipulator.has_operand1 = m.has_operand1;
+          db_manipulator.has_operand2 = m.has_operand2;
+          db_manipulator.operand1 = m.operand1;
+          db_manipulator.operand2 = m.operand2;
+          manipulators.push_back(db_manipulator);
+        }
+
+        patterns.push_back(db_pattern);
+        indices[p.pattern.name] = static_cast<std::uint32_t>(i);
+      }
+    }
+
+    detail::PatternDbHeader header{};
+    std::vector<std::uint8_t> buf(sizeof(header));
+    auto const append = [&](void const* data, std::size_t len)
+    {
+      buf.resize((buf.size() + 7) & ~static_cast<std::size_t>(7));
+      auto const offset = buf.size();
+      buf.resize(offset + len);
+      if (len)
+      {
+        std::memcpy(&buf[offset], data, len);
+      }
+      return static_cast<std::uint32_t>(offset);
+    };
+
+    header.magic = PatternDatabase::kMagic;
+    header.version = PatternDatabase::kVersion;
+    header.num_modules = static_cast<std::uint32_t>(modules.size());
+    header.modules_offset =
+      append(modules.data(), modules.size() * sizeof(modules[0]));
+    header.num_patterns = static_cast<std::uint32_t>(patterns.size());
+    header.patterns_offset =
+      append(patterns.data(), patterns.size() * sizeof(patterns[0]));
+    header.num_manipulators = static_cast<std::uint32_t>(manipulators.size());
+    header.manipulators_offset = append(
+      manipulators.data(), manipulators.size() * sizeof(manipulators[0]));
+    header.bytes_size = static_cast<std::uint32_t>(bytes.size());
+    header.bytes_offset = append(bytes.data(), bytes.size());
+    header.strings_size = static_cast<std::uint32_t>(strings.size());
+    header.strings_offset = append(strings.data(), strings.size());
+    if (buf.size() > 0xFFFFFFFF)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Pattern database too large."});
+    }
+    header.file_size = static_cast<std::uint32_t>(buf.size());
+    std::memcpy(buf.data(), &header, sizeof(header));
+
+    return buf;
+  }
+
   friend bool operator==(FindPattern const& lhs, FindPattern const& rhs)
   {
     return lhs.process_ == rhs.process_ &&
@@ -789,10 +1085,13 @@ public:
   }
 
 private:
-  void LoadPatternFile(std::wstring const& path)
+  static void ParsePatternFile(pugi::xml_document& doc,
+                               std::wstring const& pattern_file,
+                               bool in_memory_file)
   {
-    pugi::xml_document doc;
-    auto const load_result = doc.load_file(path.c_str());
+    auto const load_result = in_memory_file
+                               ? doc.load(pattern_file.c_str())
+                               : doc.load_file(pattern_file.c_str());
     if (!load_result)
     {
       HADESMEM_DETAIL_THROW_EXCEPTION(
@@ -800,23 +1099,48 @@ private:
                 << ErrorCodeOther{static_cast<DWORD_PTR>(load_result.status)}
                 << ErrorStringOther{load_result.description()});
     }
+  }
 
-    LoadPatternFileImpl(doc);
+  void LoadPatternFileAny(std::wstring const& pattern_file, bool in_memory_file)
+  {
+    if (in_memory_file)
+    {
+      LoadPatternFileMemory(pattern_file);
+    }
+    else
+    {
+      LoadPatternFile(pattern_file);
+    }
+  }
+
+  void LoadPatternFile(std::wstring const& path)
+  {
+    pugi::xml_document doc;
+    ParsePatternFile(doc, path, false);
+
+    std::uint64_t file_hash = 0;
+    if (!cache_path_.empty() || shared_cache_)
+    {
+      auto const buf = detail::FileToBuffer(path);
+      file_hash = detail::GetFastHash(buf.data(), buf.size());
+    }
+
+    LoadPatternFileImpl(doc, file_hash);
   }
 
   void LoadPatternFileMemory(std::wstring const& data)
   {
     pugi::xml_document doc;
-    auto const load_result = doc.load(data.c_str());
-    if (!load_result)
+    ParsePatternFile(doc, data, true);
+
+    std::uint64_t file_hash = 0;
+    if (!cache_path_.empty() || shared_cache_)
     {
-      HADESMEM_DETAIL_THROW_EXCEPTION(
-        Error{} << ErrorString{"Loading XML file failed."}
-                << ErrorCodeOther{static_cast<DWORD_PTR>(load_result.status)}
-                << ErrorStringOther{load_result.description()});
+      file_hash =
+        detail::GetFastHash(data.data(), data.size() * sizeof(wchar_t));
     }
 
-    LoadPatternFileImpl(doc);
+    LoadPatternFileImpl(doc, file_hash);
   }
 
   Pattern LookupEx(std::wstring const& module, std::wstring const& name) const
@@ -873,7 +1197,7 @@ private:
     std::vector<PatternInfoFull> patterns;
   };
 
-  std::uint32_t ReadFlags(pugi::xml_node const& node) const
+  static std::uint32_t ReadFlags(pugi::xml_node const& node)
   {
     std::uint32_t flags = PatternFlags::kNone;
     for (auto const& flag : node.children(L"Flag"))
@@ -906,8 +1230,8 @@ private:
     return flags;
   }
 
-  std::map<std::wstring, FindPatternInfo>
-    ReadPatternsFromXml(pugi::xml_document const& doc) const
+  static std::map<std::wstring, FindPatternInfo>
+    ReadPatternsFromXml(pugi::xml_document const& doc)
   {
     auto const hadesmem_root = doc.child(L"HadesMem");
     if (!hadesmem_root)
@@ -1134,9 +1458,386 @@ private:
     return start_rva;
   }
 
-  void LoadPatternFileImpl(pugi::xml_document const& doc)
+  void* FindCompiled(detail::ModuleRegionInfo const& mod_info,
+                     std::vector<std::vector<std::uint8_t>> const& buffers,
+                     PatternDatabase const& database,
+                     detail::PatternDbPattern const& pattern,
+                     std::uintptr_t start_rva,
+                     std::wstring const& name) const
+  {
+    auto const base =
+      reinterpret_cast<std::uint8_t*>(mod_info.module->GetHandle());
+    auto const& regions = !!(pattern.flags & PatternFlags::kScanData)
+                            ? mod_info.data_regions
+                            : mod_info.code_regions;
+    auto const value = database.GetBytes(pattern.data_offset);
+    auto const mask = value + pattern.len;
+    for (std::size_t i = 0; i < regions.size(); ++i)
+    {
+      auto const& region = regions[i];
+      std::size_t offset = 0;
+      if (start_rva)
+      {
+        auto const start = base + start_rva;
+        if (start < region.first || start >= region.second)
+        {
+          continue;
+        }
+
+        offset = static_cast<std::size_t>(start - region.first) + 1;
+        if (region.first + offset == region.second)
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error() << ErrorString("Invalid start address."));
+        }
+      }
+
+      auto const h_beg = buffers[i].data();
+      if (auto const match = detail::FindMasked(h_beg + offset,
+                                                h_beg + buffers[i].size(),
+                                                value,
+                                                mask,
+                                                pattern.len,
+                                                pattern.anchor_offset,
+                                                pattern.anchor_len))
+      {
+        auto const address = region.first + (match - h_beg);
+        return !!(pattern.flags & PatternFlags::kRelativeAddress)
+                 ? reinterpret_cast<void*>(
+                     static_cast<std::uintptr_t>(address - base))
+                 : address;
+      }
+    }
+
+    if (!!(pattern.flags & PatternFlags::kThrowOnUnmatch))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Could not match pattern."}
+                << ErrorStringOther{detail::WideCharToMultiByte(name)});
+    }
+
+    return nullptr;
+  }
+
+  void LoadPatternDatabase(PatternDatabase const& database)
+  {
+    for (std::uint32_t i = 0; i < database.GetNumModules(); ++i)
+    {
+      auto const& db_module = database.GetModule(i);
+      auto const module =
+        database.GetString(db_module.name_offset, db_module.name_len);
+      HADESMEM_DETAIL_ASSERT(find_pattern_datas_.find(module) ==
+                             std::end(find_pattern_datas_));
+
+      auto const mod_info = detail::GetModuleInfo(*process_, module);
+      auto const base =
+        reinterpret_cast<std::uintptr_t>(mod_info.module->GetHandle());
+
+      std::vector<std::vector<std::uint8_t>> code_buffers;
+      std::vector<std::vector<std::uint8_t>> data_buffers;
+      auto const get_buffers = [&](bool scan_data)
+        -> std::vector<std::vector<std::uint8_t>> const&
+      {
+        auto& buffers = scan_data ? data_buffers : code_buffers;
+        auto const& regions =
+          scan_data ? mod_info.data_regions : mod_info.code_regions;
+        if (buffers.size() != regions.size())
+        {
+          for (auto const& region : regions)
+          {
+            buffers.emplace_back(ReadVector<std::uint8_t>(
+              *process_,
+              region.first,
+              static_cast<std::size_t>(region.second - region.first)));
+          }
+        }
+        return buffers;
+      };
+
+      std::vector<Pattern> results;
+      for (std::uint32_t j = 0; j < db_module.num_patterns; ++j)
+      {
+        auto const& p = database.GetPattern(db_module.first_pattern + j);
+        auto const name = database.GetString(p.name_offset, p.name_len);
+
+        std::uintptr_t start_rva = 0U;
+        switch (p.start_type)
+        {
+        case detail::PatternDbStart::kRva:
+          start_rva = p.start_value;
+          break;
+
+        case detail::PatternDbStart::kExport:
+          start_rva = GetStartRvaFromExport(
+            *mod_info.module, database.GetString(p.start_value, p.start_len));
+          break;
+
+        case detail::PatternDbStart::kPattern:
+        {
+          Pattern const& start_pattern = results[p.start_value];
+          start_rva =
+            reinterpret_cast<std::uintptr_t>(start_pattern.GetAddress());
+          if (!(start_pattern.GetFlags() & PatternFlags::kRelativeAddress))
+          {
+            start_rva -= base;
+          }
+          break;
+        }
+
+        default:
+          break;
+        }
+
+        void* address = FindCompiled(
+          mod_info,
+          get_buffers(!!(p.flags & PatternFlags::kScanData)),
+          database,
+          p,
+          start_rva,
+          name);
+
+        if (address)
+        {
+          std::vector<ManipInfo> manipulators;
+          for (std::uint32_t k = 0; k < p.num_manipulators; ++k)
+          {
+            auto const& m = database.GetManipulator(p.first_manipulator + k);
+            manipulators.push_back(
+              ManipInfo{static_cast<ManipInfo::Manipulator>(
+                          static_cast<std::uint32_t>(m.type)),
+                        !!m.has_operand1,
+                        static_cast<std::uintptr_t>(m.operand1),
+                        !!m.has_operand2,
+                        static_cast<std::uintptr_t>(m.operand2)});
+          }
+          address = ApplyManipulators(address, p.flags, base, manipulators);
+        }
+
+        results.emplace_back(address, p.flags);
+        find_pattern_datas_[module][name] = results.back();
+      }
+    }
+  }
+
+  static std::uint32_t const kCacheMagic = 0x43504D48; // "HMPC"
+  static std::uint32_t const kCacheVersion = 1;
+  static std::uint32_t const kCacheNotFound = 0xFFFFFFFF;
+
+  struct CacheKey
+  {
+    std::uint32_t time_date_stamp;
+    std::uint32_t size_of_image;
+    std::uint32_t check_sum;
+
+    bool operator==(CacheKey const& other) const HADESMEM_DETAIL_NOEXCEPT
+    {
+      return time_date_stamp == other.time_date_stamp &&
+             size_of_image == other.size_of_image &&
+             check_sum == other.check_sum;
+    }
+  };
+
+  // Match RVAs (before manipulators are applied) in pattern file order.
+  struct CachedModule
+  {
+    CacheKey key;
+    std::vector<std::uint32_t> rvas;
+  };
+
+  CacheKey GetCacheKey(Module const& module) const
+  {
+    PeFile const pe_file{
+      *process_, module.GetHandle(), PeFileType::Image, 0};
+    NtHeaders const nt_headers{*process_, pe_file};
+    CacheKey const key = {nt_headers.GetTimeDateStamp(),
+                          nt_headers.GetSizeOfImage(),
+                          nt_headers.GetCheckSum()};
+    return key;
+  }
+
+  std::map<std::wstring, CachedModule>
+    LoadCache(std::uint64_t file_hash) const
+  {
+    std::map<std::wstring, CachedModule> cache;
+    if (!detail::DoesFileExist(cache_path_))
+    {
+      return cache;
+    }
+
+    try
+    {
+      auto const buf = detail::FileToBuffer(cache_path_);
+      auto p = reinterpret_cast<std::uint8_t const*>(buf.data());
+      auto const end = p + buf.size();
+      auto const get = [&](std::size_t n) -> std::uint64_t
+      {
+        if (static_cast<std::size_t>(end - p) < n)
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error{} << ErrorString{"Truncated pattern cache."});
+        }
+        std::uint64_t value = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+          value |= static_cast<std::uint64_t>(*p++) << (i * 8);
+        }
+        return value;
+      };
+
+      if (get(4) != kCacheMagic || get(4) != kCacheVersion ||
+          get(8) != file_hash)
+      {
+        return cache;
+      }
+
+      auto const num_modules = get(4);
+      for (std::uint64_t i = 0; i < num_modules; ++i)
+      {
+        auto const name_len = static_cast<std::size_t>(get(4));
+        std::wstring name;
+        for (std::size_t j = 0; j < name_len; ++j)
+        {
+          name += static_cast<wchar_t>(get(2));
+        }
+
+        CachedModule cached;
+        cached.key.time_date_stamp = static_cast<std::uint32_t>(get(4));
+        cached.key.size_of_image = static_cast<std::uint32_t>(get(4));
+        cached.key.check_sum = static_cast<std::uint32_t>(get(4));
+        auto const num_rvas = static_cast<std::size_t>(get(4));
+        if (num_rvas > static_cast<std::size_t>(end - p) / 4)
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error{} << ErrorString{"Truncated pattern cache."});
+        }
+        for (std::size_t j = 0; j < num_rvas; ++j)
+        {
+          cached.rvas.push_back(static_cast<std::uint32_t>(get(4)));
+        }
+        cache[name] = std::move(cached);
+      }
+    }
+    catch (std::exception const& /*e*/)
+    {
+      // Treat a corrupt cache as a miss.
+      cache.clear();
+    }
+
+    return cache;
+  }
+
+  void SaveCache(std::uint64_t file_hash,
+                 std::map<std::wstring, CachedModule> const& cache) const
+  {
+    std::vector<std::uint8_t> buf;
+    auto const put = [&](std::uint64_t value, std::size_t len)
+    {
+      for (std::size_t i = 0; i < len; ++i)
+      {
+        buf.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+      }
+    };
+
+    put(kCacheMagic, 4);
+    put(kCacheVersion, 4);
+    put(file_hash, 8);
+    put(cache.size(), 4);
+    for (auto const& cached : cache)
+    {
+      put(cached.first.size(), 4);
+      for (auto const c : cached.first)
+      {
+        put(static_cast<std::uint16_t>(c), 2);
+      }
+      put(cached.second.key.time_date_stamp, 4);
+      put(cached.second.key.size_of_image, 4);
+      put(cached.second.key.check_sum, 4);
+      put(cached.second.rvas.size(), 4);
+      for (auto const rva : cached.second.rvas)
+      {
+        put(rva, 4);
+      }
+    }
+
+    // Failing to write the cache only costs a rescan next time, so it must
+    // not fail the load (which may be running inside a constructor).
+    try
+    {
+      detail::BufferToFile(
+        cache_path_, buf.data(), static_cast<std::streamsize>(buf.size()));
+    }
+    catch (...)
+    {
+      HADESMEM_DETAIL_TRACE_A(
+        boost::current_exception_diagnostic_information().c_str());
+    }
+  }
+
+  // Verifying a match only needs the pattern length to be read, rather than
+  // every section in the module. A cached failure to match is trusted unless
+  // the pattern is required to match, in which case it is scanned for again
+  // so the error is reported in the usual way.
+  bool LookupCachedMatch(detail::ModuleRegionInfo const& mod_info,
+                         std::wstring const& data,
+                         std::uint32_t flags,
+                         std::uint32_t rva,
+                         void*& address) const
+  {
+    if (rva == kCacheNotFound)
+    {
+      address = nullptr;
+      return !(flags & PatternFlags::kThrowOnUnmatch);
+    }
+
+    auto const needle = detail::ConvertData(data);
+    auto const base =
+      reinterpret_cast<std::uint8_t*>(mod_info.module->GetHandle());
+    auto const match = base + rva;
+    auto const& regions = !!(flags & PatternFlags::kScanData)
+                            ? mod_info.data_regions
+                            : mod_info.code_regions;
+    auto const region =
+      std::find_if(std::begin(regions),
+                   std::end(regions),
+                   [&](detail::ModuleRegionInfo::ScanRegion const& r)
+                   {
+                     return match >= r.first && match < r.second &&
+                            needle.size() <=
+                              static_cast<std::size_t>(r.second - match);
+                   });
+    if (region == std::end(regions))
+    {
+      return false;
+    }
+
+    auto const haystack =
+      ReadVector<std::uint8_t>(*process_, match, needle.size());
+    if (!std::equal(std::begin(needle),
+                    std::end(needle),
+                    std::begin(haystack),
+                    [](detail::PatternDataByte const& n_cur, std::uint8_t h_cur)
+                    {
+                      return n_cur.wildcard || h_cur == n_cur.data;
+                    }))
+    {
+      return false;
+    }
+
+    address = !!(flags & PatternFlags::kRelativeAddress)
+                ? reinterpret_cast<void*>(static_cast<std::uintptr_t>(rva))
+                : match;
+    return true;
+  }
+
+  void LoadPatternFileImpl(pugi::xml_document const& doc,
+                           std::uint64_t file_hash)
   {
     auto const patterns_info_full_list = ReadPatternsFromXml(doc);
+    bool const use_cache = !cache_path_.empty();
+    bool const record_matches = use_cache || shared_cache_;
+    auto const cache = use_cache ? LoadCache(file_hash)
+                                 : std::map<std::wstring, CachedModule>{};
+    std::map<std::wstring, CachedModule> new_cache;
     for (auto const& patterns_info_full_pair : patterns_info_full_list)
     {
       HADESMEM_DETAIL_ASSERT(
@@ -1150,8 +1851,56 @@ private:
       auto const& module = patterns_info_full_pair.first;
       auto const& patterns_info_full = patterns_info_full_pair.second;
       auto const& pattern_infos = patterns_info_full.patterns;
-      for (auto const& p : pattern_infos)
+
+      CachedModule* const cached_module =
+        record_matches ? &new_cache[module] : nullptr;
+      std::vector<std::uint32_t> const* cached_rvas = nullptr;
+      if (use_cache)
       {
+        cached_module->key = GetCacheKey(*mod_info.module);
+        auto const iter = cache.find(module);
+        if (iter != std::end(cache) &&
+            iter->second.key == cached_module->key &&
+            iter->second.rvas.size() == pattern_infos.size())
+        {
+          cached_rvas = &iter->second.rvas;
+        }
+      }
+
+      PatternCache::Key shared_key{};
+      std::vector<std::uint32_t> shared_rvas;
+      bool publish_shared = false;
+      if (shared_cache_)
+      {
+        cached_module->key = GetCacheKey(*mod_info.module);
+        shared_key.file_hash = file_hash;
+        shared_key.module = module;
+        shared_key.time_date_stamp = cached_module->key.time_date_stamp;
+        shared_key.size_of_image = cached_module->key.size_of_image;
+        shared_key.check_sum = cached_module->key.check_sum;
+        if (!shared_cache_->Acquire(shared_key, shared_rvas))
+        {
+          publish_shared = true;
+        }
+        else if (shared_rvas.size() == pattern_infos.size())
+        {
+          cached_rvas = &shared_rvas;
+        }
+      }
+
+      // If the scan fails another instance waiting on the module takes over.
+      auto const abandon_shared = [&]()
+      {
+        if (publish_shared)
+        {
+          shared_cache_->Abandon(shared_key);
+        }
+      };
+      auto scope_abandon_shared = detail::MakeScopeWarden(abandon_shared);
+
+      for (std::size_t i = 0; i < pattern_infos.size(); ++i)
+      {
+        auto const& p = pattern_infos[i];
         std::uint32_t const flags = patterns_info_full.flags | p.pattern.flags;
         void* address = nullptr;
         std::uintptr_t const start_rva = [&]() -> std::uintptr_t
@@ -1171,8 +1920,32 @@ private:
           }
         }();
 
-        address = ::hadesmem::Find(
-          *process_, module, p.pattern.data, flags, start_rva, &p.pattern.name);
+        if (cached_rvas &&
+            LookupCachedMatch(
+              mod_info, p.pattern.data, flags, (*cached_rvas)[i], address))
+        {
+          ++cache_stats_.hits;
+        }
+        else
+        {
+          address = ::hadesmem::Find(*process_,
+                                     module,
+                                     p.pattern.data,
+                                     flags,
+                                     start_rva,
+                                     &p.pattern.name);
+          ++cache_stats_.misses;
+        }
+
+        if (cached_module)
+        {
+          std::uintptr_t const rva =
+            !address ? kCacheNotFound
+                     : (!!(flags & PatternFlags::kRelativeAddress)
+                          ? reinterpret_cast<std::uintptr_t>(address)
+                          : reinterpret_cast<std::uintptr_t>(address) - base);
+          cached_module->rvas.push_back(static_cast<std::uint32_t>(rva));
+        }
 
         if (address)
         {
@@ -1182,10 +1955,26 @@ private:
         find_pattern_datas_[patterns_info_full_pair.first][p.pattern.name] =
           Pattern{address, flags};
       }
+
+      if (publish_shared)
+      {
+        shared_cache_->Publish(shared_key, cached_module->rvas);
+        scope_abandon_shared.Dismiss();
+      }
+    }
+
+    if (use_cache && cache_stats_.misses)
+    {
+      SaveCache(file_hash, new_cache);
     }
   }
 
   Process const* process_;
   ModuleMap find_pattern_datas_;
+  std::wstring cache_path_;
+  PatternCacheStats cache_stats_;
+  PatternCache* shared_cache_{};
 };
 }
+
+#endif // #if !defined(_WIN32)
@@ -0,0 +1,196 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/thread_pool.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/pointer_path.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+// Runs the same operation against many processes (e.g. several clients of the
+// same game) concurrently on a thread pool. Every operation returns one future
+// per process, in the order the processes were given, holding either the
+// result or the exception the operation threw for that process.
+//
+// Pattern scans share a PatternCache, so a module image loaded by several
+// processes is scanned by the first of them only. The others verify each
+// match at the same RVA in their own copy (which only reads the bytes of the
+// pattern) and only scan for patterns which fail verification.
+
+namespace hadesmem
+{
+struct FleetRead
+{
+  PointerPath path;
+  std::size_t size;
+};
+
+class Fleet
+{
+public:
+  // The processes must outlive the fleet. Zero threads means one per CPU.
+  explicit Fleet(std::vector<Process> const& processes,
+                 std::size_t num_threads = 0)
+    : pool_{num_threads}
+  {
+    for (auto const& process : processes)
+    {
+      processes_.push_back(&process);
+    }
+  }
+
+  explicit Fleet(std::vector<Process>&& processes,
+                 std::size_t num_threads = 0) = delete;
+
+  Fleet(Fleet const&) = delete;
+
+  Fleet& operator=(Fleet const&) = delete;
+
+  std::size_t GetSize() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return processes_.size();
+  }
+
+  Process const& GetProcess(std::size_t index) const
+  {
+    HADESMEM_DETAIL_ASSERT(index < processes_.size());
+    return *processes_[index];
+  }
+
+  PatternCache& GetPatternCache() HADESMEM_DETAIL_NOEXCEPT
+  {
+    return pattern_cache_;
+  }
+
+  // Runs func(process) for each process. func must be safe to call
+  // concurrently.
+  template <typename Func>
+  auto ForEach(Func func)
+    -> std::vector<std::future<decltype(func(std::declval<Process const&>()))>>
+  {
+    using ResultT = decltype(func(std::declval<Process const&>()));
+    std::vector<std::future<ResultT>> results;
+    results.reserve(processes_.size());
+    for (auto const process : processes_)
+    {
+      results.emplace_back(pool_.Submit([func, process]() -> ResultT
+                                        {
+                                          return func(*process);
+                                        }));
+    }
+    return results;
+  }
+
+  // Equivalent to FindPattern(process, pattern_file, in_memory_file)
+  // .GetModuleMap() for each process.
+  std::vector<std::future<ModuleMap>>
+    FindPattern(std::wstring const& pattern_file, bool in_memory_file)
+  {
+    PatternCache* const cache = &pattern_cache_;
+    return ForEach([pattern_file, in_memory_file, cache](
+      Process const& process) -> ModuleMap
+                   {
+                     ::hadesmem::FindPattern const find_pattern{
+                       process, pattern_file, in_memory_file, *cache};
+                     return find_pattern.GetModuleMap();
+                   });
+  }
+
+  // Resolves every path in each process. Module bases are looked up once per
+  // module per process.
+  std::vector<std::future<std::vector<void*>>>
+    ResolvePointerPaths(std::vector<PointerPath> const& paths)
+  {
+    auto const shared_paths =
+      std::make_shared<std::vector<PointerPath> const>(paths);
+    return ForEach([shared_paths](Process const& process)
+                     -> std::vector<void*>
+                   {
+                     ModuleBaseCache module_bases{process};
+                     std::vector<void*> addresses;
+                     addresses.reserve(shared_paths->size());
+                     for (auto const& path : *shared_paths)
+                     {
+                       addresses.push_back(detail::ResolvePointerPath(
+                         process, path, module_bases.Get(path.module)));
+                     }
+                     return addresses;
+                   });
+  }
+
+  // Resolves each path and reads size bytes from the result, in each process.
+  std::vector<std::future<std::vector<std::vector<std::uint8_t>>>>
+    ReadBatch(std::vector<FleetRead> const& reads)
+  {
+    auto const shared_reads =
+      std::make_shared<std::vector<FleetRead> const>(reads);
+    return ForEach([shared_reads](Process const& process)
+                     -> std::vector<std::vector<std::uint8_t>>
+                   {
+                     ModuleBaseCache module_bases{process};
+                     std::vector<std::vector<std::uint8_t>> data;
+                     data.reserve(shared_reads->size());
+                     for (auto const& read : *shared_reads)
+                     {
+                       void* const address = detail::ResolvePointerPath(
+                         process,
+                         read.path,
+                         module_bases.Get(read.path.module));
+                       data.emplace_back(ReadVector<std::uint8_t>(
+                         process, address, read.size));
+                     }
+                     return data;
+                   });
+  }
+
+private:
+  class ModuleBaseCache
+  {
+  public:
+    explicit ModuleBaseCache(Process const& process) : process_{&process}
+    {
+    }
+
+    void* Get(std::wstring const& name)
+    {
+      auto const iter = bases_.find(name);
+      if (iter != std::end(bases_))
+      {
+        return iter->second;
+      }
+
+      Module const module = name.empty() ? Module{*process_, nullptr}
+                                         : Module{*process_, name};
+      void* const base = module.GetHandle();
+      bases_[name] = base;
+      return base;
+    }
+
+  private:
+    Process const* process_;
+    std::map<std::wstring, void*> bases_;
+  };
+
+  std::vector<Process const*> processes_;
+  PatternCache pattern_cache_;
+  // Last, so that queued tasks finish before anything they use is destroyed.
+  detail::ThreadPool pool_;
+};
+}
@@ -0,0 +1,457 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <pugixml.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/instruction_decoder.hpp>
+#include <hadesmem/detail/thread_pool.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/module_index.hpp>
+#include <hadesmem/pelib/nt_headers.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/relocation.hpp>
+#include <hadesmem/pelib/relocation_block.hpp>
+#include <hadesmem/pelib/relocation_block_list.hpp>
+#include <hadesmem/pelib/relocation_list.hpp>
+#include <hadesmem/process.hpp>
+
+// Generates the shortest pattern (in the FindPattern format) which uniquely
+// identifies an address in a module. Bytes which are likely to change between
+// builds or loads are wildcarded: relocated pointers, and in code the operands
+// of rel16/rel32 branches and RIP-relative displacements (rel8 branches are
+// local to the function so are kept). Addresses in code are assumed to be
+// instruction boundaries.
+
+namespace hadesmem
+{
+struct Signature
+{
+  // RVA of the address the signature was generated for.
+  std::uint32_t rva;
+  // Pattern data, or empty if no unique pattern was found within the maximum
+  // length.
+  std::wstring data;
+  // Offset of the address from the start of the pattern.
+  std::uint32_t offset;
+  // Pattern must be found with PatternFlags::kScanData.
+  bool scan_data;
+};
+
+class SignatureGenerator
+{
+public:
+  static std::size_t const kDefaultMaxLen = 64;
+
+  explicit SignatureGenerator(Process const& process,
+                              ModuleIndex const& index,
+                              std::size_t max_len = kDefaultMaxLen)
+    : index_{&index}, sections_(index.GetSections()), max_len_{max_len}
+  {
+    HADESMEM_DETAIL_ASSERT(max_len != 0);
+
+    PeFile const pe_file{process, index.GetBase(), PeFileType::Image, 0};
+    NtHeaders const nt_headers{process, pe_file};
+    is_64_ = nt_headers.GetMachine() == IMAGE_FILE_MACHINE_AMD64;
+
+    RelocationBlockList const blocks{process, pe_file};
+    for (auto const& block : blocks)
+    {
+      RelocationList const relocs{process,
+                                  pe_file,
+                                  block.GetRelocationDataStart(),
+                                  block.GetNumberOfRelocations()};
+      for (auto const& reloc : relocs)
+      {
+        std::uint8_t const type = reloc.GetType();
+        std::uint32_t const size = type == IMAGE_REL_BASED_DIR64
+                                     ? 8
+                                     : (type == IMAGE_REL_BASED_HIGHLOW ? 4
+                                                                        : 0);
+        if (size)
+        {
+          std::uint32_t const beg =
+            block.GetVirtualAddress() + reloc.GetOffset();
+          relocs_.emplace_back(beg, beg + size);
+        }
+      }
+    }
+    std::sort(std::begin(relocs_), std::end(relocs_));
+  }
+
+  explicit SignatureGenerator(Process&& process,
+                              ModuleIndex const& index,
+                              std::size_t max_len = kDefaultMaxLen) = delete;
+
+  explicit SignatureGenerator(Process const& process,
+                              ModuleIndex&& index,
+                              std::size_t max_len = kDefaultMaxLen) = delete;
+
+  Signature Generate(void const* address) const
+  {
+    auto const rva_ptr = reinterpret_cast<std::uintptr_t>(address) -
+                         reinterpret_cast<std::uintptr_t>(index_->GetBase());
+    auto const section_iter =
+      std::find_if(std::begin(sections_),
+                   std::end(sections_),
+                   [&](ModuleIndex::SectionView const& s)
+                   {
+                     return rva_ptr >= s.rva && rva_ptr - s.rva < s.size;
+                   });
+    if (section_iter == std::end(sections_))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Address is not in an indexed section."});
+    }
+
+    auto const& section = *section_iter;
+    auto const rva = static_cast<std::uint32_t>(rva_ptr);
+    std::size_t const target = rva - section.rva;
+    std::size_t const back_max = (std::min)(max_len_ - 1, target);
+    std::size_t const fwd_max = (std::min)(max_len_, section.size - target);
+    std::size_t const win_beg = target - back_max;
+    std::size_t const win_len = back_max + fwd_max;
+
+    std::vector<detail::PatternDataByte> window(win_len);
+    for (std::size_t i = 0; i < win_len; ++i)
+    {
+      window[i].data = section.data[win_beg + i];
+      window[i].wildcard = false;
+    }
+
+    auto const wildcard = [&](std::size_t beg, std::size_t end)
+    {
+      beg = (std::max)(beg, win_beg);
+      end = (std::min)(end, win_beg + win_len);
+      for (std::size_t i = beg; i < end; ++i)
+      {
+        window[i - win_beg].wildcard = true;
+      }
+    };
+
+    std::uint32_t const win_rva =
+      section.rva + static_cast<std::uint32_t>(win_beg);
+    auto reloc = std::lower_bound(
+      std::begin(relocs_),
+      std::end(relocs_),
+      std::make_pair(win_rva > 8 ? win_rva - 8 : 0, 0U));
+    for (; reloc != std::end(relocs_) && reloc->first < win_rva + win_len;
+         ++reloc)
+    {
+      if (reloc->second > win_rva)
+      {
+        wildcard((std::max)(reloc->first, win_rva) - section.rva,
+                 reloc->second - section.rva);
+      }
+    }
+
+    if (section.is_code)
+    {
+      WildcardInstructions(section, target, win_beg, win_len, wildcard);
+    }
+
+    Signature signature = {rva, std::wstring(), 0, !section.is_code};
+
+    auto const is_unique = [&](std::size_t back, std::size_t fwd)
+    {
+      auto const beg = std::begin(window) + (back_max - back);
+      auto const end = beg + (back + fwd);
+      if (std::all_of(beg,
+                      end,
+                      [](detail::PatternDataByte const& b)
+                      {
+                        return b.wildcard;
+                      }))
+      {
+        return false;
+      }
+      return index_->FindAllRvas(beg, end, !section.is_code).size() == 1;
+    };
+
+    // Adding bytes can only remove matches, so the shortest window in each
+    // direction can be found with a binary search.
+    auto const shortest = [](std::size_t lo,
+                             std::size_t hi,
+                             std::function<bool(std::size_t)> const& pred)
+    {
+      while (lo < hi)
+      {
+        std::size_t const mid = lo + (hi - lo) / 2;
+        if (pred(mid))
+        {
+          hi = mid;
+        }
+        else
+        {
+          lo = mid + 1;
+        }
+      }
+      return lo;
+    };
+
+    std::size_t back = 0;
+    std::size_t fwd = 0;
+    if (is_unique(0, fwd_max))
+    {
+      fwd = shortest(1,
+                     fwd_max,
+                     [&](std::size_t f)
+                     {
+                       return is_unique(0, f);
+                     });
+    }
+    else if (back_max && is_unique(back_max, fwd_max))
+    {
+      back = shortest(1,
+                      back_max,
+                      [&](std::size_t b)
+                      {
+                        return is_unique(b, fwd_max);
+                      });
+      fwd = shortest(1,
+                     fwd_max,
+                     [&](std::size_t f)
+                     {
+                       return is_unique(back, f);
+                     });
+    }
+    else
+    {
+      return signature;
+    }
+
+    signature.offset = static_cast<std::uint32_t>(back);
+    signature.data = FormatPattern(std::begin(window) + (back_max - back),
+                                   std::begin(window) + (back_max + fwd));
+    return signature;
+  }
+
+  // Generate signatures for many addresses in parallel. A num_threads of zero
+  // uses one thread per hardware thread.
+  std::vector<Signature> Generate(std::vector<void const*> const& addresses,
+                                  std::size_t num_threads = 0) const
+  {
+    std::vector<Signature> signatures(addresses.size());
+    std::atomic<std::size_t> next(0);
+    auto const worker = [&]()
+    {
+      for (std::size_t i = next++; i < addresses.size(); i = next++)
+      {
+        signatures[i] = Generate(addresses[i]);
+      }
+    };
+
+    if (!num_threads)
+    {
+      num_threads = (std::max)(std::thread::hardware_concurrency(), 1U);
+    }
+    num_threads = (std::min)(num_threads, addresses.size());
+
+    if (num_threads > 1)
+    {
+      detail::ThreadPool pool{num_threads};
+      std::vector<std::future<void>> results;
+      for (std::size_t i = 0; i < num_threads; ++i)
+      {
+        results.emplace_back(pool.Submit([&]()
+                                         {
+                                           try
+                                           {
+                                             worker();
+                                           }
+                                           catch (...)
+                                           {
+                                             next = addresses.size();
+                                             throw;
+                                           }
+                                         }));
+      }
+
+      // Every worker references our locals, so all of them must finish
+      // before the first error is rethrown.
+      for (auto const& result : results)
+      {
+        result.wait();
+      }
+
+      for (auto& result : results)
+      {
+        result.get();
+      }
+    }
+    else
+    {
+      worker();
+    }
+
+    return signatures;
+  }
+
+private:
+  // Instructions before the target are found by decoding from each offset
+  // up to a maximal instruction length before the window until one lands
+  // exactly on the target.
+  template <typename WildcardFunc>
+  void WildcardInstructions(ModuleIndex::SectionView const& section,
+                            std::size_t target,
+                            std::size_t win_beg,
+                            std::size_t win_len,
+                            WildcardFunc const& wildcard) const
+  {
+    std::size_t const kMaxInstructionLen = 15;
+    std::size_t const win_end = win_beg + win_len;
+
+    auto const decode = [&](std::size_t offset, std::size_t end, bool apply)
+    {
+      while (offset < end)
+      {
+        detail::InstructionInfo info;
+        if (!detail::DecodeInstruction(section.data + offset,
+                                       section.size - offset,
+                                       is_64_,
+                                       info))
+        {
+          break;
+        }
+
+        if (apply)
+        {
+          if (detail::IsRelativeBranch(info) && info.rel_size >= 2)
+          {
+            wildcard(offset + info.rel_offset,
+                     offset + info.rel_offset + info.rel_size);
+          }
+          if (info.rip_relative)
+          {
+            wildcard(offset + info.disp_offset, offset + info.disp_offset + 4);
+          }
+        }
+
+        offset += info.len;
+      }
+      return offset;
+    };
+
+    std::size_t const sync_beg =
+      win_beg > kMaxInstructionLen ? win_beg - kMaxInstructionLen : 0;
+    for (std::size_t start = sync_beg; start < target; ++start)
+    {
+      if (decode(start, target, false) == target)
+      {
+        decode(start, target, true);
+        break;
+      }
+    }
+
+    decode(target, win_end, true);
+  }
+
+  template <typename NeedleIterator>
+  static std::wstring FormatPattern(NeedleIterator beg, NeedleIterator end)
+  {
+    wchar_t const* const kHexDigits = L"0123456789ABCDEF";
+    std::wstring data;
+    for (auto i = beg; i != end; ++i)
+    {
+      if (i != beg)
+      {
+        data += L' ';
+      }
+      if (i->wildcard)
+      {
+        data += L"??";
+      }
+      else
+      {
+        data += kHexDigits[i->data >> 4];
+        data += kHexDigits[i->data & 0xF];
+      }
+    }
+    return data;
+  }
+
+  ModuleIndex const* index_;
+  std::vector<ModuleIndex::SectionView> sections_;
+  std::size_t max_len_;
+  bool is_64_{};
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> relocs_;
+};
+
+inline Signature GenerateSignature(Process const& process,
+                                   std::wstring const& module,
+                                   void const* address)
+{
+  ModuleIndex const index{process, module};
+  SignatureGenerator const generator{process, index};
+  return generator.Generate(address);
+}
+
+// Named signatures as a pattern file which can be loaded by FindPattern.
+// Signatures without any data (i.e. no unique pattern was found) are skipped.
+inline std::wstring
+  SignaturesToXml(std::wstring const& module,
+                  std::vector<std::pair<std::wstring, Signature>> const&
+                    signatures)
+{
+  pugi::xml_document doc;
+  auto root = doc.append_child(L"HadesMem");
+  auto find_pattern = root.append_child(L"FindPattern");
+  if (!module.empty())
+  {
+    find_pattern.append_attribute(L"Module").set_value(module.c_str());
+  }
+
+  for (auto const& named : signatures)
+  {
+    auto const& signature = named.second;
+    if (signature.data.empty())
+    {
+      continue;
+    }
+
+    auto pattern = find_pattern.append_child(L"Pattern");
+    pattern.append_attribute(L"Name").set_value(named.first.c_str());
+    pattern.append_attribute(L"Data").set_value(signature.data.c_str());
+    if (signature.scan_data)
+    {
+      pattern.append_child(L"Flag").append_attribute(L"Name").set_value(
+        L"ScanData");
+    }
+    if (signature.offset)
+    {
+      std::wostringstream offset_str;
+      offset_str.imbue(std::locale::classic());
+      offset_str << std::hex << std::uppercase << L"0x" << signature.offset;
+      auto manipulator = pattern.append_child(L"Manipulator");
+      manipulator.append_attribute(L"Name").set_value(L"Add");
+      manipulator.append_attribute(L"Operand1")
+        .set_value(offset_str.str().c_str());
+    }
+  }
+
+  std::wostringstream xml;
+  doc.save(xml, L"  ");
+  return xml.str();
+}
+}
@@ -0,0 +1,146 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+
+// When built with HADESMEM_HOOK_PROFILE, every call through a detour stub
+// (PatchDetour and friends) records its call count and inclusive time in a
+// named shared memory segment owned by the hooked process, which any other
+// process can poll with ReadHookProfile without stopping or otherwise
+// disturbing the target.
+
+namespace hadesmem
+{
+struct HookProfileEntry
+{
+  // Bucket i counts calls which took [2^i, 2^(i+1)) cycles. The last bucket
+  // also counts anything longer.
+  static std::size_t const kNumBuckets = 32;
+
+  // Address of the hooked function in the target.
+  void* target;
+  std::uint64_t num_calls;
+  std::uint64_t total_cycles;
+  std::uint64_t histogram[kNumBuckets];
+};
+
+namespace detail
+{
+struct HookProfileCounters
+{
+  std::uint64_t num_calls;
+  std::uint64_t total_cycles;
+  std::uint64_t histogram[HookProfileEntry::kNumBuckets];
+};
+
+// Counters are sharded by thread ID, so that threads calling the same hook
+// rarely contend, and summed by the reader. Addresses are stored as 64-bit
+// values so the layout doesn't depend on the bitness of either side.
+struct HookProfileSegment
+{
+  static std::uint32_t const kMagic = 0x50484D48; // "HMHP"
+  static std::size_t const kMaxHooks = 256;
+  static std::size_t const kNumShards = 8;
+
+  std::uint32_t magic;
+  // One past the highest claimed slot. Only raised after the target of that
+  // slot is written, and targets are never changed once written.
+  std::uint32_t num_hooks;
+  std::uint64_t targets[kMaxHooks];
+  HookProfileCounters counters[kNumShards][kMaxHooks];
+};
+
+inline std::wstring GetHookProfileSegmentName(DWORD pid)
+{
+  return L"Local\\HadesMem-HookProfile-" + std::to_wstring(pid);
+}
+}
+
+// Returns a snapshot of the profile of the process, which must have been built
+// with HADESMEM_HOOK_PROFILE and have applied at least one hook. Counters are
+// updated concurrently, so the snapshot is only consistent per counter.
+inline std::vector<HookProfileEntry> ReadHookProfile(Process const& process)
+{
+  std::wstring const name =
+    detail::GetHookProfileSegmentName(process.GetId());
+  detail::SmartHandle const mapping{
+    ::OpenFileMappingW(FILE_MAP_READ, FALSE, name.c_str())};
+  if (!mapping.IsValid())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Failed to open hook profile segment."}
+              << ErrorCodeWinLast{last_error});
+  }
+
+  detail::SmartMappedFileHandle const view{
+    ::MapViewOfFile(mapping.GetHandle(),
+                    FILE_MAP_READ,
+                    0,
+                    0,
+                    sizeof(detail::HookProfileSegment))};
+  if (!view.IsValid())
+  {
+    DWORD const last_error = ::GetLastError();
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"MapViewOfFile failed."}
+                                    << ErrorCodeWinLast{last_error});
+  }
+
+  auto const segment =
+    static_cast<detail::HookProfileSegment const*>(view.GetHandle());
+  if (segment->magic != detail::HookProfileSegment::kMagic)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Invalid hook profile segment."});
+  }
+
+  std::uint32_t const volatile* const num_hooks_ptr = &segment->num_hooks;
+  std::size_t num_hooks = *num_hooks_ptr;
+  if (num_hooks > detail::HookProfileSegment::kMaxHooks)
+  {
+    num_hooks = detail::HookProfileSegment::kMaxHooks;
+  }
+  std::vector<HookProfileEntry> entries;
+  entries.reserve(num_hooks);
+  for (std::size_t i = 0; i < num_hooks; ++i)
+  {
+    // Slots below num_hooks always have a target, but don't trust the
+    // segment blindly as it's writable by anything in the target process.
+    std::uint64_t const target = segment->targets[i];
+    if (!target)
+    {
+      continue;
+    }
+
+    entries.emplace_back(HookProfileEntry{});
+    HookProfileEntry& entry = entries.back();
+    entry.target =
+      reinterpret_cast<void*>(static_cast<std::uintptr_t>(target));
+    for (std::size_t j = 0; j < detail::HookProfileSegment::kNumShards; ++j)
+    {
+      auto const& counters = segment->counters[j][i];
+      entry.num_calls += counters.num_calls;
+      entry.total_cycles += counters.total_cycles;
+      for (std::size_t k = 0; k < HookProfileEntry::kNumBuckets; ++k)
+      {
+        entry.histogram[k] += counters.histogram[k];
+      }
+    }
+  }
+
+  return entries;
+}
+}
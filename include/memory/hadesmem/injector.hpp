@@ -29,6 +29,7 @@
 #include <hadesmem/find_procedure.hpp>
 #include <hadesmem/module.hpp>
 #include <hadesmem/process.hpp>
+#include <hadesmem/remote_arena.hpp>
 #include <hadesmem/write.hpp>
 
 namespace hadesmem
@@ -95,9 +96,11 @@ struct InjectFlags
   };
 };
 
+// The path is written to memory from the arena if one is given.
 inline HMODULE InjectDll(Process const& process,
                          std::wstring const& path,
-                         std::uint32_t flags)
+                         std::uint32_t flags,
+                         RemoteArena* arena = nullptr)
 {
   HADESMEM_DETAIL_ASSERT(!(flags & ~(InjectFlags::kInvalidFlagMaxValue - 1UL)));
 
@@ -142,7 +145,8 @@ inline HMODULE InjectDll(Process const& process,
 
   HADESMEM_DETAIL_TRACE_A("Allocating memory for module path.");
 
-  Allocator const lib_file_remote{process, path_buf_size};
+  Allocator const lib_file_remote{detail::AllocateFrom(
+    process, arena, path_buf_size, RemoteArenaPool::kReadWrite)};
 
   HADESMEM_DETAIL_TRACE_A("Writing memory for module path.");
 
@@ -0,0 +1,229 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/read.hpp>
+#include <hadesmem/linux/region.hpp>
+#include <hadesmem/linux/region_list.hpp>
+
+// Pattern scanning for the Linux backend. There is no PE to get sections
+// from, so the executable mappings of a module take the place of its code
+// sections and its other readable mappings take the place of its data
+// sections. Pattern data and flags are the same as for FindPattern.
+
+namespace hadesmem
+{
+namespace procfs
+{
+namespace detail
+{
+// Amount of memory read per call while scanning.
+std::size_t const kFindChunkSize = 1 << 20;
+
+using ScanRegion = std::pair<std::uint8_t*, std::uint8_t*>;
+
+struct ModuleRegionInfo
+{
+  // Lowest mapping of the module (or zero if scanning all mappings), which
+  // start addresses and relative results are relative to.
+  std::uint8_t* base;
+  std::vector<ScanRegion> code_regions;
+  std::vector<ScanRegion> data_regions;
+};
+
+inline std::string GetFileName(std::string const& path)
+{
+  auto const pos = path.find_last_of('/');
+  return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+// Module is the file name (e.g. "libc.so.6") or full path of a mapped file,
+// or empty for all mappings.
+inline ModuleRegionInfo GetModuleInfo(Process const& process,
+                                      std::string const& module)
+{
+  ModuleRegionInfo mod_info{};
+  bool const match_path = module.find('/') != std::string::npos;
+  bool found = false;
+  for (auto const& region : RegionList{process})
+  {
+    auto const& path = region.GetPath();
+    if (!module.empty() &&
+        (match_path ? path != module : GetFileName(path) != module))
+    {
+      continue;
+    }
+
+    auto const beg = static_cast<std::uint8_t*>(region.GetBase());
+    if (!found)
+    {
+      mod_info.base = module.empty() ? nullptr : beg;
+      found = true;
+    }
+
+    // Guard pages and the like can't be read, and [vvar] can't be read even
+    // though it is mapped readable.
+    int const protect = region.GetProtect();
+    if (!(protect & PROT_READ) || path == "[vvar]")
+    {
+      continue;
+    }
+
+    auto& regions = (protect & PROT_EXEC) ? mod_info.code_regions
+                                          : mod_info.data_regions;
+    regions.emplace_back(beg, beg + region.GetSize());
+  }
+
+  if (!found)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Could not find module."}
+                                    << ErrorStringOther{module});
+  }
+
+  return mod_info;
+}
+
+// Reads in chunks rather than the whole region at once as the anonymous and
+// heap mappings of a large process can be huge. Chunks overlap by the pattern
+// length minus one so matches spanning a chunk boundary are not missed.
+inline void* FindRaw(Process const& process,
+                     std::uint8_t* s_beg,
+                     std::uint8_t* s_end,
+                     hadesmem::detail::MaskedPattern const& pattern)
+{
+  std::size_t const len = pattern.value.size();
+  if (static_cast<std::size_t>(s_end - s_beg) < len)
+  {
+    return nullptr;
+  }
+
+  std::size_t const chunk_size = (std::max)(kFindChunkSize, len);
+  std::vector<std::uint8_t> haystack(chunk_size);
+  for (auto cur = s_beg;;)
+  {
+    std::size_t const cur_len =
+      (std::min)(chunk_size, static_cast<std::size_t>(s_end - cur));
+    try
+    {
+      detail::ReadUnchecked(process, cur, haystack.data(), cur_len);
+    }
+    catch (std::exception const& /*e*/)
+    {
+      // File backed mappings which extend past the end of the file can't be
+      // read past it, so treat the rest of the region as unmatched.
+      return nullptr;
+    }
+
+    auto const h_beg = haystack.data();
+    if (auto const match =
+          hadesmem::detail::FindMasked(h_beg,
+                                       h_beg + cur_len,
+                                       pattern.value.data(),
+                                       pattern.mask.data(),
+                                       len,
+                                       pattern.anchor_offset,
+                                       pattern.anchor_len))
+    {
+      return cur + (match - h_beg);
+    }
+
+    if (cur + cur_len == s_end)
+    {
+      return nullptr;
+    }
+
+    cur += cur_len - (len - 1);
+  }
+}
+
+inline void* Find(Process const& process,
+                  ScanRegion const& region,
+                  void* start,
+                  hadesmem::detail::MaskedPattern const& pattern)
+{
+  std::uint8_t* s_beg = region.first;
+  std::uint8_t* const s_end = region.second;
+
+  // Support custom scan start address. As on Windows, only the region
+  // containing it is scanned, from the address after it (so we don't just
+  // find the same thing again).
+  if (start)
+  {
+    if (start >= s_beg && start < s_end)
+    {
+      s_beg = static_cast<std::uint8_t*>(start) + 1;
+      if (s_beg == s_end)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Invalid start address."});
+      }
+    }
+    else
+    {
+      return nullptr;
+    }
+  }
+
+  return FindRaw(process, s_beg, s_end, pattern);
+}
+}
+
+inline void* Find(Process const& process,
+                  std::string const& module,
+                  std::wstring const& data,
+                  std::uint32_t flags,
+                  std::uintptr_t start,
+                  std::string const& name = std::string())
+{
+  HADESMEM_DETAIL_ASSERT(
+    !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
+
+  auto const mod_info = detail::GetModuleInfo(process, module);
+  auto const pattern = hadesmem::detail::ConvertToMaskedPattern(
+    hadesmem::detail::ConvertData(data));
+  auto const base = reinterpret_cast<std::uintptr_t>(mod_info.base);
+  void* const start_abs =
+    start ? reinterpret_cast<void*>(base + start) : nullptr;
+
+  bool const scan_data = !!(flags & PatternFlags::kScanData);
+  for (auto const& region :
+       scan_data ? mod_info.data_regions : mod_info.code_regions)
+  {
+    if (void* const address =
+          detail::Find(process, region, start_abs, pattern))
+    {
+      return !!(flags & PatternFlags::kRelativeAddress)
+               ? reinterpret_cast<void*>(
+                   reinterpret_cast<std::uintptr_t>(address) - base)
+               : address;
+    }
+  }
+
+  if (!!(flags & PatternFlags::kThrowOnUnmatch))
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Could not match pattern."}
+                                    << ErrorStringOther{name});
+  }
+
+  return nullptr;
+}
+}
+}
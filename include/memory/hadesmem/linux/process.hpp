@@ -0,0 +1,206 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cerrno>
+#include <locale>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/error.hpp>
+
+// Linux backend, for examining processes (e.g. Wine hosted Windows processes)
+// from Linux. Memory is accessed with process_vm_readv/process_vm_writev,
+// falling back to /proc/<pid>/mem, so the same ptrace access checks apply as
+// for a debugger (a parent can always access its children).
+
+namespace hadesmem
+{
+namespace procfs
+{
+class Process
+{
+public:
+  explicit Process(pid_t id) : mem_fd_{OpenMem(id)}, id_{id}
+  {
+  }
+
+  Process(Process const& other)
+    : mem_fd_{Duplicate(other.mem_fd_)}, id_{other.id_}
+  {
+  }
+
+  Process& operator=(Process const& other)
+  {
+    Process tmp{other};
+    *this = std::move(tmp);
+
+    return *this;
+  }
+
+  Process(Process&& other) HADESMEM_DETAIL_NOEXCEPT : mem_fd_{other.mem_fd_},
+                                                      id_{other.id_}
+  {
+    other.mem_fd_ = -1;
+    other.id_ = 0;
+  }
+
+  Process& operator=(Process&& other) HADESMEM_DETAIL_NOEXCEPT
+  {
+    CleanupUnchecked();
+
+    mem_fd_ = other.mem_fd_;
+    id_ = other.id_;
+
+    other.mem_fd_ = -1;
+    other.id_ = 0;
+
+    return *this;
+  }
+
+  ~Process()
+  {
+    CleanupUnchecked();
+  }
+
+  pid_t GetId() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return id_;
+  }
+
+  // File descriptor for /proc/<pid>/mem. Opened for writing if possible,
+  // otherwise read-only.
+  int GetMemFd() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return mem_fd_;
+  }
+
+  void Cleanup()
+  {
+    if (mem_fd_ != -1 && ::close(mem_fd_))
+    {
+      int const last_error = errno;
+      mem_fd_ = -1;
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"close failed."}
+                                              << ErrorCodeErrno{last_error});
+    }
+
+    mem_fd_ = -1;
+    id_ = 0;
+  }
+
+private:
+  void CleanupUnchecked() HADESMEM_DETAIL_NOEXCEPT
+  {
+    try
+    {
+      Cleanup();
+    }
+    catch (...)
+    {
+      HADESMEM_DETAIL_ASSERT(false);
+
+      mem_fd_ = -1;
+      id_ = 0;
+    }
+  }
+
+  static int OpenMem(pid_t id)
+  {
+    std::string const path = "/proc/" + std::to_string(id) + "/mem";
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd == -1)
+    {
+      fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    if (fd == -1)
+    {
+      int const last_error = errno;
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Failed to open process."}
+                                      << ErrorCodeErrno{last_error});
+    }
+
+    return fd;
+  }
+
+  static int Duplicate(int fd)
+  {
+    int const new_fd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (new_fd == -1)
+    {
+      int const last_error = errno;
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"fcntl failed."}
+                                              << ErrorCodeErrno{last_error});
+    }
+
+    return new_fd;
+  }
+
+  int mem_fd_;
+  pid_t id_;
+};
+
+inline bool operator==(Process const& lhs,
+                       Process const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetId() == rhs.GetId();
+}
+
+inline bool operator!=(Process const& lhs,
+                       Process const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return !(lhs == rhs);
+}
+
+inline bool operator<(Process const& lhs,
+                      Process const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetId() < rhs.GetId();
+}
+
+inline bool operator<=(Process const& lhs,
+                       Process const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetId() <= rhs.GetId();
+}
+
+inline bool operator>(Process const& lhs,
+                      Process const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetId() > rhs.GetId();
+}
+
+inline bool operator>=(Process const& lhs,
+                       Process const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetId() >= rhs.GetId();
+}
+
+inline std::ostream& operator<<(std::ostream& lhs, Process const& rhs)
+{
+  std::locale const old = lhs.imbue(std::locale::classic());
+  lhs << rhs.GetId();
+  lhs.imbue(old);
+  return lhs;
+}
+
+inline std::wostream& operator<<(std::wostream& lhs, Process const& rhs)
+{
+  std::locale const old = lhs.imbue(std::locale::classic());
+  lhs << rhs.GetId();
+  lhs.imbue(old);
+  return lhs;
+}
+}
+}
@@ -0,0 +1,198 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+
+namespace hadesmem
+{
+namespace procfs
+{
+struct ReadRequest
+{
+  void const* address;
+  void* data;
+  std::size_t len;
+};
+
+namespace detail
+{
+// Maximum number of iovecs per call (UIO_MAXIOV).
+std::size_t const kMaxIovecs = 1024;
+
+inline void ReadMem(Process const& process,
+                    void const* address,
+                    void* data,
+                    std::size_t len)
+{
+  auto const out = static_cast<std::uint8_t*>(data);
+  auto const offset = reinterpret_cast<std::uintptr_t>(address);
+  std::size_t done = 0;
+  while (done < len)
+  {
+    ssize_t const n = ::pread(process.GetMemFd(),
+                              out + done,
+                              len - done,
+                              static_cast<off_t>(offset + done));
+    if (n <= 0)
+    {
+      int const last_error = n ? errno : EIO;
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Could not read process memory."}
+                << ErrorCodeOther{offset + done}
+                << ErrorCodeErrno{last_error});
+    }
+    done += static_cast<std::size_t>(n);
+  }
+}
+
+// process_vm_readv is tried first as it avoids the seek and page pinning of
+// /proc/<pid>/mem, but it can be unavailable (ENOSYS/EPERM under some
+// sandboxes), so anything it fails to read is retried through the file.
+inline void ReadUnchecked(Process const& process,
+                          void const* address,
+                          void* data,
+                          std::size_t len)
+{
+  iovec local = {data, len};
+  iovec remote = {const_cast<void*>(address), len};
+  ssize_t const n =
+    ::process_vm_readv(process.GetId(), &local, 1, &remote, 1, 0);
+  std::size_t const done = n > 0 ? static_cast<std::size_t>(n) : 0;
+  if (done != len)
+  {
+    ReadMem(process,
+            static_cast<std::uint8_t const*>(address) + done,
+            static_cast<std::uint8_t*>(data) + done,
+            len - done);
+  }
+}
+}
+
+inline void ReadUnchecked(Process const& process,
+                          void const* address,
+                          void* data,
+                          std::size_t len)
+{
+  if (len)
+  {
+    detail::ReadUnchecked(process, address, data, len);
+  }
+}
+
+template <typename T> T Read(Process const& process, void const* address)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
+
+  T data;
+  ReadUnchecked(process, address, &data, sizeof(data));
+  return data;
+}
+
+template <typename T>
+std::vector<T>
+  ReadVector(Process const& process, void const* address, std::size_t count)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
+
+  std::vector<T> data(count);
+  ReadUnchecked(process, address, data.data(), sizeof(T) * count);
+  return data;
+}
+
+// Read many (possibly discontiguous) ranges with as few system calls as
+// possible, by passing up to kMaxIovecs ranges to each process_vm_readv.
+// Partial transfers stop at the first range which could not be read, which is
+// then retried on its own through /proc/<pid>/mem (and throws if it still
+// fails), and the batch continues from the range after it.
+inline void ReadScatter(Process const& process,
+                        ReadRequest const* beg,
+                        ReadRequest const* end)
+{
+  std::vector<iovec> local;
+  std::vector<iovec> remote;
+  local.reserve(detail::kMaxIovecs);
+  remote.reserve(detail::kMaxIovecs);
+
+  while (beg != end)
+  {
+    local.clear();
+    remote.clear();
+    auto batch_end = beg;
+    for (; batch_end != end && local.size() < detail::kMaxIovecs; ++batch_end)
+    {
+      if (batch_end->len)
+      {
+        iovec const local_iov = {batch_end->data, batch_end->len};
+        iovec const remote_iov = {const_cast<void*>(batch_end->address),
+                                  batch_end->len};
+        local.push_back(local_iov);
+        remote.push_back(remote_iov);
+      }
+    }
+
+    ssize_t const n = local.empty()
+                        ? 0
+                        : ::process_vm_readv(process.GetId(),
+                                             local.data(),
+                                             local.size(),
+                                             remote.data(),
+                                             remote.size(),
+                                             0);
+    if (n == -1 && errno != EFAULT)
+    {
+      // process_vm_readv is unavailable, rather than the first range being
+      // unreadable.
+      for (; beg != batch_end; ++beg)
+      {
+        if (beg->len)
+        {
+          detail::ReadMem(process, beg->address, beg->data, beg->len);
+        }
+      }
+      continue;
+    }
+
+    std::size_t remaining = n > 0 ? static_cast<std::size_t>(n) : 0;
+    for (; beg != batch_end; ++beg)
+    {
+      if (remaining < beg->len)
+      {
+        detail::ReadMem(process,
+                        static_cast<std::uint8_t const*>(beg->address) +
+                          remaining,
+                        static_cast<std::uint8_t*>(beg->data) + remaining,
+                        beg->len - remaining);
+        ++beg;
+        break;
+      }
+      remaining -= beg->len;
+    }
+  }
+}
+
+inline void ReadScatter(Process const& process,
+                        std::vector<ReadRequest> const& requests)
+{
+  ReadScatter(process,
+              requests.data(),
+              requests.data() + requests.size());
+}
+}
+}
@@ -0,0 +1,224 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <locale>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+
+namespace hadesmem
+{
+namespace procfs
+{
+class Region;
+
+namespace detail
+{
+std::vector<Region> ReadMaps(Process const& process);
+}
+
+// A mapping from /proc/<pid>/maps. Unlike Windows, unmapped ranges between
+// mappings are not regions.
+class Region
+{
+public:
+  // The mapping containing the address.
+  explicit Region(Process const& process, void const* address);
+
+  void* GetBase() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return reinterpret_cast<void*>(base_);
+  }
+
+  std::size_t GetSize() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return size_;
+  }
+
+  // Combination of PROT_READ, PROT_WRITE and PROT_EXEC.
+  int GetProtect() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return protect_;
+  }
+
+  // Private (copy on write) rather than shared mapping.
+  bool IsPrivate() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return private_;
+  }
+
+  // Offset in the mapped file.
+  std::uint64_t GetOffset() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return offset_;
+  }
+
+  std::uint64_t GetInode() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return inode_;
+  }
+
+  // Path of the mapped file, a pseudo-path such as "[heap]" or "[stack]", or
+  // empty for anonymous mappings.
+  std::string const& GetPath() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return path_;
+  }
+
+private:
+  friend std::vector<Region> detail::ReadMaps(Process const& process);
+
+  Region() HADESMEM_DETAIL_NOEXCEPT
+  {
+  }
+
+  std::uintptr_t base_{};
+  std::size_t size_{};
+  int protect_{};
+  bool private_{};
+  std::uint64_t offset_{};
+  std::uint64_t inode_{};
+  std::string path_;
+};
+
+namespace detail
+{
+// Each line is "start-end perms offset dev inode [path]", e.g.
+// "7f1c2a000000-7f1c2a021000 r-xp 00001000 08:01 1234 /usr/lib/foo.so".
+inline std::vector<Region> ReadMaps(Process const& process)
+{
+  std::string const path =
+    "/proc/" + std::to_string(process.GetId()) + "/maps";
+  std::ifstream maps{path};
+  if (!maps)
+  {
+    int const last_error = errno;
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Failed to open maps."}
+                                    << ErrorCodeErrno{last_error});
+  }
+
+  std::vector<Region> regions;
+  std::string line;
+  while (std::getline(maps, line))
+  {
+    std::istringstream line_str{line};
+    line_str.imbue(std::locale::classic());
+    std::uintptr_t beg = 0;
+    std::uintptr_t end = 0;
+    char dash = 0;
+    std::string perms;
+    std::uint64_t offset = 0;
+    std::string dev;
+    std::uint64_t inode = 0;
+    if (!(line_str >> std::hex >> beg >> dash >> end >> perms >> offset >>
+          dev >> std::dec >> inode) ||
+        dash != '-' || end <= beg || perms.size() != 4)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Invalid maps entry."});
+    }
+
+    Region region;
+    region.base_ = beg;
+    region.size_ = end - beg;
+    region.protect_ = (perms[0] == 'r' ? PROT_READ : 0) |
+                      (perms[1] == 'w' ? PROT_WRITE : 0) |
+                      (perms[2] == 'x' ? PROT_EXEC : 0);
+    region.private_ = perms[3] == 'p';
+    region.offset_ = offset;
+    region.inode_ = inode;
+
+    // The path is the rest of the line, which may contain spaces.
+    std::getline(line_str >> std::ws, region.path_);
+
+    regions.push_back(region);
+  }
+
+  return regions;
+}
+}
+
+inline Region::Region(Process const& process, void const* address)
+{
+  auto const target = reinterpret_cast<std::uintptr_t>(address);
+  for (auto const& region : detail::ReadMaps(process))
+  {
+    if (target >= region.base_ && target - region.base_ < region.size_)
+    {
+      *this = region;
+      return;
+    }
+  }
+
+  HADESMEM_DETAIL_THROW_EXCEPTION(
+    Error{} << ErrorString{"Address is not mapped."}
+            << ErrorCodeOther{target});
+}
+
+inline bool operator==(Region const& lhs,
+                       Region const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetBase() == rhs.GetBase();
+}
+
+inline bool operator!=(Region const& lhs,
+                       Region const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return !(lhs == rhs);
+}
+
+inline bool operator<(Region const& lhs,
+                      Region const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetBase() < rhs.GetBase();
+}
+
+inline bool operator<=(Region const& lhs,
+                       Region const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetBase() <= rhs.GetBase();
+}
+
+inline bool operator>(Region const& lhs,
+                      Region const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetBase() > rhs.GetBase();
+}
+
+inline bool operator>=(Region const& lhs,
+                       Region const& rhs) HADESMEM_DETAIL_NOEXCEPT
+{
+  return lhs.GetBase() >= rhs.GetBase();
+}
+
+inline std::ostream& operator<<(std::ostream& lhs, Region const& rhs)
+{
+  std::locale const old = lhs.imbue(std::locale::classic());
+  lhs << rhs.GetBase();
+  lhs.imbue(old);
+  return lhs;
+}
+
+inline std::wostream& operator<<(std::wostream& lhs, Region const& rhs)
+{
+  std::locale const old = lhs.imbue(std::locale::classic());
+  lhs << rhs.GetBase();
+  lhs.imbue(old);
+  return lhs;
+}
+}
+}
@@ -0,0 +1,60 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <vector>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/region.hpp>
+
+namespace hadesmem
+{
+namespace procfs
+{
+// Snapshot of /proc/<pid>/maps, in address order. The whole file is read at
+// once as the kernel only guarantees a consistent view per read.
+class RegionList
+{
+public:
+  using value_type = Region;
+  using iterator = std::vector<Region>::const_iterator;
+  using const_iterator = std::vector<Region>::const_iterator;
+  using size_type = std::vector<Region>::size_type;
+
+  explicit RegionList(Process const& process)
+    : regions_(detail::ReadMaps(process))
+  {
+  }
+
+  const_iterator begin() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return regions_.begin();
+  }
+
+  const_iterator cbegin() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return regions_.cbegin();
+  }
+
+  const_iterator end() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return regions_.end();
+  }
+
+  const_iterator cend() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return regions_.cend();
+  }
+
+  size_type size() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return regions_.size();
+  }
+
+private:
+  std::vector<Region> regions_;
+};
+}
+}
@@ -0,0 +1,394 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/snapshot_store.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/read.hpp>
+#include <hadesmem/linux/region.hpp>
+#include <hadesmem/linux/region_list.hpp>
+
+// Incremental snapshot of the writable memory of a process. The first capture
+// reads everything, and later ones only reread the pages written since the
+// previous capture, as reported by the soft-dirty bits in
+// /proc/<pid>/pagemap (which are reset through /proc/<pid>/clear_refs). If
+// the kernel does not support soft-dirty tracking (CONFIG_MEM_SOFT_DIRTY), or
+// the files can not be opened, every page is reread and compared against the
+// previous capture instead.
+//
+// Each capture is a generation, and GetChangedSince(N) returns the pages whose
+// contents changed in any capture after generation N. With soft-dirty
+// tracking, a write which lands between reading pagemap and clearing the bits
+// is missed until the page is written again. Stop the process around Capture,
+// or periodically pass full = true, if that matters.
+
+namespace hadesmem
+{
+namespace procfs
+{
+namespace detail
+{
+// Soft-dirty bit of a /proc/<pid>/pagemap entry.
+std::uint64_t const kPagemapSoftDirty = 1ULL << 55;
+
+// Number of pagemap entries read per call.
+std::size_t const kPagemapBatch = 4096;
+
+inline std::size_t GetPageSize()
+{
+  long const page_size = ::sysconf(_SC_PAGESIZE);
+  if (page_size <= 0)
+  {
+    int const last_error = errno;
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{} << ErrorString{"sysconf failed."}
+                                            << ErrorCodeErrno{last_error});
+  }
+
+  return static_cast<std::size_t>(page_size);
+}
+
+inline int OpenProcFile(pid_t id, char const* name, int flags)
+{
+  std::string const path = "/proc/" + std::to_string(id) + "/" + name;
+  return ::open(path.c_str(), flags | O_CLOEXEC);
+}
+
+inline bool ReadPagemap(int fd,
+                        std::uintptr_t address,
+                        std::size_t page_size,
+                        std::uint64_t* entries,
+                        std::size_t count)
+{
+  std::size_t const len = count * sizeof(std::uint64_t);
+  auto const offset =
+    static_cast<off_t>(address / page_size * sizeof(std::uint64_t));
+  return ::pread(fd, entries, len, offset) == static_cast<ssize_t>(len);
+}
+
+// Pages are soft-dirty from the moment they are faulted in, so a page we just
+// touched which is not marked means the kernel does not track the bit.
+inline bool IsSoftDirtySupported(std::size_t page_size)
+{
+  int const fd = OpenProcFile(::getpid(), "pagemap", O_RDONLY);
+  if (fd == -1)
+  {
+    return false;
+  }
+
+  bool supported = false;
+  void* const page = ::mmap(nullptr,
+                            page_size,
+                            PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS,
+                            -1,
+                            0);
+  if (page != MAP_FAILED)
+  {
+    *static_cast<std::uint8_t volatile*>(page) = 1;
+    std::uint64_t entry = 0;
+    supported = ReadPagemap(fd,
+                            reinterpret_cast<std::uintptr_t>(page),
+                            page_size,
+                            &entry,
+                            1) &&
+                (entry & kPagemapSoftDirty);
+    ::munmap(page, page_size);
+  }
+
+  ::close(fd);
+  return supported;
+}
+}
+
+class Snapshot
+{
+public:
+  explicit Snapshot(Process const& process)
+    : process_{&process},
+      store_{detail::GetPageSize()},
+      pagemap_fd_{-1},
+      clear_refs_fd_{-1}
+  {
+    if (detail::IsSoftDirtySupported(store_.GetPageSize()))
+    {
+      pagemap_fd_ =
+        detail::OpenProcFile(process.GetId(), "pagemap", O_RDONLY);
+      clear_refs_fd_ =
+        detail::OpenProcFile(process.GetId(), "clear_refs", O_WRONLY);
+      if (pagemap_fd_ == -1 || clear_refs_fd_ == -1)
+      {
+        CloseUnchecked();
+      }
+    }
+  }
+
+  explicit Snapshot(Process&& process) = delete;
+
+  Snapshot(Snapshot const&) = delete;
+
+  Snapshot& operator=(Snapshot const&) = delete;
+
+  Snapshot(Snapshot&& other) HADESMEM_DETAIL_NOEXCEPT
+    : process_{other.process_},
+      store_{std::move(other.store_)},
+      pagemap_fd_{other.pagemap_fd_},
+      clear_refs_fd_{other.clear_refs_fd_}
+  {
+    other.pagemap_fd_ = -1;
+    other.clear_refs_fd_ = -1;
+  }
+
+  Snapshot& operator=(Snapshot&& other) HADESMEM_DETAIL_NOEXCEPT
+  {
+    CloseUnchecked();
+
+    process_ = other.process_;
+    store_ = std::move(other.store_);
+    pagemap_fd_ = other.pagemap_fd_;
+    clear_refs_fd_ = other.clear_refs_fd_;
+
+    other.pagemap_fd_ = -1;
+    other.clear_refs_fd_ = -1;
+
+    return *this;
+  }
+
+  ~Snapshot()
+  {
+    CloseUnchecked();
+  }
+
+  bool IsDirtyTrackingEnabled() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return pagemap_fd_ != -1;
+  }
+
+  // Captures a new generation and returns its number. Passing full = true
+  // rereads every page even when dirty tracking is enabled.
+  std::uint64_t Capture(bool full = false)
+  {
+    std::vector<std::pair<std::uintptr_t, std::size_t>> extents;
+    for (auto const& region : RegionList{*process_})
+    {
+      if (IsCapturable(region))
+      {
+        extents.emplace_back(
+          reinterpret_cast<std::uintptr_t>(region.GetBase()),
+          region.GetSize());
+      }
+    }
+
+    store_.BeginCapture(extents);
+
+    // Runs of pages to read, as (first page, number of pages), per region.
+    // Pagemap must be read for every region before the bits are cleared.
+    std::vector<std::vector<std::pair<std::size_t, std::size_t>>> runs(
+      store_.GetNumRegions());
+    std::vector<bool> tracked(store_.GetNumRegions());
+    for (std::size_t i = 0; i < store_.GetNumRegions(); ++i)
+    {
+      auto const& region = store_.GetRegion(i);
+      std::size_t const num_pages = region.size / store_.GetPageSize();
+      if (IsDirtyTrackingEnabled() && !full && !region.is_new &&
+          GetDirtyRuns(region.base, num_pages, runs[i]))
+      {
+        tracked[i] = true;
+      }
+      else
+      {
+        runs[i].assign(1, std::make_pair(std::size_t{0}, num_pages));
+      }
+    }
+
+    if (IsDirtyTrackingEnabled())
+    {
+      ClearSoftDirty();
+    }
+
+    // Backwards, so that removing a region does not move those still to be
+    // read.
+    std::vector<std::uint8_t> buffer;
+    std::vector<ReadRequest> requests;
+    std::size_t const page_size = store_.GetPageSize();
+    for (std::size_t i = runs.size(); i--;)
+    {
+      std::size_t num_pages = 0;
+      for (auto const& run : runs[i])
+      {
+        num_pages += run.second;
+      }
+
+      buffer.resize(num_pages * page_size);
+      requests.clear();
+      std::size_t offset = 0;
+      for (auto const& run : runs[i])
+      {
+        ReadRequest const request = {
+          reinterpret_cast<void const*>(store_.GetRegion(i).base +
+                                        run.first * page_size),
+          &buffer[offset],
+          run.second * page_size};
+        requests.push_back(request);
+        offset += request.len;
+      }
+
+      try
+      {
+        ReadScatter(*process_, requests);
+      }
+      catch (Error const&)
+      {
+        // Unmapped or protected since it was enumerated.
+        store_.Remove(i);
+        continue;
+      }
+
+      offset = 0;
+      for (auto const& run : runs[i])
+      {
+        store_.Update(i, run.first, &buffer[offset], run.second);
+        offset += run.second * page_size;
+      }
+
+      if (tracked[i])
+      {
+        store_.MarkTracked(i);
+      }
+    }
+
+    return store_.GetGeneration();
+  }
+
+  std::uint64_t GetGeneration() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return store_.GetGeneration();
+  }
+
+  // Pages whose contents changed in a capture after the given generation.
+  std::vector<SnapshotRange> GetChangedSince(std::uint64_t generation) const
+  {
+    return store_.GetChangedSince(generation);
+  }
+
+  // Captured copy of the given range, or null if it was not captured.
+  void const* GetData(void const* address, std::size_t len) const
+  {
+    return store_.GetData(address, len);
+  }
+
+  // Statistics for the last capture.
+  SnapshotStats GetStats() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return store_.GetStats();
+  }
+
+private:
+  static bool IsCapturable(Region const& region)
+  {
+    int const prot = region.GetProtect();
+    if (!(prot & PROT_READ) || !(prot & PROT_WRITE))
+    {
+      return false;
+    }
+
+    // Special mappings which can not be read through process_vm_readv or
+    // /proc/<pid>/mem.
+    std::string const& path = region.GetPath();
+    return path != "[vvar]" && path != "[vvar_vclock]" &&
+           path != "[vsyscall]";
+  }
+
+  bool GetDirtyRuns(std::uintptr_t base,
+                    std::size_t num_pages,
+                    std::vector<std::pair<std::size_t, std::size_t>>& runs)
+  {
+    std::size_t const page_size = store_.GetPageSize();
+    std::vector<std::uint64_t> entries(
+      num_pages < detail::kPagemapBatch ? num_pages : detail::kPagemapBatch);
+    for (std::size_t first = 0; first < num_pages; first += entries.size())
+    {
+      std::size_t const count = num_pages - first < entries.size()
+                                  ? num_pages - first
+                                  : entries.size();
+      if (!detail::ReadPagemap(pagemap_fd_,
+                               base + first * page_size,
+                               page_size,
+                               entries.data(),
+                               count))
+      {
+        runs.clear();
+        return false;
+      }
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        if (!(entries[i] & detail::kPagemapSoftDirty))
+        {
+          continue;
+        }
+
+        std::size_t const page = first + i;
+        if (!runs.empty() && runs.back().first + runs.back().second == page)
+        {
+          ++runs.back().second;
+        }
+        else
+        {
+          runs.emplace_back(page, 1);
+        }
+      }
+    }
+
+    return true;
+  }
+
+  void ClearSoftDirty()
+  {
+    char const kClearSoftDirty[] = "4";
+    if (::pwrite(clear_refs_fd_, kClearSoftDirty, 1, 0) != 1)
+    {
+      int const last_error = errno;
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Failed to clear soft-dirty bits."}
+                << ErrorCodeErrno{last_error});
+    }
+  }
+
+  void CloseUnchecked() HADESMEM_DETAIL_NOEXCEPT
+  {
+    if (pagemap_fd_ != -1)
+    {
+      ::close(pagemap_fd_);
+      pagemap_fd_ = -1;
+    }
+
+    if (clear_refs_fd_ != -1)
+    {
+      ::close(clear_refs_fd_);
+      clear_refs_fd_ = -1;
+    }
+  }
+
+  Process const* process_;
+  ::hadesmem::detail::SnapshotStore store_;
+  int pagemap_fd_;
+  int clear_refs_fd_;
+};
+}
+}
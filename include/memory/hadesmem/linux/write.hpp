@@ -0,0 +1,99 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/linux/process.hpp>
+
+namespace hadesmem
+{
+namespace procfs
+{
+namespace detail
+{
+inline void WriteMem(Process const& process,
+                     void* address,
+                     void const* data,
+                     std::size_t len)
+{
+  auto const in = static_cast<std::uint8_t const*>(data);
+  auto const offset = reinterpret_cast<std::uintptr_t>(address);
+  std::size_t done = 0;
+  while (done < len)
+  {
+    ssize_t const n = ::pwrite(process.GetMemFd(),
+                               in + done,
+                               len - done,
+                               static_cast<off_t>(offset + done));
+    if (n <= 0)
+    {
+      int const last_error = n ? errno : EIO;
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Could not write process memory."}
+                << ErrorCodeOther{offset + done}
+                << ErrorCodeErrno{last_error});
+    }
+    done += static_cast<std::size_t>(n);
+  }
+}
+}
+
+// process_vm_writev honours page protections, so writes to read-only pages
+// (e.g. code) fail and are retried through /proc/<pid>/mem, which does not.
+// This matches Write on Windows, which changes the protection as required.
+inline void WriteUnchecked(Process const& process,
+                           void* address,
+                           void const* data,
+                           std::size_t len)
+{
+  if (!len)
+  {
+    return;
+  }
+
+  iovec local = {const_cast<void*>(data), len};
+  iovec remote = {address, len};
+  ssize_t const n =
+    ::process_vm_writev(process.GetId(), &local, 1, &remote, 1, 0);
+  std::size_t const done = n > 0 ? static_cast<std::size_t>(n) : 0;
+  if (done != len)
+  {
+    detail::WriteMem(process,
+                     static_cast<std::uint8_t*>(address) + done,
+                     static_cast<std::uint8_t const*>(data) + done,
+                     len - done);
+  }
+}
+
+template <typename T>
+void Write(Process const& process, void* address, T const& data)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
+
+  WriteUnchecked(process, address, &data, sizeof(data));
+}
+
+template <typename T>
+void WriteVector(Process const& process,
+                 void* address,
+                 std::vector<T> const& data)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
+
+  WriteUnchecked(process, address, data.data(), sizeof(T) * data.size());
+}
+}
+}
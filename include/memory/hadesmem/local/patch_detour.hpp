@@ -5,8 +5,11 @@
 
 #include <atomic>
 #include <climits>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <limits>
 #include <map>
 #include <memory>
 #include <sstream>
@@ -23,6 +26,7 @@
 #include <hadesmem/alloc.hpp>
 #include <hadesmem/detail/alias_cast.hpp>
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/instruction_decoder.hpp>
 #include <hadesmem/detail/patch_code_gen.hpp>
 #include <hadesmem/detail/patch_detour_stub.hpp>
 #include <hadesmem/detail/patcher_aux.hpp>
@@ -44,6 +48,28 @@
 
 namespace hadesmem
 {
+struct PatchDetourFlags
+{
+  enum : std::uint32_t
+  {
+    kNone = 0,
+    // Enter the detour through a gate which only clobbers a volatile register
+    // and hands over the stub in a TLS slot, rather than one which saves every
+    // register and swaps ArbitraryUserPointer around a call. Falls back to the
+    // regular gate if the process has run out of inline TLS slots.
+    kFastGate = 1 << 0,
+    kInvalidFlagMaxValue = 1 << 1
+  };
+};
+
+// Binds a detour at compile time, so it is called directly instead of through
+// a std::function. Implies PatchDetourFlags::kFastGate.
+//   PatchDetour<decltype(&Foo)> patch{
+//     process, &Foo, StaticDetour<decltype(&FooDetour), &FooDetour>{}};
+template <typename DetourFuncT, DetourFuncT Detour> struct StaticDetour
+{
+};
+
 template <typename TargetFuncT> class PatchDetour : public PatchDetourBase
 {
 public:
@@ -54,6 +80,8 @@ public:
   using StubT = detail::PatchDetourStub<TargetFuncT>;
   using DetourFuncRawT = typename StubT::DetourFuncRawT;
   using DetourFuncT = typename StubT::DetourFuncT;
+  using DetourFuncPtrT =
+    std::add_pointer_t<std::remove_pointer_t<DetourFuncRawT>>;
 
   HADESMEM_DETAIL_STATIC_ASSERT(detail::IsFunction<TargetFuncT>::value);
   HADESMEM_DETAIL_STATIC_ASSERT(detail::IsFunction<TargetFuncRawT>::value);
@@ -62,18 +90,45 @@ public:
   explicit PatchDetour(Process const& process,
                        TargetFuncRawT target,
                        DetourFuncT const& detour,
-                       void* context = nullptr)
+                       void* context = nullptr,
+                       std::uint32_t flags = PatchDetourFlags::kNone)
     : process_{&process},
       target_{detail::AliasCast<void*>(target)},
       detour_{detour},
       context_{context},
-      stub_{std::make_unique<StubT>(this)}
+      stub_{std::make_unique<StubT>(this)},
+      fast_stub_fn_{(flags & PatchDetourFlags::kFastGate)
+                      ? detail::AliasCast<void*>(&StubT::FastStub)
+                      : nullptr}
+  {
+    HADESMEM_DETAIL_ASSERT(flags < PatchDetourFlags::kInvalidFlagMaxValue);
+  }
+
+  template <DetourFuncPtrT Detour>
+  explicit PatchDetour(Process const& process,
+                       TargetFuncRawT target,
+                       StaticDetour<DetourFuncPtrT, Detour> /*detour*/,
+                       void* context = nullptr)
+    : process_{&process},
+      target_{detail::AliasCast<void*>(target)},
+      context_{context},
+      stub_{std::make_unique<StubT>(this)},
+      fast_stub_fn_{
+        detail::AliasCast<void*>(&StubT::template StaticStub<Detour>)},
+      static_detour_{true}
   {
   }
 
   explicit PatchDetour(Process&& process,
                        TargetFuncRawT target,
                        DetourFuncT const& detour,
+                       void* context = nullptr,
+                       std::uint32_t flags = PatchDetourFlags::kNone) = delete;
+
+  template <DetourFuncPtrT Detour>
+  explicit PatchDetour(Process&& process,
+                       TargetFuncRawT target,
+                       StaticDetour<DetourFuncPtrT, Detour> detour,
                        void* context = nullptr) = delete;
 
   PatchDetour(PatchDetour const& other) = delete;
@@ -89,15 +144,17 @@ public:
       stub_gate_{std::move(other.stub_gate_)},
       orig_(std::move(other.orig_)),
       trampolines_(std::move(other.trampolines_)),
-      ref_count_{other.ref_count_.load()},
       stub_{other.stub_},
-      context_{other.context_}
+      context_{other.context_},
+      fast_stub_fn_{other.fast_stub_fn_},
+      static_detour_{other.static_detour_}
   {
     other.process_ = nullptr;
     other.applied_ = false;
     other.target_ = nullptr;
     other.stub_ = nullptr;
     other.context_ = nullptr;
+    other.fast_stub_fn_ = nullptr;
   }
 
   PatchDetour& operator=(PatchDetour&& other)
@@ -123,14 +180,17 @@ public:
 
     trampolines_ = std::move(other.trampolines_);
 
-    ref_count_ = other.ref_count_.load();
-
     stub_ = other.stub_;
     other.stub_ = nullptr;
 
     context_ = other.context_;
     other.context_ = nullptr;
 
+    fast_stub_fn_ = other.fast_stub_fn_;
+    other.fast_stub_fn_ = nullptr;
+
+    static_detour_ = other.static_detour_;
+
     return *this;
   }
 
@@ -166,7 +226,9 @@ public:
     std::uint32_t const kMaxInstructionLen = 15;
     std::uint32_t const kTrampSize = kMaxInstructionLen * 3;
 
-    trampoline_ = std::make_unique<Allocator>(*process_, kTrampSize);
+    // Allocated near the target (where possible) so that RIP-relative
+    // operands in the relocated instructions can be fixed up.
+    trampoline_ = detail::AllocatePageNear(*process_, target_);
     auto tramp_cur = static_cast<std::uint8_t*>(trampoline_->GetBase());
 
     auto const detour_raw = detour_.target<DetourFuncRawT>();
@@ -189,15 +251,10 @@ public:
     auto const buffer =
       ReadVector<std::uint8_t>(*process_, target_, kTrampSize);
 
-    ud_t ud_obj;
-    ud_init(&ud_obj);
-    ud_set_input_buffer(&ud_obj, buffer.data(), buffer.size());
-    ud_set_syntax(&ud_obj, UD_SYN_INTEL);
-    ud_set_pc(&ud_obj, reinterpret_cast<std::uint64_t>(target_));
 #if defined(HADESMEM_DETAIL_ARCH_X64)
-    ud_set_mode(&ud_obj, 64);
+    bool const is_64 = true;
 #elif defined(HADESMEM_DETAIL_ARCH_X86)
-    ud_set_mode(&ud_obj, 32);
+    bool const is_64 = false;
 #else
 #error "[HadesMem] Unsupported architecture."
 #endif
@@ -209,68 +266,42 @@ public:
     std::uint32_t instr_size = 0;
     do
     {
-      std::uint32_t const len = ud_disassemble(&ud_obj);
-      if (len == 0)
+      detail::InstructionInfo insn;
+      std::uint8_t const* const raw = buffer.data() + instr_size;
+      if (!detail::DecodeInstruction(
+            raw, buffer.size() - instr_size, is_64, insn))
       {
         HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
                                         << ErrorString{"Disassembly failed."});
       }
 
+      std::uint8_t* const insn_base =
+        static_cast<std::uint8_t*>(target_) + instr_size;
+      std::uint8_t* const insn_end = insn_base + insn.len;
+
 #if !defined(HADESMEM_NO_TRACE)
-      char const* const asm_str = ud_insn_asm(&ud_obj);
-      char const* const asm_bytes_str = ud_insn_hex(&ud_obj);
-      HADESMEM_DETAIL_TRACE_FORMAT_A(
-        "%s. [%s].",
-        (asm_str ? asm_str : "Invalid."),
-        (asm_bytes_str ? asm_bytes_str : "Invalid."));
+      TraceInstruction(insn_base, raw, insn.len);
 #endif
 
-      ud_operand_t const* const op = ud_insn_opr(&ud_obj, 0);
-      bool is_jimm = op && op->type == UD_OP_JIMM;
+      bool const is_jimm = insn.type == detail::InstructionType::kJmpRel ||
+                           insn.type == detail::InstructionType::kCallRel;
       // Handle JMP QWORD PTR [RIP+Rel32]. Necessary for hook chain support.
-      bool is_jmem = op && op->type == UD_OP_MEM && op->base == UD_R_RIP &&
-                     op->index == UD_NONE && op->scale == 0 && op->size == 0x40;
-      if ((ud_obj.mnemonic == UD_Ijmp || ud_obj.mnemonic == UD_Icall) && op &&
-          (is_jimm || is_jmem))
+      bool const is_jmem =
+        (insn.type == detail::InstructionType::kJmpIndirect ||
+         insn.type == detail::InstructionType::kCallIndirect) &&
+        insn.rip_relative;
+      if (is_jimm || is_jmem)
       {
-        std::uint16_t const size = is_jimm ? op->size : op->offset;
-        HADESMEM_DETAIL_TRACE_FORMAT_A("Operand/offset size is %hu.", size);
-        std::int64_t const insn_target = [&]() -> std::int64_t
-        {
-          switch (size)
-          {
-          case sizeof(std::int8_t) * CHAR_BIT:
-            return op->lval.sbyte;
-          case sizeof(std::int16_t) * CHAR_BIT:
-            return op->lval.sword;
-          case sizeof(std::int32_t) * CHAR_BIT:
-            return op->lval.sdword;
-          case sizeof(std::int64_t) * CHAR_BIT:
-            return op->lval.sqword;
-          default:
-            HADESMEM_DETAIL_ASSERT(false);
-            HADESMEM_DETAIL_THROW_EXCEPTION(
-              Error{} << ErrorString{"Unknown instruction size."});
-          }
-        }();
-
-        auto const resolve_rel =
-          [](std::uint64_t base, std::int64_t target, std::uint32_t insn_len)
-        {
-          return reinterpret_cast<std::uint8_t*>(
-                   static_cast<std::uintptr_t>(base)) +
-                 target + insn_len;
-        };
-
-        std::uint64_t const insn_base = ud_insn_off(&ud_obj);
-        std::uint32_t const insn_len = ud_insn_len(&ud_obj);
+        HADESMEM_DETAIL_TRACE_FORMAT_A(
+          "Operand/offset size is %u.",
+          is_jimm ? insn.rel_size * CHAR_BIT : 32U);
 
-        auto const resolved_target =
-          resolve_rel(insn_base, insn_target, insn_len);
         void* const jump_target =
-          is_jimm ? resolved_target : Read<void*>(*process_, resolved_target);
+          is_jimm ? insn_end + static_cast<std::ptrdiff_t>(insn.rel)
+                  : Read<void*>(*process_, insn_end + insn.disp);
         HADESMEM_DETAIL_TRACE_FORMAT_A("Jump/call target = %p.", jump_target);
-        if (ud_obj.mnemonic == UD_Ijmp)
+        if (insn.type == detail::InstructionType::kJmpRel ||
+            insn.type == detail::InstructionType::kJmpIndirect)
         {
           HADESMEM_DETAIL_TRACE_A("Writing resolved jump.");
           tramp_cur += detail::WriteJump(
@@ -278,20 +309,40 @@ public:
         }
         else
         {
-          HADESMEM_DETAIL_ASSERT(ud_obj.mnemonic == UD_Icall);
           HADESMEM_DETAIL_TRACE_A("Writing resolved call.");
           tramp_cur +=
             detail::WriteCall(*process_, tramp_cur, jump_target, trampolines_);
         }
       }
+      else if (insn.type == detail::InstructionType::kJccRel ||
+               insn.type == detail::InstructionType::kLoopRel)
+      {
+        std::uint8_t* const jump_target =
+          insn_end + static_cast<std::ptrdiff_t>(insn.rel);
+        HADESMEM_DETAIL_TRACE_FORMAT_A("Jump target = %p.", jump_target);
+        if (jump_target >= target_ &&
+            jump_target < static_cast<std::uint8_t*>(target_) + patch_size)
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error{} << ErrorString{"Conditional jump into patched region."});
+        }
+
+        HADESMEM_DETAIL_TRACE_A("Writing resolved conditional jump.");
+        tramp_cur += WriteConditionalJump(insn, tramp_cur, jump_target);
+      }
+      else if (insn.rip_relative)
+      {
+        HADESMEM_DETAIL_TRACE_A("Writing relocated RIP-relative instruction.");
+        WriteRipRelative(insn, raw, tramp_cur, insn_end + insn.disp);
+        tramp_cur += insn.len;
+      }
       else
       {
-        std::uint8_t const* const raw = ud_insn_ptr(&ud_obj);
-        Write(*process_, tramp_cur, raw, raw + len);
-        tramp_cur += len;
+        Write(*process_, tramp_cur, raw, raw + insn.len);
+        tramp_cur += insn.len;
       }
 
-      instr_size += len;
+      instr_size += insn.len;
     } while (instr_size < patch_size);
 
     HADESMEM_DETAIL_TRACE_A("Writing jump back to original code.");
@@ -306,14 +357,28 @@ public:
     FlushInstructionCache(
       *process_, trampoline_->GetBase(), trampoline_->GetSize());
 
-    detail::WriteStubGate<TargetFuncT>(*process_,
-                                       stub_gate_->GetBase(),
-                                       &*stub_,
-                                       &GetOriginalArbitraryUserPtrPtr);
+    if (!fast_stub_fn_ ||
+        !detail::WriteFastStubGate(
+          *process_, stub_gate_->GetBase(), &*stub_, fast_stub_fn_))
+    {
+      // A statically bound detour can only be reached through the fast gate.
+      if (static_detour_)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Fast stub gate unavailable."});
+      }
+
+      detail::WriteStubGate<TargetFuncT>(*process_,
+                                         stub_gate_->GetBase(),
+                                         &*stub_,
+                                         &GetOriginalArbitraryUserPtrPtr);
+    }
 
     orig_ = ReadVector<std::uint8_t>(*process_, target_, patch_size);
 
-    detail::VerifyPatchThreads(process_->GetId(), target_, orig_.size());
+    detail::VerifyPatchThreads(suspended_process, target_, orig_.size());
+
+    SetProfileTarget(target_);
 
     WritePatch();
 
@@ -331,9 +396,9 @@ public:
 
     SuspendedProcess const suspended_process{process_->GetId()};
 
-    detail::VerifyPatchThreads(process_->GetId(), target_, orig_.size());
+    detail::VerifyPatchThreads(suspended_process, target_, orig_.size());
     detail::VerifyPatchThreads(
-      process_->GetId(), trampoline_->GetBase(), trampoline_->GetSize());
+      suspended_process, trampoline_->GetBase(), trampoline_->GetSize());
 
     RemovePatch();
 
@@ -360,12 +425,12 @@ public:
     return trampoline_->GetBase();
   }
 
-  virtual std::atomic<std::uint32_t>& GetRefCount() override
+  virtual detail::ShardedRefCount& GetRefCount() override
   {
     return ref_count_;
   }
 
-  virtual std::atomic<std::uint32_t> const& GetRefCount() const override
+  virtual detail::ShardedRefCount const& GetRefCount() const override
   {
     return ref_count_;
   }
@@ -414,6 +479,94 @@ protected:
     return true;
   }
 
+#if !defined(HADESMEM_NO_TRACE)
+  static void TraceInstruction(void* address,
+                               std::uint8_t const* raw,
+                               std::size_t len)
+  {
+    ud_t ud_obj;
+    ud_init(&ud_obj);
+    ud_set_input_buffer(&ud_obj, raw, len);
+    ud_set_syntax(&ud_obj, UD_SYN_INTEL);
+    ud_set_pc(&ud_obj, reinterpret_cast<std::uint64_t>(address));
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+    ud_set_mode(&ud_obj, 64);
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+    ud_set_mode(&ud_obj, 32);
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+
+    bool const valid = ud_disassemble(&ud_obj) != 0;
+    char const* const asm_str = valid ? ud_insn_asm(&ud_obj) : nullptr;
+    char const* const asm_bytes_str = valid ? ud_insn_hex(&ud_obj) : nullptr;
+    HADESMEM_DETAIL_TRACE_FORMAT_A(
+      "%s. [%s].",
+      (asm_str ? asm_str : "Invalid."),
+      (asm_bytes_str ? asm_bytes_str : "Invalid."));
+  }
+#endif
+
+  // Jcc/LOOP/JCXZ only come in short (or 32-bit relative) forms, so the
+  // relocated version branches over an absolute jump to the original target:
+  //   Jcc taken
+  //   JMP not_taken
+  // taken:
+  //   JMP target
+  // not_taken:
+  std::size_t WriteConditionalJump(detail::InstructionInfo const& insn,
+                                   std::uint8_t* address,
+                                   void* target)
+  {
+    std::vector<std::uint8_t> buf;
+    if (insn.type == detail::InstructionType::kJccRel)
+    {
+      buf.push_back(static_cast<std::uint8_t>(0x70 | (insn.opcode & 0x0F)));
+    }
+    else
+    {
+      HADESMEM_DETAIL_ASSERT(insn.type == detail::InstructionType::kLoopRel);
+      if (insn.addr_size_prefix)
+      {
+        buf.push_back(0x67);
+      }
+      buf.push_back(insn.opcode);
+    }
+    buf.push_back(0x02);
+    buf.push_back(0xEB);
+    buf.push_back(0x00);
+    WriteVector(*process_, address, buf);
+
+    std::size_t const jump_size = detail::WriteJump(
+      *process_, address + buf.size(), target, true, &trampolines_);
+    HADESMEM_DETAIL_ASSERT(jump_size < 0x80);
+    Write(*process_,
+          address + buf.size() - 1,
+          static_cast<std::uint8_t>(jump_size));
+
+    return buf.size() + jump_size;
+  }
+
+  void WriteRipRelative(detail::InstructionInfo const& insn,
+                        std::uint8_t const* raw,
+                        std::uint8_t* address,
+                        void* target)
+  {
+    std::int64_t const disp = static_cast<std::uint8_t*>(target) -
+                              (address + insn.len);
+    if (disp < (std::numeric_limits<std::int32_t>::min)() ||
+        disp > (std::numeric_limits<std::int32_t>::max)())
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Unable to relocate RIP-relative operand."});
+    }
+
+    std::vector<std::uint8_t> buf(raw, raw + insn.len);
+    auto const disp_32 = static_cast<std::int32_t>(disp);
+    std::memcpy(&buf[insn.disp_offset], &disp_32, sizeof(disp_32));
+    WriteVector(*process_, address, buf);
+  }
+
   void RemoveUnchecked() HADESMEM_DETAIL_NOEXCEPT
   {
     try
@@ -448,8 +601,10 @@ protected:
   std::unique_ptr<Allocator> stub_gate_{};
   std::vector<BYTE> orig_{};
   std::vector<std::unique_ptr<Allocator>> trampolines_{};
-  std::atomic<std::uint32_t> ref_count_{};
+  detail::ShardedRefCount ref_count_;
   std::unique_ptr<StubT> stub_{};
   void* context_{nullptr};
+  void* fast_stub_fn_{nullptr};
+  bool static_detour_{false};
 };
 }
@@ -10,6 +10,8 @@
 #include <hadesmem/alloc.hpp>
 #include <hadesmem/detail/alias_cast.hpp>
 #include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/hook_profile.hpp>
+#include <hadesmem/detail/sharded_ref_count.hpp>
 #include <hadesmem/detail/thread_aux.hpp>
 #include <hadesmem/detail/type_traits.hpp>
 #include <hadesmem/error.hpp>
@@ -30,9 +32,9 @@ public:
 
   virtual void* GetTrampoline() const HADESMEM_DETAIL_NOEXCEPT = 0;
 
-  virtual std::atomic<std::uint32_t>& GetRefCount() = 0;
+  virtual detail::ShardedRefCount& GetRefCount() = 0;
 
-  virtual std::atomic<std::uint32_t> const& GetRefCount() const = 0;
+  virtual detail::ShardedRefCount const& GetRefCount() const = 0;
 
   virtual bool CanHookChain() const HADESMEM_DETAIL_NOEXCEPT = 0;
 
@@ -45,6 +47,14 @@ public:
     return *GetOriginalArbitraryUserPtrPtr();
   }
 
+  // Waits for calls to the detour which are in flight to complete, e.g. after
+  // Remove or Detach and before unloading the module containing the detour.
+  // Returns false on timeout.
+  bool WaitForQuiescence(DWORD timeout = INFINITE) const
+  {
+    return GetRefCount().WaitForQuiescence(timeout);
+  }
+
   template <typename FuncT>
   FuncT GetTrampolineT() const HADESMEM_DETAIL_NOEXCEPT
   {
@@ -53,11 +63,33 @@ public:
     return detail::AliasCastUnchecked<FuncT>(GetTrampoline());
   }
 
+#if defined(HADESMEM_HOOK_PROFILE)
+  std::uint32_t GetProfileSlot() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return profile_slot_;
+  }
+#endif
+
 protected:
   static void** GetOriginalArbitraryUserPtrPtr() HADESMEM_DETAIL_NOEXCEPT
   {
     static __declspec(thread) void* orig_user_ptr = 0;
     return &orig_user_ptr;
   }
+
+  // Called on Apply. Hooks on the same target share a profile slot.
+  void SetProfileTarget(void const* target) HADESMEM_DETAIL_NOEXCEPT
+  {
+#if defined(HADESMEM_HOOK_PROFILE)
+    profile_slot_ = detail::GetHookProfileSlot(target);
+#else
+    (void)target;
+#endif
+  }
+
+#if defined(HADESMEM_HOOK_PROFILE)
+private:
+  std::uint32_t profile_slot_{detail::kInvalidHookProfileSlot};
+#endif
 };
 }
@@ -0,0 +1,358 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/patch_detour_stub.hpp>
+#include <hadesmem/detail/srw_lock.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/local/patch_detour.hpp>
+#include <hadesmem/local/patch_detour_base.hpp>
+#include <hadesmem/process.hpp>
+
+namespace hadesmem
+{
+namespace detail
+{
+template <typename TargetFuncT, typename DetourFuncT> class PatchDispatcherImpl;
+
+template <typename TargetFuncT, typename R, typename... Args>
+class PatchDispatcherImpl<TargetFuncT,
+                          std::function<R(PatchDetourBase*, Args...)>>
+{
+public:
+  using DetourT = PatchDetour<TargetFuncT>;
+  using TargetFuncRawT = typename DetourT::TargetFuncRawT;
+
+  HADESMEM_DETAIL_STATIC_ASSERT(
+    !std::is_member_function_pointer<TargetFuncT>::value);
+
+  struct HandlerEntry;
+
+  using HandlerArray = std::vector<HandlerEntry>;
+
+  // Calls the next handler in the chain, or the original function after the
+  // last handler. Only valid for the duration of the call it was passed to.
+  class Next
+  {
+  public:
+    explicit Next(HandlerArray const* handlers,
+                  std::size_t index,
+                  TargetFuncRawT orig) HADESMEM_DETAIL_NOEXCEPT
+      : handlers_{handlers},
+        index_{index},
+        orig_{orig}
+    {
+    }
+
+    R operator()(Args... args) const
+    {
+      if (index_ == handlers_->size())
+      {
+        return orig_(std::forward<Args>(args)...);
+      }
+
+      Next const next{handlers_, index_ + 1, orig_};
+      return (*handlers_)[index_].handler(next, std::forward<Args>(args)...);
+    }
+
+    TargetFuncRawT GetOriginal() const HADESMEM_DETAIL_NOEXCEPT
+    {
+      return orig_;
+    }
+
+  private:
+    HandlerArray const* handlers_;
+    std::size_t index_;
+    TargetFuncRawT orig_;
+  };
+
+  using HandlerFuncT = std::function<R(Next const&, Args...)>;
+
+  struct HandlerEntry
+  {
+    std::size_t id;
+    std::int32_t priority;
+    HandlerFuncT handler;
+  };
+
+  explicit PatchDispatcherImpl(Process const& process, TargetFuncRawT target)
+    : srw_lock_(SRWLOCK_INIT),
+      handlers_{new HandlerArray{}},
+      detour_{std::make_unique<DetourT>(process,
+                                        target,
+                                        DispatchFn{this},
+                                        nullptr,
+                                        PatchDetourFlags::kFastGate)}
+  {
+  }
+
+  explicit PatchDispatcherImpl(Process&& process,
+                               TargetFuncRawT target) = delete;
+
+  PatchDispatcherImpl(PatchDispatcherImpl const& other) = delete;
+
+  PatchDispatcherImpl& operator=(PatchDispatcherImpl const& other) = delete;
+
+  // The underlying detour must be removed and quiescent (or detached) before
+  // the dispatcher is destroyed, exactly as for PatchDetour.
+  ~PatchDispatcherImpl()
+  {
+    detour_ = nullptr;
+    retired_.clear();
+    delete handlers_.load();
+  }
+
+  void Apply()
+  {
+    detour_->Apply();
+  }
+
+  // Frees the retired handler arrays if no calls are in flight. Otherwise
+  // they're left to FreeRetired or the destructor, as calls may be blocked
+  // inside the target indefinitely.
+  void Remove()
+  {
+    detour_->Remove();
+
+    FreeRetired(0);
+  }
+
+  void Detach() HADESMEM_DETAIL_NOEXCEPT
+  {
+    detour_->Detach();
+  }
+
+  bool IsApplied() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return detour_->IsApplied();
+  }
+
+  bool WaitForQuiescence(DWORD timeout = INFINITE) const
+  {
+    return detour_->WaitForQuiescence(timeout);
+  }
+
+  // Handlers run in descending order of priority, with handlers of equal
+  // priority running in the order they were registered. Can be called while
+  // the patch is applied and the target is being called; calls already in
+  // flight see the old set of handlers.
+  std::size_t Register(HandlerFuncT const& handler, std::int32_t priority = 0)
+  {
+    std::size_t id = 0;
+    std::size_t num_retired = 0;
+    {
+      AcquireSRWLock const lock{&srw_lock_, SRWLockType::Exclusive};
+
+      id = next_id_++;
+      HandlerArray const* const cur = handlers_.load();
+      auto new_handlers = std::make_unique<HandlerArray>(*cur);
+      auto const iter = std::find_if(std::begin(*new_handlers),
+                                     std::end(*new_handlers),
+                                     [&](HandlerEntry const& entry)
+                                     {
+                                       return entry.priority < priority;
+                                     });
+      new_handlers->insert(iter, HandlerEntry{id, priority, handler});
+      num_retired = Publish(std::move(new_handlers));
+    }
+
+    ReclaimIfFull(num_retired);
+
+    return id;
+  }
+
+  void Unregister(std::size_t id)
+  {
+    std::size_t num_retired = 0;
+    {
+      AcquireSRWLock const lock{&srw_lock_, SRWLockType::Exclusive};
+
+      HandlerArray const* const cur = handlers_.load();
+      auto new_handlers = std::make_unique<HandlerArray>(*cur);
+      auto const iter = std::find_if(std::begin(*new_handlers),
+                                     std::end(*new_handlers),
+                                     [&](HandlerEntry const& entry)
+                                     {
+                                       return entry.id == id;
+                                     });
+      if (iter == std::end(*new_handlers))
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                        << ErrorString{"Invalid handler ID."});
+      }
+
+      new_handlers->erase(iter);
+      num_retired = Publish(std::move(new_handlers));
+    }
+
+    ReclaimIfFull(num_retired);
+  }
+
+  std::size_t GetNumHandlers() const
+  {
+    AcquireSRWLock const lock{&srw_lock_, SRWLockType::Shared};
+    return handlers_.load()->size();
+  }
+
+  // Handler arrays which have been replaced but may still be in use by calls
+  // in flight. Freed by the next Register/Unregister (or Remove) which sees
+  // no calls in flight, by FreeRetired, or on destruction.
+  std::size_t GetNumRetired() const
+  {
+    AcquireSRWLock const lock{&srw_lock_, SRWLockType::Shared};
+    return retired_.size();
+  }
+
+  // Waits (up to the timeout) for the calls in flight to drain and frees the
+  // handler arrays retired before the call. Returns false on timeout, in
+  // which case nothing is freed. The lock isn't held while waiting, so calls
+  // in flight (and other threads) can still use the dispatcher. Calling this
+  // from a handler with a timeout of INFINITE never returns.
+  bool FreeRetired(DWORD timeout = INFINITE)
+  {
+    std::size_t end_seq = 0;
+    {
+      AcquireSRWLock const lock{&srw_lock_, SRWLockType::Shared};
+      if (retired_.empty())
+      {
+        return true;
+      }
+
+      end_seq = freed_seq_ + retired_.size();
+    }
+
+    // Every array up to end_seq was retired before we started waiting, so no
+    // call which begins after this point can load one of them.
+    if (!detour_->WaitForQuiescence(timeout))
+    {
+      return false;
+    }
+
+    AcquireSRWLock const lock{&srw_lock_, SRWLockType::Exclusive};
+    FreeRetiredBefore(end_seq);
+    return true;
+  }
+
+  DetourT& GetDetour() HADESMEM_DETAIL_NOEXCEPT
+  {
+    return *detour_;
+  }
+
+  DetourT const& GetDetour() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return *detour_;
+  }
+
+private:
+  struct DispatchFn
+  {
+    R operator()(PatchDetourBase* patch, Args... args) const
+    {
+      return dispatcher->Dispatch(patch, std::forward<Args>(args)...);
+    }
+
+    PatchDispatcherImpl* dispatcher;
+  };
+
+  // The stub takes a reference on the detour before we get here and drops it
+  // after we return, so any call which loaded a handler array is counted.
+  R Dispatch(PatchDetourBase* patch, Args... args)
+  {
+    Next const next{handlers_.load(),
+                    0,
+                    patch->GetTrampolineT<TargetFuncRawT>()};
+    return next(std::forward<Args>(args)...);
+  }
+
+  // Handler arrays are never modified once published, so readers need no
+  // lock. The old array is retired rather than freed, as calls which loaded
+  // it before the swap may still be using it. Once the detour's reference
+  // count is observed to be zero after the swap, no call can still hold any
+  // retired array. Caller must hold the lock exclusively. Returns the number
+  // of arrays still retired.
+  std::size_t Publish(std::unique_ptr<HandlerArray> new_handlers)
+  {
+    retired_.reserve(retired_.size() + 1);
+    retired_.emplace_back(handlers_.exchange(new_handlers.release()));
+
+    if (!detour_->GetRefCount().GetCount())
+    {
+      FreeRetiredBefore(freed_seq_ + retired_.size());
+    }
+
+    return retired_.size();
+  }
+
+  // A busy target may never be seen idle by the check in Publish, so once
+  // kMaxRetired arrays are pending we also wait a little for the calls in
+  // flight to drain. The wait is bounded (and done without the lock), as a
+  // call may be blocked inside the target indefinitely, or be the caller.
+  void ReclaimIfFull(std::size_t num_retired)
+  {
+    if (num_retired >= kMaxRetired)
+    {
+      FreeRetired(kReclaimTimeout);
+    }
+  }
+
+  // Retired arrays are numbered in order of retirement, with retired_[0]
+  // being number freed_seq_. Frees those numbered below end_seq which are
+  // still retired. Caller must hold the lock exclusively.
+  void FreeRetiredBefore(std::size_t end_seq) HADESMEM_DETAIL_NOEXCEPT
+  {
+    if (end_seq <= freed_seq_)
+    {
+      return;
+    }
+
+    std::size_t const num_freed =
+      (std::min)(end_seq - freed_seq_, retired_.size());
+    retired_.erase(std::begin(retired_),
+                   std::begin(retired_) +
+                     static_cast<std::ptrdiff_t>(num_freed));
+    freed_seq_ += num_freed;
+  }
+
+  static std::size_t const kMaxRetired = 16;
+  static DWORD const kReclaimTimeout = 10;
+
+  mutable SRWLOCK srw_lock_;
+  std::size_t next_id_{};
+  std::size_t freed_seq_{};
+  std::atomic<HandlerArray const*> handlers_;
+  std::vector<std::unique_ptr<HandlerArray const>> retired_;
+  std::unique_ptr<DetourT> detour_;
+};
+}
+
+// Owns a single detour on a target and dispatches calls to any number of
+// handlers, each of which chooses whether (and how) to call the next one. This
+// avoids stacking a separate detour (stub gate, trampoline and reference
+// count) per hook when several hooks share a target, and registering or
+// unregistering a handler doesn't touch the patched code.
+//   PatchDispatcher<decltype(&Foo)> dispatcher{process, &Foo};
+//   dispatcher.Register([](PatchDispatcher<decltype(&Foo)>::Next const& next,
+//                          int a) { return next(a + 1); });
+//   dispatcher.Apply();
+// Only non-member functions are supported.
+template <typename TargetFuncT>
+using PatchDispatcher = detail::PatchDispatcherImpl<
+  TargetFuncT,
+  typename detail::PatchDetourStub<TargetFuncT>::DetourFuncT>;
+}
@@ -64,7 +64,6 @@ public:
       detour_{std::move(other.detour_)},
       stub_gate_{std::move(other.stub_gate_)},
       orig_(other.orig_),
-      ref_count_{other.ref_count_.load()},
       stub_{other.stub_},
       context_{other.context_}
   {
@@ -96,8 +95,6 @@ public:
     orig_ = other.orig_;
     other.orig_ = nullptr;
 
-    ref_count_ = other.ref_count_.load();
-
     stub_ = other.stub_;
     other.stub_ = nullptr;
 
@@ -147,6 +144,8 @@ public:
 
     orig_ = Read<void*>(*process_, target_);
 
+    SetProfileTarget(target_);
+
     WritePatch();
 
     applied_ = true;
@@ -184,12 +183,12 @@ public:
     return orig_;
   }
 
-  virtual std::atomic<std::uint32_t>& GetRefCount() override
+  virtual detail::ShardedRefCount& GetRefCount() override
   {
     return ref_count_;
   }
 
-  virtual std::atomic<std::uint32_t> const& GetRefCount() const override
+  virtual detail::ShardedRefCount const& GetRefCount() const override
   {
     return ref_count_;
   }
@@ -264,7 +263,7 @@ private:
   DetourFuncT detour_{};
   std::unique_ptr<Allocator> stub_gate_{};
   void* orig_{};
-  std::atomic<std::uint32_t> ref_count_{};
+  detail::ShardedRefCount ref_count_;
   std::unique_ptr<StubT> stub_{};
   void* context_{nullptr};
 };
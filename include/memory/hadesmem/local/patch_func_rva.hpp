@@ -64,7 +64,6 @@ public:
       detour_{std::move(other.detour_)},
       stub_gate_{std::move(other.stub_gate_)},
       orig_(other.orig_),
-      ref_count_{other.ref_count_.load()},
       stub_{other.stub_},
       context_{other.context_}
   {
@@ -100,8 +99,6 @@ public:
     orig_ = other.orig_;
     other.orig_ = 0;
 
-    ref_count_ = other.ref_count_.load();
-
     stub_ = other.stub_;
     other.stub_ = nullptr;
 
@@ -151,6 +148,8 @@ public:
 
     orig_ = Read<DWORD>(*process_, target_);
 
+    SetProfileTarget(target_);
+
     WritePatch();
 
     applied_ = true;
@@ -188,12 +187,12 @@ public:
     return static_cast<std::uint8_t*>(base_) + orig_;
   }
 
-  virtual std::atomic<std::uint32_t>& GetRefCount() override
+  virtual detail::ShardedRefCount& GetRefCount() override
   {
     return ref_count_;
   }
 
-  virtual std::atomic<std::uint32_t> const& GetRefCount() const override
+  virtual detail::ShardedRefCount const& GetRefCount() const override
   {
     return ref_count_;
   }
@@ -275,7 +274,7 @@ private:
   DetourFuncT detour_{};
   std::unique_ptr<Allocator> stub_gate_{};
   DWORD orig_{};
-  std::atomic<std::uint32_t> ref_count_{};
+  detail::ShardedRefCount ref_count_;
   std::unique_ptr<StubT> stub_{};
   void* context_{nullptr};
 };
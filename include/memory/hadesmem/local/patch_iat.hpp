@@ -185,7 +185,8 @@ private:
       HADESMEM_DETAIL_TRACE_FORMAT_A(
         "Got import thunk at [%p] with value [%p].",
         it->GetFunctionPtr(),
-        reinterpret_cast<void const*>(it->GetFunction()));
+        reinterpret_cast<void const*>(
+          static_cast<std::uintptr_t>(it->GetFunction())));
 
       auto& iat_hook = iat_hooks_[pe_file.GetBase()];
       HADESMEM_DETAIL_ASSERT(!iat_hook);
@@ -0,0 +1,411 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/fast_hash.hpp>
+#include <hadesmem/detail/patch_detour_stub.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/detail/to_upper_ordinal.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/local/patch_detour_base.hpp>
+#include <hadesmem/local/patch_func_ptr.hpp>
+#include <hadesmem/local/patch_func_rva.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/module_list.hpp>
+#include <hadesmem/pelib/export.hpp>
+#include <hadesmem/pelib/export_list.hpp>
+#include <hadesmem/pelib/import_dir.hpp>
+#include <hadesmem/pelib/import_dir_list.hpp>
+#include <hadesmem/pelib/import_thunk.hpp>
+#include <hadesmem/pelib/import_thunk_list.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/thread_helpers.hpp>
+
+namespace hadesmem
+{
+// Equivalent to a PatchIat for each entry added, but every module's export
+// and import tables are walked once in total (rather than once per entry),
+// matching names against a hash table keyed by (module, function), and all
+// patches are applied or removed together under a single suspension of the
+// process. If the export is forwarded only the import thunks are patched, as
+// the export table entry holds the forwarder string rather than code; to also
+// catch calls resolved through the forwarder (e.g. by GetProcAddress), add an
+// entry for the module and function it forwards to.
+class PatchIatSet
+{
+public:
+  explicit PatchIatSet(Process const& process) : process_{&process}
+  {
+  }
+
+  explicit PatchIatSet(Process&& process) = delete;
+
+  PatchIatSet(PatchIatSet const& other) = delete;
+
+  PatchIatSet& operator=(PatchIatSet const& other) = delete;
+
+  ~PatchIatSet()
+  {
+    RemoveUnchecked();
+  }
+
+  // Entries must be added before the first call to Apply. Returns the index of
+  // the entry.
+  template <typename TargetFuncT>
+  std::size_t
+    Add(std::wstring const& module,
+        std::string const& function,
+        typename detail::PatchDetourStub<TargetFuncT>::DetourFuncT const&
+          detour,
+        void* context = nullptr)
+  {
+    using TargetFuncRawT = typename PatchFuncPtr<TargetFuncT>::TargetFuncRawT;
+
+    HADESMEM_DETAIL_ASSERT(!hooked_);
+
+    Entry entry;
+    entry.module = detail::ToUpperOrdinal(module);
+    entry.function = function;
+    entry.make_eat_hook = [detour, context](
+      Process const& process, void* base, DWORD* rva_ptr)
+    {
+      return std::unique_ptr<PatchDetourBase>(
+        std::make_unique<PatchFuncRva<TargetFuncT>>(
+          process, base, rva_ptr, detour, context));
+    };
+    entry.make_iat_hook =
+      [detour, context](Process const& process, void* func_ptr)
+    {
+      return std::unique_ptr<PatchDetourBase>(
+        std::make_unique<PatchFuncPtr<TargetFuncT>>(
+          process,
+          static_cast<TargetFuncRawT*>(func_ptr),
+          detour,
+          context));
+    };
+
+    std::uint64_t const module_hash = GetModuleHash(entry.module);
+    std::uint64_t const function_hash = GetFunctionHash(entry.function);
+    std::size_t const index = entries_.size();
+    entries_.emplace_back(std::move(entry));
+    lookup_[Key{module_hash, function_hash}].push_back(index);
+    module_hashes_.insert(module_hash);
+
+    return index;
+  }
+
+  void Apply()
+  {
+    if (!hooked_)
+    {
+      HookModules();
+      hooked_ = true;
+    }
+
+    if (!HasPatches())
+    {
+      return;
+    }
+
+    SuspendedProcess const suspended_process{process_->GetId()};
+
+    for (auto& entry : entries_)
+    {
+      if (entry.eat_hook)
+      {
+        entry.eat_hook->Apply();
+      }
+
+      for (auto& iat_hook : entry.iat_hooks)
+      {
+        iat_hook.second->Apply();
+      }
+    }
+
+    applied_ = true;
+  }
+
+  // Doesn't suspend the process (including on destruction) unless there's
+  // something to remove.
+  void Remove()
+  {
+    if (!applied_)
+    {
+      return;
+    }
+
+    SuspendedProcess const suspended_process{process_->GetId()};
+
+    for (auto& entry : entries_)
+    {
+      if (entry.eat_hook)
+      {
+        entry.eat_hook->Remove();
+      }
+
+      for (auto& iat_hook : entry.iat_hooks)
+      {
+        iat_hook.second->Remove();
+      }
+    }
+
+    applied_ = false;
+  }
+
+  std::size_t GetNumEntries() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return entries_.size();
+  }
+
+  // Number of patches (import thunks plus the export, if found) created for
+  // the given entry. Only valid after Apply.
+  std::size_t GetNumPatches(std::size_t index) const HADESMEM_DETAIL_NOEXCEPT
+  {
+    HADESMEM_DETAIL_ASSERT(index < entries_.size());
+    auto const& entry = entries_[index];
+    return entry.iat_hooks.size() + (entry.eat_hook ? 1 : 0);
+  }
+
+private:
+  struct Key
+  {
+    std::uint64_t module_hash;
+    std::uint64_t function_hash;
+
+    bool operator==(Key const& other) const HADESMEM_DETAIL_NOEXCEPT
+    {
+      return module_hash == other.module_hash &&
+             function_hash == other.function_hash;
+    }
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(Key const& key) const HADESMEM_DETAIL_NOEXCEPT
+    {
+      return static_cast<std::size_t>(
+        key.module_hash ^ (key.function_hash * 0x9E3779B97F4A7C15ULL));
+    }
+  };
+
+  struct Entry
+  {
+    std::wstring module;
+    std::string function;
+    std::function<std::unique_ptr<PatchDetourBase>(
+      Process const& process, void* base, DWORD* rva_ptr)> make_eat_hook;
+    std::function<std::unique_ptr<PatchDetourBase>(Process const& process,
+                                                   void* func_ptr)>
+      make_iat_hook;
+    std::unique_ptr<PatchDetourBase> eat_hook;
+    std::map<void*, std::unique_ptr<PatchDetourBase>> iat_hooks;
+  };
+
+  static std::uint64_t GetModuleHash(std::wstring const& module)
+  {
+    return detail::GetFastHash(module.c_str(),
+                               module.size() * sizeof(wchar_t));
+  }
+
+  static std::uint64_t GetFunctionHash(std::string const& function)
+  {
+    return detail::GetFastHash(function.c_str(), function.size());
+  }
+
+  // Import names are almost always plain ASCII, so avoid the cost of a full
+  // conversion (and CharUpperBuff) unless necessary.
+  static void ToUpperModuleName(std::string const& name, std::wstring& upper)
+  {
+    upper.resize(name.size());
+    for (std::size_t i = 0; i < name.size(); ++i)
+    {
+      auto const c = static_cast<unsigned char>(name[i]);
+      if (c & 0x80)
+      {
+        upper = detail::ToUpperOrdinal(detail::MultiByteToWideChar(name));
+        return;
+      }
+
+      upper[i] = static_cast<wchar_t>((c >= 'a' && c <= 'z') ? c - 'a' + 'A'
+                                                             : c);
+    }
+  }
+
+  template <typename Func>
+  void ForEachMatch(std::uint64_t module_hash,
+                    std::wstring const& module,
+                    std::string const& function,
+                    Func func)
+  {
+    auto const iter =
+      lookup_.find(Key{module_hash, GetFunctionHash(function)});
+    if (iter == std::end(lookup_))
+    {
+      return;
+    }
+
+    for (auto const index : iter->second)
+    {
+      auto& entry = entries_[index];
+      if (entry.module == module && entry.function == function)
+      {
+        func(entry);
+      }
+    }
+  }
+
+  void HookModules()
+  {
+    std::wstring import_module;
+    ModuleList const modules{*process_};
+    for (auto const& m : modules)
+    {
+      PeFile const pe_file{*process_, m.GetHandle(), PeFileType::Image, 0};
+
+      auto const module = detail::ToUpperOrdinal(m.GetName());
+      std::uint64_t const module_hash = GetModuleHash(module);
+      if (module_hashes_.find(module_hash) != std::end(module_hashes_))
+      {
+        HookModuleExports(pe_file, module, module_hash);
+      }
+
+      HookModuleImports(pe_file, import_module);
+    }
+  }
+
+  void HookModuleExports(PeFile const& pe_file,
+                         std::wstring const& module,
+                         std::uint64_t module_hash)
+  {
+    ExportList const exports{*process_, pe_file};
+    for (auto const& e : exports)
+    {
+      if (!e.ByName())
+      {
+        continue;
+      }
+
+      ForEachMatch(module_hash,
+                   module,
+                   e.GetName(),
+                   [&](Entry& entry)
+                   {
+        // Deliberately skipped. See the comment on the class.
+        if (e.IsForwarded())
+        {
+          HADESMEM_DETAIL_TRACE_FORMAT_A(
+            "WARNING! Skipping forwarded export with forwarder [%s].",
+            e.GetForwarder().c_str());
+          return;
+        }
+
+        HADESMEM_DETAIL_ASSERT(!entry.eat_hook);
+
+        HADESMEM_DETAIL_TRACE_FORMAT_A(
+          "Got export at [%p] with value [%p].", e.GetRvaPtr(), e.GetVa());
+
+        entry.eat_hook =
+          entry.make_eat_hook(*process_, pe_file.GetBase(), e.GetRvaPtr());
+      });
+    }
+  }
+
+  void HookModuleImports(PeFile const& pe_file, std::wstring& import_module)
+  {
+    ImportDirList const import_dirs{*process_, pe_file};
+    for (auto const& id : import_dirs)
+    {
+      ToUpperModuleName(id.GetName(), import_module);
+      std::uint64_t const module_hash = GetModuleHash(import_module);
+      if (module_hashes_.find(module_hash) == std::end(module_hashes_))
+      {
+        continue;
+      }
+
+      ImportThunkList import_thunks{*process_, pe_file, id.GetFirstThunk()};
+      ImportThunkList orig_import_thunks{
+        *process_, pe_file, id.GetOriginalFirstThunk()};
+      for (auto it = std::begin(import_thunks),
+                oit = std::begin(orig_import_thunks);
+           it != std::end(import_thunks) &&
+             oit != std::end(orig_import_thunks);
+           ++it, ++oit)
+      {
+        if (oit->ByOrdinal())
+        {
+          continue;
+        }
+
+        ForEachMatch(module_hash,
+                     import_module,
+                     oit->GetName(),
+                     [&](Entry& entry)
+                     {
+          HADESMEM_DETAIL_TRACE_FORMAT_A(
+            "Got import thunk at [%p] with value [%p].",
+            it->GetFunctionPtr(),
+            reinterpret_cast<void const*>(
+              static_cast<std::uintptr_t>(it->GetFunction())));
+
+          void* const func_ptr = it->GetFunctionPtr();
+          auto& iat_hook = entry.iat_hooks[func_ptr];
+          HADESMEM_DETAIL_ASSERT(!iat_hook);
+          iat_hook = entry.make_iat_hook(*process_, func_ptr);
+        });
+      }
+    }
+  }
+
+  bool HasPatches() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    for (auto const& entry : entries_)
+    {
+      if (entry.eat_hook || !entry.iat_hooks.empty())
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void RemoveUnchecked() HADESMEM_DETAIL_NOEXCEPT
+  {
+    try
+    {
+      Remove();
+    }
+    catch (...)
+    {
+      // WARNING: Patches may not be removed if Remove fails.
+      HADESMEM_DETAIL_TRACE_A(
+        boost::current_exception_diagnostic_information().c_str());
+      HADESMEM_DETAIL_ASSERT(false);
+    }
+  }
+
+  Process const* process_;
+  bool hooked_{false};
+  bool applied_{false};
+  std::vector<Entry> entries_;
+  std::unordered_map<Key, std::vector<std::size_t>, KeyHash> lookup_;
+  std::unordered_set<std::uint64_t> module_hashes_;
+};
+}
@@ -17,6 +17,7 @@
 #include <hadesmem/local/patch_func_ptr.hpp>
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
+#include <hadesmem/remote_arena.hpp>
 #include <hadesmem/write.hpp>
 
 namespace hadesmem
@@ -28,24 +29,35 @@ public:
   {
   };
 
+  // The new VMT is allocated from the arena if one is given.
   PatchVmt(hadesmem::Process const& process,
            void* target_class,
-           std::size_t vmt_size)
+           std::size_t vmt_size,
+           RemoteArena* arena = nullptr)
     : process_{&process},
       class_base_{static_cast<void***>(target_class)},
       old_vmt_{Read<void**>(process, class_base_)},
       vmt_size_{vmt_size},
-      new_vmt_{process, vmt_size_ * sizeof(void*) + 1}
+      new_vmt_{detail::AllocateFrom(process,
+                                    arena,
+                                    vmt_size_ * sizeof(void*) + 1,
+                                    RemoteArenaPool::kReadWrite)}
   {
     Initialize();
   }
 
-  PatchVmt(hadesmem::Process const& process, void* target_class, TagUnsafe)
+  PatchVmt(hadesmem::Process const& process,
+           void* target_class,
+           TagUnsafe,
+           RemoteArena* arena = nullptr)
     : process_{&process},
       class_base_{static_cast<void***>(target_class)},
       old_vmt_{Read<void**>(process, class_base_)},
       vmt_size_{GetVmtSizeUnsafe(old_vmt_)},
-      new_vmt_{process, vmt_size_ * sizeof(void*)}
+      new_vmt_{detail::AllocateFrom(process,
+                                    arena,
+                                    vmt_size_ * sizeof(void*),
+                                    RemoteArenaPool::kReadWrite)}
   {
     Initialize();
   }
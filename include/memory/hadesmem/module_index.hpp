@@ -0,0 +1,478 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/str_conv.hpp>
+#include <hadesmem/detail/suffix_array.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/pelib/nt_headers.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+// Index over the code and data sections of a module for answering repeated
+// pattern queries without rescanning. Built once (in parallel) from a snapshot
+// of the module, so later writes to the module (e.g. to .data) are not seen.
+// Results are the same as the equivalent call to Find.
+
+namespace hadesmem
+{
+class ModuleIndex
+{
+public:
+  explicit ModuleIndex(Process const& process,
+                       std::wstring const& module,
+                       std::size_t num_threads = 0)
+  {
+    Build(process, module, num_threads);
+  }
+
+  // Load the index from the cache file if it was built from the same module
+  // image (timestamp, checksum, size and base address), otherwise build it and
+  // rewrite the cache.
+  explicit ModuleIndex(Process const& process,
+                       std::wstring const& module,
+                       std::wstring const& cache_path,
+                       std::size_t num_threads = 0)
+  {
+    Module const mod = module.empty() ? Module{process, nullptr}
+                                      : Module{process, module};
+    Key const key = GetKey(process, mod);
+
+    if (detail::DoesFileExist(cache_path))
+    {
+      try
+      {
+        auto const buf = detail::FileToBuffer(cache_path);
+        Deserialize(buf.data(), buf.size());
+        if (key_ == key)
+        {
+          from_cache_ = true;
+          return;
+        }
+      }
+      catch (std::exception const& /*e*/)
+      {
+        // Treat a corrupt cache as a miss.
+      }
+    }
+
+    Build(process, module, num_threads);
+    Save(cache_path);
+  }
+
+  explicit ModuleIndex(Process&& process,
+                       std::wstring const& module,
+                       std::size_t num_threads = 0) = delete;
+
+  explicit ModuleIndex(Process&& process,
+                       std::wstring const& module,
+                       std::wstring const& cache_path,
+                       std::size_t num_threads = 0) = delete;
+
+  explicit ModuleIndex(void const* data, std::size_t len)
+  {
+    Deserialize(data, len);
+  }
+
+  void* GetBase() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return reinterpret_cast<void*>(static_cast<std::uintptr_t>(key_.base));
+  }
+
+  bool IsFromCache() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return from_cache_;
+  }
+
+  struct SectionView
+  {
+    std::uint32_t rva;
+    std::uint32_t size;
+    bool is_code;
+    std::uint8_t const* data;
+  };
+
+  // The indexed sections and the snapshot of their contents the index was
+  // built from.
+  std::vector<SectionView> GetSections() const
+  {
+    std::vector<SectionView> sections;
+    for (auto const& region : regions_)
+    {
+      SectionView const section = {
+        region.rva, region.size, region.is_code, &data_[region.offset]};
+      sections.push_back(section);
+    }
+    return sections;
+  }
+
+  // Same semantics as the Find overload taking a module name.
+  void* Find(std::wstring const& data,
+             std::uint32_t flags,
+             std::uintptr_t start,
+             std::wstring const* name = nullptr) const
+  {
+    HADESMEM_DETAIL_ASSERT(
+      !(flags & ~(PatternFlags::kInvalidFlagMaxValue - 1UL)));
+
+    auto const needle = detail::ConvertData(data);
+    auto const n_len = needle.size();
+    bool const has_literal =
+      std::any_of(std::begin(needle),
+                  std::end(needle),
+                  [](detail::PatternDataByte const& b)
+                  {
+                    return !b.wildcard;
+                  });
+    auto const matches = FindOffsets(std::begin(needle), std::end(needle));
+
+    bool const scan_data = !!(flags & PatternFlags::kScanData);
+    for (auto const& region : regions_)
+    {
+      if (region.is_code == scan_data)
+      {
+        continue;
+      }
+
+      std::uint32_t lo = region.offset;
+      std::uint32_t const hi = region.offset + region.size;
+      if (start)
+      {
+        if (start < region.rva || start - region.rva >= region.size)
+        {
+          continue;
+        }
+
+        lo += static_cast<std::uint32_t>(start - region.rva) + 1;
+        if (lo == hi)
+        {
+          HADESMEM_DETAIL_THROW_EXCEPTION(
+            Error() << ErrorString("Invalid start address."));
+        }
+      }
+
+      std::uint32_t const* match = nullptr;
+      std::uint32_t offset = lo;
+      if (has_literal)
+      {
+        auto const iter =
+          std::lower_bound(std::begin(matches), std::end(matches), lo);
+        match = iter != std::end(matches) ? &*iter : nullptr;
+        offset = match ? *match : 0;
+      }
+
+      if ((match || !has_literal) && offset + n_len <= hi)
+      {
+        std::uintptr_t const rva = region.rva + (offset - region.offset);
+        return !!(flags & PatternFlags::kRelativeAddress)
+                 ? reinterpret_cast<void*>(rva)
+                 : static_cast<std::uint8_t*>(GetBase()) + rva;
+      }
+    }
+
+    if (!!(flags & PatternFlags::kThrowOnUnmatch))
+    {
+      auto const name_narrow =
+        name ? detail::WideCharToMultiByte(*name) : std::string();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"Could not match pattern."}
+                                      << ErrorStringOther{name_narrow});
+    }
+
+    return nullptr;
+  }
+
+  // Every match in the code (or data if kScanData is set) sections.
+  std::vector<void*> FindAll(std::wstring const& data,
+                             std::uint32_t flags) const
+  {
+    auto const needle = detail::ConvertData(data);
+    auto const rvas = FindAllRvas(std::begin(needle),
+                                  std::end(needle),
+                                  !!(flags & PatternFlags::kScanData));
+    std::vector<void*> results;
+    results.reserve(rvas.size());
+    for (auto const rva : rvas)
+    {
+      results.push_back(!!(flags & PatternFlags::kRelativeAddress)
+                          ? reinterpret_cast<void*>(
+                              static_cast<std::uintptr_t>(rva))
+                          : static_cast<std::uint8_t*>(GetBase()) + rva);
+    }
+    return results;
+  }
+
+  // Needle is a sequence of detail::PatternDataByte (or anything else with
+  // data and wildcard members), which must contain at least one literal byte.
+  template <typename NeedleIterator>
+  std::vector<std::uint32_t> FindAllRvas(NeedleIterator n_beg,
+                                         NeedleIterator n_end,
+                                         bool scan_data) const
+  {
+    std::size_t const n_len =
+      static_cast<std::size_t>(std::distance(n_beg, n_end));
+    std::vector<std::uint32_t> results;
+    for (auto const offset : FindOffsets(n_beg, n_end))
+    {
+      auto const region = std::upper_bound(std::begin(regions_),
+                                           std::end(regions_),
+                                           offset,
+                                           [](std::uint32_t o, Region const& r)
+                                           {
+                                             return o < r.offset;
+                                           }) -
+                          1;
+      if (region->is_code != scan_data &&
+          offset + n_len <= region->offset + region->size)
+      {
+        results.push_back(region->rva + (offset - region->offset));
+      }
+    }
+    return results;
+  }
+
+  std::vector<std::uint8_t> Serialize() const
+  {
+    std::vector<std::uint8_t> buf;
+    auto const put = [&](std::uint64_t value, std::size_t len)
+    {
+      for (std::size_t i = 0; i < len; ++i)
+      {
+        buf.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+      }
+    };
+
+    put(kMagic, 4);
+    put(kVersion, 4);
+    put(depth_, 4);
+    put(key_.time_date_stamp, 4);
+    put(key_.size_of_image, 4);
+    put(key_.check_sum, 4);
+    put(key_.base, 8);
+    put(regions_.size(), 4);
+    put(data_.size(), 4);
+    for (auto const& region : regions_)
+    {
+      put(region.rva, 4);
+      put(region.offset, 4);
+      put(region.size, 4);
+      put(region.is_code, 4);
+    }
+    buf.insert(std::end(buf), std::begin(data_), std::end(data_));
+    std::size_t const sa_offset = buf.size();
+    buf.resize(sa_offset + sa_.size() * sizeof(std::uint32_t));
+    if (!sa_.empty())
+    {
+      std::memcpy(&buf[sa_offset], sa_.data(), sa_.size() * sizeof(sa_[0]));
+    }
+    return buf;
+  }
+
+  void Save(std::wstring const& path) const
+  {
+    auto const buf = Serialize();
+    detail::BufferToFile(
+      path, buf.data(), static_cast<std::streamsize>(buf.size()));
+  }
+
+private:
+  static std::uint32_t const kMagic = 0x494D4D48; // "HMMI"
+  static std::uint32_t const kVersion = 1;
+
+  struct Key
+  {
+    std::uint32_t time_date_stamp;
+    std::uint32_t size_of_image;
+    std::uint32_t check_sum;
+    std::uint64_t base;
+
+    bool operator==(Key const& other) const HADESMEM_DETAIL_NOEXCEPT
+    {
+      return time_date_stamp == other.time_date_stamp &&
+             size_of_image == other.size_of_image &&
+             check_sum == other.check_sum && base == other.base;
+    }
+  };
+
+  struct Region
+  {
+    std::uint32_t rva;
+    std::uint32_t offset;
+    std::uint32_t size;
+    bool is_code;
+  };
+
+  static Key GetKey(Process const& process, Module const& module)
+  {
+    PeFile const pe_file{
+      process, module.GetHandle(), PeFileType::Image, 0};
+    NtHeaders const nt_headers{process, pe_file};
+    Key const key = {nt_headers.GetTimeDateStamp(),
+                     nt_headers.GetSizeOfImage(),
+                     nt_headers.GetCheckSum(),
+                     reinterpret_cast<std::uintptr_t>(module.GetHandle())};
+    return key;
+  }
+
+  void Build(Process const& process,
+             std::wstring const& module,
+             std::size_t num_threads)
+  {
+    auto const mod_info = detail::GetModuleInfo(process, module);
+    key_ = GetKey(process, *mod_info.module);
+    regions_.clear();
+    data_.clear();
+    auto const base =
+      reinterpret_cast<std::uint8_t*>(mod_info.module->GetHandle());
+
+    // Regions are kept in section order within each type, as Find returns
+    // the match in the first region rather than the lowest address.
+    for (std::size_t i = 0; i < 2; ++i)
+    {
+      bool const is_code = i == 0;
+      for (auto const& r : is_code ? mod_info.code_regions
+                                   : mod_info.data_regions)
+      {
+        Region const region = {static_cast<std::uint32_t>(r.first - base),
+                               static_cast<std::uint32_t>(data_.size()),
+                               static_cast<std::uint32_t>(r.second - r.first),
+                               is_code};
+        regions_.push_back(region);
+        ReadVector<std::uint8_t>(process,
+                                 r.first,
+                                 region.size,
+                                 std::back_inserter(data_));
+      }
+    }
+
+    depth_ = detail::kSuffixArrayDefaultDepth;
+    sa_ = detail::BuildSuffixArray(
+      data_.data(), data_.size(), depth_, num_threads);
+  }
+
+  void Deserialize(void const* data, std::size_t len)
+  {
+    auto p = static_cast<std::uint8_t const*>(data);
+    auto const end = p + len;
+    auto const get = [&](std::size_t n) -> std::uint64_t
+    {
+      if (static_cast<std::size_t>(end - p) < n)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Truncated module index."});
+      }
+      std::uint64_t value = 0;
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        value |= static_cast<std::uint64_t>(*p++) << (i * 8);
+      }
+      return value;
+    };
+
+    if (get(4) != kMagic || get(4) != kVersion)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid module index header."});
+    }
+
+    depth_ = static_cast<std::size_t>(get(4));
+    key_.time_date_stamp = static_cast<std::uint32_t>(get(4));
+    key_.size_of_image = static_cast<std::uint32_t>(get(4));
+    key_.check_sum = static_cast<std::uint32_t>(get(4));
+    key_.base = get(8);
+    auto const num_regions = static_cast<std::size_t>(get(4));
+    auto const data_size = static_cast<std::size_t>(get(4));
+    if (depth_ < 2 || num_regions > data_size)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid module index header."});
+    }
+
+    std::vector<Region> regions;
+    std::uint32_t expected_offset = 0;
+    for (std::size_t i = 0; i < num_regions; ++i)
+    {
+      Region region;
+      region.rva = static_cast<std::uint32_t>(get(4));
+      region.offset = static_cast<std::uint32_t>(get(4));
+      region.size = static_cast<std::uint32_t>(get(4));
+      region.is_code = !!get(4);
+      if (region.offset != expected_offset || !region.size ||
+          region.size > data_size - region.offset)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Invalid module index region."});
+      }
+      expected_offset += region.size;
+      regions.push_back(region);
+    }
+
+    if (expected_offset != data_size ||
+        static_cast<std::size_t>(end - p) !=
+          data_size + data_size * sizeof(std::uint32_t))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid module index size."});
+    }
+
+    std::vector<std::uint8_t> index_data(p, p + data_size);
+    p += data_size;
+    std::vector<std::uint32_t> sa(data_size);
+    if (data_size)
+    {
+      std::memcpy(sa.data(), p, data_size * sizeof(std::uint32_t));
+    }
+    if (std::any_of(std::begin(sa),
+                    std::end(sa),
+                    [&](std::uint32_t pos)
+                    {
+                      return pos >= data_size;
+                    }))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid module index suffix array."});
+    }
+
+    regions_ = std::move(regions);
+    data_ = std::move(index_data);
+    sa_ = std::move(sa);
+  }
+
+  template <typename NeedleIterator>
+  std::vector<std::uint32_t> FindOffsets(NeedleIterator n_beg,
+                                         NeedleIterator n_end) const
+  {
+    return detail::FindInSuffixArray(data_.data(),
+                                     data_.size(),
+                                     sa_.data(),
+                                     sa_.data() + sa_.size(),
+                                     depth_,
+                                     n_beg,
+                                     n_end);
+  }
+
+  Key key_{};
+  std::vector<Region> regions_;
+  std::vector<std::uint8_t> data_;
+  std::vector<std::uint32_t> sa_;
+  std::size_t depth_{};
+  bool from_cache_{};
+};
+}
@@ -96,7 +96,7 @@ public:
 
     SuspendedProcess const suspended_process{process_->GetId()};
 
-    detail::VerifyPatchThreads(process_->GetId(), target_, data_.size());
+    detail::VerifyPatchThreads(suspended_process, target_, data_.size());
 
     orig_ = ReadVector<std::uint8_t>(*process_, target_, data_.size());
 
@@ -116,7 +116,7 @@ public:
 
     SuspendedProcess const suspended_process{process_->GetId()};
 
-    detail::VerifyPatchThreads(process_->GetId(), target_, data_.size());
+    detail::VerifyPatchThreads(suspended_process, target_, data_.size());
 
     WriteVector(*process_, target_, orig_);
 
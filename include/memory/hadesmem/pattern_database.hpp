@@ -0,0 +1,379 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/error.hpp>
+
+// Compiled form of a FindPattern pattern file (see
+// FindPattern::CompilePatternFile). All conversion of the XML (pattern data to
+// mask/value arrays, operands to numbers, names of Start patterns to indices)
+// is done by the compiler, so loading is a bounds check of the tables
+// followed by direct use of the mapped file. All values are little-endian and
+// all tables are 8-byte aligned.
+
+namespace hadesmem
+{
+namespace detail
+{
+struct PatternDbHeader
+{
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t file_size;
+  std::uint32_t num_modules;
+  std::uint32_t modules_offset;
+  std::uint32_t num_patterns;
+  std::uint32_t patterns_offset;
+  std::uint32_t num_manipulators;
+  std::uint32_t manipulators_offset;
+  std::uint32_t bytes_offset;
+  std::uint32_t bytes_size;
+  std::uint32_t strings_offset;
+  std::uint32_t strings_size;
+  std::uint32_t reserved;
+};
+
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PatternDbHeader) == 56);
+
+// Strings are UTF-16, with offsets in bytes from the start of the string
+// table and lengths in characters.
+struct PatternDbModule
+{
+  std::uint32_t name_offset;
+  std::uint32_t name_len;
+  std::uint32_t first_pattern;
+  std::uint32_t num_patterns;
+};
+
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PatternDbModule) == 16);
+
+enum class PatternDbStart : std::uint32_t
+{
+  kNone,
+  // start_value is the start RVA.
+  kRva,
+  // start_value/start_len are the export name in the string table.
+  kExport,
+  // start_value is the index (in the module) of an earlier pattern.
+  kPattern
+};
+
+// Patterns are stored in dependency order within each module, so a pattern
+// which starts from another pattern always comes after it.
+struct PatternDbPattern
+{
+  std::uint32_t name_offset;
+  std::uint32_t name_len;
+  // Module flags combined with the pattern flags.
+  std::uint32_t flags;
+  // Offset in the byte table of len value bytes, followed by len mask bytes
+  // (0xFF for bytes which must match, 0x00 for wildcards).
+  std::uint32_t data_offset;
+  std::uint32_t len;
+  // Longest run of non-wildcard bytes in the pattern, which is searched for
+  // first. Zero length if the pattern is all wildcards.
+  std::uint32_t anchor_offset;
+  std::uint32_t anchor_len;
+  PatternDbStart start_type;
+  std::uint32_t start_value;
+  std::uint32_t start_len;
+  std::uint32_t first_manipulator;
+  std::uint32_t num_manipulators;
+};
+
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PatternDbPattern) == 48);
+
+enum class PatternDbManipulatorType : std::uint32_t
+{
+  kAdd,
+  kSub,
+  kRel,
+  kLea,
+  kAnd
+};
+
+struct PatternDbManipulator
+{
+  PatternDbManipulatorType type;
+  std::uint16_t has_operand1;
+  std::uint16_t has_operand2;
+  std::uint64_t operand1;
+  std::uint64_t operand2;
+};
+
+HADESMEM_DETAIL_STATIC_ASSERT(sizeof(PatternDbManipulator) == 24);
+}
+
+class PatternDatabase
+{
+public:
+  static std::uint32_t const kMagic = 0x44504D48; // "HMPD"
+  static std::uint32_t const kVersion = 1;
+
+  explicit PatternDatabase(std::wstring const& path)
+  {
+    file_ = ::CreateFileW(path.c_str(),
+                          GENERIC_READ,
+                          FILE_SHARE_READ,
+                          nullptr,
+                          OPEN_EXISTING,
+                          0,
+                          nullptr);
+    if (!file_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"CreateFileW failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    LARGE_INTEGER file_size;
+    if (!::GetFileSizeEx(file_.GetHandle(), &file_size))
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"GetFileSizeEx failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    if (file_size.QuadPart < static_cast<LONGLONG>(sizeof(Header)) ||
+        file_size.QuadPart > static_cast<LONGLONG>(0xFFFFFFFF))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid pattern database size."});
+    }
+
+    file_mapping_ = ::CreateFileMappingW(
+      file_.GetHandle(), nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file_mapping_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"CreateFileMappingW failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    file_view_ =
+      ::MapViewOfFile(file_mapping_.GetHandle(), FILE_MAP_READ, 0, 0, 0);
+    if (!file_view_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"MapViewOfFile failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    Validate(file_view_.GetHandle(),
+             static_cast<std::size_t>(file_size.QuadPart));
+  }
+
+  // The buffer is used in place, so must be 8-byte aligned and outlive the
+  // database.
+  explicit PatternDatabase(void const* data, std::size_t len)
+  {
+    Validate(data, len);
+  }
+
+  PatternDatabase(PatternDatabase const&) = delete;
+
+  PatternDatabase& operator=(PatternDatabase const&) = delete;
+
+  std::uint32_t GetNumModules() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return header_->num_modules;
+  }
+
+  detail::PatternDbModule const& GetModule(std::uint32_t index) const
+    HADESMEM_DETAIL_NOEXCEPT
+  {
+    return modules_[index];
+  }
+
+  detail::PatternDbPattern const& GetPattern(std::uint32_t index) const
+    HADESMEM_DETAIL_NOEXCEPT
+  {
+    return patterns_[index];
+  }
+
+  detail::PatternDbManipulator const&
+    GetManipulator(std::uint32_t index) const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return manipulators_[index];
+  }
+
+  std::uint8_t const* GetBytes(std::uint32_t offset) const
+    HADESMEM_DETAIL_NOEXCEPT
+  {
+    return bytes_ + offset;
+  }
+
+  std::wstring GetString(std::uint32_t offset, std::uint32_t len) const
+  {
+    std::wstring str(len, L'\0');
+    for (std::uint32_t i = 0; i < len; ++i)
+    {
+      std::uint16_t c;
+      std::memcpy(&c, strings_ + offset + i * 2, sizeof(c));
+      str[i] = static_cast<wchar_t>(c);
+    }
+    return str;
+  }
+
+private:
+  using Header = detail::PatternDbHeader;
+
+  void Validate(void const* data, std::size_t len)
+  {
+    auto const base = static_cast<std::uint8_t const*>(data);
+    auto const invalid = []()
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid pattern database."});
+    };
+
+    // Tables are only checked to be in bounds here. Cross references are
+    // checked below, which is cheap compared to parsing but still catches a
+    // truncated or corrupt file before it is used.
+    auto const check_table = [&](std::uint32_t offset,
+                                 std::uint64_t count,
+                                 std::size_t entry_size)
+    {
+      if (offset % 8 || offset > len ||
+          count * entry_size > static_cast<std::uint64_t>(len - offset))
+      {
+        invalid();
+      }
+    };
+
+    if (reinterpret_cast<std::uintptr_t>(base) % 8 || len < sizeof(Header))
+    {
+      invalid();
+    }
+
+    header_ = reinterpret_cast<Header const*>(base);
+    if (header_->magic != kMagic || header_->version != kVersion ||
+        header_->file_size != len)
+    {
+      invalid();
+    }
+
+    check_table(header_->modules_offset,
+                header_->num_modules,
+                sizeof(detail::PatternDbModule));
+    check_table(header_->patterns_offset,
+                header_->num_patterns,
+                sizeof(detail::PatternDbPattern));
+    check_table(header_->manipulators_offset,
+                header_->num_manipulators,
+                sizeof(detail::PatternDbManipulator));
+    check_table(header_->bytes_offset, header_->bytes_size, 1);
+    check_table(header_->strings_offset, header_->strings_size, 1);
+
+    modules_ = reinterpret_cast<detail::PatternDbModule const*>(
+      base + header_->modules_offset);
+    patterns_ = reinterpret_cast<detail::PatternDbPattern const*>(
+      base + header_->patterns_offset);
+    manipulators_ = reinterpret_cast<detail::PatternDbManipulator const*>(
+      base + header_->manipulators_offset);
+    bytes_ = base + header_->bytes_offset;
+    strings_ = base + header_->strings_offset;
+
+    auto const check_string = [&](std::uint32_t offset, std::uint32_t len)
+    {
+      if (offset > header_->strings_size ||
+          static_cast<std::uint64_t>(len) * 2 > header_->strings_size - offset)
+      {
+        invalid();
+      }
+    };
+
+    for (std::uint32_t i = 0; i < header_->num_modules; ++i)
+    {
+      auto const& module = modules_[i];
+      check_string(module.name_offset, module.name_len);
+      if (module.first_pattern > header_->num_patterns ||
+          module.num_patterns > header_->num_patterns - module.first_pattern)
+      {
+        invalid();
+      }
+
+      for (std::uint32_t j = 0; j < module.num_patterns; ++j)
+      {
+        auto const& pattern = patterns_[module.first_pattern + j];
+        check_string(pattern.name_offset, pattern.name_len);
+        if (!pattern.len || pattern.data_offset > header_->bytes_size ||
+            static_cast<std::uint64_t>(pattern.len) * 2 >
+              header_->bytes_size - pattern.data_offset ||
+            pattern.anchor_offset > pattern.len ||
+            pattern.anchor_len > pattern.len - pattern.anchor_offset ||
+            pattern.first_manipulator > header_->num_manipulators ||
+            pattern.num_manipulators >
+              header_->num_manipulators - pattern.first_manipulator)
+        {
+          invalid();
+        }
+
+        switch (pattern.start_type)
+        {
+        case detail::PatternDbStart::kNone:
+        case detail::PatternDbStart::kRva:
+          break;
+
+        case detail::PatternDbStart::kExport:
+          check_string(pattern.start_value, pattern.start_len);
+          break;
+
+        case detail::PatternDbStart::kPattern:
+          if (pattern.start_value >= j)
+          {
+            invalid();
+          }
+          break;
+
+        default:
+          invalid();
+          break;
+        }
+      }
+    }
+
+    for (std::uint32_t i = 0; i < header_->num_manipulators; ++i)
+    {
+      switch (manipulators_[i].type)
+      {
+      case detail::PatternDbManipulatorType::kAdd:
+      case detail::PatternDbManipulatorType::kSub:
+      case detail::PatternDbManipulatorType::kRel:
+      case detail::PatternDbManipulatorType::kLea:
+      case detail::PatternDbManipulatorType::kAnd:
+        break;
+
+      default:
+        invalid();
+        break;
+      }
+    }
+  }
+
+  detail::SmartFileHandle file_;
+  detail::SmartHandle file_mapping_;
+  detail::SmartMappedFileHandle file_view_;
+  Header const* header_{};
+  detail::PatternDbModule const* modules_{};
+  detail::PatternDbPattern const* patterns_{};
+  detail::PatternDbManipulator const* manipulators_{};
+  std::uint8_t const* bytes_{};
+  std::uint8_t const* strings_{};
+};
+}
@@ -4,6 +4,8 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <iosfwd>
 #include <ostream>
@@ -14,6 +16,7 @@
 #include <winnt.h>
 
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/pelib/import_dir.hpp>
 #include <hadesmem/pelib/nt_headers.hpp>
@@ -29,70 +32,101 @@ class ImportThunk
 public:
   explicit ImportThunk(Process const& process,
                        PeFile const& pe_file,
-                       PIMAGE_THUNK_DATA thunk)
+                       void* thunk)
     : process_{&process},
       pe_file_{&pe_file},
-      base_{reinterpret_cast<std::uint8_t*>(thunk)}
+      base_{static_cast<std::uint8_t*>(thunk)}
   {
     UpdateRead();
   }
 
   explicit ImportThunk(Process&& process,
                        PeFile const& pe_file,
-                       PIMAGE_THUNK_DATA thunk) = delete;
+                       void* thunk) = delete;
 
   explicit ImportThunk(Process const& process,
                        PeFile&& pe_file,
-                       PIMAGE_THUNK_DATA thunk) = delete;
+                       void* thunk) = delete;
 
   explicit ImportThunk(Process&& process,
                        PeFile&& pe_file,
-                       PIMAGE_THUNK_DATA thunk) = delete;
+                       void* thunk) = delete;
 
   PVOID GetBase() const HADESMEM_DETAIL_NOEXCEPT
   {
     return base_;
   }
 
+  // Size of a thunk in the file, which is 8 bytes for PE32+ and 4 bytes for
+  // PE32.
+  std::size_t GetSize() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return pe_file_->Is64() ? sizeof(IMAGE_THUNK_DATA64)
+                            : sizeof(IMAGE_THUNK_DATA32);
+  }
+
   void UpdateRead()
   {
-    data_ = Read<IMAGE_THUNK_DATA>(*process_, base_);
+    if (pe_file_->Is64())
+    {
+      data_ = Read<ULONGLONG>(*process_, base_);
+    }
+    else
+    {
+      data_ = Read<DWORD>(*process_, base_);
+    }
   }
 
   void UpdateWrite()
   {
-    Write(*process_, base_, data_);
+    if (pe_file_->Is64())
+    {
+      Write(*process_, base_, data_);
+    }
+    else
+    {
+      if (data_ > (std::numeric_limits<DWORD>::max)())
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Value does not fit in a PE32 thunk."});
+      }
+
+      Write(*process_, base_, static_cast<DWORD>(data_));
+    }
   }
 
-  DWORD_PTR GetAddressOfData() const
+  ULONGLONG GetAddressOfData() const
   {
-    return data_.u1.AddressOfData;
+    return data_;
   }
 
-  DWORD_PTR GetOrdinalRaw() const
+  ULONGLONG GetOrdinalRaw() const
   {
-    return data_.u1.Ordinal;
+    return data_;
   }
 
   bool ByOrdinal() const
   {
-    return IMAGE_SNAP_BY_ORDINAL(GetOrdinalRaw());
+    return pe_file_->Is64() ? IMAGE_SNAP_BY_ORDINAL64(GetOrdinalRaw())
+                            : IMAGE_SNAP_BY_ORDINAL32(GetOrdinalRaw());
   }
 
   WORD GetOrdinal() const
   {
-    return IMAGE_ORDINAL(GetOrdinalRaw());
+    return static_cast<WORD>(IMAGE_ORDINAL64(GetOrdinalRaw()));
   }
 
-  DWORD_PTR GetFunction() const
+  ULONGLONG GetFunction() const
   {
-    return data_.u1.Function;
+    return data_;
   }
 
+  // Only usable when the file has the same bitness as us, which is always the
+  // case for modules loaded in our own process.
   DWORD_PTR* GetFunctionPtr()
   {
-    return reinterpret_cast<DWORD_PTR*>(
-      base_ + offsetof(IMAGE_THUNK_DATA, u1.Function));
+    HADESMEM_DETAIL_ASSERT(GetSize() == sizeof(DWORD_PTR));
+    return reinterpret_cast<DWORD_PTR*>(base_);
   }
 
   WORD GetHint() const
@@ -121,19 +155,19 @@ public:
       *process_, *pe_file_, name_import + offsetof(IMAGE_IMPORT_BY_NAME, Name));
   }
 
-  void SetAddressOfData(DWORD_PTR address_of_data)
+  void SetAddressOfData(ULONGLONG address_of_data)
   {
-    data_.u1.AddressOfData = address_of_data;
+    data_ = address_of_data;
   }
 
-  void SetOrdinalRaw(DWORD_PTR ordinal_raw)
+  void SetOrdinalRaw(ULONGLONG ordinal_raw)
   {
-    data_.u1.Ordinal = ordinal_raw;
+    data_ = ordinal_raw;
   }
 
-  void SetFunction(DWORD_PTR function)
+  void SetFunction(ULONGLONG function)
   {
-    data_.u1.Function = function;
+    data_ = function;
   }
 
   void SetHint(WORD hint)
@@ -148,7 +182,7 @@ private:
   Process const* process_;
   PeFile const* pe_file_;
   PBYTE base_;
-  IMAGE_THUNK_DATA data_ = IMAGE_THUNK_DATA{};
+  ULONGLONG data_{};
 };
 
 inline bool operator==(ImportThunk const& lhs,
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iterator>
 #include <memory>
 #include <utility>
@@ -44,8 +45,7 @@ public:
   {
     try
     {
-      auto const thunk_ptr = reinterpret_cast<PIMAGE_THUNK_DATA>(
-        RvaToVa(process, pe_file, first_thunk));
+      void* const thunk_ptr = RvaToVa(process, pe_file, first_thunk);
       if (!thunk_ptr)
       {
         return;
@@ -116,10 +116,11 @@ public:
     {
       HADESMEM_DETAIL_ASSERT(impl_.get());
 
-      auto const cur_base =
-        reinterpret_cast<PIMAGE_THUNK_DATA>(impl_->import_thunk_->GetBase());
+      auto const next_base =
+        static_cast<std::uint8_t*>(impl_->import_thunk_->GetBase()) +
+        impl_->import_thunk_->GetSize();
       impl_->import_thunk_ =
-        ImportThunk{*impl_->process_, *impl_->pe_file_, cur_base + 1};
+        ImportThunk{*impl_->process_, *impl_->pe_file_, next_base};
 
       if (!impl_->import_thunk_->GetAddressOfData())
       {
@@ -8,6 +8,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <iosfwd>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <ostream>
 #include <utility>
@@ -46,6 +48,87 @@ enum class PeDataDir : std::uint32_t
   Reserved
 };
 
+namespace detail
+{
+// Copies the fields which PE32 and PE32+ optional headers have in common,
+// converting between their widths.
+template <typename SourceT, typename DestT>
+void CopyOptionalHeader(SourceT const& source, DestT& dest)
+{
+  dest.Magic = source.Magic;
+  dest.MajorLinkerVersion = source.MajorLinkerVersion;
+  dest.MinorLinkerVersion = source.MinorLinkerVersion;
+  dest.SizeOfCode = source.SizeOfCode;
+  dest.SizeOfInitializedData = source.SizeOfInitializedData;
+  dest.SizeOfUninitializedData = source.SizeOfUninitializedData;
+  dest.AddressOfEntryPoint = source.AddressOfEntryPoint;
+  dest.BaseOfCode = source.BaseOfCode;
+  dest.ImageBase = static_cast<decltype(dest.ImageBase)>(source.ImageBase);
+  dest.SectionAlignment = source.SectionAlignment;
+  dest.FileAlignment = source.FileAlignment;
+  dest.MajorOperatingSystemVersion = source.MajorOperatingSystemVersion;
+  dest.MinorOperatingSystemVersion = source.MinorOperatingSystemVersion;
+  dest.MajorImageVersion = source.MajorImageVersion;
+  dest.MinorImageVersion = source.MinorImageVersion;
+  dest.MajorSubsystemVersion = source.MajorSubsystemVersion;
+  dest.MinorSubsystemVersion = source.MinorSubsystemVersion;
+  dest.Win32VersionValue = source.Win32VersionValue;
+  dest.SizeOfImage = source.SizeOfImage;
+  dest.SizeOfHeaders = source.SizeOfHeaders;
+  dest.CheckSum = source.CheckSum;
+  dest.Subsystem = source.Subsystem;
+  dest.DllCharacteristics = source.DllCharacteristics;
+  dest.SizeOfStackReserve =
+    static_cast<decltype(dest.SizeOfStackReserve)>(source.SizeOfStackReserve);
+  dest.SizeOfStackCommit =
+    static_cast<decltype(dest.SizeOfStackCommit)>(source.SizeOfStackCommit);
+  dest.SizeOfHeapReserve =
+    static_cast<decltype(dest.SizeOfHeapReserve)>(source.SizeOfHeapReserve);
+  dest.SizeOfHeapCommit =
+    static_cast<decltype(dest.SizeOfHeapCommit)>(source.SizeOfHeapCommit);
+  dest.LoaderFlags = source.LoaderFlags;
+  dest.NumberOfRvaAndSizes = source.NumberOfRvaAndSizes;
+  std::copy(std::begin(source.DataDirectory),
+            std::end(source.DataDirectory),
+            std::begin(dest.DataDirectory));
+}
+
+inline IMAGE_NT_HEADERS64 WidenNtHeaders(IMAGE_NT_HEADERS32 const& nt_headers)
+{
+  IMAGE_NT_HEADERS64 wide = IMAGE_NT_HEADERS64{};
+  wide.Signature = nt_headers.Signature;
+  wide.FileHeader = nt_headers.FileHeader;
+  CopyOptionalHeader(nt_headers.OptionalHeader, wide.OptionalHeader);
+  return wide;
+}
+
+inline IMAGE_NT_HEADERS32 NarrowNtHeaders(IMAGE_NT_HEADERS64 const& nt_headers,
+                                          DWORD base_of_data)
+{
+  auto const& optional = nt_headers.OptionalHeader;
+  ULONGLONG const kMaxValue = (std::numeric_limits<DWORD>::max)();
+  if (optional.ImageBase > kMaxValue ||
+      optional.SizeOfStackReserve > kMaxValue ||
+      optional.SizeOfStackCommit > kMaxValue ||
+      optional.SizeOfHeapReserve > kMaxValue ||
+      optional.SizeOfHeapCommit > kMaxValue)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Value does not fit in a PE32 header."});
+  }
+
+  IMAGE_NT_HEADERS32 narrow = IMAGE_NT_HEADERS32{};
+  narrow.Signature = nt_headers.Signature;
+  narrow.FileHeader = nt_headers.FileHeader;
+  CopyOptionalHeader(optional, narrow.OptionalHeader);
+  narrow.OptionalHeader.BaseOfData = base_of_data;
+  return narrow;
+}
+}
+
+// PE32 and PE32+ headers are both supported, whatever our own bitness. PE32
+// headers are widened to the PE32+ layout when read and narrowed again when
+// written, so the accessors work on a single layout.
 class NtHeaders
 {
 public:
@@ -72,25 +155,43 @@ public:
 
   void UpdateRead()
   {
-    data_ = Read<IMAGE_NT_HEADERS>(*process_, base_);
+    if (pe_file_->Is64())
+    {
+      data_ = Read<IMAGE_NT_HEADERS64>(*process_, base_);
+      base_of_data_ = 0;
+    }
+    else
+    {
+      auto const nt_headers = Read<IMAGE_NT_HEADERS32>(*process_, base_);
+      data_ = detail::WidenNtHeaders(nt_headers);
+      base_of_data_ = nt_headers.OptionalHeader.BaseOfData;
+    }
   }
 
   void UpdateWrite()
   {
-    Write(*process_, base_, data_);
+    if (pe_file_->Is64())
+    {
+      Write(*process_, base_, data_);
+    }
+    else
+    {
+      Write(*process_, base_, detail::NarrowNtHeaders(data_, base_of_data_));
+    }
   }
 
   bool IsValid() const
   {
-    return IMAGE_NT_SIGNATURE == GetSignature() &&
-           IMAGE_NT_OPTIONAL_HDR_MAGIC == GetMagic() &&
-#if defined(HADESMEM_DETAIL_ARCH_X86)
-           IMAGE_FILE_MACHINE_I386 == GetMachine();
-#elif defined(HADESMEM_DETAIL_ARCH_X64)
-           IMAGE_FILE_MACHINE_AMD64 == GetMachine();
-#else
-#error "[HadesMem] Unsupported architecture."
-#endif
+    if (IMAGE_NT_SIGNATURE != GetSignature())
+    {
+      return false;
+    }
+
+    return pe_file_->Is64()
+             ? IMAGE_NT_OPTIONAL_HDR64_MAGIC == GetMagic() &&
+                 IMAGE_FILE_MACHINE_AMD64 == GetMachine()
+             : IMAGE_NT_OPTIONAL_HDR32_MAGIC == GetMagic() &&
+                 IMAGE_FILE_MACHINE_I386 == GetMachine();
   }
 
   void EnsureValid() const
@@ -182,14 +283,13 @@ public:
     return data_.OptionalHeader.BaseOfCode;
   }
 
-#if defined(HADESMEM_DETAIL_ARCH_X86)
+  // Always zero for PE32+, which has no BaseOfData.
   DWORD GetBaseOfData() const
   {
-    return data_.OptionalHeader.BaseOfData;
+    return base_of_data_;
   }
-#endif
 
-  ULONG_PTR GetImageBase() const
+  ULONGLONG GetImageBase() const
   {
     return data_.OptionalHeader.ImageBase;
   }
@@ -264,22 +364,22 @@ public:
     return data_.OptionalHeader.DllCharacteristics;
   }
 
-  ULONG_PTR GetSizeOfStackReserve() const
+  ULONGLONG GetSizeOfStackReserve() const
   {
     return data_.OptionalHeader.SizeOfStackReserve;
   }
 
-  ULONG_PTR GetSizeOfStackCommit() const
+  ULONGLONG GetSizeOfStackCommit() const
   {
     return data_.OptionalHeader.SizeOfStackCommit;
   }
 
-  ULONG_PTR GetSizeOfHeapReserve() const
+  ULONGLONG GetSizeOfHeapReserve() const
   {
     return data_.OptionalHeader.SizeOfHeapReserve;
   }
 
-  ULONG_PTR GetSizeOfHeapCommit() const
+  ULONGLONG GetSizeOfHeapCommit() const
   {
     return data_.OptionalHeader.SizeOfHeapCommit;
   }
@@ -404,14 +504,13 @@ public:
     data_.OptionalHeader.BaseOfCode = base_of_code;
   }
 
-#if defined(HADESMEM_DETAIL_ARCH_X86)
+  // Ignored for PE32+.
   void SetBaseOfData(DWORD base_of_data)
   {
-    data_.OptionalHeader.BaseOfData = base_of_data;
+    base_of_data_ = base_of_data;
   }
-#endif
 
-  void SetImageBase(ULONG_PTR image_base)
+  void SetImageBase(ULONGLONG image_base)
   {
     data_.OptionalHeader.ImageBase = image_base;
   }
@@ -488,22 +587,22 @@ public:
     data_.OptionalHeader.DllCharacteristics = dll_characteristics;
   }
 
-  void SetSizeOfStackReserve(ULONG_PTR size_of_stack_reserve)
+  void SetSizeOfStackReserve(ULONGLONG size_of_stack_reserve)
   {
     data_.OptionalHeader.SizeOfStackReserve = size_of_stack_reserve;
   }
 
-  void SetSizeOfStackCommit(ULONG_PTR size_of_stack_commit)
+  void SetSizeOfStackCommit(ULONGLONG size_of_stack_commit)
   {
     data_.OptionalHeader.SizeOfStackCommit = size_of_stack_commit;
   }
 
-  void SetSizeOfHeapReserve(ULONG_PTR size_of_heap_reserve)
+  void SetSizeOfHeapReserve(ULONGLONG size_of_heap_reserve)
   {
     data_.OptionalHeader.SizeOfHeapReserve = size_of_heap_reserve;
   }
 
-  void SetSizeOfHeapCommit(ULONG_PTR size_of_heap_commit)
+  void SetSizeOfHeapCommit(ULONGLONG size_of_heap_commit)
   {
     data_.OptionalHeader.SizeOfHeapCommit = size_of_heap_commit;
   }
@@ -554,7 +653,8 @@ private:
   Process const* process_;
   PeFile const* pe_file_;
   std::uint8_t* base_;
-  IMAGE_NT_HEADERS data_ = IMAGE_NT_HEADERS{};
+  IMAGE_NT_HEADERS64 data_ = IMAGE_NT_HEADERS64{};
+  DWORD base_of_data_{};
 };
 
 inline bool operator==(NtHeaders const& lhs,
@@ -609,7 +709,7 @@ inline std::wostream& operator<<(std::wostream& lhs, NtHeaders const& rhs)
   return lhs;
 }
 
-inline ULONG_PTR GetRuntimeBase(Process const& process, PeFile const& pe_file)
+inline ULONGLONG GetRuntimeBase(Process const& process, PeFile const& pe_file)
 {
   switch (pe_file.GetType())
   {
@@ -5,6 +5,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <exception>
 #include <iosfwd>
 #include <memory>
 #include <ostream>
@@ -66,6 +67,8 @@ public:
         size_ = static_cast<DWORD>(region_alloc_size);
       }
     }
+
+    is_64_ = CalculateIs64();
   }
 
   explicit PeFile(Process&& process,
@@ -88,11 +91,76 @@ public:
     return size_;
   }
 
+  // Whether the file is PE32+ rather than PE32, regardless of our own
+  // bitness. Resolved once on construction from the optional header magic, so
+  // that the types which depend on it don't have to look it up again.
+  bool Is64() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return is_64_;
+  }
+
 private:
+  // Files without a readable optional header are assumed to match our own
+  // bitness, and are rejected later when their headers are validated.
+  bool CalculateIs64() const
+  {
+#if defined(HADESMEM_DETAIL_ARCH_X64)
+    bool const is_native_64 = true;
+#elif defined(HADESMEM_DETAIL_ARCH_X86)
+    bool const is_native_64 = false;
+#else
+#error "[HadesMem] Unsupported architecture."
+#endif
+
+    try
+    {
+      std::size_t const magic_offset =
+        offsetof(IMAGE_NT_HEADERS32, OptionalHeader) +
+        offsetof(IMAGE_OPTIONAL_HEADER32, Magic);
+      if (type_ == PeFileType::Data && size_ < sizeof(IMAGE_DOS_HEADER))
+      {
+        return is_native_64;
+      }
+
+      auto const dos_header = Read<IMAGE_DOS_HEADER>(*process_, base_);
+      if (dos_header.e_magic != IMAGE_DOS_SIGNATURE ||
+          dos_header.e_lfanew < 0)
+      {
+        return is_native_64;
+      }
+
+      std::size_t const nt_offset =
+        static_cast<std::size_t>(dos_header.e_lfanew);
+      if (type_ == PeFileType::Data &&
+          nt_offset + magic_offset + sizeof(WORD) > size_)
+      {
+        return is_native_64;
+      }
+
+      WORD const magic =
+        Read<WORD>(*process_, base_ + nt_offset + magic_offset);
+      if (magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+      {
+        return true;
+      }
+      else if (magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC)
+      {
+        return false;
+      }
+    }
+    catch (std::exception const& /*e*/)
+    {
+      // Nothing to do here.
+    }
+
+    return is_native_64;
+  }
+
   Process const* process_;
   PBYTE base_;
   PeFileType type_;
   DWORD size_;
+  bool is_64_{};
 };
 
 inline bool operator==(PeFile const& lhs,
@@ -166,9 +234,11 @@ inline PVOID RvaToVa(Process const& process, PeFile const& pe_file, DWORD rva)
                                       << ErrorString{"Invalid DOS header."});
     }
 
+    // Everything used below is at the same offset in PE32 and PE32+ headers,
+    // so read the smaller of the two regardless of the file's bitness.
     BYTE* ptr_nt_headers = base + dos_header.e_lfanew;
-    IMAGE_NT_HEADERS nt_headers =
-      Read<IMAGE_NT_HEADERS>(process, ptr_nt_headers);
+    IMAGE_NT_HEADERS32 nt_headers =
+      Read<IMAGE_NT_HEADERS32>(process, ptr_nt_headers);
     if (nt_headers.Signature != IMAGE_NT_SIGNATURE)
     {
       HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
@@ -220,7 +290,7 @@ inline PVOID RvaToVa(Process const& process, PeFile const& pe_file, DWORD rva)
     }
 
     auto ptr_section_header = reinterpret_cast<PIMAGE_SECTION_HEADER>(
-      ptr_nt_headers + offsetof(IMAGE_NT_HEADERS, OptionalHeader) +
+      ptr_nt_headers + offsetof(IMAGE_NT_HEADERS32, OptionalHeader) +
       nt_headers.FileHeader.SizeOfOptionalHeader);
     void const* const file_end =
       static_cast<std::uint8_t*>(pe_file.GetBase()) + pe_file.GetSize();
@@ -0,0 +1,441 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+
+// Applies base relocations to a PE image held in a local buffer, in the
+// layout it has when mapped (section data at its RVA), e.g. as read from a
+// loaded module. The headers and relocation directory are parsed directly from
+// the buffer rather than through PeFile and RelocationBlockList, so there is
+// no dependency on the process or Windows APIs, and the whole directory is
+// validated before anything is written, so a malformed image is left as it
+// was.
+
+namespace hadesmem
+{
+namespace detail
+{
+// IMAGE_REL_BASED_*.
+std::uint16_t const kRelocAbsolute = 0;
+std::uint16_t const kRelocHigh = 1;
+std::uint16_t const kRelocLow = 2;
+std::uint16_t const kRelocHighLow = 3;
+std::uint16_t const kRelocDir64 = 10;
+
+// IMAGE_FILE_RELOCS_STRIPPED.
+std::uint16_t const kFileRelocsStripped = 0x0001;
+
+// IMAGE_DIRECTORY_ENTRY_BASERELOC.
+std::uint32_t const kDirEntryBaseReloc = 5;
+
+// Blocks per unit of work when rebasing in parallel.
+std::size_t const kRebaseBlocksPerChunk = 64;
+
+struct RebaseImageInfo
+{
+  bool is_64;
+  std::uint16_t characteristics;
+  // Offset of ImageBase in the buffer.
+  std::size_t image_base_offset;
+  std::uint32_t reloc_dir_rva;
+  std::uint32_t reloc_dir_size;
+};
+
+// A validated fixup. Fixups are copied out of the directory when it's parsed,
+// as an earlier fixup may target the directory itself, and re-reading the
+// entries afterwards could then see an unvalidated type or offset.
+struct RebaseFixup
+{
+  // Offset in the buffer.
+  std::size_t target;
+  std::uint16_t type;
+};
+
+struct RebaseBlock
+{
+  // Range of the block's fixups in the parsed fixup list, excluding padding.
+  std::size_t first_fixup;
+  std::size_t num_fixups;
+  // Bytes written by the block's fixups, as [begin, end) offsets in the
+  // buffer. Empty if the block only has padding.
+  std::size_t begin;
+  std::size_t end;
+};
+
+template <typename T>
+T ReadRebaseField(std::uint8_t const* buffer,
+                  std::size_t size,
+                  std::size_t offset)
+{
+  if (offset > size || size - offset < sizeof(T))
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Invalid PE headers."});
+  }
+
+  T value;
+  std::memcpy(&value, buffer + offset, sizeof(value));
+  return value;
+}
+
+inline RebaseImageInfo GetRebaseImageInfo(std::uint8_t const* buffer,
+                                          std::size_t size)
+{
+  if (ReadRebaseField<std::uint16_t>(buffer, size, 0) != 0x5A4D)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Invalid DOS signature."});
+  }
+
+  std::size_t const nt = ReadRebaseField<std::uint32_t>(buffer, size, 0x3C);
+  if (ReadRebaseField<std::uint32_t>(buffer, size, nt) != 0x00004550)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"Invalid NT signature."});
+  }
+
+  RebaseImageInfo info;
+  info.characteristics =
+    ReadRebaseField<std::uint16_t>(buffer, size, nt + 4 + 18);
+
+  std::size_t const optional = nt + 4 + 20;
+  std::uint16_t const magic =
+    ReadRebaseField<std::uint16_t>(buffer, size, optional);
+  if (magic != 0x10B && magic != 0x20B)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Invalid optional header magic."});
+  }
+
+  info.is_64 = magic == 0x20B;
+  info.image_base_offset = optional + (info.is_64 ? 24 : 28);
+  std::size_t const num_dirs_offset = optional + (info.is_64 ? 108 : 92);
+  std::size_t const dirs_offset = optional + (info.is_64 ? 112 : 96);
+  // Make sure ImageBase is in the buffer.
+  (void)ReadRebaseField<std::uint32_t>(buffer, size, info.image_base_offset);
+
+  info.reloc_dir_rva = 0;
+  info.reloc_dir_size = 0;
+  if (ReadRebaseField<std::uint32_t>(buffer, size, num_dirs_offset) >
+      kDirEntryBaseReloc)
+  {
+    std::size_t const reloc_dir = dirs_offset + kDirEntryBaseReloc * 8;
+    info.reloc_dir_rva =
+      ReadRebaseField<std::uint32_t>(buffer, size, reloc_dir);
+    info.reloc_dir_size =
+      ReadRebaseField<std::uint32_t>(buffer, size, reloc_dir + 4);
+  }
+
+  return info;
+}
+
+inline std::size_t GetRelocWidth(std::uint16_t type) HADESMEM_DETAIL_NOEXCEPT
+{
+  switch (type)
+  {
+  case kRelocHigh:
+  case kRelocLow:
+    return 2;
+  case kRelocHighLow:
+    return 4;
+  case kRelocDir64:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+// Splits the relocation directory into blocks, checking that every fixup is
+// of a supported type and lies within the buffer. Returns the number of
+// fixups.
+inline std::size_t ParseRebaseBlocks(std::uint8_t const* buffer,
+                                     std::size_t size,
+                                     RebaseImageInfo const& info,
+                                     std::vector<RebaseBlock>& blocks,
+                                     std::vector<RebaseFixup>& fixups)
+{
+  std::size_t const dir_begin = info.reloc_dir_rva;
+  std::size_t const dir_end = dir_begin + info.reloc_dir_size;
+  if (dir_end > size || dir_end < dir_begin)
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Invalid relocation directory."});
+  }
+
+  std::size_t offset = dir_begin;
+  while (dir_end - offset >= 8)
+  {
+    std::uint32_t const block_rva =
+      ReadRebaseField<std::uint32_t>(buffer, size, offset);
+    std::uint32_t const size_of_block =
+      ReadRebaseField<std::uint32_t>(buffer, size, offset + 4);
+    // Some linkers pad the directory with an empty block.
+    if (!size_of_block)
+    {
+      break;
+    }
+
+    if (size_of_block < 8 || size_of_block > dir_end - offset)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid relocation block."}
+                << ErrorCodeOther{offset});
+    }
+
+    RebaseBlock block;
+    block.first_fixup = fixups.size();
+    block.num_fixups = 0;
+    block.begin = 0;
+    block.end = 0;
+    std::size_t const num_entries = (size_of_block - 8) / 2;
+    for (std::size_t i = 0; i < num_entries; ++i)
+    {
+      std::uint16_t const entry =
+        ReadRebaseField<std::uint16_t>(buffer, size, offset + 8 + i * 2);
+      std::uint16_t const type = static_cast<std::uint16_t>(entry >> 12);
+      if (type == kRelocAbsolute)
+      {
+        continue;
+      }
+
+      std::size_t const width = GetRelocWidth(type);
+      if (!width)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Unsupported relocation type."}
+                  << ErrorCodeOther{type});
+      }
+
+      std::size_t const target =
+        static_cast<std::size_t>(block_rva) + (entry & 0x0FFF);
+      if (target > size || size - target < width)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Relocation target out of bounds."}
+                  << ErrorCodeOther{target});
+      }
+
+      if (block.begin == block.end)
+      {
+        block.begin = target;
+        block.end = target + width;
+      }
+      else
+      {
+        block.begin = (std::min)(block.begin, target);
+        block.end = (std::max)(block.end, target + width);
+      }
+
+      RebaseFixup const fixup = {target, type};
+      fixups.push_back(fixup);
+      ++block.num_fixups;
+    }
+
+    blocks.push_back(block);
+    offset += size_of_block;
+  }
+
+  return fixups.size();
+}
+
+// Whether no two blocks write to the same byte, in which case they can be
+// applied in any order (and in parallel) with the same result as applying
+// them in directory order. Linkers emit one block per page in ascending order,
+// but nothing stops a malformed (or hand crafted) directory from repeating a
+// page, and a fixup near the end of a page can spill into the next one.
+inline bool AreRebaseBlocksDisjoint(std::vector<RebaseBlock> const& blocks)
+{
+  std::vector<std::pair<std::size_t, std::size_t>> ranges;
+  ranges.reserve(blocks.size());
+  for (auto const& block : blocks)
+  {
+    if (block.begin != block.end)
+    {
+      ranges.emplace_back(block.begin, block.end);
+    }
+  }
+
+  std::sort(std::begin(ranges), std::end(ranges));
+  for (std::size_t i = 1; i < ranges.size(); ++i)
+  {
+    if (ranges[i].first < ranges[i - 1].second)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <typename T>
+void ApplyFixup(std::uint8_t* target, T delta) HADESMEM_DETAIL_NOEXCEPT
+{
+  T value;
+  std::memcpy(&value, target, sizeof(value));
+  value = static_cast<T>(value + delta);
+  std::memcpy(target, &value, sizeof(value));
+}
+
+inline void ApplyRebaseBlock(std::uint8_t* buffer,
+                             RebaseFixup const* fixups,
+                             RebaseBlock const& block,
+                             std::uint64_t delta) HADESMEM_DETAIL_NOEXCEPT
+{
+  auto const delta_32 = static_cast<std::uint32_t>(delta);
+  auto const delta_low = static_cast<std::uint16_t>(delta);
+  auto const delta_high = static_cast<std::uint16_t>(delta >> 16);
+  for (std::size_t i = 0; i < block.num_fixups; ++i)
+  {
+    RebaseFixup const& fixup = fixups[block.first_fixup + i];
+    std::uint8_t* const target = buffer + fixup.target;
+    switch (fixup.type)
+    {
+    case kRelocHighLow:
+      ApplyFixup(target, delta_32);
+      break;
+    case kRelocDir64:
+      ApplyFixup(target, delta);
+      break;
+    case kRelocHigh:
+      ApplyFixup(target, delta_high);
+      break;
+    case kRelocLow:
+      ApplyFixup(target, delta_low);
+      break;
+    default:
+      break;
+    }
+  }
+}
+}
+
+inline std::uint64_t GetImageBase(void const* buffer, std::size_t size)
+{
+  auto const data = static_cast<std::uint8_t const*>(buffer);
+  auto const info = detail::GetRebaseImageInfo(data, size);
+  return info.is_64 ? detail::ReadRebaseField<std::uint64_t>(
+                        data, size, info.image_base_offset)
+                    : detail::ReadRebaseField<std::uint32_t>(
+                        data, size, info.image_base_offset);
+}
+
+// Applies the fixups needed to move the image from old_base to new_base and
+// sets ImageBase to new_base. Returns the number of fixups applied. Large
+// images can be rebased with several threads, each taking runs of blocks,
+// provided no two blocks write to the same bytes; otherwise the blocks are
+// applied on the calling thread in directory order, as the loader would. A
+// num_threads of zero uses one thread per hardware thread.
+inline std::size_t RebaseImage(void* buffer,
+                               std::size_t size,
+                               std::uint64_t old_base,
+                               std::uint64_t new_base,
+                               std::size_t num_threads = 1)
+{
+  auto const data = static_cast<std::uint8_t*>(buffer);
+  auto const info = detail::GetRebaseImageInfo(data, size);
+  if (!info.is_64 && (new_base >> 32))
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Base out of range for a 32-bit image."});
+  }
+
+  std::uint64_t const delta = new_base - old_base;
+  std::vector<detail::RebaseBlock> blocks;
+  std::vector<detail::RebaseFixup> fixups;
+  std::size_t num_fixups = 0;
+  if (delta)
+  {
+    if (info.characteristics & detail::kFileRelocsStripped)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Image has had its relocations stripped."});
+    }
+
+    num_fixups = detail::ParseRebaseBlocks(data, size, info, blocks, fixups);
+  }
+
+  if (!num_threads)
+  {
+    num_threads = (std::max)(std::thread::hardware_concurrency(), 1U);
+  }
+  std::size_t const num_chunks =
+    (blocks.size() + detail::kRebaseBlocksPerChunk - 1) /
+    detail::kRebaseBlocksPerChunk;
+  num_threads = (std::min)(num_threads, num_chunks);
+  if (num_threads > 1 && !detail::AreRebaseBlocksDisjoint(blocks))
+  {
+    num_threads = 1;
+  }
+
+  std::atomic<std::size_t> next_chunk(0);
+  auto const worker = [&]()
+  {
+    for (std::size_t i = next_chunk++; i < num_chunks; i = next_chunk++)
+    {
+      std::size_t const begin = i * detail::kRebaseBlocksPerChunk;
+      std::size_t const end =
+        (std::min)(begin + detail::kRebaseBlocksPerChunk, blocks.size());
+      for (std::size_t j = begin; j < end; ++j)
+      {
+        detail::ApplyRebaseBlock(data, fixups.data(), blocks[j], delta);
+      }
+    }
+  };
+
+  if (num_threads > 1)
+  {
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < num_threads; ++i)
+    {
+      threads.emplace_back(worker);
+    }
+
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+  }
+  else
+  {
+    worker();
+  }
+
+  if (info.is_64)
+  {
+    std::memcpy(data + info.image_base_offset, &new_base, sizeof(new_base));
+  }
+  else
+  {
+    auto const new_base_32 = static_cast<std::uint32_t>(new_base);
+    std::memcpy(
+      data + info.image_base_offset, &new_base_32, sizeof(new_base_32));
+  }
+
+  return num_fixups;
+}
+
+// Reverts the relocations of an image loaded at loaded_base, so that every
+// relocated pointer holds its RVA and ImageBase is zero. Images of the same
+// module dumped from processes with different ASLR bases are then byte for
+// byte comparable (apart from data actually written at runtime), and
+// RebaseImage(buffer, size, 0, base) relocates the image again.
+inline std::size_t UnrelocateImage(void* buffer,
+                                   std::size_t size,
+                                   std::uint64_t loaded_base,
+                                   std::size_t num_threads = 1)
+{
+  return RebaseImage(buffer, size, loaded_base, 0, num_threads);
+}
+}
@@ -7,6 +7,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <iosfwd>
+#include <limits>
 #include <memory>
 #include <ostream>
 #include <vector>
@@ -60,30 +61,70 @@ public:
 
   void UpdateRead()
   {
-    data_ = Read<IMAGE_TLS_DIRECTORY>(*process_, base_);
+    if (pe_file_->Is64())
+    {
+      data_ = Read<IMAGE_TLS_DIRECTORY64>(*process_, base_);
+    }
+    else
+    {
+      auto const tls_dir = Read<IMAGE_TLS_DIRECTORY32>(*process_, base_);
+      data_ = IMAGE_TLS_DIRECTORY64{};
+      data_.StartAddressOfRawData = tls_dir.StartAddressOfRawData;
+      data_.EndAddressOfRawData = tls_dir.EndAddressOfRawData;
+      data_.AddressOfIndex = tls_dir.AddressOfIndex;
+      data_.AddressOfCallBacks = tls_dir.AddressOfCallBacks;
+      data_.SizeOfZeroFill = tls_dir.SizeOfZeroFill;
+      data_.Characteristics = tls_dir.Characteristics;
+    }
   }
 
   void UpdateWrite()
   {
-    Write(*process_, base_, data_);
+    if (pe_file_->Is64())
+    {
+      Write(*process_, base_, data_);
+    }
+    else
+    {
+      ULONGLONG const kMaxValue = (std::numeric_limits<DWORD>::max)();
+      if (data_.StartAddressOfRawData > kMaxValue ||
+          data_.EndAddressOfRawData > kMaxValue ||
+          data_.AddressOfIndex > kMaxValue ||
+          data_.AddressOfCallBacks > kMaxValue)
+      {
+        HADESMEM_DETAIL_THROW_EXCEPTION(
+          Error{} << ErrorString{"Value does not fit in a PE32 TLS dir."});
+      }
+
+      IMAGE_TLS_DIRECTORY32 tls_dir = IMAGE_TLS_DIRECTORY32{};
+      tls_dir.StartAddressOfRawData =
+        static_cast<DWORD>(data_.StartAddressOfRawData);
+      tls_dir.EndAddressOfRawData =
+        static_cast<DWORD>(data_.EndAddressOfRawData);
+      tls_dir.AddressOfIndex = static_cast<DWORD>(data_.AddressOfIndex);
+      tls_dir.AddressOfCallBacks = static_cast<DWORD>(data_.AddressOfCallBacks);
+      tls_dir.SizeOfZeroFill = data_.SizeOfZeroFill;
+      tls_dir.Characteristics = data_.Characteristics;
+      Write(*process_, base_, tls_dir);
+    }
   }
 
-  DWORD_PTR GetStartAddressOfRawData() const
+  ULONGLONG GetStartAddressOfRawData() const
   {
     return data_.StartAddressOfRawData;
   }
 
-  DWORD_PTR GetEndAddressOfRawData() const
+  ULONGLONG GetEndAddressOfRawData() const
   {
     return data_.EndAddressOfRawData;
   }
 
-  DWORD_PTR GetAddressOfIndex() const
+  ULONGLONG GetAddressOfIndex() const
   {
     return data_.AddressOfIndex;
   }
 
-  DWORD_PTR GetAddressOfCallBacks() const
+  ULONGLONG GetAddressOfCallBacks() const
   {
     return data_.AddressOfCallBacks;
   }
@@ -96,8 +137,8 @@ public:
     HADESMEM_DETAIL_STATIC_ASSERT(
       std::is_base_of<std::output_iterator_tag, OutputIteratorCategory>::value);
 
-    ULONG_PTR image_base = GetRuntimeBase(*process_, *pe_file_);
-    auto callbacks_raw = reinterpret_cast<PIMAGE_TLS_CALLBACK*>(
+    ULONGLONG const image_base = GetRuntimeBase(*process_, *pe_file_);
+    auto callbacks_raw = static_cast<std::uint8_t*>(
       RvaToVa(*process_,
               *pe_file_,
               static_cast<DWORD>(GetAddressOfCallBacks() - image_base)));
@@ -107,12 +148,15 @@ public:
         Error{} << ErrorString{"TLS callbacks are invalid."});
     }
 
-    for (auto callback = Read<PIMAGE_TLS_CALLBACK>(*process_, callbacks_raw);
-         callback;
-         callback = Read<PIMAGE_TLS_CALLBACK>(*process_, ++callbacks_raw))
+    // Callbacks are stored as VAs of the file's own width, and returned as
+    // offsets from the image base.
+    std::size_t const callback_size =
+      pe_file_->Is64() ? sizeof(ULONGLONG) : sizeof(DWORD);
+    for (auto callback = ReadCallback(callbacks_raw); callback;
+         callback = ReadCallback(callbacks_raw += callback_size))
     {
-      DWORD_PTR const callback_offset =
-        reinterpret_cast<DWORD_PTR>(callback) - image_base;
+      auto const callback_offset =
+        static_cast<DWORD_PTR>(callback - image_base);
       *callbacks = reinterpret_cast<PIMAGE_TLS_CALLBACK>(callback_offset);
       ++callbacks;
     }
@@ -128,22 +172,22 @@ public:
     return data_.Characteristics;
   }
 
-  void SetStartAddressOfRawData(DWORD_PTR start_address_of_raw_data)
+  void SetStartAddressOfRawData(ULONGLONG start_address_of_raw_data)
   {
     data_.StartAddressOfRawData = start_address_of_raw_data;
   }
 
-  void SetEndAddressOfRawData(DWORD_PTR end_address_of_raw_data)
+  void SetEndAddressOfRawData(ULONGLONG end_address_of_raw_data)
   {
     data_.EndAddressOfRawData = end_address_of_raw_data;
   }
 
-  void SetAddressOfIndex(DWORD_PTR address_of_index)
+  void SetAddressOfIndex(ULONGLONG address_of_index)
   {
     data_.AddressOfIndex = address_of_index;
   }
 
-  void SetAddressOfCallBacks(DWORD_PTR address_of_callbacks)
+  void SetAddressOfCallBacks(ULONGLONG address_of_callbacks)
   {
     data_.AddressOfCallBacks = address_of_callbacks;
   }
@@ -159,10 +203,16 @@ public:
   }
 
 private:
+  ULONGLONG ReadCallback(void* address) const
+  {
+    return pe_file_->Is64() ? Read<ULONGLONG>(*process_, address)
+                            : Read<DWORD>(*process_, address);
+  }
+
   Process const* process_;
   PeFile const* pe_file_;
   std::uint8_t* base_{};
-  IMAGE_TLS_DIRECTORY data_ = IMAGE_TLS_DIRECTORY{};
+  IMAGE_TLS_DIRECTORY64 data_ = IMAGE_TLS_DIRECTORY64{};
 };
 
 inline bool operator==(TlsDir const& lhs,
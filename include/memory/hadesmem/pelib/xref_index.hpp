@@ -0,0 +1,250 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/xref_builder.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/pelib/export.hpp>
+#include <hadesmem/pelib/export_list.hpp>
+#include <hadesmem/pelib/nt_headers.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/pelib/relocation.hpp>
+#include <hadesmem/pelib/relocation_block.hpp>
+#include <hadesmem/pelib/relocation_block_list.hpp>
+#include <hadesmem/pelib/relocation_list.hpp>
+#include <hadesmem/pelib/section.hpp>
+#include <hadesmem/pelib/section_list.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+// Cross reference index of a module. The code sections are disassembled once
+// (in parallel) and every call/jmp target, RIP-relative operand and relocated
+// absolute address is stored sorted by target RVA, so 'who references X' is a
+// binary search rather than a pattern scan. Works on both PeFileType::Image
+// and PeFileType::Data, so a module can be indexed offline from disk, and the
+// index can be saved and loaded.
+
+namespace hadesmem
+{
+class XrefIndex
+{
+public:
+  using const_iterator = std::vector<Xref>::const_iterator;
+  using Range = std::pair<const_iterator, const_iterator>;
+
+  explicit XrefIndex(Process const& process,
+                     PeFile const& pe_file,
+                     std::size_t num_threads = 0)
+  {
+    NtHeaders const nt_headers{process, pe_file};
+
+    detail::XrefImageInfo image;
+    image.is_64 = nt_headers.GetMachine() == IMAGE_FILE_MACHINE_AMD64;
+    image.image_size = nt_headers.GetSizeOfImage();
+
+    std::vector<std::pair<DWORD, std::vector<std::uint8_t>>> buffers;
+    SectionList const sections{process, pe_file};
+    for (auto const& section : sections)
+    {
+      if (!(section.GetCharacteristics() & IMAGE_SCN_CNT_CODE))
+      {
+        continue;
+      }
+
+      DWORD const rva = section.GetVirtualAddress();
+      void* const va = RvaToVa(process, pe_file, rva);
+      std::size_t const size = GetSectionDataSize(pe_file, section, va);
+      if (!va || !size)
+      {
+        continue;
+      }
+
+      buffers.emplace_back(rva, ReadVector<std::uint8_t>(process, va, size));
+    }
+
+    for (auto const& buffer : buffers)
+    {
+      detail::XrefCodeRegion const region = {
+        buffer.first, buffer.second.data(), buffer.second.size()};
+      image.code.push_back(region);
+    }
+
+    if (DWORD const entry_point = nt_headers.GetAddressOfEntryPoint())
+    {
+      image.hints.push_back(entry_point);
+    }
+
+    ExportList const exports{process, pe_file};
+    for (auto const& e : exports)
+    {
+      if (!e.IsForwarded())
+      {
+        image.hints.push_back(e.GetRva());
+      }
+    }
+
+    AddRelocations(process, pe_file, nt_headers, image);
+
+    xrefs_ = detail::BuildXrefs(image, num_threads);
+  }
+
+  explicit XrefIndex(Process&& process,
+                     PeFile const& pe_file,
+                     std::size_t num_threads = 0) = delete;
+
+  explicit XrefIndex(void const* data, std::size_t len)
+    : xrefs_(detail::DeserializeXrefs(data, len))
+  {
+  }
+
+  explicit XrefIndex(std::wstring const& path)
+  {
+    auto const buf = detail::FileToBuffer(path);
+    xrefs_ = detail::DeserializeXrefs(buf.data(), buf.size());
+  }
+
+  const_iterator begin() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return std::begin(xrefs_);
+  }
+
+  const_iterator end() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return std::end(xrefs_);
+  }
+
+  std::size_t size() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return xrefs_.size();
+  }
+
+  // All references to the given RVA, ordered by source.
+  Range FindReferencesTo(DWORD rva) const
+  {
+    return FindReferencesToRange(rva, rva + 1);
+  }
+
+  // All references to any RVA in [beg, end), ordered by target then source.
+  Range FindReferencesToRange(DWORD beg, DWORD end) const
+  {
+    auto const lower = [](Xref const& xref, DWORD rva)
+    {
+      return xref.to < rva;
+    };
+    auto const first =
+      std::lower_bound(std::begin(xrefs_), std::end(xrefs_), beg, lower);
+    auto const last = std::lower_bound(first, std::end(xrefs_), end, lower);
+    return {first, last};
+  }
+
+  std::vector<std::uint8_t> Serialize() const
+  {
+    return detail::SerializeXrefs(xrefs_);
+  }
+
+  void Save(std::wstring const& path) const
+  {
+    auto const buf = Serialize();
+    detail::BufferToFile(
+      path, buf.data(), static_cast<std::streamsize>(buf.size()));
+  }
+
+private:
+  // Images are zero filled up to the virtual size but files only contain the
+  // raw data, which may be shorter (or longer, due to file alignment).
+  static std::size_t GetSectionDataSize(PeFile const& pe_file,
+                                        Section const& section,
+                                        void* va)
+  {
+    DWORD const virtual_size = section.GetVirtualSize();
+    DWORD const raw_size = section.GetSizeOfRawData();
+    if (pe_file.GetType() == PeFileType::Image)
+    {
+      return virtual_size ? virtual_size : raw_size;
+    }
+
+    std::size_t size = virtual_size ? (std::min)(virtual_size, raw_size)
+                                    : raw_size;
+    auto const file_beg = static_cast<std::uint8_t*>(pe_file.GetBase());
+    auto const file_end = file_beg + pe_file.GetSize();
+    auto const section_beg = static_cast<std::uint8_t*>(va);
+    if (section_beg < file_beg || section_beg >= file_end)
+    {
+      return 0;
+    }
+    return (std::min)(size, static_cast<std::size_t>(file_end - section_beg));
+  }
+
+  // Relocated pointers give absolute references. Those which point into code
+  // (e.g. function pointers and jump tables) are also used as hints.
+  static void AddRelocations(Process const& process,
+                             PeFile const& pe_file,
+                             NtHeaders const& nt_headers,
+                             detail::XrefImageInfo& image)
+  {
+    // Images have already been relocated to their runtime base.
+    ULONGLONG const base =
+      pe_file.GetType() == PeFileType::Image
+        ? reinterpret_cast<ULONG_PTR>(pe_file.GetBase())
+        : nt_headers.GetImageBase();
+    auto const file_end =
+      static_cast<std::uint8_t*>(pe_file.GetBase()) + pe_file.GetSize();
+
+    RelocationBlockList const blocks{process, pe_file};
+    for (auto const& block : blocks)
+    {
+      RelocationList const relocs{process,
+                                  pe_file,
+                                  block.GetRelocationDataStart(),
+                                  block.GetNumberOfRelocations()};
+      for (auto const& reloc : relocs)
+      {
+        std::uint8_t const type = reloc.GetType();
+        if (type != IMAGE_REL_BASED_HIGHLOW && type != IMAGE_REL_BASED_DIR64)
+        {
+          continue;
+        }
+
+        DWORD const site = block.GetVirtualAddress() + reloc.GetOffset();
+        auto const va = static_cast<std::uint8_t*>(
+          RvaToVa(process, pe_file, site));
+        std::size_t const ptr_size = type == IMAGE_REL_BASED_DIR64 ? 8 : 4;
+        if (!va || (pe_file.GetType() == PeFileType::Data &&
+                    (va < static_cast<std::uint8_t*>(pe_file.GetBase()) ||
+                     va + ptr_size > file_end)))
+        {
+          continue;
+        }
+
+        ULONGLONG const value = type == IMAGE_REL_BASED_DIR64
+                                  ? Read<ULONGLONG>(process, va)
+                                  : Read<DWORD>(process, va);
+        if (value < base || value - base >= image.image_size)
+        {
+          continue;
+        }
+
+        auto const target = static_cast<std::uint32_t>(value - base);
+        Xref const xref = {site, target, XrefType::kAbsolute};
+        image.extra.push_back(xref);
+        image.hints.push_back(target);
+      }
+    }
+  }
+
+  std::vector<Xref> xrefs_;
+};
+}
@@ -0,0 +1,65 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/module.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+
+namespace hadesmem
+{
+// Chain of pointers starting from a module, which (unlike a raw address)
+// stays valid across restarts of the target and across processes running the
+// same binary. Resolution starts at the module base plus base_offset, then
+// for each offset reads the pointer at the current address and adds the
+// offset to it. Pointers are the size of our own.
+struct PointerPath
+{
+  // Empty for the main module.
+  std::wstring module;
+  std::uintptr_t base_offset;
+  std::vector<std::ptrdiff_t> offsets;
+};
+
+namespace detail
+{
+inline void* ResolvePointerPath(Process const& process,
+                                PointerPath const& path,
+                                void* module_base)
+{
+  auto address = static_cast<std::uint8_t*>(module_base) + path.base_offset;
+  for (auto const offset : path.offsets)
+  {
+    auto const pointer = Read<std::uint8_t*>(process, address);
+    if (!pointer)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Null pointer in pointer path."}
+                << ErrorCodeOther{reinterpret_cast<DWORD_PTR>(address)});
+    }
+
+    address = pointer + offset;
+  }
+
+  return address;
+}
+}
+
+inline void* ResolvePointerPath(Process const& process,
+                                PointerPath const& path)
+{
+  Module const module = path.module.empty() ? Module{process, nullptr}
+                                            : Module{process, path.module};
+  return detail::ResolvePointerPath(process, path, module.GetHandle());
+}
+}
@@ -3,6 +3,20 @@
 
 #pragma once
 
+// Elsewhere the Linux backend takes the place of the Windows one. Process,
+// Read, Write, Region, RegionList, Snapshot and Find come from hadesmem::procfs
+// under the same names, so code using only those builds for either.
+#if !defined(_WIN32)
+
+#include <hadesmem/linux/process.hpp>
+
+namespace hadesmem
+{
+using procfs::Process;
+}
+
+#else // #if !defined(_WIN32)
+
 #include <memory>
 #include <ostream>
 #include <string>
@@ -190,3 +204,5 @@ inline std::wostream& operator<<(std::wostream& lhs, Process const& rhs)
   return lhs;
 }
 }
+
+#endif // #if !defined(_WIN32)
@@ -3,6 +3,20 @@
 
 #pragma once
 
+#if !defined(_WIN32)
+
+#include <hadesmem/linux/read.hpp>
+
+namespace hadesmem
+{
+using procfs::Read;
+using procfs::ReadRequest;
+using procfs::ReadScatter;
+using procfs::ReadVector;
+}
+
+#else // #if !defined(_WIN32)
+
 #include <array>
 #include <cstddef>
 #include <exception>
@@ -266,3 +280,5 @@ inline void ReadVector(Process const& process,
   return ReadVectorEx<T>(process, address, count, out, ReadFlags::kNone);
 }
 }
+
+#endif // #if !defined(_WIN32)
@@ -3,6 +3,17 @@
 
 #pragma once
 
+#if !defined(_WIN32)
+
+#include <hadesmem/linux/region.hpp>
+
+namespace hadesmem
+{
+using procfs::Region;
+}
+
+#else // #if !defined(_WIN32)
+
 #include <memory>
 #include <ostream>
 #include <utility>
@@ -126,3 +137,5 @@ inline std::wostream& operator<<(std::wostream& lhs, Region const& rhs)
   return lhs;
 }
 }
+
+#endif // #if !defined(_WIN32)
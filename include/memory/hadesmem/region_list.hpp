@@ -3,6 +3,17 @@
 
 #pragma once
 
+#if !defined(_WIN32)
+
+#include <hadesmem/linux/region_list.hpp>
+
+namespace hadesmem
+{
+using procfs::RegionList;
+}
+
+#else // #if !defined(_WIN32)
+
 #include <iterator>
 #include <memory>
 #include <utility>
@@ -202,3 +213,5 @@ private:
   Process const* process_;
 };
 }
+
+#endif // #if !defined(_WIN32)
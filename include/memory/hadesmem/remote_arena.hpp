@@ -0,0 +1,449 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+
+// Sub-allocator for small remote allocations. Every VirtualAllocEx call costs
+// a round trip to the kernel and reserves a whole allocation granule (64KB)
+// of the target's address space, however little is asked for, so instead
+// large chunks are reserved up front and committed as required, and small
+// allocations are carved from them in power of two size classes. All of the
+// bookkeeping (free lists, live allocations) is kept on the local side, so
+// allocating and freeing don't touch the target at all once a chunk is
+// committed.
+//
+// Not thread safe. The arena must outlive any Allocator obtained from it.
+
+namespace hadesmem
+{
+enum class RemoteArenaPool
+{
+  // PAGE_READWRITE. For data such as strings, VMTs and return values.
+  kReadWrite,
+  // PAGE_EXECUTE_READ. For code. Write handles the temporary protection
+  // change required to fill it in.
+  kExecute,
+  kInvalidMaxValue
+};
+
+struct RemoteArenaStats
+{
+  // Chunks reserved in the target (not counting large allocations).
+  std::size_t num_chunks;
+  SIZE_T reserved;
+  SIZE_T committed;
+  // Size of live allocations, rounded up to their size class.
+  SIZE_T in_use;
+  std::size_t num_live;
+  std::size_t num_allocs;
+  std::size_t num_frees;
+  // Allocations too large for a size class, which get their own
+  // VirtualAllocEx.
+  std::size_t num_large;
+  // Number of VirtualAllocEx calls made, including commits.
+  std::size_t num_remote_allocs;
+};
+
+class RemoteArena
+{
+public:
+  static SIZE_T const kMinSizeClass = 16;
+  static SIZE_T const kMaxSizeClass = 4096;
+  static std::size_t const kNumSizeClasses = 9;
+  static SIZE_T const kDefaultChunkSize = 1 << 20;
+  // Matches the allocation granularity, so each commit is worth the call.
+  static SIZE_T const kCommitSize = 1 << 16;
+
+  explicit RemoteArena(Process const& process,
+                       SIZE_T chunk_size = kDefaultChunkSize)
+    : process_{&process},
+      chunk_size_{RoundUp(chunk_size, kCommitSize)},
+      chunks_(),
+      current_chunk_(),
+      free_lists_(),
+      live_(),
+      owned_(),
+      stats_()
+  {
+    HADESMEM_DETAIL_ASSERT(chunk_size_ >= kMaxSizeClass);
+  }
+
+  explicit RemoteArena(Process&& process,
+                       SIZE_T chunk_size = kDefaultChunkSize) = delete;
+
+  RemoteArena(RemoteArena const& other) = delete;
+
+  RemoteArena& operator=(RemoteArena const& other) = delete;
+
+  ~RemoteArena()
+  {
+    ReleaseUnchecked();
+  }
+
+  // Raw allocation, to be returned with Free or bulk freed with Reset.
+  PVOID AllocateRaw(SIZE_T size,
+                    RemoteArenaPool pool = RemoteArenaPool::kReadWrite)
+  {
+    return AllocateImpl(size, pool, false);
+  }
+
+  // Allocation which is returned to the arena when the Allocator is freed or
+  // destroyed, so it can be used anywhere an Allocator from VirtualAllocEx
+  // could.
+  Allocator Allocate(SIZE_T size,
+                     RemoteArenaPool pool = RemoteArenaPool::kReadWrite)
+  {
+    PVOID const base = AllocateImpl(size, pool, true);
+    return Allocator{*process_, base, size, &RemoteArena::FreeThunk, this};
+  }
+
+  void Free(PVOID address)
+  {
+    auto const iter = live_.find(address);
+    if (iter == std::end(live_))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Address is not a live arena allocation."});
+    }
+
+    LiveAllocation const live = iter->second;
+    live_.erase(iter);
+    ++stats_.num_frees;
+    stats_.in_use -= live.size;
+    owned_ -= live.owned;
+
+    if (live.class_idx == kLargeSizeClass)
+    {
+      --stats_.num_large;
+      ::hadesmem::Free(*process_, address);
+      return;
+    }
+
+    free_lists_[static_cast<std::size_t>(live.pool)][live.class_idx]
+      .push_back(address);
+  }
+
+  // Frees every allocation at once. Chunks are kept (and stay committed) for
+  // reuse, and large allocations are released. Must not be called while any
+  // Allocator from Allocate is outstanding.
+  void Reset()
+  {
+    HADESMEM_DETAIL_ASSERT(owned_ == 0);
+
+    for (auto const& live : live_)
+    {
+      if (live.second.class_idx == kLargeSizeClass)
+      {
+        ::hadesmem::Free(*process_, live.first);
+      }
+    }
+    live_.clear();
+
+    for (auto& pool_lists : free_lists_)
+    {
+      for (auto& list : pool_lists)
+      {
+        list.clear();
+      }
+    }
+
+    for (std::size_t i = 0; i < kNumPools; ++i)
+    {
+      for (auto& chunk : chunks_[i])
+      {
+        chunk.used = 0;
+      }
+      current_chunk_[i] = 0;
+    }
+
+    stats_.in_use = 0;
+    stats_.num_large = 0;
+    owned_ = 0;
+  }
+
+  // Frees every allocation and releases all chunks. Same restrictions as
+  // Reset.
+  void Release()
+  {
+    Reset();
+
+    for (auto& pool_chunks : chunks_)
+    {
+      for (auto const& chunk : pool_chunks)
+      {
+        ::hadesmem::Free(*process_, chunk.base);
+      }
+      pool_chunks.clear();
+    }
+
+    stats_.num_chunks = 0;
+    stats_.reserved = 0;
+    stats_.committed = 0;
+  }
+
+  RemoteArenaStats GetStats() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    RemoteArenaStats stats = stats_;
+    stats.num_live = live_.size();
+    return stats;
+  }
+
+  Process const& GetProcess() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return *process_;
+  }
+
+  SIZE_T GetChunkSize() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return chunk_size_;
+  }
+
+  // Size class an allocation of the given size is served from, or zero if it
+  // is too large for any class and gets its own VirtualAllocEx.
+  static SIZE_T GetSizeClass(SIZE_T size) HADESMEM_DETAIL_NOEXCEPT
+  {
+    if (size > kMaxSizeClass)
+    {
+      return 0;
+    }
+
+    SIZE_T size_class = kMinSizeClass;
+    while (size_class < size)
+    {
+      size_class <<= 1;
+    }
+    return size_class;
+  }
+
+private:
+  static std::size_t const kLargeSizeClass = static_cast<std::size_t>(-1);
+  static std::size_t const kNumPools =
+    static_cast<std::size_t>(RemoteArenaPool::kInvalidMaxValue);
+
+  struct Chunk
+  {
+    std::uint8_t* base;
+    SIZE_T used;
+    SIZE_T committed;
+  };
+
+  struct LiveAllocation
+  {
+    RemoteArenaPool pool;
+    std::size_t class_idx;
+    SIZE_T size;
+    bool owned;
+  };
+
+  static SIZE_T RoundUp(SIZE_T size, SIZE_T alignment) HADESMEM_DETAIL_NOEXCEPT
+  {
+    return (size + alignment - 1) & ~(alignment - 1);
+  }
+
+  static DWORD GetProtect(RemoteArenaPool pool) HADESMEM_DETAIL_NOEXCEPT
+  {
+    return pool == RemoteArenaPool::kExecute ? PAGE_EXECUTE_READ
+                                             : PAGE_READWRITE;
+  }
+
+  static void FreeThunk(void* context, PVOID base)
+  {
+    static_cast<RemoteArena*>(context)->Free(base);
+  }
+
+  PVOID VirtualAllocChecked(PVOID base, SIZE_T size, DWORD type, DWORD protect)
+  {
+    PVOID const address =
+      ::VirtualAllocEx(process_->GetHandle(), base, size, type, protect);
+    if (!address)
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"VirtualAllocEx failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    ++stats_.num_remote_allocs;
+    return address;
+  }
+
+  PVOID AllocateImpl(SIZE_T size, RemoteArenaPool pool, bool owned)
+  {
+    HADESMEM_DETAIL_ASSERT(size != 0);
+    HADESMEM_DETAIL_ASSERT(pool < RemoteArenaPool::kInvalidMaxValue);
+
+    if (!size)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Invalid allocation size."});
+    }
+
+    auto const pool_idx = static_cast<std::size_t>(pool);
+    SIZE_T const size_class = GetSizeClass(size);
+    PVOID address = nullptr;
+    std::size_t class_idx = kLargeSizeClass;
+    SIZE_T in_use = size;
+    if (!size_class)
+    {
+      address = VirtualAllocChecked(
+        nullptr, size, MEM_COMMIT | MEM_RESERVE, GetProtect(pool));
+      ++stats_.num_large;
+    }
+    else
+    {
+      class_idx = 0;
+      while ((kMinSizeClass << class_idx) < size_class)
+      {
+        ++class_idx;
+      }
+      in_use = size_class;
+
+      auto& free_list = free_lists_[pool_idx][class_idx];
+      if (!free_list.empty())
+      {
+        address = free_list.back();
+        free_list.pop_back();
+      }
+      else
+      {
+        address = Carve(pool, size_class);
+      }
+    }
+
+    try
+    {
+      LiveAllocation const live = {pool, class_idx, in_use, owned};
+      live_.emplace(address, live);
+    }
+    catch (...)
+    {
+      if (class_idx == kLargeSizeClass)
+      {
+        --stats_.num_large;
+        ::hadesmem::Free(*process_, address);
+      }
+      else
+      {
+        free_lists_[pool_idx][class_idx].push_back(address);
+      }
+      throw;
+    }
+
+    ++stats_.num_allocs;
+    stats_.in_use += in_use;
+    owned_ += owned;
+    return address;
+  }
+
+  // Takes a new block from the end of the pool's current chunk, committing
+  // more of it or reserving a new chunk as required. Blocks are aligned to
+  // their size class (which is at most a page), so they never straddle a
+  // commit boundary.
+  PVOID Carve(RemoteArenaPool pool, SIZE_T size_class)
+  {
+    auto const pool_idx = static_cast<std::size_t>(pool);
+    auto& pool_chunks = chunks_[pool_idx];
+    auto& current = current_chunk_[pool_idx];
+    for (;; ++current)
+    {
+      if (current == pool_chunks.size())
+      {
+        PVOID const base = VirtualAllocChecked(
+          nullptr, chunk_size_, MEM_RESERVE, PAGE_NOACCESS);
+        Chunk const chunk = {static_cast<std::uint8_t*>(base), 0, 0};
+        try
+        {
+          pool_chunks.push_back(chunk);
+        }
+        catch (...)
+        {
+          ::hadesmem::Free(*process_, base);
+          throw;
+        }
+        ++stats_.num_chunks;
+        stats_.reserved += chunk_size_;
+      }
+
+      Chunk& chunk = pool_chunks[current];
+      SIZE_T const beg = RoundUp(chunk.used, size_class);
+      if (beg + size_class > chunk_size_)
+      {
+        continue;
+      }
+
+      if (beg + size_class > chunk.committed)
+      {
+        SIZE_T const commit_size =
+          RoundUp(beg + size_class - chunk.committed, kCommitSize);
+        VirtualAllocChecked(chunk.base + chunk.committed,
+                            commit_size,
+                            MEM_COMMIT,
+                            GetProtect(pool));
+        chunk.committed += commit_size;
+        stats_.committed += commit_size;
+      }
+
+      chunk.used = beg + size_class;
+      return chunk.base + beg;
+    }
+  }
+
+  void ReleaseUnchecked() HADESMEM_DETAIL_NOEXCEPT
+  {
+    try
+    {
+      Release();
+    }
+    catch (...)
+    {
+      // WARNING: Memory in remote process is leaked if 'Release' fails.
+      HADESMEM_DETAIL_TRACE_A(
+        boost::current_exception_diagnostic_information().c_str());
+      HADESMEM_DETAIL_ASSERT(false);
+    }
+  }
+
+  Process const* process_;
+  SIZE_T chunk_size_;
+  std::array<std::vector<Chunk>, kNumPools> chunks_;
+  std::array<std::size_t, kNumPools> current_chunk_;
+  std::array<std::array<std::vector<PVOID>, kNumSizeClasses>, kNumPools>
+    free_lists_;
+  std::unordered_map<PVOID, LiveAllocation> live_;
+  std::size_t owned_;
+  RemoteArenaStats stats_;
+};
+
+namespace detail
+{
+// Allocation for call sites which can optionally use an arena.
+inline Allocator AllocateFrom(Process const& process,
+                              RemoteArena* arena,
+                              SIZE_T size,
+                              RemoteArenaPool pool)
+{
+  if (arena)
+  {
+    HADESMEM_DETAIL_ASSERT(&arena->GetProcess() == &process);
+    return arena->Allocate(size, pool);
+  }
+
+  return Allocator{process, size};
+}
+}
+}
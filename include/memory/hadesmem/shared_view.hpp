@@ -0,0 +1,329 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include <windows.h>
+#include <winternl.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/smart_handle.hpp>
+#include <hadesmem/detail/static_assert.hpp>
+#include <hadesmem/detail/trace.hpp>
+#include <hadesmem/detail/type_traits.hpp>
+#include <hadesmem/detail/winapi.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+
+// A pagefile backed section mapped into both this process and the target, so
+// that memory the target writes to the view can be read here directly, with
+// no system call or kernel copy per read. Useful for large structures which
+// are polled frequently, where injected code (or a hook) in the target
+// publishes into the view. Concurrent updates can be read consistently by
+// having the writer wrap each update in BeginSeqLockWrite/EndSeqLockWrite and
+// reading it with ReadSeqLocked.
+
+namespace hadesmem
+{
+namespace detail
+{
+// SECTION_INHERIT::ViewUnmap. The view is not inherited by child processes.
+DWORD const kSectionViewUnmap = 2;
+
+inline PVOID MapViewOfSectionRemote(Process const& process,
+                                    HANDLE section,
+                                    SIZE_T size,
+                                    PVOID base)
+{
+  using FnNtMapViewOfSection = NTSTATUS(NTAPI*)(HANDLE section,
+                                                HANDLE process,
+                                                PVOID* base,
+                                                ULONG_PTR zero_bits,
+                                                SIZE_T commit_size,
+                                                PLARGE_INTEGER section_offset,
+                                                PSIZE_T view_size,
+                                                DWORD inherit_disposition,
+                                                ULONG allocation_type,
+                                                ULONG protect);
+  auto const nt_map_view_of_section =
+    GetNtdllProc<FnNtMapViewOfSection>("NtMapViewOfSection");
+
+  PVOID remote_base = base;
+  SIZE_T view_size = size;
+  NTSTATUS const status = nt_map_view_of_section(section,
+                                                 process.GetHandle(),
+                                                 &remote_base,
+                                                 0,
+                                                 0,
+                                                 nullptr,
+                                                 &view_size,
+                                                 kSectionViewUnmap,
+                                                 0,
+                                                 PAGE_READWRITE);
+  if (!NT_SUCCESS(status))
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                    << ErrorString{"NtMapViewOfSection failed."}
+                                    << ErrorCodeWinStatus{status});
+  }
+
+  return remote_base;
+}
+
+inline void UnmapViewOfSectionRemote(Process const& process, PVOID base)
+{
+  using FnNtUnmapViewOfSection = NTSTATUS(NTAPI*)(HANDLE process, PVOID base);
+  auto const nt_unmap_view_of_section =
+    GetNtdllProc<FnNtUnmapViewOfSection>("NtUnmapViewOfSection");
+
+  NTSTATUS const status =
+    nt_unmap_view_of_section(process.GetHandle(), base);
+  if (!NT_SUCCESS(status))
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"NtUnmapViewOfSection failed."}
+              << ErrorCodeWinStatus{status});
+  }
+}
+}
+
+class SharedView
+{
+public:
+  // Maps the view at remote_base in the target if given (it must be free and
+  // aligned to the allocation granularity), otherwise wherever the system
+  // chooses.
+  explicit SharedView(Process const& process,
+                      SIZE_T size,
+                      PVOID remote_base = nullptr)
+    : process_{&process}, size_{size}
+  {
+    HADESMEM_DETAIL_ASSERT(size_ != 0);
+
+    auto const size_64 = static_cast<std::uint64_t>(size);
+    section_ = ::CreateFileMappingW(INVALID_HANDLE_VALUE,
+                                    nullptr,
+                                    PAGE_READWRITE,
+                                    static_cast<DWORD>(size_64 >> 32),
+                                    static_cast<DWORD>(size_64),
+                                    nullptr);
+    if (!section_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"CreateFileMappingW failed."}
+                << ErrorCodeWinLast{last_error});
+    }
+
+    local_view_ = ::MapViewOfFile(
+      section_.GetHandle(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size);
+    if (!local_view_.IsValid())
+    {
+      DWORD const last_error = ::GetLastError();
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"MapViewOfFile failed."}
+                                      << ErrorCodeWinLast{last_error});
+    }
+
+    remote_base_ = detail::MapViewOfSectionRemote(
+      process, section_.GetHandle(), size, remote_base);
+  }
+
+  explicit SharedView(Process&& process,
+                      SIZE_T size,
+                      PVOID remote_base = nullptr) = delete;
+
+  SharedView(SharedView const& other) = delete;
+
+  SharedView& operator=(SharedView const& other) = delete;
+
+  SharedView(SharedView&& other) HADESMEM_DETAIL_NOEXCEPT
+    : process_{other.process_},
+      size_{other.size_},
+      section_{std::move(other.section_)},
+      local_view_{std::move(other.local_view_)},
+      remote_base_{other.remote_base_}
+  {
+    other.process_ = nullptr;
+    other.size_ = 0;
+    other.remote_base_ = nullptr;
+  }
+
+  SharedView& operator=(SharedView&& other) HADESMEM_DETAIL_NOEXCEPT
+  {
+    UnmapRemoteUnchecked();
+
+    process_ = other.process_;
+    other.process_ = nullptr;
+
+    size_ = other.size_;
+    other.size_ = 0;
+
+    section_ = std::move(other.section_);
+
+    local_view_ = std::move(other.local_view_);
+
+    remote_base_ = other.remote_base_;
+    other.remote_base_ = nullptr;
+
+    return *this;
+  }
+
+  ~SharedView()
+  {
+    UnmapRemoteUnchecked();
+  }
+
+  // Unmaps the view from the target. The local view stays valid until
+  // destruction.
+  void UnmapRemote()
+  {
+    if (!remote_base_)
+    {
+      return;
+    }
+
+    detail::UnmapViewOfSectionRemote(*process_, remote_base_);
+    remote_base_ = nullptr;
+  }
+
+  // Base of the view in this process.
+  PVOID GetBase() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return local_view_.GetHandle();
+  }
+
+  // Base of the view in the target.
+  PVOID GetRemoteBase() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return remote_base_;
+  }
+
+  SIZE_T GetSize() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return size_;
+  }
+
+  // Translates an address in the target's view to the same byte in ours.
+  PVOID RemoteToLocal(PVOID remote_address) const
+  {
+    auto const offset = static_cast<std::uint8_t*>(remote_address) -
+                        static_cast<std::uint8_t*>(remote_base_);
+    if (!remote_base_ || offset < 0 ||
+        static_cast<SIZE_T>(offset) >= size_)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error{} << ErrorString{"Address is outside the shared view."});
+    }
+
+    return static_cast<std::uint8_t*>(GetBase()) + offset;
+  }
+
+private:
+  void UnmapRemoteUnchecked() HADESMEM_DETAIL_NOEXCEPT
+  {
+    try
+    {
+      UnmapRemote();
+    }
+    catch (...)
+    {
+      // WARNING: The view is leaked in the target if the unmap fails (which
+      // is expected if it has exited).
+      HADESMEM_DETAIL_TRACE_A(
+        boost::current_exception_diagnostic_information().c_str());
+
+      remote_base_ = nullptr;
+    }
+  }
+
+  Process const* process_;
+  SIZE_T size_;
+  detail::SmartHandle section_;
+  detail::SmartMappedFileHandle local_view_;
+  PVOID remote_base_{};
+};
+
+// Sequence lock for data in a shared view. The writer (typically in the
+// target) makes the sequence odd for the duration of each update, and readers
+// retry any copy which overlapped an update. Readers never block the writer.
+struct SeqLock
+{
+  std::uint32_t volatile sequence;
+};
+
+inline void BeginSeqLockWrite(SeqLock& lock) HADESMEM_DETAIL_NOEXCEPT
+{
+  HADESMEM_DETAIL_ASSERT(!(lock.sequence & 1));
+  ::InterlockedIncrement(reinterpret_cast<LONG volatile*>(&lock.sequence));
+}
+
+inline void EndSeqLockWrite(SeqLock& lock) HADESMEM_DETAIL_NOEXCEPT
+{
+  HADESMEM_DETAIL_ASSERT(!!(lock.sequence & 1));
+  ::InterlockedIncrement(reinterpret_cast<LONG volatile*>(&lock.sequence));
+}
+
+// Copies size bytes from src (which the lock protects) to dst. Spins briefly
+// while an update is in progress before falling back to yielding the thread.
+// Returns false if no consistent copy could be taken in max_attempts, e.g.
+// because the writer died mid-update.
+inline bool TryReadSeqLocked(SeqLock const& lock,
+                             void const* src,
+                             void* dst,
+                             std::size_t size,
+                             std::uint32_t max_attempts = 100000)
+  HADESMEM_DETAIL_NOEXCEPT
+{
+  std::uint32_t const kSpinCount = 1000;
+
+  for (std::uint32_t i = 0; i < max_attempts; ++i)
+  {
+    std::uint32_t const begin = lock.sequence;
+    if (begin & 1)
+    {
+      if (i < kSpinCount)
+      {
+        ::YieldProcessor();
+      }
+      else
+      {
+        ::Sleep(0);
+      }
+      continue;
+    }
+
+    // The barriers keep the copy from moving outside the two sequence reads.
+    ::MemoryBarrier();
+    std::memcpy(dst, src, size);
+    ::MemoryBarrier();
+
+    if (lock.sequence == begin)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <typename T> T ReadSeqLocked(SeqLock const& lock, T const* src)
+{
+  HADESMEM_DETAIL_STATIC_ASSERT(detail::IsTriviallyCopyable<T>::value);
+
+  T data;
+  if (!TryReadSeqLocked(lock, src, &data, sizeof(data)))
+  {
+    HADESMEM_DETAIL_THROW_EXCEPTION(
+      Error{} << ErrorString{"Failed to take a consistent copy."});
+  }
+  return data;
+}
+}
@@ -0,0 +1,241 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#pragma once
+
+#if !defined(_WIN32)
+
+#include <hadesmem/linux/snapshot.hpp>
+
+namespace hadesmem
+{
+using procfs::Snapshot;
+}
+
+#else // #if !defined(_WIN32)
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <windows.h>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/assert.hpp>
+#include <hadesmem/detail/query_region.hpp>
+#include <hadesmem/detail/read_impl.hpp>
+#include <hadesmem/detail/snapshot_store.hpp>
+#include <hadesmem/detail/winapi.hpp>
+#include <hadesmem/detail/winternl.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/region.hpp>
+#include <hadesmem/region_list.hpp>
+
+// Incremental snapshot of the writable memory of a process. The first capture
+// reads everything, and later ones only reread the pages of write watched
+// regions (allocated with MEM_WRITE_WATCH, e.g. by the GC heaps of some
+// runtimes, or by our own code in the target) which were written since the
+// previous capture. Other regions are reread in full and compared against the
+// previous capture. Write watch state is fetched and reset atomically, so no
+// writes are missed.
+//
+// Each capture is a generation, and GetChangedSince(N) returns the pages whose
+// contents changed in any capture after generation N.
+
+namespace hadesmem
+{
+namespace detail
+{
+// Returns false if the region is not write watched. Otherwise fills runs with
+// the (first page, number of pages) runs written since the last reset, and
+// resets the write watch state.
+inline bool
+  GetWriteWatchRuns(Process const& process,
+                    std::uintptr_t base,
+                    std::size_t size,
+                    std::size_t page_size,
+                    std::vector<PVOID>& addresses,
+                    std::vector<std::pair<std::size_t, std::size_t>>& runs)
+{
+  using FnNtGetWriteWatch = NTSTATUS(NTAPI*)(HANDLE process,
+                                             ULONG flags,
+                                             PVOID base,
+                                             SIZE_T size,
+                                             PVOID* addresses,
+                                             PULONG_PTR count,
+                                             PULONG granularity);
+  auto const nt_get_write_watch =
+    GetNtdllProc<FnNtGetWriteWatch>("NtGetWriteWatch");
+
+  addresses.resize(size / page_size);
+  ULONG_PTR count = addresses.size();
+  ULONG granularity = 0;
+  NTSTATUS const status =
+    nt_get_write_watch(process.GetHandle(),
+                       WRITE_WATCH_FLAG_RESET,
+                       reinterpret_cast<PVOID>(base),
+                       size,
+                       addresses.data(),
+                       &count,
+                       &granularity);
+  if (!NT_SUCCESS(status))
+  {
+    return false;
+  }
+
+  HADESMEM_DETAIL_ASSERT(granularity == page_size);
+  (void)granularity;
+
+  runs.clear();
+  for (ULONG_PTR i = 0; i < count; ++i)
+  {
+    std::size_t const page =
+      (reinterpret_cast<std::uintptr_t>(addresses[i]) - base) / page_size;
+    if (!runs.empty() && runs.back().first + runs.back().second == page)
+    {
+      ++runs.back().second;
+    }
+    else
+    {
+      runs.emplace_back(page, 1);
+    }
+  }
+
+  return true;
+}
+}
+
+class Snapshot
+{
+public:
+  explicit Snapshot(Process const& process)
+    : process_{&process}, store_{detail::GetSystemInfo().dwPageSize}
+  {
+  }
+
+  explicit Snapshot(Process&& process) = delete;
+
+  Snapshot(Snapshot const&) = delete;
+
+  Snapshot& operator=(Snapshot const&) = delete;
+
+  Snapshot(Snapshot&& other) HADESMEM_DETAIL_NOEXCEPT
+    : process_{other.process_},
+      store_{std::move(other.store_)}
+  {
+  }
+
+  Snapshot& operator=(Snapshot&& other) HADESMEM_DETAIL_NOEXCEPT
+  {
+    process_ = other.process_;
+    store_ = std::move(other.store_);
+
+    return *this;
+  }
+
+  // Captures a new generation and returns its number. Passing full = true
+  // rereads every page, including those of write watched regions.
+  std::uint64_t Capture(bool full = false)
+  {
+    std::vector<std::pair<std::uintptr_t, std::size_t>> extents;
+    for (auto const& region : RegionList{*process_})
+    {
+      MEMORY_BASIC_INFORMATION mbi{};
+      mbi.State = region.GetState();
+      mbi.Protect = region.GetProtect();
+      if (detail::CanWrite(mbi) && !detail::IsBadProtect(mbi))
+      {
+        extents.emplace_back(
+          reinterpret_cast<std::uintptr_t>(region.GetBase()),
+          region.GetSize());
+      }
+    }
+
+    store_.BeginCapture(extents);
+
+    // Backwards, so that removing a region does not move those still to be
+    // read.
+    std::size_t const page_size = store_.GetPageSize();
+    std::vector<PVOID> addresses;
+    std::vector<std::pair<std::size_t, std::size_t>> runs;
+    std::vector<std::uint8_t> buffer;
+    for (std::size_t i = store_.GetNumRegions(); i--;)
+    {
+      auto const& region = store_.GetRegion(i);
+      // The write watch state is reset even when every page is read, so that
+      // the next capture only sees later writes.
+      bool const tracked =
+        detail::GetWriteWatchRuns(*process_,
+                                  region.base,
+                                  region.size,
+                                  page_size,
+                                  addresses,
+                                  runs) &&
+        !full && !region.is_new;
+      if (!tracked)
+      {
+        runs.assign(1,
+                    std::make_pair(std::size_t{0}, region.size / page_size));
+      }
+
+      try
+      {
+        for (auto const& run : runs)
+        {
+          buffer.resize(run.second * page_size);
+          detail::ReadImpl(
+            *process_,
+            reinterpret_cast<void*>(region.base + run.first * page_size),
+            buffer.data(),
+            buffer.size());
+          store_.Update(i, run.first, buffer.data(), run.second);
+        }
+      }
+      catch (Error const&)
+      {
+        // Freed or protected since it was enumerated.
+        store_.Remove(i);
+        continue;
+      }
+
+      if (tracked)
+      {
+        store_.MarkTracked(i);
+      }
+    }
+
+    return store_.GetGeneration();
+  }
+
+  std::uint64_t GetGeneration() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return store_.GetGeneration();
+  }
+
+  // Pages whose contents changed in a capture after the given generation.
+  std::vector<SnapshotRange> GetChangedSince(std::uint64_t generation) const
+  {
+    return store_.GetChangedSince(generation);
+  }
+
+  // Captured copy of the given range, or null if it was not captured.
+  void const* GetData(void const* address, std::size_t len) const
+  {
+    return store_.GetData(address, len);
+  }
+
+  // Statistics for the last capture.
+  SnapshotStats GetStats() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return store_.GetStats();
+  }
+
+private:
+  Process const* process_;
+  detail::SnapshotStore store_;
+};
+}
+
+#endif // #if !defined(_WIN32)
@@ -27,6 +27,14 @@ public:
   {
   }
 
+  // Takes ownership of an existing handle to the thread (e.g. one obtained
+  // while enumerating the threads of a process).
+  explicit Thread(detail::SmartHandle&& handle, DWORD id)
+    : handle_{std::move(handle)}, id_{id}
+  {
+    HADESMEM_DETAIL_ASSERT(handle_.IsValid());
+  }
+
   Thread(Thread const& other)
     : handle_{DuplicateHandle(other.id_, other.handle_.GetHandle())},
       id_{other.id_}
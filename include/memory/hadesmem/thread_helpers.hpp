@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <set>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 #include <windows.h>
@@ -140,6 +141,68 @@ inline void* GetStartAddress(Thread const& thread)
   return start_address;
 }
 
+namespace detail
+{
+using NtGetNextThreadPtr = NTSTATUS(NTAPI*)(HANDLE process_handle,
+                                            HANDLE thread_handle,
+                                            ACCESS_MASK desired_access,
+                                            ULONG handle_attributes,
+                                            ULONG flags,
+                                            PHANDLE new_thread_handle);
+
+// Returns nullptr if NtGetNextThread is unavailable.
+inline NtGetNextThreadPtr GetNtGetNextThread() HADESMEM_DETAIL_NOEXCEPT
+{
+  HMODULE const ntdll = ::GetModuleHandleW(L"ntdll");
+  if (!ntdll)
+  {
+    return nullptr;
+  }
+
+  return reinterpret_cast<NtGetNextThreadPtr>(
+    ::GetProcAddress(ntdll, "NtGetNextThread"));
+}
+
+// Calls 'func' with a handle (opened with 'access') to each thread in the
+// process, walking the process's own thread list rather than taking a snapshot
+// of every thread in the system. 'func' may take ownership of the handle by
+// moving from it, but must then keep it open until the enumeration completes,
+// because it is needed to continue the walk.
+template <typename Func>
+void ForEachProcessThread(NtGetNextThreadPtr nt_get_next_thread,
+                          HANDLE process,
+                          DWORD access,
+                          Func func)
+{
+  HADESMEM_DETAIL_ASSERT(nt_get_next_thread);
+
+  SmartHandle prev_owned;
+  HANDLE prev = nullptr;
+  for (;;)
+  {
+    HANDLE next = nullptr;
+    NTSTATUS const status =
+      nt_get_next_thread(process, prev, access, 0, 0, &next);
+    if (status == HADESMEM_DETAIL_STATUS_NO_MORE_ENTRIES)
+    {
+      break;
+    }
+
+    if (!NT_SUCCESS(status))
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(Error{}
+                                      << ErrorString{"NtGetNextThread failed."}
+                                      << ErrorCodeWinStatus{status});
+    }
+
+    SmartHandle next_owned{next};
+    func(next_owned);
+    prev = next;
+    prev_owned = std::move(next_owned);
+  }
+}
+}
+
 class SuspendedThread
 {
 public:
@@ -148,6 +211,11 @@ public:
     SuspendThread(thread_);
   }
 
+  // The thread is only moved from if it is successfully suspended.
+  explicit SuspendedThread(Thread&& thread) : thread_(Suspend(thread))
+  {
+  }
+
   SuspendedThread(SuspendedThread const& other) = delete;
 
   SuspendedThread& operator=(SuspendedThread const& other) = delete;
@@ -189,7 +257,18 @@ public:
     return thread_.GetHandle();
   }
 
+  Thread const& GetThread() const HADESMEM_DETAIL_NOEXCEPT
+  {
+    return thread_;
+  }
+
 private:
+  static Thread&& Suspend(Thread& thread)
+  {
+    SuspendThread(thread);
+    return std::move(thread);
+  }
+
   void ResumeUnchecked()
   {
     try
@@ -217,6 +296,100 @@ public:
     // whereby after a thread snapshot is taken but before suspension
     // takes place, an existing thread launches a new thread which
     // would then be missed.
+    auto const nt_get_next_thread = detail::GetNtGetNextThread();
+    bool const need_retry =
+      nt_get_next_thread ? SuspendFromProcess(nt_get_next_thread, pid, retries)
+                         : SuspendFromSnapshot(pid, retries);
+    if (need_retry)
+    {
+      HADESMEM_DETAIL_THROW_EXCEPTION(
+        Error() << ErrorString("Failed to suspend all threads in process "
+                               "(too many retries)."));
+    }
+  }
+
+  SuspendedProcess(SuspendedProcess const& other) = delete;
+
+  SuspendedProcess& operator=(SuspendedProcess const& other) = delete;
+
+  SuspendedProcess(SuspendedProcess&& other) HADESMEM_DETAIL_NOEXCEPT
+    : threads_(std::move(other.threads_))
+  {
+  }
+
+  SuspendedProcess& operator=(SuspendedProcess&& other) HADESMEM_DETAIL_NOEXCEPT
+  {
+    threads_ = std::move(other.threads_);
+
+    return *this;
+  }
+
+  // All suspended threads (i.e. every thread in the process other than the
+  // calling thread), with their handles still open.
+  std::vector<SuspendedThread> const& GetThreads() const
+    HADESMEM_DETAIL_NOEXCEPT
+  {
+    return threads_;
+  }
+
+private:
+  // Handles are obtained directly from the target process, so unlike with a
+  // snapshot there is no window for a TID to be reused by a thread in another
+  // process, and the handle used for suspension is kept for later use.
+  bool SuspendFromProcess(detail::NtGetNextThreadPtr nt_get_next_thread,
+                          DWORD pid,
+                          DWORD retries)
+  {
+    detail::SmartHandle const process{
+      detail::OpenProcess(pid, PROCESS_QUERY_INFORMATION)};
+    DWORD const current_thread_id = ::GetCurrentThreadId();
+    std::set<DWORD> tids;
+    // Threads which could not be suspended (most likely because they are
+    // terminating) must stay open until the enumeration is finished.
+    std::vector<Thread> skipped;
+    bool need_retry = false;
+    do
+    {
+      need_retry = false;
+
+      detail::ForEachProcessThread(
+        nt_get_next_thread,
+        process.GetHandle(),
+        THREAD_ALL_ACCESS,
+        [&](detail::SmartHandle& handle)
+        {
+          DWORD const tid = ::GetThreadId(handle.GetHandle());
+          if (!tid || tid == current_thread_id)
+          {
+            return;
+          }
+
+          auto const inserted = tids.insert(tid);
+          if (!inserted.second)
+          {
+            return;
+          }
+
+          need_retry = true;
+
+          Thread thread{std::move(handle), tid};
+          try
+          {
+            threads_.emplace_back(std::move(thread));
+          }
+          catch (std::exception const& /*e*/)
+          {
+            tids.erase(inserted.first);
+            skipped.emplace_back(std::move(thread));
+          }
+        });
+    } while (need_retry && retries--);
+
+    return need_retry;
+  }
+
+  bool SuspendFromSnapshot(DWORD pid, DWORD retries)
+  {
     std::set<DWORD> tids;
     bool need_retry = false;
     do
@@ -239,13 +412,13 @@ public:
               // Close potential race condition whereby after the snapshot is
               // taken the thread could terminate and have its TID reused in
               // a different process.
-              Thread const thread(thread_entry.GetId());
+              Thread thread(thread_entry.GetId());
               VerifyPid(thread, pid);
 
               // Should be safe (with the exception outlined above) to suspend
               // the thread now, because we have a handle to the thread open,
               // and we've verified it exists in the correct process.
-              threads_.emplace_back(thread_entry.GetId());
+              threads_.emplace_back(std::move(thread));
             }
             catch (std::exception const& /*e*/)
             {
@@ -257,31 +430,9 @@ public:
       }
     } while (need_retry && retries--);
 
-    if (need_retry)
-    {
-      HADESMEM_DETAIL_THROW_EXCEPTION(
-        Error() << ErrorString("Failed to suspend all threads in process "
-                               "(too many retries)."));
-    }
-  }
-
-  SuspendedProcess(SuspendedProcess const& other) = delete;
-
-  SuspendedProcess& operator=(SuspendedProcess const& other) = delete;
-
-  SuspendedProcess(SuspendedProcess&& other) HADESMEM_DETAIL_NOEXCEPT
-    : threads_(std::move(other.threads_))
-  {
+    return need_retry;
   }
 
-  SuspendedProcess& operator=(SuspendedProcess&& other) HADESMEM_DETAIL_NOEXCEPT
-  {
-    threads_ = std::move(other.threads_);
-
-    return *this;
-  }
-
-private:
   void VerifyPid(Thread const& thread, DWORD pid) const
   {
     DWORD const tid_pid = ::GetProcessIdOfThread(thread.GetHandle());
@@ -299,6 +450,7 @@ private:
         Error() << ErrorString("PID verification failed."));
     }
   }
+
   std::vector<SuspendedThread> threads_;
 };
 }
@@ -3,6 +3,18 @@
 
 #pragma once
 
+#if !defined(_WIN32)
+
+#include <hadesmem/linux/write.hpp>
+
+namespace hadesmem
+{
+using procfs::Write;
+using procfs::WriteVector;
+}
+
+#else // #if !defined(_WIN32)
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -97,3 +109,5 @@ inline void WriteVector(Process const& process,
   detail::WriteImpl(process, address, data.data(), raw_size);
 }
 }
+
+#endif // #if !defined(_WIN32)
@@ -0,0 +1,53 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/detail/fast_hash.hpp>
+#include <hadesmem/detail/fast_hash.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+
+void TestFastHash()
+{
+  // Reference values for XXH64.
+  BOOST_TEST_EQ(hadesmem::detail::GetFastHash("", 0), 0xEF46DB3751D8E999ULL);
+  BOOST_TEST_EQ(hadesmem::detail::GetFastHash("abc", 3),
+                0x44BC2CF5AD770999ULL);
+
+  std::vector<std::uint8_t> buf(1000);
+  for (std::size_t i = 0; i < buf.size(); ++i)
+  {
+    buf[i] = static_cast<std::uint8_t>(i * 7);
+  }
+
+  // Every length exercises a different combination of the bulk loop and the
+  // tail handling, so check that neighbouring lengths and seeds all differ.
+  std::vector<std::uint64_t> hashes;
+  for (std::size_t len = 0; len < 100; ++len)
+  {
+    std::uint64_t const hash = hadesmem::detail::GetFastHash(buf.data(), len);
+    BOOST_TEST_EQ(hash, hadesmem::detail::GetFastHash(buf.data(), len));
+    BOOST_TEST_NE(hash, hadesmem::detail::GetFastHash(buf.data(), len, 1));
+    for (auto const other : hashes)
+    {
+      BOOST_TEST_NE(hash, other);
+    }
+    hashes.push_back(hash);
+  }
+
+  std::uint64_t const hash = hadesmem::detail::GetFastHash(buf.data(), 1000);
+  buf[500] ^= 1;
+  BOOST_TEST_NE(hash, hadesmem::detail::GetFastHash(buf.data(), 1000));
+}
+
+int main()
+{
+  TestFastHash();
+  return boost::report_errors();
+}
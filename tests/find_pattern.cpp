@@ -9,6 +9,7 @@
 #include <hadesmem/detail/warning_disable_suffix.hpp>
 
 #include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
 #include <hadesmem/detail/self_path.hpp>
 #include <hadesmem/error.hpp>
 #include <hadesmem/process.hpp>
@@ -204,6 +205,51 @@ void TestFindPattern()
     hadesmem::detail::AliasCast<void*>(FindProcedure(process, ntdll, 1));
   BOOST_TEST(nop_ordinal_1 > ordinal_1);
 
+  // The first load scans and writes the cache, the second uses it.
+  std::wstring const cache_path =
+    hadesmem::detail::GetSelfPath() + L".pattern_cache";
+  ::DeleteFileW(cache_path.c_str());
+  hadesmem::FindPattern const find_pattern_built{
+    process, pattern_file_data, true, cache_path};
+  BOOST_TEST_EQ(find_pattern_built.GetCacheStats().hits, 0UL);
+  BOOST_TEST_EQ(find_pattern_built.GetCacheStats().misses, 10UL);
+  BOOST_TEST(find_pattern_built == find_pattern);
+  hadesmem::FindPattern const find_pattern_cached{
+    process, pattern_file_data, true, cache_path};
+  BOOST_TEST_EQ(find_pattern_cached.GetCacheStats().hits, 10UL);
+  BOOST_TEST_EQ(find_pattern_cached.GetCacheStats().misses, 0UL);
+  BOOST_TEST(find_pattern_cached == find_pattern);
+
+  // A different pattern file invalidates the cache.
+  hadesmem::FindPattern const find_pattern_changed{
+    process, pattern_file_data + L"\n", true, cache_path};
+  BOOST_TEST_EQ(find_pattern_changed.GetCacheStats().hits, 0UL);
+  BOOST_TEST(find_pattern_changed == find_pattern);
+
+  // A corrupt cache is ignored and rewritten.
+  char const corrupt[] = "HMPC";
+  hadesmem::detail::BufferToFile(cache_path, corrupt, sizeof(corrupt));
+  hadesmem::FindPattern const find_pattern_corrupt{
+    process, pattern_file_data, true, cache_path};
+  BOOST_TEST_EQ(find_pattern_corrupt.GetCacheStats().hits, 0UL);
+  BOOST_TEST(find_pattern_corrupt == find_pattern);
+  hadesmem::FindPattern const find_pattern_rewritten{
+    process, pattern_file_data, true, cache_path};
+  BOOST_TEST_EQ(find_pattern_rewritten.GetCacheStats().hits, 10UL);
+  ::DeleteFileW(cache_path.c_str());
+
+  // An in-memory cache is shared in the same way, without touching disk.
+  hadesmem::PatternCache shared_cache;
+  hadesmem::FindPattern const find_pattern_shared_built{
+    process, pattern_file_data, true, shared_cache};
+  BOOST_TEST_EQ(find_pattern_shared_built.GetCacheStats().misses, 10UL);
+  BOOST_TEST_EQ(shared_cache.GetNumModules(), 2UL);
+  hadesmem::FindPattern const find_pattern_shared{
+    process, pattern_file_data, true, shared_cache};
+  BOOST_TEST_EQ(find_pattern_shared.GetCacheStats().hits, 10UL);
+  BOOST_TEST_EQ(find_pattern_shared.GetCacheStats().misses, 0UL);
+  BOOST_TEST(find_pattern_shared == find_pattern);
+
   std::wstring const pattern_file_data_invalid1 = LR"(
 <?xml version="1.0" encoding="utf-8"?>
 <HadesMem>
@@ -0,0 +1,173 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/fleet.hpp>
+#include <hadesmem/fleet.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/pointer_path.hpp>
+#include <hadesmem/process.hpp>
+
+namespace
+{
+struct Node
+{
+  Node* next;
+  std::uint32_t value;
+};
+
+Node g_leaf = {nullptr, 0xDEADBEEF};
+Node g_middle = {&g_leaf, 0};
+Node* g_root = &g_middle;
+
+std::vector<hadesmem::Process> OpenSelf(std::size_t count)
+{
+  std::vector<hadesmem::Process> processes;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    processes.emplace_back(::GetCurrentProcessId());
+  }
+  return processes;
+}
+
+hadesmem::PointerPath GetLeafValuePath()
+{
+  auto const base =
+    reinterpret_cast<std::uintptr_t>(::GetModuleHandleW(nullptr));
+  hadesmem::PointerPath path;
+  path.base_offset = reinterpret_cast<std::uintptr_t>(&g_root) - base;
+  path.offsets.push_back(static_cast<std::ptrdiff_t>(offsetof(Node, next)));
+  path.offsets.push_back(static_cast<std::ptrdiff_t>(offsetof(Node, value)));
+  return path;
+}
+}
+
+void TestPointerPath()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  auto path = GetLeafValuePath();
+  BOOST_TEST_EQ(hadesmem::ResolvePointerPath(process, path),
+                static_cast<void*>(&g_leaf.value));
+
+  path.offsets.clear();
+  BOOST_TEST_EQ(hadesmem::ResolvePointerPath(process, path),
+                static_cast<void*>(&g_root));
+
+  // The leaf's next pointer is null.
+  path = GetLeafValuePath();
+  path.offsets.back() = static_cast<std::ptrdiff_t>(offsetof(Node, next));
+  path.offsets.push_back(0);
+  BOOST_TEST_THROWS(hadesmem::ResolvePointerPath(process, path),
+                    hadesmem::Error);
+}
+
+void TestFleet()
+{
+  std::size_t const kNumProcesses = 8;
+  auto const processes = OpenSelf(kNumProcesses);
+  hadesmem::Fleet fleet{processes, 4};
+  BOOST_TEST_EQ(fleet.GetSize(), kNumProcesses);
+
+  auto ids = fleet.ForEach([](hadesmem::Process const& process)
+                           {
+                             return process.GetId();
+                           });
+  BOOST_TEST_EQ(ids.size(), kNumProcesses);
+  for (auto& id : ids)
+  {
+    BOOST_TEST_EQ(id.get(), ::GetCurrentProcessId());
+  }
+
+  // Each process gets its own exception.
+  auto failures = fleet.ForEach([](hadesmem::Process const&) -> int
+                                {
+                                  HADESMEM_DETAIL_THROW_EXCEPTION(
+                                    hadesmem::Error{} << hadesmem::ErrorString{
+                                      "Expected failure."});
+                                });
+  for (auto& failure : failures)
+  {
+    BOOST_TEST_THROWS(failure.get(), hadesmem::Error);
+  }
+
+  std::vector<hadesmem::PointerPath> paths;
+  paths.push_back(GetLeafValuePath());
+  paths.push_back(GetLeafValuePath());
+  paths.back().offsets.pop_back();
+  paths.back().offsets.back() =
+    static_cast<std::ptrdiff_t>(offsetof(Node, value));
+  auto addresses = fleet.ResolvePointerPaths(paths);
+  BOOST_TEST_EQ(addresses.size(), kNumProcesses);
+  for (auto& address : addresses)
+  {
+    auto const resolved = address.get();
+    BOOST_TEST_EQ(resolved.size(), 2UL);
+    BOOST_TEST_EQ(resolved[0], static_cast<void*>(&g_leaf.value));
+    BOOST_TEST_EQ(resolved[1], static_cast<void*>(&g_middle.value));
+  }
+
+  std::vector<hadesmem::FleetRead> reads;
+  reads.push_back(
+    hadesmem::FleetRead{GetLeafValuePath(), sizeof(g_leaf.value)});
+  auto data = fleet.ReadBatch(reads);
+  for (auto& process_data : data)
+  {
+    auto const values = process_data.get();
+    BOOST_TEST_EQ(values.size(), 1UL);
+    std::uint32_t value = 0;
+    BOOST_TEST_EQ(values[0].size(), sizeof(value));
+    std::memcpy(&value, values[0].data(), sizeof(value));
+    BOOST_TEST_EQ(value, 0xDEADBEEFU);
+  }
+
+  // Every process has the same images, so each module is scanned once no
+  // matter how many processes load it, and the rest use the verified match.
+  std::wstring const pattern_file_data = LR"(
+<?xml version="1.0" encoding="utf-8"?>
+<HadesMem>
+  <FindPattern>
+    <Flag Name="RelativeAddress"/>
+    <Pattern Name="Nop" Data="90"/>
+    <Pattern Name="Nop Second" Data="90" Start="Nop"/>
+  </FindPattern>
+  <FindPattern Module="ntdll.dll">
+    <Flag Name="ThrowOnUnmatch"/>
+    <Pattern Name="Two Nop" Data="90 90"/>
+  </FindPattern>
+</HadesMem>
+)";
+  hadesmem::FindPattern const expected{
+    processes[0], pattern_file_data, true};
+  auto module_maps = fleet.FindPattern(pattern_file_data, true);
+  BOOST_TEST_EQ(module_maps.size(), kNumProcesses);
+  for (auto& module_map : module_maps)
+  {
+    BOOST_TEST(module_map.get() == expected.GetModuleMap());
+  }
+  BOOST_TEST_EQ(fleet.GetPatternCache().GetNumModules(), 2UL);
+
+  hadesmem::FindPattern const cached{
+    processes[0], pattern_file_data, true, fleet.GetPatternCache()};
+  BOOST_TEST_EQ(cached.GetCacheStats().hits, 3UL);
+  BOOST_TEST_EQ(cached.GetCacheStats().misses, 0UL);
+}
+
+int main()
+{
+  TestPointerPath();
+  TestFleet();
+  return boost::report_errors();
+}
@@ -0,0 +1,99 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/generate_signature.hpp>
+#include <hadesmem/generate_signature.hpp>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/module_index.hpp>
+#include <hadesmem/process.hpp>
+
+namespace
+{
+char const kDataString[] = "HadesMem GenerateSignature data string";
+
+void* ResolveSignature(hadesmem::Process const& process,
+                       std::wstring const& module,
+                       hadesmem::Signature const& signature)
+{
+  auto const flags = signature.scan_data
+                       ? static_cast<std::uint32_t>(
+                           hadesmem::PatternFlags::kScanData)
+                       : static_cast<std::uint32_t>(
+                           hadesmem::PatternFlags::kNone);
+  auto const address =
+    hadesmem::Find(process, module, signature.data, flags, 0U);
+  return address ? static_cast<std::uint8_t*>(address) + signature.offset
+                 : nullptr;
+}
+}
+
+void TestGenerateSignature()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  HMODULE const ntdll = ::GetModuleHandleW(L"ntdll.dll");
+  std::vector<void const*> addresses;
+  std::vector<std::pair<std::wstring, hadesmem::Signature>> named;
+  for (auto const name : {"NtClose",
+                          "NtQueryInformationProcess",
+                          "RtlAllocateHeap",
+                          "LdrLoadDll",
+                          "RtlInitUnicodeString"})
+  {
+    addresses.push_back(
+      reinterpret_cast<void const*>(::GetProcAddress(ntdll, name)));
+    BOOST_TEST(addresses.back() != nullptr);
+  }
+
+  hadesmem::ModuleIndex const index{process, L"ntdll.dll"};
+  hadesmem::SignatureGenerator const generator{process, index};
+  auto const signatures = generator.Generate(addresses);
+  BOOST_TEST_EQ(signatures.size(), addresses.size());
+  for (std::size_t i = 0; i < addresses.size(); ++i)
+  {
+    auto const& signature = signatures[i];
+    BOOST_TEST(!signature.data.empty());
+    BOOST_TEST(!signature.scan_data);
+    BOOST_TEST_EQ(ResolveSignature(process, L"ntdll.dll", signature),
+                  addresses[i]);
+    BOOST_TEST(generator.Generate(addresses[i]).data == signature.data);
+    named.emplace_back(L"Signature " + std::to_wstring(i), signature);
+  }
+
+  // Round trip through the pattern file format.
+  auto const xml = hadesmem::SignaturesToXml(L"ntdll.dll", named);
+  hadesmem::FindPattern const find_pattern{process, xml, true};
+  for (std::size_t i = 0; i < addresses.size(); ++i)
+  {
+    BOOST_TEST_EQ(find_pattern.Lookup(L"ntdll.dll", named[i].first),
+                  addresses[i]);
+  }
+
+  // Data in the main module.
+  auto const data_signature =
+    hadesmem::GenerateSignature(process, L"", kDataString + 4);
+  BOOST_TEST(!data_signature.data.empty());
+  BOOST_TEST(data_signature.scan_data);
+  BOOST_TEST_EQ(ResolveSignature(process, L"", data_signature),
+                static_cast<void const*>(kDataString + 4));
+
+  BOOST_TEST_THROWS(generator.Generate(ntdll), hadesmem::Error);
+}
+
+int main()
+{
+  TestGenerateSignature();
+  return boost::report_errors();
+}
@@ -0,0 +1,126 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/hook_profile.hpp>
+#include <hadesmem/hook_profile.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/patcher.hpp>
+#include <hadesmem/process.hpp>
+
+#if !defined(HADESMEM_HOOK_PROFILE)
+#error "[HadesMem] This test must be built with HADESMEM_HOOK_PROFILE."
+#endif
+
+namespace
+{
+int volatile g_addend = 1;
+
+extern "C" __declspec(noinline) int __stdcall ProfileMe(int a)
+{
+  return a + g_addend;
+}
+
+int ProfileMeDetour(hadesmem::PatchDetourBase* patch, int a)
+{
+  auto const orig = patch->GetTrampolineT<decltype(&ProfileMe)>();
+  return orig(a) * 2;
+}
+
+hadesmem::HookProfileEntry const* FindEntry(
+  std::vector<hadesmem::HookProfileEntry> const& entries, void* target)
+{
+  auto const iter =
+    std::find_if(std::begin(entries),
+                 std::end(entries),
+                 [&](hadesmem::HookProfileEntry const& entry)
+                 {
+                   return entry.target == target;
+                 });
+  return iter == std::end(entries) ? nullptr : &*iter;
+}
+
+std::uint64_t GetHistogramTotal(hadesmem::HookProfileEntry const& entry)
+{
+  return std::accumulate(std::begin(entry.histogram),
+                         std::end(entry.histogram),
+                         static_cast<std::uint64_t>(0));
+}
+}
+
+void TestHookProfile()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  auto volatile const target = &ProfileMe;
+  void* const target_ptr = reinterpret_cast<void*>(target);
+
+  using DetourT = hadesmem::PatchDetour<decltype(&ProfileMe)>;
+  auto detour = std::make_unique<DetourT>(process, target, &ProfileMeDetour);
+  detour->Apply();
+
+  int const kNumCalls = 100;
+  for (int i = 0; i < kNumCalls; ++i)
+  {
+    BOOST_TEST_EQ(target(i), (i + 1) * 2);
+  }
+
+  auto entries = hadesmem::ReadHookProfile(process);
+  auto entry = FindEntry(entries, target_ptr);
+  BOOST_TEST(entry != nullptr);
+  if (entry)
+  {
+    BOOST_TEST_EQ(entry->num_calls, static_cast<std::uint64_t>(kNumCalls));
+    BOOST_TEST_EQ(GetHistogramTotal(*entry),
+                  static_cast<std::uint64_t>(kNumCalls));
+    BOOST_TEST(entry->total_cycles > 0);
+  }
+
+  // Calls made while the hook is removed aren't counted, and a new hook on
+  // the same target keeps accumulating into the same entry.
+  detour->Remove();
+  BOOST_TEST_EQ(target(1), 2);
+  BOOST_TEST(detour->WaitForQuiescence());
+  detour = std::make_unique<DetourT>(process,
+                                     target,
+                                     &ProfileMeDetour,
+                                     nullptr,
+                                     hadesmem::PatchDetourFlags::kFastGate);
+  detour->Apply();
+  BOOST_TEST_EQ(target(1), 4);
+  detour->Remove();
+
+  entries = hadesmem::ReadHookProfile(process);
+  BOOST_TEST_EQ(std::count_if(std::begin(entries),
+                              std::end(entries),
+                              [&](hadesmem::HookProfileEntry const& e)
+                              {
+                                return e.target == target_ptr;
+                              }),
+                1);
+  entry = FindEntry(entries, target_ptr);
+  BOOST_TEST(entry != nullptr);
+  if (entry)
+  {
+    BOOST_TEST_EQ(entry->num_calls,
+                  static_cast<std::uint64_t>(kNumCalls + 1));
+  }
+}
+
+int main()
+{
+  TestHookProfile();
+  return boost::report_errors();
+}
@@ -0,0 +1,240 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/detail/instruction_decoder.hpp>
+#include <hadesmem/detail/instruction_decoder.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+
+namespace
+{
+struct LengthTest
+{
+  std::vector<std::uint8_t> code;
+  std::uint32_t len_32;
+  std::uint32_t len_64;
+};
+
+hadesmem::detail::InstructionInfo Decode(std::vector<std::uint8_t> const& code,
+                                         bool is_64)
+{
+  hadesmem::detail::InstructionInfo info;
+  BOOST_TEST(hadesmem::detail::DecodeInstruction(
+    code.data(), code.size(), is_64, info));
+  return info;
+}
+}
+
+void TestLengths()
+{
+  // A length of zero means the instruction is invalid in that mode.
+  std::vector<LengthTest> const tests = {
+    // push ebp/rbp
+    {{0x55}, 1, 1},
+    // mov ebp, esp / mov rbp, rsp (REX.W on x64, DEC EAX + MOV on x86)
+    {{0x48, 0x8B, 0xEC}, 1, 3},
+    // mov edi, edi
+    {{0x8B, 0xFF}, 2, 2},
+    // sub esp, 0x20
+    {{0x83, 0xEC, 0x20}, 3, 3},
+    // sub esp, 0x1000
+    {{0x81, 0xEC, 0x00, 0x10, 0x00, 0x00}, 6, 6},
+    // mov [esp+0x8], ecx
+    {{0x89, 0x4C, 0x24, 0x08}, 4, 4},
+    // mov eax, [ebp-0x100]
+    {{0x8B, 0x85, 0x00, 0xFF, 0xFF, 0xFF}, 6, 6},
+    // mov eax, [disp32] / mov eax, [rip+disp32]
+    {{0x8B, 0x05, 0x00, 0x00, 0x00, 0x00}, 6, 6},
+    // mov eax, [disp32+eax*4] (SIB with no base)
+    {{0x8B, 0x04, 0x85, 0x00, 0x00, 0x00, 0x00}, 7, 7},
+    // mov ax, 0x1234
+    {{0x66, 0xB8, 0x34, 0x12}, 4, 4},
+    // mov rax, imm64 (DEC EAX + MOV EAX, imm32 on x86)
+    {{0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8}, 1, 10},
+    // mov eax, [moffs]
+    {{0xA1, 1, 2, 3, 4, 5, 6, 7, 8}, 5, 9},
+    // test byte ptr [eax], 1
+    {{0xF6, 0x00, 0x01}, 3, 3},
+    // test dword ptr [eax], 1
+    {{0xF7, 0x00, 0x01, 0x00, 0x00, 0x00}, 6, 6},
+    // not dword ptr [eax]
+    {{0xF7, 0x10}, 2, 2},
+    // ret 8
+    {{0xC2, 0x08, 0x00}, 3, 3},
+    // enter 0x10, 0
+    {{0xC8, 0x10, 0x00, 0x00}, 4, 4},
+    // push es
+    {{0x06}, 1, 0},
+    // lea ax, [bx+si+0x10] (16-bit addressing on x86)
+    {{0x67, 0x8D, 0x40, 0x10}, 4, 4},
+    // movzx eax, byte ptr [ecx]
+    {{0x0F, 0xB6, 0x01}, 3, 3},
+    // nop dword ptr [eax+eax+0x0]
+    {{0x0F, 0x1F, 0x44, 0x00, 0x00}, 5, 5},
+    // pshufd xmm0, xmm1, 0x1B
+    {{0x66, 0x0F, 0x70, 0xC1, 0x1B}, 5, 5},
+    // pshufb xmm0, xmm1
+    {{0x66, 0x0F, 0x38, 0x00, 0xC1}, 5, 5},
+    // palignr xmm0, xmm1, 4
+    {{0x66, 0x0F, 0x3A, 0x0F, 0xC1, 0x04}, 6, 6},
+    // lock cmpxchg [ecx], edx
+    {{0xF0, 0x0F, 0xB1, 0x11}, 4, 4},
+    // vzeroupper
+    {{0xC5, 0xF8, 0x77}, 3, 3},
+    // vmovdqu ymm0, [eax]
+    {{0xC5, 0xFE, 0x6F, 0x00}, 4, 4},
+    // vpshufd ymm0, ymm1, 0x1B
+    {{0xC5, 0xFD, 0x70, 0xC1, 0x1B}, 5, 5},
+    // vpermq ymm0, ymm1, 0x1B
+    {{0xC4, 0xE3, 0xFD, 0x00, 0xC1, 0x1B}, 6, 6},
+    // syscall
+    {{0x0F, 0x05}, 2, 2},
+    // ud2
+    {{0x0F, 0x0B}, 2, 2},
+  };
+
+  for (auto const& test : tests)
+  {
+    for (std::size_t i = 0; i < 2; ++i)
+    {
+      bool const is_64 = i == 1;
+      std::uint32_t const expected = is_64 ? test.len_64 : test.len_32;
+      hadesmem::detail::InstructionInfo info;
+      bool const valid = hadesmem::detail::DecodeInstruction(
+        test.code.data(), test.code.size(), is_64, info);
+      BOOST_TEST_EQ(valid, expected != 0);
+      BOOST_TEST_EQ(info.len, expected);
+    }
+  }
+}
+
+void TestBranches()
+{
+  // jmp short -2
+  auto info = Decode({0xEB, 0xFE}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kJmpRel);
+  BOOST_TEST_EQ(info.rel, -2);
+  BOOST_TEST_EQ(info.rel_offset, 1UL);
+  BOOST_TEST_EQ(info.rel_size, 1UL);
+
+  // jmp rel32
+  info = Decode({0xE9, 0x00, 0x01, 0x00, 0x00}, false);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kJmpRel);
+  BOOST_TEST_EQ(info.len, 5UL);
+  BOOST_TEST_EQ(info.rel, 0x100);
+
+  // call rel32
+  info = Decode({0xE8, 0xFB, 0xFF, 0xFF, 0xFF}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kCallRel);
+  BOOST_TEST_EQ(info.rel, -5);
+
+  // call rel16 (x86 only, operand size prefix)
+  info = Decode({0x66, 0xE8, 0x10, 0x00}, false);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kCallRel);
+  BOOST_TEST_EQ(info.len, 4UL);
+  BOOST_TEST_EQ(info.rel_size, 2UL);
+  BOOST_TEST_EQ(info.rel, 0x10);
+
+  // jz short +0x10
+  info = Decode({0x74, 0x10}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kJccRel);
+  BOOST_TEST_EQ(info.opcode & 0x0F, 0x4);
+  BOOST_TEST_EQ(info.rel, 0x10);
+
+  // jnz rel32
+  info = Decode({0x0F, 0x85, 0x00, 0x00, 0x00, 0x80}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kJccRel);
+  BOOST_TEST_EQ(info.len, 6UL);
+  BOOST_TEST_EQ(info.opcode & 0x0F, 0x5);
+  BOOST_TEST_EQ(info.rel, -0x80000000LL);
+
+  // jecxz short -4 (address size prefix)
+  info = Decode({0x67, 0xE3, 0xFC}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kLoopRel);
+  BOOST_TEST(info.addr_size_prefix);
+  BOOST_TEST_EQ(info.opcode, 0xE3);
+  BOOST_TEST_EQ(info.rel, -4);
+
+  // jmp qword ptr [rip+0x100]
+  info = Decode({0xFF, 0x25, 0x00, 0x01, 0x00, 0x00}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kJmpIndirect);
+  BOOST_TEST(info.rip_relative);
+  BOOST_TEST_EQ(info.disp, 0x100);
+  BOOST_TEST_EQ(info.disp_offset, 2UL);
+
+  // jmp dword ptr [0x100] (absolute on x86)
+  info = Decode({0xFF, 0x25, 0x00, 0x01, 0x00, 0x00}, false);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kJmpIndirect);
+  BOOST_TEST(!info.rip_relative);
+
+  // call qword ptr [rip-0x10]
+  info = Decode({0xFF, 0x15, 0xF0, 0xFF, 0xFF, 0xFF}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kCallIndirect);
+  BOOST_TEST(info.rip_relative);
+  BOOST_TEST_EQ(info.disp, -0x10);
+
+  // call rax
+  info = Decode({0xFF, 0xD0}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kCallIndirect);
+  BOOST_TEST(!info.rip_relative);
+
+  // ret 8
+  info = Decode({0xC2, 0x08, 0x00}, false);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kReturn);
+
+  // movnti [rax], eax (two byte opcode with the same low byte as ret)
+  info = Decode({0x0F, 0xC3, 0x00}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kOther);
+
+  // cmp byte ptr [rip+0x10], 0 (immediate after the displacement)
+  info = Decode({0x80, 0x3D, 0x10, 0x00, 0x00, 0x00, 0x00}, true);
+  BOOST_TEST(info.type == hadesmem::detail::InstructionType::kOther);
+  BOOST_TEST_EQ(info.len, 7UL);
+  BOOST_TEST(info.rip_relative);
+  BOOST_TEST_EQ(info.disp_offset, 2UL);
+  BOOST_TEST_EQ(info.disp, 0x10);
+
+  // mov rax, qword ptr [rip+0x20] (with REX.W)
+  info = Decode({0x48, 0x8B, 0x05, 0x20, 0x00, 0x00, 0x00}, true);
+  BOOST_TEST_EQ(info.len, 7UL);
+  BOOST_TEST(info.rip_relative);
+  BOOST_TEST_EQ(info.disp_offset, 3UL);
+}
+
+void TestInvalid()
+{
+  hadesmem::detail::InstructionInfo info;
+
+  // Truncated.
+  std::uint8_t const truncated[] = {0xE9, 0x00, 0x00};
+  BOOST_TEST(!hadesmem::detail::DecodeInstruction(
+    truncated, sizeof(truncated), true, info));
+  BOOST_TEST(!hadesmem::detail::DecodeInstruction(truncated, 0, true, info));
+
+  // Too many prefixes (longer than 15 bytes).
+  std::vector<std::uint8_t> prefixes(16, 0x66);
+  prefixes.push_back(0x90);
+  BOOST_TEST(!hadesmem::detail::DecodeInstruction(
+    prefixes.data(), prefixes.size(), true, info));
+
+  // Invalid two byte opcode.
+  std::uint8_t const invalid[] = {0x0F, 0x04};
+  BOOST_TEST(
+    !hadesmem::detail::DecodeInstruction(invalid, sizeof(invalid), true, info));
+}
+
+int main()
+{
+  TestLengths();
+  TestBranches();
+  TestInvalid();
+  return boost::report_errors();
+}
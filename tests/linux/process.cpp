@@ -0,0 +1,419 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/linux/process.hpp>
+#include <hadesmem/linux/process.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <locale>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/pattern_data.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/linux/find_pattern.hpp>
+#include <hadesmem/linux/read.hpp>
+#include <hadesmem/linux/region.hpp>
+#include <hadesmem/linux/region_list.hpp>
+#include <hadesmem/linux/write.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+#include <hadesmem/region.hpp>
+#include <hadesmem/region_list.hpp>
+#include <hadesmem/write.hpp>
+
+namespace
+{
+std::size_t const kNumPages = 4;
+
+// Forked child which fills a shared-at-fork buffer with data only it knows
+// about (so reading the parent's copy would not pass), then waits to be
+// killed.
+class Child
+{
+public:
+  explicit Child(std::uint8_t* buffer, std::size_t size) : pid_{}
+  {
+    int ready[2];
+    BOOST_TEST_EQ(::pipe(ready), 0);
+
+    pid_ = ::fork();
+    if (pid_ == 0)
+    {
+      ::close(ready[0]);
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        buffer[i] = static_cast<std::uint8_t>(i * 7 + 3);
+      }
+      char const c = 0;
+      if (::write(ready[1], &c, 1) != 1)
+      {
+        ::_exit(1);
+      }
+      for (;;)
+      {
+        ::pause();
+      }
+    }
+
+    ::close(ready[1]);
+    char c = 1;
+    BOOST_TEST_EQ(::read(ready[0], &c, 1), 1);
+    ::close(ready[0]);
+  }
+
+  Child(Child const&) = delete;
+  Child& operator=(Child const&) = delete;
+
+  ~Child()
+  {
+    ::kill(pid_, SIGKILL);
+    ::waitpid(pid_, nullptr, 0);
+  }
+
+  pid_t GetId() const
+  {
+    return pid_;
+  }
+
+private:
+  pid_t pid_;
+};
+
+std::uint8_t Expected(std::size_t i)
+{
+  return static_cast<std::uint8_t>(i * 7 + 3);
+}
+
+std::wstring ToPatternString(std::vector<std::uint8_t> const& data)
+{
+  std::wostringstream str;
+  str.imbue(std::locale::classic());
+  for (auto const b : data)
+  {
+    str << std::hex << std::setw(2) << std::setfill(L'0')
+        << static_cast<unsigned>(b) << L' ';
+  }
+  return str.str();
+}
+}
+
+void TestProcess(pid_t id)
+{
+  hadesmem::procfs::Process const process{id};
+  BOOST_TEST_EQ(process.GetId(), id);
+  BOOST_TEST(process.GetMemFd() != -1);
+
+  hadesmem::procfs::Process process_copy{process};
+  BOOST_TEST(process_copy == process);
+  BOOST_TEST(process_copy.GetMemFd() != process.GetMemFd());
+  hadesmem::procfs::Process const process_moved{std::move(process_copy)};
+  BOOST_TEST(process_moved == process);
+  BOOST_TEST_EQ(process_copy.GetMemFd(), -1);
+
+  std::stringstream str;
+  str << process;
+  pid_t id_str = 0;
+  str >> id_str;
+  BOOST_TEST_EQ(id_str, id);
+
+  BOOST_TEST_THROWS(hadesmem::procfs::Process{-1}, hadesmem::Error);
+}
+
+void TestRead(pid_t id, std::uint8_t* buffer, std::size_t size)
+{
+  hadesmem::procfs::Process const process{id};
+
+  BOOST_TEST_EQ(hadesmem::procfs::Read<std::uint8_t>(process, buffer + 5),
+                Expected(5));
+
+  auto const data =
+    hadesmem::procfs::ReadVector<std::uint8_t>(process, buffer, size);
+  BOOST_TEST_EQ(data.size(), size);
+  bool all_match = true;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    all_match = all_match && data[i] == Expected(i);
+  }
+  BOOST_TEST(all_match);
+
+  // More requests than fit in one batch, plus empty requests, and a request
+  // spanning a page boundary.
+  std::size_t const page_size = static_cast<std::size_t>(::getpagesize());
+  std::vector<std::uint8_t> out(3000 * 4);
+  std::vector<hadesmem::procfs::ReadRequest> requests;
+  for (std::size_t i = 0; i < 3000; ++i)
+  {
+    std::size_t const offset = (i * 997) % (size - 4);
+    std::size_t const len = i % 5 == 4 ? 0 : 4;
+    requests.push_back({buffer + offset, out.data() + i * 4, len});
+  }
+  requests.push_back({buffer + page_size - 2, out.data(), 4});
+  hadesmem::procfs::ReadScatter(process, requests);
+  bool scatter_match = true;
+  for (std::size_t i = 0; i < 3000; ++i)
+  {
+    std::size_t const offset = (i * 997) % (size - 4);
+    for (std::size_t j = 0; j < requests[i].len; ++j)
+    {
+      std::uint8_t const expected =
+        i == 0 ? Expected(page_size - 2 + j) : Expected(offset + j);
+      scatter_match = scatter_match && out[i * 4 + j] == expected;
+    }
+  }
+  BOOST_TEST(scatter_match);
+
+  // An unmapped range fails rather than returning partial data.
+  std::vector<hadesmem::procfs::ReadRequest> bad_requests{
+    {buffer, out.data(), 4}, {nullptr, out.data() + 4, 4}};
+  BOOST_TEST_THROWS(hadesmem::procfs::ReadScatter(process, bad_requests),
+                    hadesmem::Error);
+  BOOST_TEST_THROWS(hadesmem::procfs::Read<int>(process, nullptr),
+                    hadesmem::Error);
+}
+
+void TestWrite(pid_t id, std::uint8_t* buffer, std::uint8_t* read_only)
+{
+  hadesmem::procfs::Process const process{id};
+
+  hadesmem::procfs::Write(process, buffer + 10, std::uint32_t{0xDEADBEEF});
+  BOOST_TEST_EQ(hadesmem::procfs::Read<std::uint32_t>(process, buffer + 10),
+                0xDEADBEEFU);
+
+  std::vector<std::uint8_t> const data{1, 2, 3, 4, 5};
+  hadesmem::procfs::WriteVector(process, buffer + 100, data);
+  BOOST_TEST(hadesmem::procfs::ReadVector<std::uint8_t>(
+               process, buffer + 100, data.size()) == data);
+
+  // Goes through /proc/<pid>/mem, which ignores the page protection.
+  hadesmem::procfs::Write(process, read_only, std::uint32_t{0x12345678});
+  BOOST_TEST_EQ(hadesmem::procfs::Read<std::uint32_t>(process, read_only),
+                0x12345678U);
+}
+
+void TestRegions(pid_t id, std::uint8_t* buffer, std::uint8_t* read_only)
+{
+  hadesmem::procfs::Process const process{id};
+
+  hadesmem::procfs::RegionList const regions{process};
+  BOOST_TEST(regions.size() > 0);
+  bool found_buffer = false;
+  void const* prev = nullptr;
+  bool sorted = true;
+  for (auto const& region : regions)
+  {
+    sorted = sorted && region.GetBase() > prev;
+    prev = region.GetBase();
+    auto const base = static_cast<std::uint8_t*>(region.GetBase());
+    if (buffer >= base && buffer < base + region.GetSize())
+    {
+      found_buffer = true;
+      BOOST_TEST_EQ(region.GetProtect() & (PROT_READ | PROT_WRITE),
+                    PROT_READ | PROT_WRITE);
+    }
+  }
+  BOOST_TEST(found_buffer);
+  BOOST_TEST(sorted);
+
+  hadesmem::procfs::Region const region{process, buffer + 1};
+  BOOST_TEST(region.GetBase() <= buffer);
+  BOOST_TEST_EQ(region.GetProtect() & PROT_EXEC, 0);
+  BOOST_TEST(region.IsPrivate());
+
+  hadesmem::procfs::Region const read_only_region{process, read_only};
+  BOOST_TEST_EQ(read_only_region.GetProtect(), PROT_READ);
+  BOOST_TEST(read_only_region != region);
+
+  bool found_exe = false;
+  for (auto const& r : regions)
+  {
+    found_exe = found_exe || ((r.GetProtect() & PROT_EXEC) &&
+                              r.GetPath().find('/') != std::string::npos);
+  }
+  BOOST_TEST(found_exe);
+
+  BOOST_TEST_THROWS(hadesmem::procfs::Region(process, nullptr),
+                    hadesmem::Error);
+}
+
+void TestFind(pid_t id, std::uint8_t* buffer, std::size_t size)
+{
+  hadesmem::procfs::Process const process{id};
+
+  // A run of the child's data long enough to be unique, which also spans a
+  // page boundary. Byte i and i + 256 are equal, so it is found twice.
+  std::size_t const page_size = static_cast<std::size_t>(::getpagesize());
+  std::size_t const offset = page_size - 8;
+  std::vector<std::uint8_t> needle;
+  for (std::size_t i = 0; i < 16; ++i)
+  {
+    needle.push_back(Expected(offset + i));
+  }
+  auto pattern = ToPatternString(needle);
+  pattern.replace(0, 2, L"??");
+
+  auto const address = static_cast<std::uint8_t*>(
+    hadesmem::procfs::Find(process,
+                           "",
+                           pattern,
+                           hadesmem::PatternFlags::kScanData,
+                           reinterpret_cast<std::uintptr_t>(buffer)));
+  BOOST_TEST(address != nullptr);
+  BOOST_TEST(address > buffer && address < buffer + size);
+  BOOST_TEST_EQ((address - buffer) % 256, offset % 256);
+
+  // Finds the next one after it when given it as the start address.
+  auto const next = static_cast<std::uint8_t*>(
+    hadesmem::procfs::Find(process,
+                           "",
+                           pattern,
+                           hadesmem::PatternFlags::kScanData,
+                           reinterpret_cast<std::uintptr_t>(address)));
+  BOOST_TEST_EQ(next, address + 256);
+
+  // Starting at the last byte of a region leaves nothing to scan.
+  hadesmem::procfs::Region const buffer_region{process, buffer};
+  auto const buffer_region_end =
+    static_cast<std::uint8_t*>(buffer_region.GetBase()) +
+    buffer_region.GetSize();
+  BOOST_TEST_THROWS(
+    hadesmem::procfs::Find(
+      process,
+      "",
+      pattern,
+      hadesmem::PatternFlags::kScanData,
+      reinterpret_cast<std::uintptr_t>(buffer_region_end - 1)),
+    hadesmem::Error);
+
+  // Not executable, so not found in code.
+  BOOST_TEST(hadesmem::procfs::Find(
+               process, "", pattern, hadesmem::PatternFlags::kNone, 0U) ==
+             nullptr);
+
+  // Random data is not anywhere in the child.
+  std::random_device rd;
+  std::vector<std::uint8_t> random;
+  for (std::size_t i = 0; i < 32; ++i)
+  {
+    random.push_back(static_cast<std::uint8_t>(rd()));
+  }
+  BOOST_TEST_THROWS(
+    hadesmem::procfs::Find(process,
+                           "",
+                           ToPatternString(random),
+                           hadesmem::PatternFlags::kScanData |
+                             hadesmem::PatternFlags::kThrowOnUnmatch,
+                           0U,
+                           "Random"),
+    hadesmem::Error);
+
+  // Code of the test itself, from its own executable mappings.
+  hadesmem::procfs::RegionList const regions{process};
+  std::string exe;
+  for (auto const& r : regions)
+  {
+    if ((r.GetProtect() & PROT_EXEC) &&
+        r.GetPath().find('/') != std::string::npos)
+    {
+      exe = r.GetPath();
+      break;
+    }
+  }
+  auto const module = hadesmem::procfs::detail::GetModuleInfo(process, exe);
+  BOOST_TEST(!module.code_regions.empty());
+  auto const code_beg = module.code_regions.front().first;
+  auto const code = hadesmem::procfs::ReadVector<std::uint8_t>(
+    process, code_beg + 64, 24);
+  auto const code_address = hadesmem::procfs::Find(
+    process,
+    exe.substr(exe.rfind('/') + 1),
+    ToPatternString(code),
+    hadesmem::PatternFlags::kRelativeAddress,
+    0U);
+  BOOST_TEST(code_address != nullptr);
+  BOOST_TEST(reinterpret_cast<std::uintptr_t>(code_address) <=
+             static_cast<std::uintptr_t>(code_beg - module.base) + 64);
+
+  // As on Windows, only the region containing the start address is scanned,
+  // so starting in code doesn't go on to find the data after it.
+  BOOST_TEST(hadesmem::procfs::Find(process,
+                                    "",
+                                    pattern,
+                                    hadesmem::PatternFlags::kScanData,
+                                    reinterpret_cast<std::uintptr_t>(
+                                      code_beg)) == nullptr);
+
+  BOOST_TEST_THROWS(
+    hadesmem::procfs::detail::GetModuleInfo(process, "not_a_module.so"),
+    hadesmem::Error);
+}
+
+// The generic headers provide the Linux backend under the usual names.
+void TestEntryPoints(pid_t id, std::uint8_t* buffer)
+{
+  hadesmem::Process const process{id};
+  BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(process, buffer + 5),
+                Expected(5));
+  auto const data = hadesmem::ReadVector<std::uint8_t>(process, buffer, 8);
+  BOOST_TEST_EQ(data[7], Expected(7));
+
+  hadesmem::RegionList const regions{process};
+  BOOST_TEST(regions.size() > 0);
+  hadesmem::Region const region{process, buffer};
+  BOOST_TEST(region.GetBase() <= buffer);
+
+  auto const address = static_cast<std::uint8_t*>(
+    hadesmem::Find(process,
+                   "",
+                   ToPatternString(data),
+                   hadesmem::PatternFlags::kScanData,
+                   reinterpret_cast<std::uintptr_t>(buffer)));
+  BOOST_TEST_EQ(address, buffer + 256);
+}
+
+int main()
+{
+  std::size_t const page_size = static_cast<std::size_t>(::getpagesize());
+  std::size_t const size = kNumPages * page_size;
+  void* const mem = ::mmap(nullptr,
+                           size + page_size,
+                           PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS,
+                           -1,
+                           0);
+  BOOST_TEST(mem != MAP_FAILED);
+  auto const buffer = static_cast<std::uint8_t*>(mem);
+  auto const read_only = buffer + size;
+  BOOST_TEST_EQ(::mprotect(read_only, page_size, PROT_READ), 0);
+
+  {
+    Child const child{buffer, size};
+    TestProcess(child.GetId());
+    TestRead(child.GetId(), buffer, size);
+    TestRegions(child.GetId(), buffer, read_only);
+    TestFind(child.GetId(), buffer, size);
+    TestEntryPoints(child.GetId(), buffer);
+    TestWrite(child.GetId(), buffer, read_only);
+  }
+
+  ::munmap(mem, size + page_size);
+
+  return boost::report_errors();
+}
@@ -0,0 +1,290 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/linux/snapshot.hpp>
+#include <hadesmem/linux/snapshot.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/snapshot_store.hpp>
+#include <hadesmem/linux/process.hpp>
+
+namespace
+{
+std::size_t const kNumPages = 8;
+
+std::uint8_t Expected(std::size_t i, std::uint8_t seed)
+{
+  return static_cast<std::uint8_t>(i * 7 + seed);
+}
+
+// Forked child which writes to its copy of a buffer when asked to, so that
+// the pages the parent sees changing are exactly the ones it asked for.
+class Child
+{
+public:
+  Child(std::uint8_t* buffer, std::size_t page_size)
+    : pid_{}, command_{-1}, reply_{-1}
+  {
+    int command[2];
+    int reply[2];
+    BOOST_TEST_EQ(::pipe(command), 0);
+    BOOST_TEST_EQ(::pipe(reply), 0);
+
+    pid_ = ::fork();
+    if (pid_ == 0)
+    {
+      ::close(command[1]);
+      ::close(reply[0]);
+      Serve(command[0], reply[1], buffer, page_size);
+    }
+
+    ::close(command[0]);
+    ::close(reply[1]);
+    command_ = command[1];
+    reply_ = reply[0];
+  }
+
+  Child(Child const&) = delete;
+  Child& operator=(Child const&) = delete;
+
+  ~Child()
+  {
+    ::close(command_);
+    ::close(reply_);
+    ::kill(pid_, SIGKILL);
+    ::waitpid(pid_, nullptr, 0);
+  }
+
+  pid_t GetId() const
+  {
+    return pid_;
+  }
+
+  // Rewrites the given page with a new seed.
+  void WritePage(std::size_t page, std::uint8_t seed)
+  {
+    std::uint8_t const command[2] = {static_cast<std::uint8_t>(page), seed};
+    BOOST_TEST_EQ(::write(command_, command, sizeof(command)), 2);
+    Wait();
+  }
+
+  // Maps and fills a new page, returning its address.
+  std::uint8_t* MapPage()
+  {
+    std::uint8_t const command[2] = {0xFF, 0};
+    BOOST_TEST_EQ(::write(command_, command, sizeof(command)), 2);
+    return Wait();
+  }
+
+private:
+  static void Serve(int command,
+                    int reply,
+                    std::uint8_t* buffer,
+                    std::size_t page_size)
+  {
+    for (;;)
+    {
+      std::uint8_t request[2];
+      if (::read(command, request, sizeof(request)) != 2)
+      {
+        ::_exit(0);
+      }
+
+      std::uint8_t* page = nullptr;
+      if (request[0] == 0xFF)
+      {
+        void* const mapping = ::mmap(nullptr,
+                                     page_size,
+                                     PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS,
+                                     -1,
+                                     0);
+        page = static_cast<std::uint8_t*>(mapping);
+        std::memset(page, 0x5A, page_size);
+      }
+      else
+      {
+        page = buffer + request[0] * page_size;
+        for (std::size_t i = 0; i < page_size; ++i)
+        {
+          page[i] = Expected(i, request[1]);
+        }
+      }
+
+      if (::write(reply, &page, sizeof(page)) != sizeof(page))
+      {
+        ::_exit(1);
+      }
+    }
+  }
+
+  std::uint8_t* Wait()
+  {
+    std::uint8_t* page = nullptr;
+    BOOST_TEST_EQ(::read(reply_, &page, sizeof(page)),
+                  static_cast<ssize_t>(sizeof(page)));
+    return page;
+  }
+
+  pid_t pid_;
+  int command_;
+  int reply_;
+};
+
+// Pages of [base, base + size) covered by the ranges.
+std::vector<std::size_t>
+  GetPages(std::vector<hadesmem::SnapshotRange> const& ranges,
+           std::uint8_t const* base,
+           std::size_t size,
+           std::size_t page_size)
+{
+  std::vector<std::size_t> pages;
+  for (std::size_t page = 0; page < size / page_size; ++page)
+  {
+    auto const address = base + page * page_size;
+    for (auto const& range : ranges)
+    {
+      auto const range_base = static_cast<std::uint8_t const*>(range.base);
+      if (address >= range_base && address < range_base + range.size)
+      {
+        pages.push_back(page);
+        break;
+      }
+    }
+  }
+  return pages;
+}
+
+bool PageMatches(hadesmem::procfs::Snapshot const& snapshot,
+                 std::uint8_t const* page,
+                 std::size_t page_size,
+                 std::uint8_t seed)
+{
+  auto const data =
+    static_cast<std::uint8_t const*>(snapshot.GetData(page, page_size));
+  if (!data)
+  {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < page_size; ++i)
+  {
+    if (data[i] != Expected(i, seed))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+void TestSnapshot(std::uint8_t* buffer, std::size_t page_size)
+{
+  std::size_t const size = kNumPages * page_size;
+  Child child{buffer, page_size};
+  for (std::size_t i = 0; i < kNumPages; ++i)
+  {
+    child.WritePage(i, 1);
+  }
+
+  hadesmem::procfs::Process const process{child.GetId()};
+  hadesmem::procfs::Snapshot snapshot{process};
+  BOOST_TEST_EQ(snapshot.GetGeneration(), 0UL);
+
+  auto const first = snapshot.Capture();
+  BOOST_TEST_EQ(first, 1UL);
+  BOOST_TEST_EQ(snapshot.GetStats().num_pages_read,
+                snapshot.GetStats().num_pages);
+  BOOST_TEST_EQ(snapshot.GetStats().num_pages_tracked, 0UL);
+  BOOST_TEST_EQ(
+    GetPages(snapshot.GetChangedSince(0), buffer, size, page_size).size(),
+    kNumPages);
+  BOOST_TEST(PageMatches(snapshot, buffer + 3 * page_size, page_size, 1));
+  BOOST_TEST(snapshot.GetData(nullptr, 1) == nullptr);
+
+  child.WritePage(2, 2);
+  child.WritePage(5, 3);
+  auto const second = snapshot.Capture();
+  BOOST_TEST_EQ(second, 2UL);
+  auto changed =
+    GetPages(snapshot.GetChangedSince(first), buffer, size, page_size);
+  BOOST_TEST_EQ(changed.size(), 2UL);
+  BOOST_TEST(changed.size() == 2 && changed[0] == 2 && changed[1] == 5);
+  BOOST_TEST(PageMatches(snapshot, buffer + 2 * page_size, page_size, 2));
+  BOOST_TEST(PageMatches(snapshot, buffer + 5 * page_size, page_size, 3));
+  BOOST_TEST(PageMatches(snapshot, buffer + 3 * page_size, page_size, 1));
+  if (snapshot.IsDirtyTrackingEnabled())
+  {
+    BOOST_TEST(snapshot.GetStats().num_pages_tracked != 0);
+    BOOST_TEST(snapshot.GetStats().num_pages_read <
+               snapshot.GetStats().num_pages);
+  }
+  else
+  {
+    BOOST_TEST_EQ(snapshot.GetStats().num_pages_read,
+                  snapshot.GetStats().num_pages);
+  }
+
+  // Rewriting a page with the same contents is not a change.
+  child.WritePage(5, 3);
+  child.WritePage(6, 4);
+  auto const third = snapshot.Capture();
+  changed = GetPages(snapshot.GetChangedSince(second), buffer, size, page_size);
+  BOOST_TEST(changed.size() == 1 && changed[0] == 6);
+  changed = GetPages(snapshot.GetChangedSince(first), buffer, size, page_size);
+  BOOST_TEST_EQ(changed.size(), 3UL);
+
+  // A full capture rereads everything but only reports actual changes.
+  auto const fourth = snapshot.Capture(true);
+  BOOST_TEST_EQ(snapshot.GetStats().num_pages_read,
+                snapshot.GetStats().num_pages);
+  BOOST_TEST(
+    GetPages(snapshot.GetChangedSince(third), buffer, size, page_size)
+      .empty());
+
+  // New mappings count as changed.
+  auto const mapped = child.MapPage();
+  snapshot.Capture();
+  auto const ranges = snapshot.GetChangedSince(fourth);
+  BOOST_TEST_EQ(GetPages(ranges, mapped, page_size, page_size).size(), 1UL);
+  auto const mapped_data =
+    static_cast<std::uint8_t const*>(snapshot.GetData(mapped, page_size));
+  BOOST_TEST(mapped_data != nullptr && mapped_data[0] == 0x5A &&
+             mapped_data[page_size - 1] == 0x5A);
+
+  hadesmem::procfs::Snapshot const moved{std::move(snapshot)};
+  BOOST_TEST_EQ(moved.GetGeneration(), 5UL);
+  BOOST_TEST(PageMatches(moved, buffer + 6 * page_size, page_size, 4));
+}
+
+int main()
+{
+  std::size_t const page_size = static_cast<std::size_t>(::getpagesize());
+  void* const buffer = ::mmap(nullptr,
+                              kNumPages * page_size,
+                              PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS,
+                              -1,
+                              0);
+  BOOST_TEST(buffer != MAP_FAILED);
+
+  TestSnapshot(static_cast<std::uint8_t*>(buffer), page_size);
+
+  ::munmap(buffer, kNumPages * page_size);
+  return boost::report_errors();
+}
@@ -0,0 +1,110 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/module_index.hpp>
+#include <hadesmem/module_index.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/self_path.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/process.hpp>
+
+void TestModuleIndex()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  std::vector<std::wstring> const patterns = {
+    L"90",
+    L"CC CC",
+    L"55 8B EC",
+    L"46 ?? 6E 64 50 61 74 74 65 72 6E",
+    L"?? ?? 00 00",
+    L"??",
+    L"11 22 33 44 55 66 77 88 99 AA BB CC DD EE FF",
+  };
+
+  for (auto const& module : {std::wstring{}, std::wstring{L"ntdll.dll"}})
+  {
+    hadesmem::ModuleIndex const index{process, module};
+    BOOST_TEST(!index.IsFromCache());
+
+    // Every query should give the same answer as a scan.
+    for (auto const& pattern : patterns)
+    {
+      for (std::uint32_t const flags :
+           {static_cast<std::uint32_t>(hadesmem::PatternFlags::kNone),
+            static_cast<std::uint32_t>(hadesmem::PatternFlags::kScanData),
+            static_cast<std::uint32_t>(
+              hadesmem::PatternFlags::kRelativeAddress)})
+      {
+        void* const expected =
+          hadesmem::Find(process, module, pattern, flags, 0U);
+        BOOST_TEST_EQ(index.Find(pattern, flags, 0U), expected);
+
+        if (!expected)
+        {
+          continue;
+        }
+
+        auto const all = index.FindAll(pattern, flags);
+        BOOST_TEST(pattern == L"??" || (!all.empty() && all[0] == expected));
+
+        std::uintptr_t const start =
+          !!(flags & hadesmem::PatternFlags::kRelativeAddress)
+            ? reinterpret_cast<std::uintptr_t>(expected)
+            : reinterpret_cast<std::uintptr_t>(expected) -
+                reinterpret_cast<std::uintptr_t>(index.GetBase());
+        BOOST_TEST_EQ(index.Find(pattern, flags, start),
+                      hadesmem::Find(process, module, pattern, flags, start));
+      }
+    }
+
+    BOOST_TEST_THROWS(
+      index.Find(L"11 22 33 44 55 66 77 88 99 AA BB CC DD EE FF",
+                 hadesmem::PatternFlags::kThrowOnUnmatch,
+                 0U),
+      hadesmem::Error);
+
+    auto const buf = index.Serialize();
+    hadesmem::ModuleIndex const index_loaded{buf.data(), buf.size()};
+    BOOST_TEST_EQ(index_loaded.GetBase(), index.GetBase());
+    BOOST_TEST_EQ(index_loaded.Find(L"55 8B EC", 0U, 0U),
+                  index.Find(L"55 8B EC", 0U, 0U));
+
+    auto bad_buf = buf;
+    bad_buf.resize(bad_buf.size() - 1);
+    BOOST_TEST_THROWS(hadesmem::ModuleIndex(bad_buf.data(), bad_buf.size()),
+                      hadesmem::Error);
+  }
+
+  // The first load builds the cache, the second uses it.
+  std::wstring const cache_path =
+    hadesmem::detail::GetSelfPath() + L".module_index";
+  ::DeleteFileW(cache_path.c_str());
+  hadesmem::ModuleIndex const index_built{process, L"", cache_path};
+  BOOST_TEST(!index_built.IsFromCache());
+  hadesmem::ModuleIndex const index_cached{process, L"", cache_path};
+  BOOST_TEST(index_cached.IsFromCache());
+  BOOST_TEST_EQ(index_cached.Find(L"90", 0U, 0U),
+                hadesmem::Find(process, L"", L"90", 0U, 0U));
+
+  // A cache built for a different module is rebuilt.
+  hadesmem::ModuleIndex const index_other{process, L"ntdll.dll", cache_path};
+  BOOST_TEST(!index_other.IsFromCache());
+  ::DeleteFileW(cache_path.c_str());
+}
+
+int main()
+{
+  TestModuleIndex();
+  return boost::report_errors();
+}
@@ -166,6 +166,139 @@ void TestPatchDetour2()
   BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x1337);
 }
 
+extern "C" int __stdcall ScratchStaticDetour(hadesmem::PatchDetourBase* patch,
+                                             int a,
+                                             float b,
+                                             void* c)
+{
+  BOOST_TEST_EQ(patch->GetContext(), &GetThisProcess());
+  BOOST_TEST_EQ(patch->GetRefCount().GetCount(), 1UL);
+  auto const orig = patch->GetTrampolineT<decltype(&Scratch)>();
+  BOOST_TEST_EQ(orig(a, b, c), 0x1337);
+  return 0x24242424;
+}
+
+void TestPatchDetourFast()
+{
+  auto volatile const scratch_fn = &Scratch;
+  auto& detour_3 = GetDetour3();
+  detour_3 = std::make_unique<hadesmem::PatchDetour<decltype(Scratch)>>(
+    GetThisProcess(),
+    scratch_fn,
+    &ScratchDetour,
+    &GetThisProcess(),
+    hadesmem::PatchDetourFlags::kFastGate);
+  detour_3->Apply();
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x42424242);
+  detour_3->Remove();
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x1337);
+  detour_3->Apply();
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x42424242);
+  detour_3 = nullptr;
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x1337);
+
+  detour_3 = std::make_unique<hadesmem::PatchDetour<decltype(Scratch)>>(
+    GetThisProcess(),
+    scratch_fn,
+    hadesmem::StaticDetour<decltype(&ScratchStaticDetour),
+                           &ScratchStaticDetour>{},
+    &GetThisProcess());
+  detour_3->Apply();
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x24242424);
+  BOOST_TEST_EQ(detour_3->GetRefCount().GetCount(), 0UL);
+  detour_3->Remove();
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x1337);
+  detour_3->Apply();
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x24242424);
+  detour_3 = nullptr;
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x1337);
+}
+
+void TestPatchDispatcher()
+{
+  using DispatcherT = hadesmem::PatchDispatcher<decltype(Scratch)>;
+
+  auto volatile const scratch_fn = &Scratch;
+  DispatcherT dispatcher{GetThisProcess(), scratch_fn};
+  dispatcher.Apply();
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x1337);
+
+  // Higher priorities run first, and each handler decides whether and how to
+  // call the next.
+  std::string order;
+  auto const id_1 = dispatcher.Register(
+    [&](DispatcherT::Next const& next, int a, float b, void* c)
+    {
+      order += '1';
+      return next(a, b, c) + 1;
+    });
+  dispatcher.Register(
+    [&](DispatcherT::Next const& next, int a, float b, void* c)
+    {
+      order += '2';
+      BOOST_TEST_EQ(a, -43);
+      return next(a + 1, b, c) * 2;
+    },
+    10);
+  dispatcher.Register(
+    [&](DispatcherT::Next const& /*next*/, int a, float b, void* c)
+    {
+      order += '3';
+      BOOST_TEST_EQ(c, static_cast<void*>(nullptr));
+      return a + static_cast<int>(b);
+    },
+    -10);
+  auto const id_4 = dispatcher.Register(
+    [&](DispatcherT::Next const& next, int a, float b, void* c)
+    {
+      order += '4';
+      return next(a - 1, b, c);
+    },
+    20);
+  BOOST_TEST_EQ(dispatcher.GetNumHandlers(), 4UL);
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), -78);
+  BOOST_TEST_EQ(order, "4213");
+
+  // Registering and unregistering doesn't touch the patch.
+  order.clear();
+  dispatcher.Unregister(id_4);
+  dispatcher.Unregister(id_1);
+  BOOST_TEST_THROWS(dispatcher.Unregister(id_1), hadesmem::Error);
+  BOOST_TEST(dispatcher.IsApplied());
+  BOOST_TEST_EQ(dispatcher.GetNumRetired(), 0UL);
+  BOOST_TEST_EQ(scratch_fn(-43, 2.f, nullptr), -80);
+  BOOST_TEST_EQ(order, "23");
+
+  // Updating the dispatcher from a handler doesn't wait on the call itself,
+  // so the replaced arrays are kept until it returns.
+  dispatcher.Register(
+    [&](DispatcherT::Next const& next, int a, float b, void* c)
+    {
+      BOOST_TEST_EQ(next.GetOriginal()(a, b, c), 0x1337);
+      BOOST_TEST_EQ(dispatcher.GetNumHandlers(), 3UL);
+      for (std::size_t i = 0; i < 20; ++i)
+      {
+        dispatcher.Unregister(dispatcher.Register(
+          [](DispatcherT::Next const& n, int x, float y, void* z)
+          {
+            return n(x, y, z);
+          }));
+      }
+      BOOST_TEST(!dispatcher.FreeRetired(0));
+      BOOST_TEST_EQ(dispatcher.GetNumRetired(), 40UL);
+      return 0x24242424;
+    },
+    30);
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x24242424);
+  BOOST_TEST_EQ(dispatcher.GetNumRetired(), 40UL);
+
+  dispatcher.Remove();
+  BOOST_TEST_EQ(scratch_fn(-42, 2.f, nullptr), 0x1337);
+  BOOST_TEST(dispatcher.WaitForQuiescence(0));
+  BOOST_TEST_EQ(dispatcher.GetNumRetired(), 0UL);
+  BOOST_TEST(dispatcher.FreeRetired(0));
+}
+
 void TestPatchRaw()
 {
   hadesmem::Process const& process = GetThisProcess();
@@ -490,6 +623,57 @@ void TestPatchIat()
   TestGetLastErrorOrig();
 }
 
+__declspec(noinline) void TestGetCurrentProcessIdOrig()
+{
+  BOOST_TEST_NE(::GetCurrentProcessId(), 0x1338UL);
+}
+
+__declspec(noinline) void TestGetCurrentProcessIdHooked()
+{
+  BOOST_TEST_EQ(::GetCurrentProcessId(), 0x1338UL);
+}
+
+void TestPatchIatSet()
+{
+  hadesmem::Process const& process = GetThisProcess();
+  TestGetLastErrorOrig();
+  TestGetCurrentProcessIdOrig();
+  auto const get_last_error_detour =
+    [](hadesmem::PatchDetourBase* patch) -> DWORD
+  {
+    (void)patch;
+    return 0x1337UL;
+  };
+  auto const get_current_process_id_detour =
+    [](hadesmem::PatchDetourBase* patch) -> DWORD
+  {
+    (void)patch;
+    return 0x1338UL;
+  };
+  hadesmem::PatchIatSet patch_set{process};
+  auto const get_last_error_index =
+    patch_set.Add<decltype(&::GetLastError)>(
+      L"kernel32.dll", "GetLastError", get_last_error_detour);
+  auto const get_current_process_id_index =
+    patch_set.Add<decltype(&::GetCurrentProcessId)>(
+      L"KERNEL32.DLL", "GetCurrentProcessId", get_current_process_id_detour);
+  BOOST_TEST_EQ(patch_set.GetNumEntries(), 2UL);
+  patch_set.Apply();
+  BOOST_TEST(patch_set.GetNumPatches(get_last_error_index) != 0);
+  BOOST_TEST(patch_set.GetNumPatches(get_current_process_id_index) != 0);
+  TestGetLastErrorHooked();
+  TestGetCurrentProcessIdHooked();
+  patch_set.Remove();
+  TestGetLastErrorOrig();
+  TestGetCurrentProcessIdOrig();
+  patch_set.Apply();
+  TestGetLastErrorHooked();
+  TestGetCurrentProcessIdHooked();
+  patch_set.Remove();
+  TestGetLastErrorOrig();
+  TestGetCurrentProcessIdOrig();
+}
+
 int main()
 {
   TestPatchRaw();
@@ -497,6 +681,9 @@ int main()
   TestPatchInt3();
   TestPatchDr();
   TestPatchDetour2();
+  TestPatchDetourFast();
+  TestPatchDispatcher();
   TestPatchIat();
+  TestPatchIatSet();
   return boost::report_errors();
 }
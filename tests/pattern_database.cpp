@@ -0,0 +1,124 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/pattern_database.hpp>
+#include <hadesmem/pattern_database.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/self_path.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/find_pattern.hpp>
+#include <hadesmem/process.hpp>
+
+void TestPatternDatabase()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  std::wstring const pattern_file_data = LR"(
+<?xml version="1.0" encoding="utf-8"?>
+<HadesMem>
+  <FindPattern>
+    <Flag Name="RelativeAddress"/>
+    <Flag Name="ThrowOnUnmatch"/>
+    <Pattern Name="First Call" Data="E8">
+      <Manipulator Name="Add" Operand1="1"/>
+      <Manipulator Name="Rel" Operand1="5" Operand2="1"/>
+    </Pattern>
+    <Pattern Name="Zeros New" Data="00 ?? 00">
+      <Manipulator Name="Add" Operand1="1"/>
+      <Manipulator Name="Sub" Operand1="1"/>
+    </Pattern>
+    <Pattern Name="Nop Other" Data="90"/>
+    <Pattern Name="Nop Second" Data="90" Start="Nop Other"/>
+    <Pattern Name="FindPattern String" Data="46 ?? 6E 64 50 61 74 74 65 72 6E">
+      <Flag Name="ScanData"/>
+    </Pattern>
+  </FindPattern>
+  <FindPattern Module="ntdll.dll">
+    <Pattern Name="Two Nop" Data="90 90"/>
+    <Pattern Name="Two Nop Next" Data="??" Start="Two Nop"/>
+    <Pattern Name="Two Nop 0x1000" Data="90 90" StartRVA="0x1000"/>
+    <Pattern Name="Two Nop NtClose" Data="90 90" StartExport="NtClose"/>
+    <Pattern Name="Nop Ordinal 1" Data="90" StartExport="#1"/>
+    <Pattern Name="Unmatched" Data="11 22 33 44 55 66 77 88 99 AA BB CC"/>
+  </FindPattern>
+</HadesMem>
+)";
+
+  // Loading the compiled file should give the same results as the XML.
+  hadesmem::FindPattern const find_pattern{process, pattern_file_data, true};
+  auto const database =
+    hadesmem::FindPattern::CompilePatternFile(pattern_file_data, true);
+  hadesmem::PatternDatabase const loaded{database.data(), database.size()};
+  BOOST_TEST_EQ(loaded.GetNumModules(), 2UL);
+  hadesmem::FindPattern const find_pattern_db{process, loaded};
+  BOOST_TEST(find_pattern_db == find_pattern);
+  BOOST_TEST_EQ(find_pattern_db.Lookup(L"ntdll.dll", L"Unmatched"),
+                static_cast<void*>(nullptr));
+
+  std::wstring const database_path =
+    hadesmem::detail::GetSelfPath() + L".pattern_database";
+  hadesmem::detail::BufferToFile(
+    database_path,
+    database.data(),
+    static_cast<std::streamsize>(database.size()));
+  {
+    hadesmem::PatternDatabase const mapped{database_path};
+    BOOST_TEST(hadesmem::FindPattern(process, mapped) == find_pattern);
+  }
+
+  auto truncated = database;
+  truncated.resize(truncated.size() - 1);
+  BOOST_TEST_THROWS(
+    hadesmem::PatternDatabase(truncated.data(), truncated.size()),
+    hadesmem::Error);
+  hadesmem::detail::BufferToFile(
+    database_path,
+    truncated.data(),
+    static_cast<std::streamsize>(truncated.size()));
+  BOOST_TEST_THROWS(hadesmem::PatternDatabase{database_path}, hadesmem::Error);
+  ::DeleteFileW(database_path.c_str());
+
+  // Unknown manipulator types are rejected up front, like start types.
+  auto bad_manipulator = database;
+  hadesmem::detail::PatternDbHeader header;
+  std::memcpy(&header, bad_manipulator.data(), sizeof(header));
+  BOOST_TEST(header.num_manipulators != 0);
+  std::uint32_t const bad_type = 0xFF;
+  std::memcpy(&bad_manipulator[header.manipulators_offset],
+              &bad_type,
+              sizeof(bad_type));
+  BOOST_TEST_THROWS(
+    hadesmem::PatternDatabase(bad_manipulator.data(), bad_manipulator.size()),
+    hadesmem::Error);
+
+  // Patterns can only start from patterns defined before them.
+  std::wstring const pattern_file_data_invalid = LR"(
+<?xml version="1.0" encoding="utf-8"?>
+<HadesMem>
+  <FindPattern>
+    <Pattern Name="Nop Second" Data="90" Start="Nop Other"/>
+    <Pattern Name="Nop Other" Data="90"/>
+  </FindPattern>
+</HadesMem>
+)";
+  BOOST_TEST_THROWS(
+    hadesmem::FindPattern::CompilePatternFile(pattern_file_data_invalid, true),
+    hadesmem::Error);
+}
+
+int main()
+{
+  TestPatternDatabase();
+  return boost::report_errors();
+}
@@ -4,8 +4,11 @@
 #include <hadesmem/pelib/import_dir_list.hpp>
 #include <hadesmem/pelib/import_dir_list.hpp>
 
+#include <cstdint>
+#include <cstring>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 #include <hadesmem/detail/warning_disable_prefix.hpp>
 #include <boost/detail/lightweight_test.hpp>
@@ -155,8 +158,61 @@ void TestImportDirList()
   BOOST_TEST(processed_one_import_dir);
 }
 
+// Thunks are 4 bytes in PE32 files and 8 bytes in PE32+ files, whatever our
+// own bitness.
+template <typename ThunkT>
+void TestImportThunksBitness(WORD magic, ThunkT ordinal_flag)
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  std::size_t const kNtOffset = 0x80;
+  DWORD const kThunksRva = 0x200;
+  DWORD const kNameRva = 0x300;
+  std::vector<std::uint8_t> file(0x400);
+  auto const dos_header = reinterpret_cast<IMAGE_DOS_HEADER*>(file.data());
+  dos_header->e_magic = IMAGE_DOS_SIGNATURE;
+  dos_header->e_lfanew = static_cast<LONG>(kNtOffset);
+  auto const nt_headers =
+    reinterpret_cast<IMAGE_NT_HEADERS32*>(&file[kNtOffset]);
+  nt_headers->Signature = IMAGE_NT_SIGNATURE;
+  nt_headers->OptionalHeader.Magic = magic;
+
+  ThunkT const thunks[] = {
+    static_cast<ThunkT>(ordinal_flag | 5), kNameRva, 0};
+  std::memcpy(&file[kThunksRva], thunks, sizeof(thunks));
+  WORD const hint = 7;
+  std::memcpy(&file[kNameRva], &hint, sizeof(hint));
+  std::memcpy(&file[kNameRva + sizeof(hint)], "Foo", 4);
+
+  hadesmem::PeFile const pe_file(process,
+                                 file.data(),
+                                 hadesmem::PeFileType::Data,
+                                 static_cast<DWORD>(file.size()));
+  BOOST_TEST_EQ(pe_file.Is64(), sizeof(ThunkT) == 8);
+
+  hadesmem::ImportThunkList const import_thunk_list{
+    process, pe_file, kThunksRva};
+  std::vector<hadesmem::ImportThunk> const import_thunks(
+    std::begin(import_thunk_list), std::end(import_thunk_list));
+  BOOST_TEST_EQ(import_thunks.size(), 2UL);
+  if (import_thunks.size() == 2)
+  {
+    BOOST_TEST_EQ(import_thunks[0].GetSize(), sizeof(ThunkT));
+    BOOST_TEST(import_thunks[0].ByOrdinal());
+    BOOST_TEST_EQ(import_thunks[0].GetOrdinal(), 5);
+    BOOST_TEST(!import_thunks[1].ByOrdinal());
+    BOOST_TEST_EQ(import_thunks[1].GetAddressOfData(), kNameRva);
+    BOOST_TEST_EQ(import_thunks[1].GetHint(), hint);
+    BOOST_TEST_EQ(import_thunks[1].GetName(), "Foo");
+  }
+}
+
 int main()
 {
   TestImportDirList();
+  TestImportThunksBitness<DWORD>(IMAGE_NT_OPTIONAL_HDR32_MAGIC,
+                                 IMAGE_ORDINAL_FLAG32);
+  TestImportThunksBitness<ULONGLONG>(IMAGE_NT_OPTIONAL_HDR64_MAGIC,
+                                     IMAGE_ORDINAL_FLAG64);
   return boost::report_errors();
 }
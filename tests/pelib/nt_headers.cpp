@@ -4,8 +4,11 @@
 #include <hadesmem/pelib/nt_headers.hpp>
 #include <hadesmem/pelib/nt_headers.hpp>
 
+#include <cstdint>
+#include <cstring>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 #include <hadesmem/detail/warning_disable_prefix.hpp>
 #include <boost/detail/lightweight_test.hpp>
@@ -19,6 +22,41 @@
 #include <hadesmem/process.hpp>
 #include <hadesmem/read.hpp>
 
+namespace
+{
+std::size_t const kNtOffset = 0x80;
+
+// Headers of a file with no sections, of either bitness.
+template <typename NtHeadersT>
+std::vector<std::uint8_t>
+  MakeFile(WORD machine, WORD magic, ULONGLONG image_base)
+{
+  std::vector<std::uint8_t> file(0x400);
+  auto const dos_header = reinterpret_cast<IMAGE_DOS_HEADER*>(file.data());
+  dos_header->e_magic = IMAGE_DOS_SIGNATURE;
+  dos_header->e_lfanew = static_cast<LONG>(kNtOffset);
+
+  auto const nt_headers = reinterpret_cast<NtHeadersT*>(&file[kNtOffset]);
+  auto& optional_header = nt_headers->OptionalHeader;
+  nt_headers->Signature = IMAGE_NT_SIGNATURE;
+  nt_headers->FileHeader.Machine = machine;
+  nt_headers->FileHeader.SizeOfOptionalHeader =
+    static_cast<WORD>(sizeof(optional_header));
+  optional_header.Magic = magic;
+  optional_header.ImageBase =
+    static_cast<decltype(optional_header.ImageBase)>(image_base);
+  optional_header.FileAlignment = 0x200;
+  optional_header.SizeOfImage = 0x1000;
+  optional_header.SizeOfHeaders = 0x400;
+  optional_header.SizeOfStackReserve = 0x100000;
+  optional_header.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+  optional_header.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG].VirtualAddress =
+    0x300;
+  optional_header.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG].Size = 0x1C;
+  return file;
+}
+}
+
 void TestNtHeaders()
 {
   hadesmem::Process const process(::GetCurrentProcessId());
@@ -73,9 +111,7 @@ void TestNtHeaders()
     cur_nt_headers.SetAddressOfEntryPoint(
       cur_nt_headers.GetAddressOfEntryPoint());
     cur_nt_headers.SetBaseOfCode(cur_nt_headers.GetBaseOfCode());
-#if defined(HADESMEM_DETAIL_ARCH_X86)
     cur_nt_headers.SetBaseOfData(cur_nt_headers.GetBaseOfData());
-#endif
     cur_nt_headers.SetImageBase(cur_nt_headers.GetImageBase());
     cur_nt_headers.SetSectionAlignment(cur_nt_headers.GetSectionAlignment());
     cur_nt_headers.SetFileAlignment(cur_nt_headers.GetFileAlignment());
@@ -142,8 +178,73 @@ void TestNtHeaders()
   }
 }
 
+// Only one of PE32 and PE32+ matches our own bitness, but both should work.
+void TestNtHeadersBitness(bool is_64)
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  ULONGLONG const image_base = is_64 ? 0x0000000140000000ULL : 0x00400000ULL;
+  auto file = is_64 ? MakeFile<IMAGE_NT_HEADERS64>(
+                        IMAGE_FILE_MACHINE_AMD64,
+                        IMAGE_NT_OPTIONAL_HDR64_MAGIC,
+                        image_base)
+                    : MakeFile<IMAGE_NT_HEADERS32>(
+                        IMAGE_FILE_MACHINE_I386,
+                        IMAGE_NT_OPTIONAL_HDR32_MAGIC,
+                        image_base);
+  auto const file_raw = file;
+
+  hadesmem::PeFile const pe_file(process,
+                                 file.data(),
+                                 hadesmem::PeFileType::Data,
+                                 static_cast<DWORD>(file.size()));
+  BOOST_TEST_EQ(pe_file.Is64(), is_64);
+
+  hadesmem::NtHeaders nt_headers(process, pe_file);
+  BOOST_TEST(nt_headers.IsValid());
+  BOOST_TEST_EQ(nt_headers.GetImageBase(), image_base);
+  BOOST_TEST_EQ(nt_headers.GetSizeOfImage(), 0x1000UL);
+  BOOST_TEST_EQ(nt_headers.GetSizeOfStackReserve(), 0x100000ULL);
+  BOOST_TEST_EQ(nt_headers.GetNumberOfRvaAndSizes(), 0x10UL);
+  BOOST_TEST_EQ(
+    nt_headers.GetDataDirectoryVirtualAddress(hadesmem::PeDataDir::Debug),
+    0x300UL);
+  BOOST_TEST_EQ(nt_headers.GetDataDirectorySize(hadesmem::PeDataDir::Debug),
+                0x1CUL);
+  BOOST_TEST_EQ(
+    hadesmem::RvaToVa(process, pe_file, 0x300),
+    static_cast<void*>(file.data() + 0x300));
+
+  // Writing back what was read leaves the file untouched.
+  nt_headers.UpdateWrite();
+  BOOST_TEST(file == file_raw);
+
+  nt_headers.SetImageBase(image_base + 0x10000);
+  nt_headers.SetBaseOfData(0x2000);
+  nt_headers.UpdateWrite();
+  nt_headers.UpdateRead();
+  BOOST_TEST_EQ(nt_headers.GetImageBase(), image_base + 0x10000);
+  BOOST_TEST_EQ(nt_headers.GetBaseOfData(), is_64 ? 0UL : 0x2000UL);
+  BOOST_TEST_EQ(hadesmem::GetRuntimeBase(process, pe_file),
+                image_base + 0x10000);
+
+  if (!is_64)
+  {
+    nt_headers.SetImageBase(0x100000000ULL);
+    BOOST_TEST_THROWS(nt_headers.UpdateWrite(), hadesmem::Error);
+    nt_headers.UpdateRead();
+  }
+
+  // The machine has to match the optional header.
+  nt_headers.SetMachine(static_cast<WORD>(is_64 ? IMAGE_FILE_MACHINE_I386
+                                                : IMAGE_FILE_MACHINE_AMD64));
+  BOOST_TEST(!nt_headers.IsValid());
+}
+
 int main()
 {
   TestNtHeaders();
+  TestNtHeadersBitness(false);
+  TestNtHeadersBitness(true);
   return boost::report_errors();
 }
@@ -36,6 +36,7 @@ void TestPeFile()
     process, ::GetModuleHandleW(nullptr), hadesmem::PeFileType::Image, 0);
   BOOST_TEST_EQ(pe_file_this.GetBase(), ::GetModuleHandle(nullptr));
   BOOST_TEST(pe_file_this.GetType() == hadesmem::PeFileType::Image);
+  BOOST_TEST_EQ(pe_file_this.Is64(), sizeof(void*) == 8);
   BOOST_TEST_EQ(hadesmem::RvaToVa(process, pe_file_this, 0),
                 static_cast<void*>(nullptr));
 
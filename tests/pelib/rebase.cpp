@@ -0,0 +1,325 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/pelib/rebase.hpp>
+#include <hadesmem/pelib/rebase.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+
+namespace
+{
+std::size_t const kPageSize = 0x1000;
+std::size_t const kNtOffset = 0x80;
+std::size_t const kFirstDataPage = 1;
+
+template <typename T>
+void Put(std::vector<std::uint8_t>& image, std::size_t offset, T value)
+{
+  std::memcpy(&image[offset], &value, sizeof(value));
+}
+
+// Offset of the i-th pointer in a data page. Spread over the page (including
+// an unaligned one) so that the fixups don't all land in one cache line.
+std::size_t GetPointerOffset(std::size_t i)
+{
+  return i * 0x101;
+}
+
+std::size_t const kPointersPerPage = 15;
+
+// Minimal mapped image with num_pages pages of pointers (to their own RVA),
+// each covered by a relocation block, followed by the relocation directory.
+// 32-bit images also get a HIGH/LOW pair at the end of each page.
+std::vector<std::uint8_t>
+  MakeImage(bool is_64, std::uint64_t base, std::size_t num_pages)
+{
+  std::size_t const reloc_rva = (kFirstDataPage + num_pages) * kPageSize;
+  std::size_t const block_size = 8 + (kPointersPerPage + 3) * 2;
+  std::size_t const reloc_size = num_pages * block_size;
+  std::vector<std::uint8_t> image(reloc_rva + reloc_size);
+
+  Put<std::uint16_t>(image, 0, 0x5A4D);
+  Put<std::uint32_t>(image, 0x3C, static_cast<std::uint32_t>(kNtOffset));
+  Put<std::uint32_t>(image, kNtOffset, 0x00004550);
+  std::size_t const optional = kNtOffset + 4 + 20;
+  Put<std::uint16_t>(image, optional, is_64 ? 0x20B : 0x10B);
+  if (is_64)
+  {
+    Put<std::uint64_t>(image, optional + 24, base);
+    Put<std::uint32_t>(image, optional + 108, 16);
+    Put<std::uint32_t>(
+      image, optional + 112 + 5 * 8, static_cast<std::uint32_t>(reloc_rva));
+    Put<std::uint32_t>(image,
+                       optional + 112 + 5 * 8 + 4,
+                       static_cast<std::uint32_t>(reloc_size));
+  }
+  else
+  {
+    Put<std::uint32_t>(image, optional + 28, static_cast<std::uint32_t>(base));
+    Put<std::uint32_t>(image, optional + 92, 16);
+    Put<std::uint32_t>(
+      image, optional + 96 + 5 * 8, static_cast<std::uint32_t>(reloc_rva));
+    Put<std::uint32_t>(image,
+                       optional + 96 + 5 * 8 + 4,
+                       static_cast<std::uint32_t>(reloc_size));
+  }
+
+  for (std::size_t page = 0; page < num_pages; ++page)
+  {
+    std::size_t const page_rva = (kFirstDataPage + page) * kPageSize;
+    std::size_t const block = reloc_rva + page * block_size;
+    Put<std::uint32_t>(image, block, static_cast<std::uint32_t>(page_rva));
+    Put<std::uint32_t>(
+      image, block + 4, static_cast<std::uint32_t>(block_size));
+
+    std::uint16_t const type = is_64 ? 10 : 3;
+    for (std::size_t i = 0; i < kPointersPerPage; ++i)
+    {
+      std::size_t const offset = GetPointerOffset(i);
+      std::uint64_t const pointer = base + page_rva + offset;
+      if (is_64)
+      {
+        Put<std::uint64_t>(image, page_rva + offset, pointer);
+      }
+      else
+      {
+        Put<std::uint32_t>(
+          image, page_rva + offset, static_cast<std::uint32_t>(pointer));
+      }
+      Put<std::uint16_t>(image,
+                         block + 8 + i * 2,
+                         static_cast<std::uint16_t>((type << 12) | offset));
+    }
+
+    // HIGH and LOW halves of a pointer, then an ABSOLUTE (padding) entry.
+    std::size_t const high = kPageSize - 4;
+    std::size_t const low = kPageSize - 2;
+    std::uint32_t const pointer = static_cast<std::uint32_t>(base + page_rva);
+    std::uint16_t const high_entry =
+      is_64 ? 0 : static_cast<std::uint16_t>((1 << 12) | high);
+    std::uint16_t const low_entry =
+      is_64 ? 0 : static_cast<std::uint16_t>((2 << 12) | low);
+    Put<std::uint16_t>(image,
+                       page_rva + high,
+                       static_cast<std::uint16_t>(is_64 ? 0 : pointer >> 16));
+    Put<std::uint16_t>(
+      image, page_rva + low, static_cast<std::uint16_t>(is_64 ? 0 : pointer));
+    Put<std::uint16_t>(image, block + 8 + kPointersPerPage * 2, high_entry);
+    Put<std::uint16_t>(image, block + 8 + kPointersPerPage * 2 + 2, low_entry);
+    Put<std::uint16_t>(image, block + 8 + kPointersPerPage * 2 + 4, 0);
+  }
+
+  return image;
+}
+
+std::size_t GetNumFixups(bool is_64, std::size_t num_pages)
+{
+  return num_pages * (kPointersPerPage + (is_64 ? 0 : 2));
+}
+}
+
+void TestRebase(bool is_64)
+{
+  std::uint64_t const old_base = is_64 ? 0x00007FF612340000ULL : 0x00400000;
+  std::uint64_t const new_base = is_64 ? 0x0000000180000000ULL : 0x10000000;
+  std::size_t const kNumPages = 3;
+
+  auto image = MakeImage(is_64, old_base, kNumPages);
+  auto const expected = MakeImage(is_64, new_base, kNumPages);
+  BOOST_TEST_EQ(hadesmem::GetImageBase(image.data(), image.size()), old_base);
+
+  BOOST_TEST_EQ(
+    hadesmem::RebaseImage(image.data(), image.size(), old_base, new_base),
+    GetNumFixups(is_64, kNumPages));
+  BOOST_TEST(image == expected);
+  BOOST_TEST_EQ(hadesmem::GetImageBase(image.data(), image.size()), new_base);
+
+  // Same base.
+  BOOST_TEST_EQ(
+    hadesmem::RebaseImage(image.data(), image.size(), new_base, new_base), 0UL);
+  BOOST_TEST(image == expected);
+
+  // Dumps from different bases are identical once unrelocated, and can be
+  // relocated again.
+  auto other = MakeImage(is_64, old_base, kNumPages);
+  hadesmem::UnrelocateImage(image.data(), image.size(), new_base);
+  hadesmem::UnrelocateImage(other.data(), other.size(), old_base);
+  BOOST_TEST(image == other);
+  BOOST_TEST(image == MakeImage(is_64, 0, kNumPages));
+  BOOST_TEST_EQ(hadesmem::GetImageBase(image.data(), image.size()), 0UL);
+  hadesmem::RebaseImage(image.data(), image.size(), 0, new_base);
+  BOOST_TEST(image == expected);
+}
+
+void TestRebaseParallel()
+{
+  std::size_t const kNumPages = 1000;
+  std::uint64_t const old_base = 0x0000000140000000ULL;
+  std::uint64_t const new_base = 0x00007FF700000000ULL;
+  auto sequential = MakeImage(true, old_base, kNumPages);
+  auto parallel = sequential;
+
+  BOOST_TEST_EQ(hadesmem::RebaseImage(
+                  sequential.data(), sequential.size(), old_base, new_base),
+                GetNumFixups(true, kNumPages));
+  BOOST_TEST_EQ(hadesmem::RebaseImage(
+                  parallel.data(), parallel.size(), old_base, new_base, 4),
+                GetNumFixups(true, kNumPages));
+  BOOST_TEST(sequential == parallel);
+  BOOST_TEST(sequential == MakeImage(true, new_base, kNumPages));
+
+  hadesmem::UnrelocateImage(parallel.data(), parallel.size(), new_base, 0);
+  BOOST_TEST(parallel == MakeImage(true, 0, kNumPages));
+}
+
+// Blocks which write to the same bytes must give the same result as applying
+// them in directory order, even when rebasing in parallel.
+void TestRebaseParallelOverlap()
+{
+  std::size_t const kNumPages = 200;
+  std::uint64_t const old_base = 0x0000000140000000ULL;
+  std::uint64_t const new_base = 0x00007FF700000000ULL;
+  std::size_t const reloc_rva = (kFirstDataPage + kNumPages) * kPageSize;
+  std::size_t const block_size = 8 + (kPointersPerPage + 3) * 2;
+  auto const original = MakeImage(true, old_base, kNumPages);
+
+  // A later block repeats the first block's page.
+  auto sequential = original;
+  Put<std::uint32_t>(sequential,
+                     reloc_rva + 150 * block_size,
+                     static_cast<std::uint32_t>(kFirstDataPage * kPageSize));
+  auto parallel = sequential;
+  hadesmem::RebaseImage(
+    sequential.data(), sequential.size(), old_base, new_base);
+  hadesmem::RebaseImage(
+    parallel.data(), parallel.size(), old_base, new_base, 4);
+  BOOST_TEST(sequential == parallel);
+
+  // A fixup at the end of the last page of one chunk of blocks spills into
+  // the pointer at the start of the next page (the first block of the next
+  // chunk). Replaces the padding entry.
+  sequential = original;
+  Put<std::uint16_t>(sequential,
+                     reloc_rva + 63 * block_size + 8 + kPointersPerPage * 2 + 4,
+                     static_cast<std::uint16_t>((10 << 12) | 0xFFC));
+  parallel = sequential;
+  BOOST_TEST_EQ(hadesmem::RebaseImage(
+                  sequential.data(), sequential.size(), old_base, new_base),
+                GetNumFixups(true, kNumPages) + 1);
+  BOOST_TEST_EQ(hadesmem::RebaseImage(
+                  parallel.data(), parallel.size(), old_base, new_base, 4),
+                GetNumFixups(true, kNumPages) + 1);
+  BOOST_TEST(sequential == parallel);
+}
+
+// A fixup may target the relocation directory itself. Later blocks must still
+// be applied as they were validated, rather than as rewritten by the fixup.
+void TestRebaseDirectoryFixup()
+{
+  std::uint64_t const old_base = 0x00400000;
+  // The low 16 bits of the delta turn the first entry of the second block
+  // from HIGHLOW at 0x000 into DIR64 at 0xFFF.
+  std::uint64_t const new_base = old_base + 0x7FFF;
+  std::size_t const kNumPages = 2;
+  std::size_t const reloc_rva = (kFirstDataPage + kNumPages) * kPageSize;
+  std::size_t const block_size = 8 + (kPointersPerPage + 3) * 2;
+  std::size_t const reloc_size = kNumPages * block_size;
+  std::size_t const hostile_size = 12;
+  auto const expected = MakeImage(false, new_base, kNumPages);
+
+  // Prepend a block which patches the first two entries of what follows.
+  auto image = MakeImage(false, old_base, kNumPages);
+  std::vector<std::uint8_t> const dir(image.begin() + reloc_rva, image.end());
+  image.resize(reloc_rva + hostile_size + reloc_size);
+  std::memcpy(&image[reloc_rva + hostile_size], dir.data(), dir.size());
+  Put<std::uint32_t>(image, reloc_rva, static_cast<std::uint32_t>(reloc_rva));
+  Put<std::uint32_t>(
+    image, reloc_rva + 4, static_cast<std::uint32_t>(hostile_size));
+  Put<std::uint16_t>(
+    image, reloc_rva + 8, static_cast<std::uint16_t>((3 << 12) | 20));
+  Put<std::uint16_t>(image, reloc_rva + 10, 0);
+  Put<std::uint32_t>(image,
+                     kNtOffset + 4 + 20 + 96 + 5 * 8 + 4,
+                     static_cast<std::uint32_t>(hostile_size + reloc_size));
+
+  BOOST_TEST_EQ(
+    hadesmem::RebaseImage(image.data(), image.size(), old_base, new_base),
+    GetNumFixups(false, kNumPages) + 1);
+  BOOST_TEST(std::equal(expected.begin() + kFirstDataPage * kPageSize,
+                        expected.begin() + reloc_rva,
+                        image.begin() + kFirstDataPage * kPageSize));
+}
+
+void TestRebaseInvalid()
+{
+  std::uint64_t const base = 0x00400000;
+  auto const original = MakeImage(false, base, 2);
+  std::size_t const reloc_rva = (kFirstDataPage + 2) * kPageSize;
+  std::size_t const block_size = 8 + (kPointersPerPage + 3) * 2;
+
+  // Unsupported type in the last block. Nothing is written, including the
+  // blocks before it.
+  auto image = original;
+  Put<std::uint16_t>(image, reloc_rva + block_size + 8, 0x4000);
+  auto const unsupported = image;
+  BOOST_TEST_THROWS(
+    hadesmem::RebaseImage(image.data(), image.size(), base, 0x10000000),
+    hadesmem::Error);
+  BOOST_TEST(image == unsupported);
+
+  // Block past the end of the directory.
+  image = original;
+  Put<std::uint32_t>(image, reloc_rva + 4, 0x10000);
+  BOOST_TEST_THROWS(
+    hadesmem::RebaseImage(image.data(), image.size(), base, 0x10000000),
+    hadesmem::Error);
+
+  // Target outside the image.
+  image = original;
+  Put<std::uint32_t>(image, reloc_rva, 0x7FFFF000);
+  BOOST_TEST_THROWS(
+    hadesmem::RebaseImage(image.data(), image.size(), base, 0x10000000),
+    hadesmem::Error);
+
+  // Relocations stripped.
+  image = original;
+  Put<std::uint16_t>(image, kNtOffset + 4 + 18, 0x0001);
+  BOOST_TEST_THROWS(
+    hadesmem::RebaseImage(image.data(), image.size(), base, 0x10000000),
+    hadesmem::Error);
+
+  // 32-bit image can't move above 4GB.
+  image = original;
+  BOOST_TEST_THROWS(
+    hadesmem::RebaseImage(image.data(), image.size(), base, 0x100000000ULL),
+    hadesmem::Error);
+
+  image = original;
+  image[0] = 0;
+  BOOST_TEST_THROWS(hadesmem::GetImageBase(image.data(), image.size()),
+                    hadesmem::Error);
+  BOOST_TEST_THROWS(hadesmem::GetImageBase(original.data(), 0x40),
+                    hadesmem::Error);
+}
+
+int main()
+{
+  TestRebase(false);
+  TestRebase(true);
+  TestRebaseParallel();
+  TestRebaseParallelOverlap();
+  TestRebaseDirectoryFixup();
+  TestRebaseInvalid();
+  return boost::report_errors();
+}
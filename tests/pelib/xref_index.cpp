@@ -0,0 +1,165 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/pelib/xref_index.hpp>
+#include <hadesmem/pelib/xref_index.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/filesystem.hpp>
+#include <hadesmem/detail/instruction_decoder.hpp>
+#include <hadesmem/detail/self_path.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/pelib/nt_headers.hpp>
+#include <hadesmem/pelib/pe_file.hpp>
+#include <hadesmem/process.hpp>
+
+void TestXrefBuilder()
+{
+  std::vector<std::uint8_t> const code = {
+    // 0x1000: call 0x100C
+    0xE8, 0x07, 0x00, 0x00, 0x00,
+    // 0x1005: mov rax, qword ptr [rip+0x10] (0x101C)
+    0x48, 0x8B, 0x05, 0x10, 0x00, 0x00, 0x00,
+    // 0x100C: jz 0x1000
+    0x74, 0xF2,
+    // 0x100E: ret
+    0xC3,
+    // 0x100F: int3
+    0xCC,
+    // 0x1010: junk which the linear sweep decodes as a call
+    0xE8,
+    // 0x1011: jmp 0x100C (only reachable via the hint)
+    0xEB, 0xF9,
+    0xCC, 0xCC,
+  };
+
+  hadesmem::detail::XrefImageInfo image;
+  image.is_64 = true;
+  image.image_size = 0x2000;
+  hadesmem::detail::XrefCodeRegion const region = {
+    0x1000, code.data(), code.size() - 5};
+  image.code.push_back(region);
+
+  auto const xrefs = hadesmem::detail::BuildXrefs(image, 1);
+  BOOST_TEST_EQ(xrefs.size(), 3UL);
+  BOOST_TEST_EQ(xrefs[0].from, 0x100CU);
+  BOOST_TEST_EQ(xrefs[0].to, 0x1000U);
+  BOOST_TEST(xrefs[0].type == hadesmem::XrefType::kJump);
+  BOOST_TEST_EQ(xrefs[1].from, 0x1000U);
+  BOOST_TEST_EQ(xrefs[1].to, 0x100CU);
+  BOOST_TEST(xrefs[1].type == hadesmem::XrefType::kCall);
+  BOOST_TEST_EQ(xrefs[2].from, 0x1005U);
+  BOOST_TEST_EQ(xrefs[2].to, 0x101CU);
+  BOOST_TEST(xrefs[2].type == hadesmem::XrefType::kRipRelative);
+
+  // Splitting into chunks (which start mid-instruction) must give the same
+  // result as a single sweep.
+  for (std::size_t chunk_size = 1; chunk_size <= code.size(); ++chunk_size)
+  {
+    BOOST_TEST(hadesmem::detail::BuildXrefs(image, 4, chunk_size) == xrefs);
+  }
+
+  // Relocations are added as is, and hints are followed by recursive descent.
+  image.code[0].size = code.size();
+  image.hints.push_back(0x1011);
+  hadesmem::Xref const absolute = {
+    0x1800, 0x1010, hadesmem::XrefType::kAbsolute};
+  image.extra.push_back(absolute);
+  auto const xrefs_hints = hadesmem::detail::BuildXrefs(image, 1);
+  BOOST_TEST_EQ(xrefs_hints.size(), 5UL);
+  BOOST_TEST(std::find(std::begin(xrefs_hints),
+                       std::end(xrefs_hints),
+                       absolute) != std::end(xrefs_hints));
+
+  auto const buf = hadesmem::detail::SerializeXrefs(xrefs_hints);
+  BOOST_TEST(hadesmem::detail::DeserializeXrefs(buf.data(), buf.size()) ==
+             xrefs_hints);
+  BOOST_TEST_THROWS(
+    hadesmem::detail::DeserializeXrefs(buf.data(), buf.size() - 1),
+    hadesmem::Error);
+  auto bad_buf = buf;
+  bad_buf[0] = 0;
+  BOOST_TEST_THROWS(
+    hadesmem::detail::DeserializeXrefs(bad_buf.data(), bad_buf.size()),
+    hadesmem::Error);
+}
+
+void TestXrefIndex()
+{
+  hadesmem::Process const process(::GetCurrentProcessId());
+
+  hadesmem::PeFile const pe_file(
+    process, ::GetModuleHandleW(nullptr), hadesmem::PeFileType::Image, 0);
+  hadesmem::NtHeaders const nt_headers(process, pe_file);
+  bool const is_64 = nt_headers.GetMachine() == IMAGE_FILE_MACHINE_AMD64;
+
+  hadesmem::XrefIndex const index(process, pe_file);
+  BOOST_TEST(index.size() != 0);
+  BOOST_TEST(std::is_sorted(std::begin(index), std::end(index)));
+
+  // Every branch should decode back to its target.
+  auto const base = static_cast<std::uint8_t const*>(pe_file.GetBase());
+  for (auto const& xref : index)
+  {
+    if (xref.type == hadesmem::XrefType::kAbsolute)
+    {
+      continue;
+    }
+
+    hadesmem::detail::InstructionInfo info;
+    BOOST_TEST(hadesmem::detail::DecodeInstruction(
+      base + xref.from, 16, is_64, info));
+    std::int64_t const target =
+      static_cast<std::int64_t>(xref.from) + info.len +
+      (xref.type == hadesmem::XrefType::kRipRelative ? info.disp : info.rel);
+    BOOST_TEST_EQ(target, static_cast<std::int64_t>(xref.to));
+
+    auto const refs = index.FindReferencesTo(xref.to);
+    BOOST_TEST(std::find(refs.first, refs.second, xref) != refs.second);
+  }
+
+  auto const refs_all =
+    index.FindReferencesToRange(0, nt_headers.GetSizeOfImage());
+  BOOST_TEST_EQ(
+    static_cast<std::size_t>(std::distance(refs_all.first, refs_all.second)),
+    index.size());
+
+  hadesmem::XrefIndex const index_single(process, pe_file, 1);
+  BOOST_TEST(std::equal(
+    std::begin(index), std::end(index), std::begin(index_single)));
+
+  // The same module indexed from disk should give the same result, as
+  // relocated pointers are converted back to RVAs.
+  auto file_buf =
+    hadesmem::detail::FileToBuffer(hadesmem::detail::GetSelfPath());
+  hadesmem::PeFile const pe_file_data(process,
+                                      file_buf.data(),
+                                      hadesmem::PeFileType::Data,
+                                      static_cast<DWORD>(file_buf.size()));
+  hadesmem::XrefIndex const index_data(process, pe_file_data);
+  BOOST_TEST_EQ(index_data.size(), index.size());
+  BOOST_TEST(std::equal(
+    std::begin(index), std::end(index), std::begin(index_data)));
+
+  auto const buf = index.Serialize();
+  hadesmem::XrefIndex const index_loaded(buf.data(), buf.size());
+  BOOST_TEST_EQ(index_loaded.size(), index.size());
+  BOOST_TEST(std::equal(
+    std::begin(index), std::end(index), std::begin(index_loaded)));
+}
+
+int main()
+{
+  TestXrefBuilder();
+  TestXrefIndex();
+  return boost::report_errors();
+}
@@ -0,0 +1,186 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/remote_arena.hpp>
+#include <hadesmem/remote_arena.hpp>
+
+#include <cstdint>
+#include <iterator>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/alloc.hpp>
+#include <hadesmem/call.hpp>
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+#include <hadesmem/write.hpp>
+
+namespace
+{
+DWORD_PTR TestCallee(DWORD_PTR a)
+{
+  return a + 1;
+}
+}
+
+void TestSizeClasses()
+{
+  BOOST_TEST_EQ(hadesmem::RemoteArena::GetSizeClass(1), 16UL);
+  BOOST_TEST_EQ(hadesmem::RemoteArena::GetSizeClass(16), 16UL);
+  BOOST_TEST_EQ(hadesmem::RemoteArena::GetSizeClass(17), 32UL);
+  BOOST_TEST_EQ(hadesmem::RemoteArena::GetSizeClass(4096), 4096UL);
+  BOOST_TEST_EQ(hadesmem::RemoteArena::GetSizeClass(4097), 0UL);
+}
+
+void TestAllocateFree()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+  hadesmem::RemoteArena arena{process};
+
+  // Allocations don't overlap, are aligned to their size class, and can be
+  // written and read.
+  std::set<std::uint8_t*> bases;
+  std::vector<void*> allocations;
+  for (SIZE_T i = 1; i < 1000; ++i)
+  {
+    SIZE_T const size = i % 300 + 1;
+    auto const base = static_cast<std::uint8_t*>(arena.AllocateRaw(size));
+    BOOST_TEST(base != nullptr);
+    BOOST_TEST_EQ(reinterpret_cast<std::uintptr_t>(base) %
+                    hadesmem::RemoteArena::GetSizeClass(size),
+                  0UL);
+    auto const next = bases.upper_bound(base);
+    BOOST_TEST(next == std::end(bases) ||
+               base + hadesmem::RemoteArena::GetSizeClass(size) <= *next);
+    bases.insert(base);
+    allocations.push_back(base);
+    hadesmem::Write(process, base, static_cast<std::uint8_t>(i));
+    BOOST_TEST_EQ(hadesmem::Read<std::uint8_t>(process, base),
+                  static_cast<std::uint8_t>(i));
+  }
+
+  auto stats = arena.GetStats();
+  BOOST_TEST_EQ(stats.num_allocs, 999UL);
+  BOOST_TEST_EQ(stats.num_live, 999UL);
+  BOOST_TEST_EQ(stats.num_chunks, 1UL);
+  BOOST_TEST(stats.num_remote_allocs < 10);
+  BOOST_TEST(stats.committed <= stats.reserved);
+  BOOST_TEST(stats.in_use <= stats.committed);
+
+  // Freed blocks are reused for the same size class.
+  void* const freed = allocations.back();
+  allocations.pop_back();
+  arena.Free(freed);
+  BOOST_TEST_EQ(arena.AllocateRaw(100), freed);
+  BOOST_TEST_THROWS(arena.Free(&stats), hadesmem::Error);
+
+  // Pools have the requested protection.
+  MEMORY_BASIC_INFORMATION mbi{};
+  void* const rw = arena.AllocateRaw(64, hadesmem::RemoteArenaPool::kReadWrite);
+  BOOST_TEST(::VirtualQuery(rw, &mbi, sizeof(mbi)));
+  BOOST_TEST_EQ(mbi.Protect, static_cast<DWORD>(PAGE_READWRITE));
+  void* const rx = arena.AllocateRaw(64, hadesmem::RemoteArenaPool::kExecute);
+  BOOST_TEST(::VirtualQuery(rx, &mbi, sizeof(mbi)));
+  BOOST_TEST_EQ(mbi.Protect, static_cast<DWORD>(PAGE_EXECUTE_READ));
+  hadesmem::Write(process, rx, std::uint32_t{0xC3C3C3C3});
+  BOOST_TEST_EQ(*static_cast<std::uint32_t*>(rx), 0xC3C3C3C3U);
+  BOOST_TEST_EQ(arena.GetStats().num_chunks, 2UL);
+
+  // Large allocations get their own region.
+  void* const large = arena.AllocateRaw(0x10000);
+  BOOST_TEST(::VirtualQuery(large, &mbi, sizeof(mbi)));
+  BOOST_TEST_EQ(mbi.AllocationBase, large);
+  BOOST_TEST_EQ(arena.GetStats().num_large, 1UL);
+  arena.Free(large);
+  BOOST_TEST_EQ(arena.GetStats().num_large, 0UL);
+
+  // Reset frees everything but keeps the chunks.
+  SIZE_T const reserved = arena.GetStats().reserved;
+  arena.Reset();
+  stats = arena.GetStats();
+  BOOST_TEST_EQ(stats.num_live, 0UL);
+  BOOST_TEST_EQ(stats.in_use, 0UL);
+  BOOST_TEST_EQ(stats.reserved, reserved);
+  BOOST_TEST_EQ(arena.AllocateRaw(16), static_cast<void*>(*bases.begin()));
+
+  arena.Release();
+  stats = arena.GetStats();
+  BOOST_TEST_EQ(stats.num_chunks, 0UL);
+  BOOST_TEST_EQ(stats.reserved, 0UL);
+}
+
+void TestAllocator()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+  hadesmem::RemoteArena arena{process};
+
+  {
+    hadesmem::Allocator allocator_1{arena.Allocate(100)};
+    BOOST_TEST(allocator_1.GetBase());
+    BOOST_TEST_EQ(allocator_1.GetSize(), 100UL);
+    BOOST_TEST_EQ(arena.GetStats().num_live, 1UL);
+
+    hadesmem::Allocator allocator_2{std::move(allocator_1)};
+    BOOST_TEST_EQ(allocator_1.GetBase(), static_cast<void*>(nullptr));
+    BOOST_TEST_EQ(arena.GetStats().num_live, 1UL);
+
+    hadesmem::Allocator allocator_3{arena.Allocate(100)};
+    BOOST_TEST_NE(allocator_2, allocator_3);
+    allocator_3.Free();
+    BOOST_TEST_EQ(arena.GetStats().num_live, 1UL);
+  }
+
+  BOOST_TEST_EQ(arena.GetStats().num_live, 0UL);
+  BOOST_TEST_EQ(arena.GetStats().num_frees, 2UL);
+}
+
+void TestCallSites()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+  hadesmem::RemoteArena arena{process};
+
+  std::vector<void*> addresses;
+  std::vector<hadesmem::CallConv> call_convs;
+  std::vector<std::vector<hadesmem::CallArg>> args;
+  for (DWORD_PTR i = 0; i < 3; ++i)
+  {
+    addresses.push_back(reinterpret_cast<void*>(&TestCallee));
+    call_convs.push_back(hadesmem::CallConv::kDefault);
+    args.push_back(std::vector<hadesmem::CallArg>{hadesmem::CallArg{i}});
+  }
+
+  std::vector<hadesmem::CallResultRaw> results;
+  hadesmem::CallMulti(process,
+                      std::begin(addresses),
+                      std::end(addresses),
+                      std::begin(call_convs),
+                      std::begin(args),
+                      std::back_inserter(results),
+                      &arena);
+  BOOST_TEST_EQ(results.size(), 3UL);
+  for (DWORD_PTR i = 0; i < results.size(); ++i)
+  {
+    BOOST_TEST_EQ(results[i].GetReturnValue<DWORD_PTR>(), i + 1);
+  }
+
+  auto const stats = arena.GetStats();
+  BOOST_TEST_EQ(stats.num_live, 0UL);
+  BOOST_TEST_EQ(stats.num_allocs, 2UL);
+  BOOST_TEST_EQ(stats.num_chunks, 2UL);
+}
+
+int main()
+{
+  TestSizeClasses();
+  TestAllocateFree();
+  TestAllocator();
+  TestCallSites();
+  return boost::report_errors();
+}
@@ -0,0 +1,87 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/detail/sharded_ref_count.hpp>
+#include <hadesmem/detail/sharded_ref_count.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/detour_ref_counter.hpp>
+
+void TestShardedRefCount()
+{
+  hadesmem::detail::ShardedRefCount ref_count;
+  BOOST_TEST_EQ(ref_count.GetCount(), 0UL);
+  BOOST_TEST(ref_count.WaitForQuiescence(0));
+
+  {
+    auto const ref_counter_1 =
+      hadesmem::detail::MakeDetourRefCounter(ref_count);
+    auto ref_counter_2 = hadesmem::detail::MakeDetourRefCounter(ref_count);
+    BOOST_TEST_EQ(ref_count.GetCount(), 2UL);
+    BOOST_TEST(!ref_count.WaitForQuiescence(0));
+
+    auto const ref_counter_3 = std::move(ref_counter_2);
+    BOOST_TEST_EQ(ref_count.GetCount(), 2UL);
+  }
+
+  BOOST_TEST_EQ(ref_count.GetCount(), 0UL);
+}
+
+void TestShardedRefCountThreads()
+{
+  hadesmem::detail::ShardedRefCount ref_count;
+
+  // Every thread holds a reference until released, so the count must be
+  // exact however the threads map onto shards.
+  std::uint32_t const kNumThreads = 16;
+  std::atomic<std::uint32_t> num_acquired{};
+  std::atomic<bool> release{false};
+  std::vector<std::thread> threads;
+  for (std::uint32_t i = 0; i < kNumThreads; ++i)
+  {
+    threads.emplace_back([&]()
+                         {
+                           auto const ref_counter =
+                             hadesmem::detail::MakeDetourRefCounter(ref_count);
+                           ++num_acquired;
+                           while (!release)
+                           {
+                             std::this_thread::yield();
+                           }
+                         });
+  }
+
+  while (num_acquired != kNumThreads)
+  {
+    std::this_thread::yield();
+  }
+
+  BOOST_TEST_EQ(ref_count.GetCount(), kNumThreads);
+  BOOST_TEST(!ref_count.WaitForQuiescence(10));
+
+  release = true;
+  BOOST_TEST(ref_count.WaitForQuiescence());
+  BOOST_TEST_EQ(ref_count.GetCount(), 0UL);
+
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+}
+
+int main()
+{
+  TestShardedRefCount();
+  TestShardedRefCountThreads();
+  return boost::report_errors();
+}
@@ -0,0 +1,133 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/shared_view.hpp>
+#include <hadesmem/shared_view.hpp>
+
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/error.hpp>
+#include <hadesmem/process.hpp>
+#include <hadesmem/read.hpp>
+#include <hadesmem/write.hpp>
+
+namespace
+{
+struct Values
+{
+  std::uint32_t data[64];
+};
+
+struct Published
+{
+  hadesmem::SeqLock lock;
+  Values values;
+};
+}
+
+void TestSharedView()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+
+  SIZE_T const kSize = 0x10000;
+  hadesmem::SharedView view{process, kSize};
+  BOOST_TEST(view.GetBase() != nullptr);
+  BOOST_TEST(view.GetRemoteBase() != nullptr);
+  BOOST_TEST(view.GetBase() != view.GetRemoteBase());
+  BOOST_TEST_EQ(view.GetSize(), kSize);
+
+  // Writes through either view are visible through the other.
+  auto const local = static_cast<std::uint32_t*>(view.GetBase());
+  auto const remote = static_cast<std::uint32_t*>(view.GetRemoteBase());
+  hadesmem::Write(process, remote + 1, 0xDEADBEEFUL);
+  BOOST_TEST_EQ(local[1], 0xDEADBEEFUL);
+  local[2] = 0x12345678UL;
+  BOOST_TEST_EQ(hadesmem::Read<std::uint32_t>(process, remote + 2),
+                0x12345678UL);
+
+  BOOST_TEST_EQ(view.RemoteToLocal(remote + 2), static_cast<void*>(local + 2));
+  BOOST_TEST_THROWS(view.RemoteToLocal(remote - 1), hadesmem::Error);
+  BOOST_TEST_THROWS(view.RemoteToLocal(remote + kSize / sizeof(*remote)),
+                    hadesmem::Error);
+
+  hadesmem::SharedView other{std::move(view)};
+  BOOST_TEST_EQ(view.GetRemoteBase(), static_cast<void*>(nullptr));
+  BOOST_TEST_EQ(other.GetRemoteBase(), static_cast<void*>(remote));
+  BOOST_TEST_EQ(other.RemoteToLocal(remote + 1),
+                static_cast<void*>(local + 1));
+
+  other.UnmapRemote();
+  BOOST_TEST_EQ(other.GetRemoteBase(), static_cast<void*>(nullptr));
+  MEMORY_BASIC_INFORMATION mbi{};
+  BOOST_TEST(::VirtualQuery(remote, &mbi, sizeof(mbi)));
+  BOOST_TEST_EQ(mbi.State, static_cast<DWORD>(MEM_FREE));
+  BOOST_TEST_EQ(local[1], 0xDEADBEEFUL);
+}
+
+void TestSeqLock()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+  hadesmem::SharedView view{process, sizeof(Published)};
+
+  // The writer publishes through the "target" view, and every copy the reader
+  // takes from the local view must come from a single update.
+  auto const writer_data = static_cast<Published*>(view.GetRemoteBase());
+  auto const reader_data = static_cast<Published const*>(view.GetBase());
+  bool volatile stop = false;
+  std::thread writer{[&]()
+                     {
+                       for (std::uint32_t i = 1; !stop; ++i)
+                       {
+                         hadesmem::BeginSeqLockWrite(writer_data->lock);
+                         for (auto& value : writer_data->values.data)
+                         {
+                           *static_cast<std::uint32_t volatile*>(&value) = i;
+                         }
+                         hadesmem::EndSeqLockWrite(writer_data->lock);
+                         std::this_thread::yield();
+                       }
+                     }};
+
+  std::size_t num_torn = 0;
+  for (std::size_t i = 0; i < 100000; ++i)
+  {
+    auto const values =
+      hadesmem::ReadSeqLocked(reader_data->lock, &reader_data->values);
+    for (auto const value : values.data)
+    {
+      if (value != values.data[0])
+      {
+        ++num_torn;
+        break;
+      }
+    }
+  }
+
+  stop = true;
+  writer.join();
+  BOOST_TEST_EQ(num_torn, 0UL);
+
+  // A writer which never finishes its update makes reads fail rather than
+  // return torn data.
+  hadesmem::BeginSeqLockWrite(writer_data->lock);
+  Values values;
+  BOOST_TEST(!hadesmem::TryReadSeqLocked(
+    reader_data->lock, &reader_data->values, &values, sizeof(values), 10));
+  hadesmem::EndSeqLockWrite(writer_data->lock);
+  BOOST_TEST(hadesmem::TryReadSeqLocked(
+    reader_data->lock, &reader_data->values, &values, sizeof(values), 10));
+}
+
+int main()
+{
+  TestSharedView();
+  TestSeqLock();
+  return boost::report_errors();
+}
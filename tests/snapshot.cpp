@@ -0,0 +1,124 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/snapshot.hpp>
+#include <hadesmem/snapshot.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+#include <hadesmem/detail/snapshot_store.hpp>
+#include <hadesmem/detail/winapi.hpp>
+#include <hadesmem/process.hpp>
+
+namespace
+{
+std::size_t const kNumPages = 4;
+
+// Pages of [base, base + size) covered by the ranges.
+std::vector<std::size_t>
+  GetPages(std::vector<hadesmem::SnapshotRange> const& ranges,
+           std::uint8_t const* base,
+           std::size_t size,
+           std::size_t page_size)
+{
+  std::vector<std::size_t> pages;
+  for (std::size_t page = 0; page < size / page_size; ++page)
+  {
+    auto const address = base + page * page_size;
+    for (auto const& range : ranges)
+    {
+      auto const range_base = static_cast<std::uint8_t const*>(range.base);
+      if (address >= range_base && address < range_base + range.size)
+      {
+        pages.push_back(page);
+        break;
+      }
+    }
+  }
+  return pages;
+}
+
+bool DataMatches(hadesmem::Snapshot const& snapshot,
+                 std::uint8_t const* address,
+                 std::size_t len)
+{
+  void const* const data = snapshot.GetData(address, len);
+  return data && !std::memcmp(data, address, len);
+}
+}
+
+void TestSnapshot()
+{
+  hadesmem::Process const process{::GetCurrentProcessId()};
+  std::size_t const page_size = hadesmem::detail::GetSystemInfo().dwPageSize;
+  std::size_t const size = kNumPages * page_size;
+
+  auto const watched = static_cast<std::uint8_t*>(
+    ::VirtualAlloc(nullptr,
+                   size,
+                   MEM_RESERVE | MEM_COMMIT | MEM_WRITE_WATCH,
+                   PAGE_READWRITE));
+  auto const plain = static_cast<std::uint8_t*>(
+    ::VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+  BOOST_TEST(watched != nullptr);
+  BOOST_TEST(plain != nullptr);
+  std::memset(watched, 0x11, size);
+  std::memset(plain, 0x22, size);
+
+  hadesmem::Snapshot snapshot{process};
+  BOOST_TEST_EQ(snapshot.GetGeneration(), 0ULL);
+
+  auto const first = snapshot.Capture();
+  BOOST_TEST_EQ(first, 1ULL);
+  BOOST_TEST_EQ(snapshot.GetStats().num_pages_tracked, 0UL);
+  auto const all = snapshot.GetChangedSince(0);
+  BOOST_TEST_EQ(GetPages(all, watched, size, page_size).size(), kNumPages);
+  BOOST_TEST_EQ(GetPages(all, plain, size, page_size).size(), kNumPages);
+  BOOST_TEST(DataMatches(snapshot, watched, size));
+  BOOST_TEST(DataMatches(snapshot, plain, size));
+  BOOST_TEST(snapshot.GetData(nullptr, 1) == nullptr);
+
+  watched[page_size + 1] = 0x33;
+  plain[2 * page_size + 2] = 0x44;
+  auto const second = snapshot.Capture();
+  BOOST_TEST_EQ(second, 2ULL);
+  BOOST_TEST(snapshot.GetStats().num_pages_tracked >= kNumPages);
+  auto const changed = snapshot.GetChangedSince(first);
+  auto const watched_pages = GetPages(changed, watched, size, page_size);
+  auto const plain_pages = GetPages(changed, plain, size, page_size);
+  BOOST_TEST(watched_pages.size() == 1 && watched_pages[0] == 1);
+  BOOST_TEST(plain_pages.size() == 1 && plain_pages[0] == 2);
+  BOOST_TEST(DataMatches(snapshot, watched, size));
+  BOOST_TEST(DataMatches(snapshot, plain, size));
+
+  // Writing the same value is not a change, in either kind of region.
+  watched[page_size + 1] = 0x33;
+  plain[2 * page_size + 2] = 0x44;
+  auto const third = snapshot.Capture(true);
+  BOOST_TEST_EQ(snapshot.GetStats().num_pages_tracked, 0UL);
+  auto const unchanged = snapshot.GetChangedSince(second);
+  BOOST_TEST(GetPages(unchanged, watched, size, page_size).empty());
+  BOOST_TEST(GetPages(unchanged, plain, size, page_size).empty());
+
+  hadesmem::Snapshot const moved{std::move(snapshot)};
+  BOOST_TEST_EQ(moved.GetGeneration(), third);
+  BOOST_TEST(DataMatches(moved, watched, size));
+
+  ::VirtualFree(watched, 0, MEM_RELEASE);
+  ::VirtualFree(plain, 0, MEM_RELEASE);
+}
+
+int main()
+{
+  TestSnapshot();
+  return boost::report_errors();
+}
@@ -0,0 +1,103 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/detail/spsc_ring_buffer.hpp>
+#include <hadesmem/detail/spsc_ring_buffer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+
+void TestSpscRingBufferBasic()
+{
+  hadesmem::detail::SpscRingBuffer<std::uint32_t, 8> ring;
+  BOOST_TEST_EQ(ring.GetCapacity(), 8UL);
+  BOOST_TEST_EQ(ring.GetSize(), 0UL);
+
+  std::uint32_t out[16] = {};
+  BOOST_TEST_EQ(ring.TryPopBatch(out, 16), 0UL);
+
+  // Wrap around the end of the buffer several times.
+  std::uint32_t next_push = 0;
+  std::uint32_t next_pop = 0;
+  for (std::size_t i = 0; i < 10; ++i)
+  {
+    while (ring.TryPush(next_push))
+    {
+      ++next_push;
+    }
+    BOOST_TEST_EQ(ring.GetSize(), 8UL);
+
+    std::size_t const count = ring.TryPopBatch(out, 5);
+    BOOST_TEST_EQ(count, 5UL);
+    for (std::size_t j = 0; j < count; ++j)
+    {
+      BOOST_TEST_EQ(out[j], next_pop++);
+    }
+  }
+
+  std::size_t const count = ring.TryPopBatch(out, 16);
+  BOOST_TEST_EQ(count, 3UL);
+  for (std::size_t j = 0; j < count; ++j)
+  {
+    BOOST_TEST_EQ(out[j], next_pop++);
+  }
+  BOOST_TEST_EQ(next_pop, next_push);
+}
+
+void TestSpscRingBufferThreaded()
+{
+  auto const ring =
+    std::make_unique<hadesmem::detail::SpscRingBuffer<std::uint32_t, 64>>();
+  std::uint32_t const kCount = 100000;
+
+  std::thread producer([&]()
+                       {
+    for (std::uint32_t i = 0; i < kCount;)
+    {
+      if (ring->TryPush(i))
+      {
+        ++i;
+      }
+      else
+      {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::uint32_t expected = 0;
+  bool in_order = true;
+  std::uint32_t out[16];
+  while (expected < kCount)
+  {
+    std::size_t const count = ring->TryPopBatch(out, 16);
+    if (!count)
+    {
+      std::this_thread::yield();
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      in_order = in_order && out[i] == expected;
+      ++expected;
+    }
+  }
+
+  producer.join();
+  BOOST_TEST(in_order);
+  BOOST_TEST_EQ(ring->GetSize(), 0UL);
+}
+
+int main()
+{
+  TestSpscRingBufferBasic();
+  TestSpscRingBufferThreaded();
+  return boost::report_errors();
+}
@@ -0,0 +1,195 @@
+// Copyright (C) 2010-2015 Joshua Boyce
+// See the file COPYING for copying permission.
+
+#include <hadesmem/detail/string_scan.hpp>
+#include <hadesmem/detail/string_scan.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <vector>
+
+#include <hadesmem/detail/warning_disable_prefix.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <hadesmem/detail/warning_disable_suffix.hpp>
+
+#include <hadesmem/config.hpp>
+
+namespace
+{
+using StringRecord =
+  std::tuple<std::size_t, std::size_t, hadesmem::detail::StringEncoding>;
+
+// Straightforward one-encoding-at-a-time reference implementation.
+void ScanStringsReference(std::vector<std::uint8_t> const& buf,
+                          std::size_t min_len,
+                          std::vector<StringRecord>& out)
+{
+  std::size_t start = 0;
+  std::size_t len = 0;
+  for (std::size_t i = 0; i <= buf.size(); ++i)
+  {
+    if (i < buf.size() && hadesmem::detail::IsStringScanPrintable(buf[i]))
+    {
+      start = len ? start : i;
+      ++len;
+    }
+    else
+    {
+      if (len >= min_len)
+      {
+        out.emplace_back(start, len, hadesmem::detail::StringEncoding::kAscii);
+      }
+      len = 0;
+    }
+  }
+
+  for (std::size_t align = 0; align < 2; ++align)
+  {
+    len = 0;
+    for (std::size_t i = align; i <= buf.size(); i += 2)
+    {
+      if (i + 1 < buf.size() &&
+          hadesmem::detail::IsStringScanPrintable(buf[i]) && buf[i + 1] == 0)
+      {
+        start = len ? start : i;
+        ++len;
+      }
+      else
+      {
+        if (len >= min_len)
+        {
+          out.emplace_back(
+            start, len, hadesmem::detail::StringEncoding::kUtf16Le);
+        }
+        len = 0;
+      }
+    }
+  }
+}
+
+void CheckScan(std::vector<std::uint8_t> const& buf, std::size_t min_len)
+{
+  std::vector<StringRecord> expected;
+  ScanStringsReference(buf, min_len, expected);
+
+  std::vector<StringRecord> actual;
+  hadesmem::detail::ScanStrings(
+    buf.data(),
+    buf.size(),
+    min_len,
+    [&](std::size_t offset,
+        std::size_t len,
+        hadesmem::detail::StringEncoding encoding)
+    {
+      actual.emplace_back(offset, len, encoding);
+    });
+
+  std::sort(std::begin(expected), std::end(expected));
+  std::sort(std::begin(actual), std::end(actual));
+  BOOST_TEST(expected == actual);
+}
+}
+
+void TestStringScanClassify()
+{
+  std::uint8_t block[64];
+  for (std::size_t base = 0; base < 256; base += 64)
+  {
+    for (std::size_t i = 0; i < 64; ++i)
+    {
+      block[i] = static_cast<std::uint8_t>(base + i);
+    }
+
+    std::uint64_t printable_scalar = 0;
+    std::uint64_t zero_scalar = 0;
+    hadesmem::detail::ClassifyStringBlockScalar(
+      block, printable_scalar, zero_scalar);
+    for (std::size_t i = 0; i < 64; ++i)
+    {
+      BOOST_TEST_EQ(((printable_scalar >> i) & 1) != 0,
+                    block[i] >= 0x20 && block[i] <= 0x7E);
+    }
+
+    if (hadesmem::detail::IsSsse3Supported())
+    {
+      std::uint64_t printable_simd = 0;
+      std::uint64_t zero_simd = 0;
+      hadesmem::detail::ClassifyStringBlockSsse3(
+        block, printable_simd, zero_simd);
+      BOOST_TEST_EQ(printable_simd, printable_scalar);
+      BOOST_TEST_EQ(zero_simd, zero_scalar);
+    }
+  }
+}
+
+void TestStringScanBasic()
+{
+  char const narrow[] = "\x01hello\x01hi\x01world";
+  std::vector<std::uint8_t> buf(std::begin(narrow), std::end(narrow) - 1);
+  std::vector<StringRecord> found;
+  hadesmem::detail::ScanStrings(
+    buf.data(),
+    buf.size(),
+    3,
+    [&](std::size_t offset,
+        std::size_t len,
+        hadesmem::detail::StringEncoding encoding)
+    {
+      found.emplace_back(offset, len, encoding);
+    });
+  std::vector<StringRecord> const expected = {
+    StringRecord(1, 5, hadesmem::detail::StringEncoding::kAscii),
+    StringRecord(10, 5, hadesmem::detail::StringEncoding::kAscii)};
+  BOOST_TEST(found == expected);
+
+  // Wide strings straddling block boundaries at both alignments.
+  for (std::size_t offset = 56; offset < 72; ++offset)
+  {
+    std::vector<std::uint8_t> wide_buf(160, 0xFF);
+    for (std::size_t i = 0; i < 8; ++i)
+    {
+      wide_buf[offset + i * 2] = static_cast<std::uint8_t>('a' + i);
+      wide_buf[offset + i * 2 + 1] = 0;
+    }
+    CheckScan(wide_buf, 3);
+    // Also check with the string running up to the end of the buffer.
+    wide_buf.resize(offset + 16);
+    CheckScan(wide_buf, 3);
+  }
+}
+
+void TestStringScanRandom()
+{
+  // Simple LCG so the test is deterministic.
+  std::uint32_t state = 0x12345678;
+  auto const next = [&]()
+  {
+    state = state * 1103515245U + 12345U;
+    return state >> 16;
+  };
+
+  for (std::size_t i = 0; i < 2000; ++i)
+  {
+    std::vector<std::uint8_t> buf(next() % 300);
+    for (auto& b : buf)
+    {
+      // Bias towards printable characters and zeros so that runs of both
+      // encodings are common.
+      auto const r = next() % 4;
+      b = static_cast<std::uint8_t>(
+        r == 0 ? 0 : (r == 3 ? next() % 256 : 0x20 + next() % 0x5F));
+    }
+    CheckScan(buf, 1 + next() % 5);
+  }
+}
+
+int main()
+{
+  TestStringScanClassify();
+  TestStringScanBasic();
+  TestStringScanRandom();
+  return boost::report_errors();
+}
@@ -116,6 +116,28 @@ void TestThisThread()
 
     {
       hadesmem::SuspendedProcess const suspend_process(::GetCurrentProcessId());
+      auto const& suspended_threads = suspend_process.GetThreads();
+      bool found_other = false;
+      for (auto const& suspended_thread : suspended_threads)
+      {
+        BOOST_TEST_NE(suspended_thread.GetId(), ::GetCurrentThreadId());
+        BOOST_TEST(suspended_thread.GetHandle() != nullptr);
+        if (suspended_thread.GetId() == other_thread.GetId())
+        {
+          found_other = true;
+          BOOST_TEST_EQ(hadesmem::SuspendThread(other_thread), 1UL);
+          BOOST_TEST_EQ(hadesmem::ResumeThread(other_thread), 2UL);
+        }
+      }
+      BOOST_TEST(found_other);
+    }
+
+    {
+      hadesmem::SuspendedThread const suspend_thread(
+        hadesmem::Thread(other_thread.GetId()));
+      BOOST_TEST_EQ(suspend_thread.GetThread().GetId(), other_thread.GetId());
+      BOOST_TEST_EQ(hadesmem::SuspendThread(other_thread), 1UL);
+      BOOST_TEST_EQ(hadesmem::ResumeThread(other_thread), 2UL);
     }
   }
 }